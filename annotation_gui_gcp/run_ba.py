@@ -334,7 +334,7 @@ def bundle_with_fixed_images(
     for point in reconstruction.points.values():
         p = ba.get_point(point.id)
         point.coordinates = [p.p[0], p.p[1], p.p[2]]
-        point.reprojection_errors = p.reprojection_errors
+        point.reprojection_errors = ba.get_point_reprojection_errors(point.id)
 
     chrono.lap("teardown")
 
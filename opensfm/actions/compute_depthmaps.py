@@ -18,5 +18,5 @@ def run_dataset(data: DataSet, subfolder, interactive) -> None:
     udataset = dataset.UndistortedDataSet(data, udata_path, io_handler=data.io_handler)
     udataset.config["interactive"] = interactive
     reconstructions = udataset.load_undistorted_reconstruction()
-    tracks_manager = udataset.load_undistorted_tracks_manager()
+    tracks_manager = udataset.load_undistorted_read_only_tracks_manager()
     dense.compute_depthmaps(udataset, tracks_manager, reconstructions[0])
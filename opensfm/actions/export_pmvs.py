@@ -38,9 +38,9 @@ def run_dataset(data: DataSet, points, image_list, output, undistorted) -> None:
     # load tracks for vis.dat
     try:
         if undistorted:
-            tracks_manager = udata.load_undistorted_tracks_manager()
+            tracks_manager = udata.load_undistorted_read_only_tracks_manager()
         else:
-            tracks_manager = data.load_tracks_manager()
+            tracks_manager = data.load_read_only_tracks_manager()
         image_graph = tracking.as_weighted_graph(tracks_manager)
     except IOError:
         image_graph = None
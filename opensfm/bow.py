@@ -1,9 +1,10 @@
 # pyre-unsafe
 import os.path
+from functools import lru_cache
 
 import cv2
 import numpy as np
-from opensfm import context
+from opensfm import context, pyfeatures
 
 
 class BagOfWords:
@@ -11,14 +12,31 @@ class BagOfWords:
         self.words = words
         self.frequencies = frequencies
         self.weights = np.log(frequencies.sum() / frequencies)
-        FLANN_INDEX_KDTREE = 1
-        flann_params = {"algorithm": FLANN_INDEX_KDTREE, "trees": 8, "checks": 300}
-        self.index = context.flann_Index(words, flann_params)
-
-    def map_to_words(self, descriptors, k, matcher_type="FLANN"):
-        if matcher_type == "FLANN":
-            params = {"checks": 200}
-            idx, dist = self.index.knnSearch(descriptors, k, params=params)
+        self._flann_index = None
+        self._tree = None
+
+    def flann_index(self):
+        if self._flann_index is None:
+            FLANN_INDEX_KDTREE = 1
+            flann_params = {"algorithm": FLANN_INDEX_KDTREE, "trees": 8, "checks": 300}
+            self._flann_index = context.flann_Index(self.words, flann_params)
+        return self._flann_index
+
+    def vocabulary_tree(self) -> pyfeatures.VocabularyTree:
+        if self._tree is None:
+            self._tree = pyfeatures.VocabularyTree(self.words)
+        return self._tree
+
+    def map_to_words(
+        self, descriptors, k, matcher_type="FLANN", num_threads=1, max_checks=200
+    ):
+        if matcher_type == "VOCABULARY_TREE":
+            idx = self.vocabulary_tree().nearest_words(
+                descriptors, k, max_checks=max_checks, num_threads=num_threads
+            )
+        elif matcher_type == "FLANN":
+            params = {"checks": max_checks}
+            idx, dist = self.flann_index().knnSearch(descriptors, k, params=params)
         else:
             matcher = cv2.DescriptorMatcher_create(matcher_type)
             matches = matcher.knnMatch(descriptors, self.words, k=k)
@@ -37,15 +55,22 @@ class BagOfWords:
             h2 = self.histogram(w2)
         return np.fabs(h1 - h2).sum()
 
+    def inverted_index(self) -> pyfeatures.BowIndex:
+        """Empty inverted file of images histograms, for retrieval."""
+        return pyfeatures.BowIndex(self.weights)
 
-def load_bow_words_and_frequencies(config):
+
+def bow_file_path(config) -> str:
     if config["bow_file"] == "bow_hahog_root_uchar_10000.npz":
         assert config["feature_type"] == "HAHOG"
         assert config["feature_root"]
         assert config["hahog_normalize_to_uchar"]
 
-    bow_file = os.path.join(context.BOW_PATH, config["bow_file"])
-    bow = np.load(bow_file)
+    return os.path.join(context.BOW_PATH, config["bow_file"])
+
+
+def load_bow_words_and_frequencies(config):
+    bow = np.load(bow_file_path(config))
     return bow["words"], bow["frequencies"]
 
 
@@ -61,5 +86,12 @@ def load_vlad_words_and_frequencies(config):
 
 
 def load_bows(config) -> BagOfWords:
-    words, frequencies = load_bow_words_and_frequencies(config)
-    return BagOfWords(words, frequencies)
+    """Load the BoW vocabulary, kept in cache as its search index is
+    built once per process."""
+    return _load_bows(bow_file_path(config))
+
+
+@lru_cache(1)
+def _load_bows(bow_file: str) -> BagOfWords:
+    bow = np.load(bow_file)
+    return BagOfWords(bow["words"], bow["frequencies"])
@@ -83,6 +83,9 @@ class OpenSfMConfig:
     hahog_peak_threshold: float = 0.00001
     hahog_edge_threshold: float = 10
     hahog_normalize_to_uchar: bool = True
+    # Remove features weaker than another one closer than this ratio of
+    # their scale (0 to disable)
+    hahog_non_maxima_suppression: float = 0.0
 
     ##################################
     # Params for general matching
@@ -116,8 +119,10 @@ class OpenSfMConfig:
     bow_words_to_match: int = 50
     # Number of matching features to check.
     bow_num_checks: int = 20
-    # Matcher type to assign words to features
+    # Matcher type to assign words to features (FLANN, VOCABULARY_TREE or an OpenCV matcher type)
     bow_matcher_type: str = "FLANN"
+    # Number of words to check when assigning words to features (FLANN and VOCABULARY_TREE)
+    bow_words_checks: int = 200
 
     ##################################
     # Params for VLAD matching
@@ -187,6 +192,10 @@ class OpenSfMConfig:
     robust_matching_calib_threshold: float = 0.004
     # Minimum number of matches to accept matches between two images
     robust_matching_min_match: int = 20
+    # Verify essential matrix hypotheses on random subsets of the matches first (SPRT)
+    robust_matching_use_sprt: bool = False
+    # Sampling of the essential matrix hypotheses: UNIFORM, or PROSAC to draw the matches with the closest descriptors first
+    robust_matching_sampling: str = "UNIFORM"
     # Outlier threshold for essential matrix estimation during incremental reconstruction in radians
     five_point_algo_threshold: float = 0.004
     # Minimum number of inliers for considering a two view reconstruction valid
@@ -219,6 +228,11 @@ class OpenSfMConfig:
     ##################################
     # Minimum number of features/images per track
     min_track_length: int = 2
+    # Save tracks in the binary (memory-mappable) format instead of text
+    tracks_binary_format: bool = False
+    # Load tracks with the read-only flat backend in the steps which only read
+    # them (depthmaps neighbors and PMVS export)
+    tracks_flat_backend: bool = False
     # Whether to use depth prior during BA
     use_depth_prior: bool = False
     # Depth prior default std deviation
@@ -273,6 +287,12 @@ class OpenSfMConfig:
     optimize_camera_parameters: bool = True
     # Maximum optimizer iterations.
     bundle_max_iterations: int = 100
+    # Bundle reconstructions having more shots than this by clusters of at most this many shots, solved in parallel (0 to disable)
+    bundle_partition_cluster_size: int = 0
+    # Maximum number of alternations between cluster and separator bundles in partitioned bundles
+    bundle_partition_max_iterations: int = 5
+    # Stop partitioned bundles when the separator bundle decreases the cost by less than this ratio
+    bundle_partition_tolerance: float = 1e-3
 
     # Retriangulate all points from time to time
     retriangulation: bool = True
@@ -280,6 +300,8 @@ class OpenSfMConfig:
     retriangulation_ratio: float = 1.2
     # Use analytic derivatives or auto-differentiated ones during bundle adjustment
     bundle_analytic_derivatives: bool = True
+    # Keep the bundle adjustment problem across the bundles of the incremental reconstruction
+    bundle_use_session: bool = True
     # Bundle after adding 'bundle_interval' cameras
     bundle_interval: int = 999999
     # Bundle when the number of points grows by this ratio
@@ -121,6 +121,12 @@ else:
         return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * rusage_unit
 
 
+def threads_per_process(processes: int) -> int:
+    """Threads of native code for each of the parallel processes, so that
+    they share the cores."""
+    return max(1, (os.cpu_count() or 1) // processes)
+
+
 def processes_that_fit_in_memory(desired: int, per_process: int) -> int:
     """Amount of parallel BoW process that fit in memory."""
     available_mem = memory_available()
@@ -5,7 +5,7 @@ import logging
 import os
 import pickle
 from io import BytesIO
-from typing import Any, Dict, IO, List, Optional, Tuple
+from typing import Any, Dict, IO, List, Optional, Tuple, Union
 
 import numpy as np
 from numpy.typing import NDArray
@@ -395,9 +395,23 @@ class DataSet(DataSetBase):
     def load_tracks_manager(
         self, filename: Optional[str] = None
     ) -> pymap.TracksManager:
-        """Return the tracks manager"""
-        with self.io_handler.open_rt(self._tracks_manager_file(filename)) as f:
-            return pymap.TracksManager.instanciate_from_string(f.read())
+        """Return the tracks manager (text or binary)"""
+        return load_tracks_manager_file(
+            self.io_handler, self._tracks_manager_file(filename)
+        )
+
+    def load_read_only_tracks_manager(
+        self, filename: Optional[str] = None
+    ) -> Union[pymap.TracksManager, pymap.FlatTracksManager]:
+        """Return the tracks manager, for steps that only read it.
+
+        The flat backend is used if 'tracks_flat_backend' is set.
+        """
+        return load_read_only_tracks_manager_file(
+            self.io_handler,
+            self._tracks_manager_file(filename),
+            self.config["tracks_flat_backend"],
+        )
 
     def tracks_exists(self, filename: Optional[str] = None) -> bool:
         return self.io_handler.isfile(self._tracks_manager_file(filename))
@@ -405,8 +419,12 @@ class DataSet(DataSetBase):
     def save_tracks_manager(
         self, tracks_manager: pymap.TracksManager, filename: Optional[str] = None
     ) -> None:
-        with self.io_handler.open_wt(self._tracks_manager_file(filename)) as fw:
-            fw.write(tracks_manager.as_string())
+        if self.config["tracks_binary_format"]:
+            with self.io_handler.open_wb(self._tracks_manager_file(filename)) as fw:
+                fw.write(tracks_manager.as_binary())
+        else:
+            with self.io_handler.open_wt(self._tracks_manager_file(filename)) as fw:
+                fw.write(tracks_manager.as_string())
 
     def _reconstruction_file(self, filename: Optional[str]) -> str:
         """Return path of reconstruction file"""
@@ -954,15 +972,30 @@ class UndistortedDataSet:
 
     def load_undistorted_tracks_manager(self) -> pymap.TracksManager:
         filename = os.path.join(self.data_path, "tracks.csv")
-        with self.io_handler.open_rt(filename) as f:
-            return pymap.TracksManager.instanciate_from_string(f.read())
+        return load_tracks_manager_file(self.io_handler, filename)
+
+    def load_undistorted_read_only_tracks_manager(
+        self,
+    ) -> Union[pymap.TracksManager, pymap.FlatTracksManager]:
+        """Return the undistorted tracks manager, for steps that only read it.
+
+        The flat backend is used if 'tracks_flat_backend' is set.
+        """
+        filename = os.path.join(self.data_path, "tracks.csv")
+        return load_read_only_tracks_manager_file(
+            self.io_handler, filename, self.config["tracks_flat_backend"]
+        )
 
     def save_undistorted_tracks_manager(
         self, tracks_manager: pymap.TracksManager
     ) -> None:
         filename = os.path.join(self.data_path, "tracks.csv")
-        with self.io_handler.open_wt(filename) as fw:
-            fw.write(tracks_manager.as_string())
+        if self.config["tracks_binary_format"]:
+            with self.io_handler.open_wb(filename) as fw:
+                fw.write(tracks_manager.as_binary())
+        else:
+            with self.io_handler.open_wt(filename) as fw:
+                fw.write(tracks_manager.as_string())
 
     def load_undistorted_reconstruction(self) -> List[types.Reconstruction]:
         filename = os.path.join(self.data_path, "reconstruction.json")
@@ -978,6 +1011,35 @@ class UndistortedDataSet:
             io.json_dump(io.reconstructions_to_json(reconstruction), fout, minify=True)
 
 
+def load_tracks_manager_file(
+    io_handler: io.IoFilesystemBase, path: str
+) -> pymap.TracksManager:
+    """Load a tracks manager file (text or binary).
+
+    Files of the local filesystem are read natively, binary ones being then
+    memory-mapped instead of going through Python memory.
+    """
+    if type(io_handler) is io.IoFilesystemDefault:
+        return pymap.TracksManager.instanciate_from_file(path)
+    with io_handler.open_rb(path) as f:
+        return pymap.TracksManager.instanciate_from_string(f.read())
+
+
+def load_read_only_tracks_manager_file(
+    io_handler: io.IoFilesystemBase, path: str, flat: bool
+) -> Union[pymap.TracksManager, pymap.FlatTracksManager]:
+    """Load a tracks manager file, as a FlatTracksManager if flat is set.
+
+    Binary files of the local filesystem are then used in place.
+    """
+    if not flat:
+        return load_tracks_manager_file(io_handler, path)
+    if type(io_handler) is io.IoFilesystemDefault:
+        return pymap.FlatTracksManager.instanciate_from_file(path)
+    with io_handler.open_rb(path) as f:
+        return pymap.FlatTracksManager.instanciate_from_string(f.read())
+
+
 def invent_reference_from_gps_and_gcp(
     data: DataSetBase, images: Optional[List[str]] = None
 ) -> geo.TopocentricConverter:
@@ -514,6 +514,8 @@ def extract_features_hahog(
         peak_threshold=config["hahog_peak_threshold"],
         edge_threshold=config["hahog_edge_threshold"],
         target_num_features=features_count,
+        non_maxima_suppression=config["hahog_non_maxima_suppression"],
+        num_threads=context.threads_per_process(config["processes"]),
     )
 
     if config["feature_root"]:
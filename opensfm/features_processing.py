@@ -9,7 +9,7 @@ from typing import Any, Dict, List, Optional, Tuple
 
 import numpy as np
 from opensfm import bow, features, io, log, masking, pygeometry, upright
-from opensfm.context import parallel_map
+from opensfm.context import parallel_map, threads_per_process
 from opensfm.dataset_base import DataSetBase
 
 
@@ -300,7 +300,11 @@ def detect(
         bows = bow.load_bows(data.config)
         n_closest = data.config["bow_words_to_match"]
         closest_words = bows.map_to_words(
-            f_sorted, n_closest, data.config["bow_matcher_type"]
+            f_sorted,
+            n_closest,
+            data.config["bow_matcher_type"],
+            threads_per_process(data.config["processes"]),
+            data.config["bow_words_checks"],
         )
         data.save_words(image, closest_words)
 
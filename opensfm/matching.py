@@ -68,7 +68,17 @@ def match_images_with_pairs(
 ) -> Dict[Tuple[str, str], List[Tuple[int, int]]]:
     """Perform pair matchings given pairs."""
     cameras = data.load_camera_models()
-    args = list(match_arguments(pairs, data, config_override, cameras, exifs, poses))
+    matcher_type = config_override.get("matcher_type", data.config["matcher_type"])
+    # Words matching of an image against all its candidates is done at once
+    batched = poses is None and matcher_type.upper() == "WORDS"
+    if batched:
+        args = list(
+            match_batch_arguments(pairs, data, config_override, cameras, exifs)
+        )
+    else:
+        args = list(
+            match_arguments(pairs, data, config_override, cameras, exifs, poses)
+        )
 
     # Perform all pair matchings in parallel
     start = timer()
@@ -78,7 +88,13 @@ def match_images_with_pairs(
     jobs_per_process = 2
     processes = context.processes_that_fit_in_memory(processes, mem_per_process)
     logger.info("Computing pair matching with %d processes" % processes)
-    matches = context.parallel_map(match_unwrap_args, args, processes, jobs_per_process)
+    if batched:
+        batches = context.parallel_map(match_batch_unwrap_args, args, processes, 1)
+        matches = [m for batch in batches for m in batch]
+    else:
+        matches = context.parallel_map(
+            match_unwrap_args, args, processes, jobs_per_process
+        )
     logger.info(
         "Matched {} pairs {} in {} seconds ({} seconds/pair).".format(
             len(pairs),
@@ -212,6 +228,50 @@ def match_unwrap_args(
     return im1, im2, matches
 
 
+def match_batch_arguments(
+    pairs: List[Tuple[str, str]],
+    data: DataSetBase,
+    config_override: Dict[str, Any],
+    cameras: Dict[str, pygeometry.Camera],
+    exifs: Dict[str, Any],
+) -> Generator[
+    Tuple[
+        str,
+        List[str],
+        Dict[str, pygeometry.Camera],
+        Dict[str, Any],
+        DataSetBase,
+        Dict[str, Any],
+    ],
+    None,
+    None,
+]:
+    """Generate arguments for parallel processing of the matching of each
+    image against all its candidates"""
+    candidates = {}
+    for im1, im2 in pairs:
+        candidates.setdefault(im1, []).append(im2)
+    for im1, ims2 in candidates.items():
+        yield im1, ims2, cameras, exifs, data, config_override
+
+
+def match_batch_unwrap_args(
+    args: Tuple[
+        str,
+        List[str],
+        Dict[str, pygeometry.Camera],
+        Dict[str, Any],
+        DataSetBase,
+        Dict[str, Any],
+    ],
+) -> List[Tuple[str, str, np.ndarray]]:
+    """Wrapper for parallel processing of the matching of an image against
+    all its candidates."""
+    log.setup()
+    im1, candidates, cameras, exifs, data, config_override = args
+    return match_words_batch(im1, candidates, cameras, exifs, data, config_override)
+
+
 def match_descriptors(
     im1: str,
     im2: str,
@@ -508,6 +568,7 @@ def match_robust(
         camera2,
         data,
         overriden_config,
+        input_is_masked,
     )
     time_robust_matching = timer() - t
 
@@ -548,10 +609,32 @@ def _match_robust_impl(
     camera2: pygeometry.Camera,
     data: DataSetBase,
     overriden_config: Dict[str, Any],
+    masked: bool = True,
 ) -> np.ndarray:
     """Perform robust geometry matching on a set of matched descriptors indexes."""
+    priors = None
+    use_prosac = overriden_config["robust_matching_sampling"].upper() == "PROSAC"
+    if use_prosac and len(matches) > 0:
+        segmentation_in_descriptor = overriden_config["matching_use_segmentation"]
+        features_data1 = feature_loader.instance.load_all_data(
+            data,
+            im1,
+            masked=masked,
+            segmentation_in_descriptor=segmentation_in_descriptor,
+        )
+        features_data2 = feature_loader.instance.load_all_data(
+            data,
+            im2,
+            masked=masked,
+            segmentation_in_descriptor=segmentation_in_descriptor,
+        )
+        assert features_data1 is not None and features_data2 is not None
+        priors = matches_priors(
+            features_data1.descriptors, features_data2.descriptors, matches
+        )
+
     # robust matching
-    rmatches = robust_match(p1, p2, camera1, camera2, matches, overriden_config)
+    rmatches = robust_match(p1, p2, camera1, camera2, matches, overriden_config, priors)
     rmatches = np.array([[a, b] for a, b in rmatches])
     return rmatches
 
@@ -581,7 +664,125 @@ def match(
             im1, im2, camera1, camera2, data, overriden_config
         )
     time_2d_matching = timer() - time_start
+    return _match_robust_and_unfilter(
+        im1,
+        im2,
+        p1,
+        p2,
+        matches,
+        matcher_type,
+        time_2d_matching,
+        camera1,
+        camera2,
+        data,
+        overriden_config,
+    )
 
+
+def match_words_batch(
+    im1: str,
+    candidates: List[str],
+    cameras: Dict[str, pygeometry.Camera],
+    exifs: Dict[str, Any],
+    data: DataSetBase,
+    config_override: Dict[str, Any],
+) -> List[Tuple[str, str, np.ndarray]]:
+    """Perform full matching (words+robust) of an image against candidates.
+
+    Descriptors of the image are matched against the ones of all the
+    candidates in a single native call, which shares the image's words.
+    """
+    # Override parameters
+    overriden_config = data.config.copy()
+    overriden_config.update(config_override)
+    segmentation_in_descriptor = overriden_config["matching_use_segmentation"]
+    results = {im2: np.array([]) for im2 in candidates}
+
+    def load(im: str) -> Optional[Tuple[Any, np.ndarray]]:
+        features_data = feature_loader.instance.load_all_data(
+            data, im, masked=True, segmentation_in_descriptor=segmentation_in_descriptor
+        )
+        words = feature_loader.instance.load_words(data, im, masked=True)
+        if (
+            features_data is None
+            or len(features_data.points) < 2
+            or features_data.descriptors is None
+            or words is None
+        ):
+            return None
+        return features_data, words
+
+    time_start = timer()
+    loaded1 = load(im1)
+    if loaded1 is None:
+        return [(im1, im2, results[im2]) for im2 in candidates]
+    features_data1, words1 = loaded1
+    valid_candidates, candidates_data = [], []
+    for im2 in candidates:
+        loaded2 = load(im2)
+        if loaded2 is not None:
+            valid_candidates.append(im2)
+            candidates_data.append(loaded2)
+
+    batch_matches = pyfeatures.match_using_words_batch(
+        features_data1.descriptors,
+        words1,
+        [features_data2.descriptors for features_data2, _ in candidates_data],
+        [words2 for _, words2 in candidates_data],
+        overriden_config["lowes_ratio"],
+        overriden_config["bow_num_checks"],
+        overriden_config["symmetric_matching"],
+        context.threads_per_process(overriden_config["processes"]),
+    )
+    time_2d_matching = (timer() - time_start) / max(1, len(valid_candidates))
+
+    camera1 = cameras[exifs[im1]["camera"]]
+    for im2, (features_data2, _), matches in zip(
+        valid_candidates, candidates_data, batch_matches
+    ):
+        camera2 = cameras[exifs[im2]["camera"]]
+        if overriden_config["matching_use_filters"]:
+            matches = apply_adhoc_filters(
+                data,
+                list(matches),
+                im1,
+                camera1,
+                features_data1.points,
+                im2,
+                camera2,
+                features_data2.points,
+            )
+        results[im2] = _match_robust_and_unfilter(
+            im1,
+            im2,
+            features_data1.points,
+            features_data2.points,
+            np.array(matches, dtype=int),
+            "WORDS",
+            time_2d_matching,
+            camera1,
+            camera2,
+            data,
+            overriden_config,
+        )
+    return [(im1, im2, results[im2]) for im2 in candidates]
+
+
+def _match_robust_and_unfilter(
+    im1: str,
+    im2: str,
+    p1: np.ndarray,
+    p2: np.ndarray,
+    matches: np.ndarray,
+    matcher_type: str,
+    time_2d_matching: float,
+    camera1: pygeometry.Camera,
+    camera2: pygeometry.Camera,
+    data: DataSetBase,
+    overriden_config: Dict[str, Any],
+) -> np.ndarray:
+    """Perform robust matching of a pair's descriptors matches, and return
+    them as indexes in the unmasked sets of features."""
     symmetric = "symmetric" if overriden_config["symmetric_matching"] else "one-way"
     robust_matching_min_match = overriden_config["robust_matching_min_match"]
     if len(matches) < robust_matching_min_match:
@@ -606,7 +807,7 @@ def match(
     if m1 is not None and m2 is not None:
         rmatches = unfilter_matches(rmatches, m1, m2)
 
-    time_total = timer() - time_start
+    time_total = time_2d_matching + timer() - t
 
     logger.debug(
         "Matching {} and {}.  Matcher: {} ({}) "
@@ -648,7 +849,10 @@ def match_words(
     """
     ratio = config["lowes_ratio"]
     num_checks = config["bow_num_checks"]
-    return pyfeatures.match_using_words(f1, words1, f2, words2[:, 0], ratio, num_checks)
+    num_threads = context.threads_per_process(config["processes"])
+    return pyfeatures.match_using_words(
+        f1, words1, f2, words2[:, 0], ratio, num_checks, num_threads
+    )
 
 
 def match_words_symmetric(
@@ -727,10 +931,8 @@ def match_brute_force(
     """
     assert f1.dtype.type == f2.dtype.type
     if f1.dtype.type == np.uint8:
-        matcher_type = "BruteForce-Hamming"
-    else:
-        matcher_type = "BruteForce"
-    matcher = cv2.DescriptorMatcher_create(matcher_type)
+        return match_hamming(f1, f2, config, maskij, symmetric=False)
+    matcher = cv2.DescriptorMatcher_create("BruteForce")
     matcher.add([f2])
     if maskij is not None:
         matches = matcher.knnMatch(f1, k=2, masks=np.array([maskij]).astype(np.uint8))
@@ -752,6 +954,34 @@ def _convert_matches_to_vector(matches: List[Any]) -> List[Tuple[int, int]]:
     return [(mm.queryIdx, mm.trainIdx) for mm in matches]
 
 
+def match_hamming(
+    f1: np.ndarray,
+    f2: np.ndarray,
+    config: Dict[str, Any],
+    maskij: Optional[np.ndarray] = None,
+    symmetric: bool = False,
+) -> List[Tuple[int, int]]:
+    """Brute force matching of binary descriptors and Lowe's ratio filtering.
+
+    Args:
+        f1: binary feature descriptors of the first image
+        f2: binary feature descriptors of the second image
+        config: config parameters
+        maskij: optional boolean mask of len(i descriptors) x len(j descriptors)
+        symmetric: only keep matches found in both directions
+    """
+    mask = maskij if maskij is not None else np.empty((0, 0), dtype=np.uint8)
+    matches = pyfeatures.match_hamming(
+        f1,
+        f2,
+        config["lowes_ratio"],
+        symmetric,
+        mask,
+        context.threads_per_process(config["processes"]),
+    )
+    return [(i, j) for i, j in matches.tolist()]
+
+
 def match_brute_force_symmetric(
     fi: np.ndarray,
     fj: np.ndarray,
@@ -766,6 +996,8 @@ def match_brute_force_symmetric(
         config: config parameters
         maskij: optional boolean mask of len(i descriptors) x len(j descriptors)
     """
+    if fi.dtype.type == np.uint8 and fj.dtype.type == np.uint8:
+        return match_hamming(fi, fj, config, maskij, symmetric=True)
     matches_ij = [(a, b) for a, b in match_brute_force(fi, fj, config, maskij)]
     maskijT = maskij.T if maskij is not None else None
     matches_ji = [(b, a) for a, b in match_brute_force(fj, fi, config, maskijT)]
@@ -860,6 +1092,23 @@ def compute_inliers_bearing_epipolar(
     return mask
 
 
+def matches_priors(d1: np.ndarray, d2: np.ndarray, matches: np.ndarray) -> np.ndarray:
+    """Priors of matches for PROSAC sampling, the bigger the better.
+
+    They are the opposite of the distances between the matched descriptors,
+    Hamming ones for binary descriptors.
+    """
+    md1 = d1[matches[:, 0]]
+    md2 = d2[matches[:, 1]]
+    if md1.dtype == np.uint8:
+        distances = np.unpackbits(md1 ^ md2, axis=1).sum(axis=1)
+    else:
+        distances = np.linalg.norm(
+            md1.astype(np.float32) - md2.astype(np.float32), axis=1
+        )
+    return -distances.astype(np.float64)
+
+
 def robust_match_calibrated(
     p1: np.ndarray,
     p2: np.ndarray,
@@ -867,8 +1116,12 @@ def robust_match_calibrated(
     camera2: pygeometry.Camera,
     matches: np.ndarray,
     config: Dict[str, Any],
+    priors: Optional[np.ndarray] = None,
 ) -> np.ndarray:
-    """Filter matches by estimating the Essential matrix via RANSAC."""
+    """Filter matches by estimating the Essential matrix via RANSAC.
+
+    Matches are sampled by decreasing priors (PROSAC) when given.
+    """
 
     if len(matches) < 8:
         return np.array([])
@@ -879,7 +1132,15 @@ def robust_match_calibrated(
     b2 = camera2.pixel_bearing_many(p2)
 
     threshold = config["robust_matching_calib_threshold"]
-    T = multiview.relative_pose_ransac(b1, b2, threshold, 1000, 0.999)
+    T = multiview.relative_pose_ransac(
+        b1,
+        b2,
+        threshold,
+        1000,
+        0.999,
+        priors=priors,
+        use_sprt=config["robust_matching_use_sprt"],
+    )
 
     for relax in [4, 2, 1]:
         inliers = compute_inliers_bearings(b1, b2, T[:, :3], T[:, 3], relax * threshold)
@@ -902,11 +1163,13 @@ def robust_match(
     camera2: pygeometry.Camera,
     matches: np.ndarray,
     config: Dict[str, Any],
+    priors: Optional[np.ndarray] = None,
 ) -> np.ndarray:
     """Filter matches by fitting a geometric model.
 
     If cameras are perspective without distortion, then the Fundamental
-    matrix is used.  Otherwise, we use the Essential matrix.
+    matrix is used.  Otherwise, we use the Essential matrix, sampling the
+    matches by decreasing priors (PROSAC) when given.
     """
     if (
         camera1.projection_type in ["perspective", "brown"]
@@ -918,7 +1181,9 @@ def robust_match(
     ):
         return robust_match_fundamental(p1, p2, matches, config)[1]
     else:
-        return robust_match_calibrated(p1, p2, camera1, camera2, matches, config)
+        return robust_match_calibrated(
+            p1, p2, camera1, camera2, matches, config, priors
+        )
 
 
 def unfilter_matches(matches, m1, m2) -> np.ndarray:
@@ -642,11 +642,23 @@ def absolute_pose_ransac(
     threshold: float,
     iterations: int,
     probability: float,
+    priors: Optional[np.ndarray] = None,
+    use_sprt: bool = False,
 ) -> np.ndarray:
+    """Samples are drawn by decreasing priors (PROSAC) when given.
+
+    With use_sprt, hypotheses are verified on a random subset of the samples
+    first, which is faster when there are many of them.
+    """
     params = pyrobust.RobustEstimatorParams()
     params.iterations = iterations
+    params.use_sprt = use_sprt
+    if priors is None:
+        priors = np.zeros(0)
+    else:
+        params.sampling = pyrobust.SamplingType.PROSAC
     result = pyrobust.ransac_absolute_pose(
-        bs, Xs, threshold, params, pyrobust.RansacType.RANSAC
+        bs, Xs, threshold, params, pyrobust.RansacType.RANSAC, priors
     )
 
     Rt = result.lo_model.copy()
@@ -662,11 +674,23 @@ def relative_pose_ransac(
     threshold: float,
     iterations: int,
     probability: float,
+    priors: Optional[np.ndarray] = None,
+    use_sprt: bool = False,
 ) -> np.ndarray:
+    """Samples are drawn by decreasing priors (PROSAC) when given.
+
+    With use_sprt, hypotheses are verified on a random subset of the samples
+    first, which is faster when there are many of them.
+    """
     params = pyrobust.RobustEstimatorParams()
     params.iterations = iterations
+    params.use_sprt = use_sprt
+    if priors is None:
+        priors = np.zeros(0)
+    else:
+        params.sampling = pyrobust.SamplingType.PROSAC
     result = pyrobust.ransac_relative_pose(
-        b1, b2, threshold, params, pyrobust.RansacType.RANSAC
+        b1, b2, threshold, params, pyrobust.RansacType.RANSAC, priors
     )
 
     Rt = result.lo_model.copy()
@@ -8,7 +8,7 @@ from typing import Any, Dict, Iterable, List, Optional, Set, Tuple
 
 import numpy as np
 import scipy.spatial as spatial
-from opensfm import bow, context, feature_loader, geo, geometry, vlad
+from opensfm import bow, context, feature_loader, geo, geometry, pyfeatures, vlad
 from opensfm.dataset_base import DataSetBase
 
 logger: logging.Logger = logging.getLogger(__name__)
@@ -310,6 +310,8 @@ def match_candidates_with_bow(
         reference,
         max_gps_distance,
         max_gps_neighbors,
+        max_neighbors,
+        enforce_other_cameras,
     )
 
     return construct_pairs(results, max_neighbors, exifs, enforce_other_cameras)
@@ -323,9 +325,15 @@ def compute_bow_affinity(
     reference: geo.TopocentricConverter,
     max_gps_distance: float,
     max_gps_neighbors: int,
+    max_neighbors: int,
+    enforce_other_cameras: bool,
 ) -> List[Tuple[str, List[float], List[str]]]:
-    """Compute affinity scores between references and candidates
-    images using BoW-based distance.
+    """Compute affinity scores between references and their nearest
+    candidates images using BoW-based distance.
+
+    Only the max_neighbors nearest candidates are returned, or the
+    max_neighbors nearest of the same camera and of other cameras if
+    enforce_other_cameras is True.
     """
     preempted_candidates, need_load = preempt_candidates(
         images_ref, images_cand, exifs, reference, max_gps_neighbors, max_gps_distance
@@ -333,14 +341,30 @@ def compute_bow_affinity(
 
     # construct BoW histograms
     logger.info("Computing %d BoW histograms" % len(need_load))
-    histograms = load_histograms(data, need_load)
+    index, images = load_bow_index(data, sorted(need_load))
+    image_index = {im: i for i, im in enumerate(images)}
+    references = [im for im in preempted_candidates if im in image_index]
+    candidates, candidates_offsets = retrieval_candidates(
+        image_index,
+        references,
+        images_cand,
+        preempted_candidates,
+        max_gps_distance > 0 or max_gps_neighbors > 0,
+    )
 
-    # parallel VLAD neighbors computation
-    args, processes, batch_size = create_parallel_matching_args(
-        data, preempted_candidates, histograms
+    logger.info(
+        "Computing BoW candidates of %d images with %d threads"
+        % (len(references), data.config["processes"])
     )
-    logger.info("Computing BoW candidates with %d processes" % processes)
-    return context.parallel_map(match_bow_unwrap_args, args, processes, batch_size)
+    neighbors, distances = index.nearest_images(
+        np.array([image_index[im] for im in references], dtype=np.int32),
+        candidates,
+        max_neighbors,
+        candidates_offsets,
+        retrieval_groups(images, exifs, enforce_other_cameras),
+        data.config["processes"],
+    )
+    return retrieval_results(images, references, neighbors, distances)
 
 
 def match_candidates_with_vlad(
@@ -382,6 +406,8 @@ def match_candidates_with_vlad(
         max_gps_distance,
         max_gps_neighbors,
         histograms,
+        max_neighbors,
+        enforce_other_cameras,
     )
 
     return construct_pairs(results, max_neighbors, exifs, enforce_other_cameras)
@@ -396,32 +422,122 @@ def compute_vlad_affinity(
     max_gps_distance: float,
     max_gps_neighbors: int,
     histograms: Dict[str, np.ndarray],
+    max_neighbors: int,
+    enforce_other_cameras: bool,
 ) -> List[Tuple[str, List[float], List[str]]]:
-    """Compute affinity scores between references and candidates
-    images using VLAD-based distance.
+    """Compute affinity scores between references and their nearest
+    candidates images using VLAD-based distance.
+
+    Only the max_neighbors nearest candidates are returned, or the
+    max_neighbors nearest of the same camera and of other cameras if
+    enforce_other_cameras is True.
     """
     preempted_candidates, need_load = preempt_candidates(
         images_ref, images_cand, exifs, reference, max_gps_neighbors, max_gps_distance
     )
 
+    use_gps = max_gps_distance > 0 or max_gps_neighbors > 0
     if len(preempted_candidates) == 0:
         logger.warning(
             f"Couldn't preempt any candidate with GPS, using ALL {len(images_cand)} as candidates"
         )
         preempted_candidates = {image: images_cand for image in images_ref}
         need_load = set(images_ref + images_cand)
+        use_gps = False
 
     # construct VLAD histograms
     need_load = {im for im in need_load if im not in histograms}
     logger.info("Computing %d VLAD histograms" % len(need_load))
     histograms.update(vlad_histograms(need_load, data))
 
-    # parallel VLAD neighbors computation
-    args, processes, batch_size = create_parallel_matching_args(
-        data, preempted_candidates, histograms
+    # VLAD neighbors computation, on the images having a histogram
+    images = sorted({im for im in images_ref + images_cand if im in histograms})
+    if len(images) == 0:
+        return []
+    image_index = {im: i for i, im in enumerate(images)}
+    descriptors = np.array([histograms[im] for im in images], dtype=np.float32)
+    references = [im for im in preempted_candidates if im in image_index]
+    candidates, candidates_offsets = retrieval_candidates(
+        image_index, references, images_cand, preempted_candidates, use_gps
     )
-    logger.info("Computing VLAD candidates with %d processes" % processes)
-    return context.parallel_map(match_vlad_unwrap_args, args, processes, batch_size)
+
+    logger.info(
+        "Computing VLAD candidates of %d images with %d threads"
+        % (len(references), data.config["processes"])
+    )
+    neighbors, distances = pyfeatures.compute_vlad_neighbors(
+        descriptors,
+        np.array([image_index[im] for im in references], dtype=np.int32),
+        candidates,
+        max_neighbors,
+        candidates_offsets,
+        retrieval_groups(images, exifs, enforce_other_cameras),
+        data.config["processes"],
+    )
+    return retrieval_results(images, references, neighbors, distances)
+
+
+def retrieval_candidates(
+    image_index: Dict[str, int],
+    references: List[str],
+    images_cand: List[str],
+    preempted_candidates: Dict[str, list],
+    use_gps: bool,
+) -> Tuple[np.ndarray, np.ndarray]:
+    """Indexes of the candidates of references, and offsets of each
+    reference candidates if they have been preempted using GPS.
+
+    Without GPS, all references share the same candidates and the
+    offsets are empty.
+    """
+    if not use_gps:
+        candidates = [image_index[im] for im in images_cand if im in image_index]
+        return np.array(candidates, dtype=np.int32), np.empty(0, dtype=np.int32)
+
+    candidates, offsets = [], [0]
+    for im in references:
+        candidates.extend(
+            image_index[c] for c in preempted_candidates[im] if c in image_index
+        )
+        offsets.append(len(candidates))
+    return np.array(candidates, dtype=np.int32), np.array(offsets, dtype=np.int32)
+
+
+def retrieval_groups(
+    images: List[str], exifs: Dict[str, Any], enforce_other_cameras: bool
+) -> np.ndarray:
+    """Camera indexes of images, for splitting their retrieved neighbors.
+
+    An empty array is returned when they are not used.
+    """
+    if not enforce_other_cameras:
+        return np.empty(0, dtype=np.int32)
+    cameras = {}
+    return np.array(
+        [cameras.setdefault(exifs[im]["camera"], len(cameras)) for im in images],
+        dtype=np.int32,
+    )
+
+
+def retrieval_results(
+    images: List[str],
+    references: List[str],
+    neighbors: np.ndarray,
+    distances: np.ndarray,
+) -> List[Tuple[str, List[float], List[str]]]:
+    """Convert retrieved neighbors indexes, padded with -1, to
+    (image, distances, neighbors) tuples."""
+    results = []
+    for im, neighbors_im, distances_im in zip(references, neighbors, distances):
+        valid = neighbors_im >= 0
+        results.append(
+            (
+                im,
+                distances_im[valid].tolist(),
+                [images[j] for j in neighbors_im[valid]],
+            )
+        )
+    return results
 
 
 def preempt_candidates(
@@ -484,39 +600,6 @@ def construct_pairs(
     return pairs
 
 
-def create_parallel_matching_args(
-    data: DataSetBase,
-    preempted_cand: Dict[str, list],
-    histograms: Dict[str, np.ndarray],
-) -> Tuple[List[Tuple[str, list, Dict[str, np.ndarray]]], int, int]:
-    """Create arguments to matching function"""
-    args = [(im, cands, histograms) for im, cands in preempted_cand.items()]
-
-    # parallel VLAD neighbors computation
-    per_process = 512
-    processes = context.processes_that_fit_in_memory(
-        data.config["processes"], per_process
-    )
-    batch_size = max(1, len(args) // (2 * processes))
-    return args, processes, batch_size
-
-
-def match_bow_unwrap_args(
-    args: Tuple[str, Iterable[str], Dict[str, np.ndarray]],
-) -> Tuple[str, List[float], List[str]]:
-    """Wrapper for parallel processing of BoW"""
-    image, other_images, histograms = args
-    return bow_distances(image, other_images, histograms)
-
-
-def match_vlad_unwrap_args(
-    args: Tuple[str, Iterable[str], Dict[str, np.ndarray]],
-) -> Tuple[str, List[float], List[str]]:
-    """Wrapper for parallel processing of VLAD"""
-    image, other_images, histograms = args
-    return vlad.vlad_distances(image, other_images, histograms)
-
-
 def match_candidates_by_time(
     images_ref: List[str],
     images_cand: List[str],
@@ -681,32 +764,17 @@ def match_candidates_from_metadata(
     return pairs, report
 
 
-def bow_distances(
-    image: str, other_images: Iterable[str], histograms: Dict[str, np.ndarray]
-) -> Tuple[str, List[float], List[str]]:
-    """Compute BoW-based distance (L1 on histogram of words)
-    between an image and other images.
+def load_bow_index(
+    data: DataSetBase, images: Iterable[str]
+) -> Tuple[pyfeatures.BowIndex, List[str]]:
+    """Load BoW histograms of given images in an inverted file.
+
+    Returns the index and the images added to it, in order.
     """
-    if image not in histograms:
-        return image, [], []
-
-    distances = []
-    other = []
-    h = histograms[image]
-    for im2 in other_images:
-        if im2 != image and im2 in histograms:
-            h2 = histograms[im2]
-            distances.append(np.fabs(h - h2).sum())
-            other.append(im2)
-    return image, distances, other
-
-
-def load_histograms(data: DataSetBase, images: Iterable[str]) -> Dict[str, np.ndarray]:
-    """Load BoW histograms of given images"""
     min_num_feature = 8
 
-    histograms = {}
-    bows = bow.load_bows(data.config)
+    index = bow.load_bows(data.config).inverted_index()
+    added = []
     for im in images:
         filtered_words = feature_loader.instance.load_words(data, im, masked=True)
         if filtered_words is None:
@@ -720,8 +788,9 @@ def load_histograms(data: DataSetBase, images: Iterable[str]) -> Dict[str, np.nd
             )
             continue
 
-        histograms[im] = bows.histogram(filtered_words[:, 0])
-    return histograms
+        index.add_image(filtered_words[:, 0])
+        added.append(im)
+    return index, added
 
 
 def vlad_histogram_unwrap_args(
@@ -71,15 +71,37 @@ def bundle(
     rig_camera_priors: Dict[str, pymap.RigCamera],
     gcp: Optional[List[pymap.GroundControlPoint]],
     config: Dict[str, Any],
+    session: Optional[pysfm.BundleSession] = None,
 ) -> Dict[str, Any]:
-    """Bundle adjust a reconstruction."""
-    report = pysfm.BAHelpers.bundle(
-        reconstruction.map,
-        dict(camera_priors),
-        dict(rig_camera_priors),
-        gcp if gcp is not None else [],
-        config,
+    """Bundle adjust a reconstruction.
+
+    Without ground control points, large reconstructions are bundled by
+    partitions if enabled and GPS bias isn't compensated, and the session of
+    the reconstruction is used if given.
+    """
+    cluster_size = config["bundle_partition_cluster_size"]
+    partitioned = (
+        not gcp
+        and not config["bundle_compensate_gps_bias"]
+        and 0 < cluster_size < len(reconstruction.shots)
     )
+    if partitioned:
+        report = pysfm.BAHelpers.bundle_partitioned(
+            reconstruction.map,
+            dict(camera_priors),
+            dict(rig_camera_priors),
+            config,
+        )
+    elif session is not None and not gcp:
+        report = session.bundle(config)
+    else:
+        report = pysfm.BAHelpers.bundle(
+            reconstruction.map,
+            dict(camera_priors),
+            dict(rig_camera_priors),
+            gcp if gcp is not None else [],
+            config,
+        )
     log_bundle_stats("GLOBAL", report)
     logger.debug(report["brief_report"])
     return report
@@ -110,16 +132,24 @@ def bundle_local(
     gcp: Optional[List[pymap.GroundControlPoint]],
     central_shot_id: str,
     config: Dict[str, Any],
+    session: Optional[pysfm.BundleSession] = None,
 ) -> Tuple[Dict[str, Any], List[int]]:
-    """Bundle adjust the local neighborhood of a shot."""
-    pt_ids, report = pysfm.BAHelpers.bundle_local(
-        reconstruction.map,
-        dict(camera_priors),
-        dict(rig_camera_priors),
-        gcp if gcp is not None else [],
-        central_shot_id,
-        config,
-    )
+    """Bundle adjust the local neighborhood of a shot.
+
+    The session of the reconstruction is used if given, unless there are
+    ground control points.
+    """
+    if session is not None and not gcp:
+        pt_ids, report = session.bundle_local(central_shot_id, config)
+    else:
+        pt_ids, report = pysfm.BAHelpers.bundle_local(
+            reconstruction.map,
+            dict(camera_priors),
+            dict(rig_camera_priors),
+            gcp if gcp is not None else [],
+            central_shot_id,
+            config,
+        )
     log_bundle_stats("LOCAL", report)
     logger.debug(report["brief_report"])
     return pt_ids, report
@@ -1186,25 +1216,21 @@ def retriangulate(
     return report
 
 
-def get_error_distribution(points: Dict[str, pymap.Landmark]) -> Tuple[float, float]:
-    all_errors = []
-    for track in points.values():
-        all_errors += track.reprojection_errors.values()
-    robust_mean = np.median(all_errors, axis=0)
-    robust_std = 1.486 * np.median(
-        np.linalg.norm(np.array(all_errors) - robust_mean, axis=1)
-    )
+def get_error_distribution(errors: np.ndarray) -> Tuple[float, float]:
+    robust_mean = np.median(errors, axis=0)
+    robust_std = 1.486 * np.median(np.linalg.norm(errors - robust_mean, axis=1))
     return robust_mean, robust_std
 
 
 def get_actual_threshold(
-    config: Dict[str, Any], points: Dict[str, pymap.Landmark]
+    config: Dict[str, Any], reconstruction: types.Reconstruction
 ) -> float:
     filter_type = config["bundle_outlier_filtering_type"]
     if filter_type == "FIXED":
         return config["bundle_outlier_fixed_threshold"]
     elif filter_type == "AUTO":
-        mean, std = get_error_distribution(points)
+        _, _, errors = reconstruction.map.get_landmarks_reprojection_errors()
+        mean, std = get_error_distribution(errors)
         return config["bundle_outlier_auto_ratio"] * np.linalg.norm(mean + std)
     else:
         return 1.0
@@ -1219,17 +1245,17 @@ def remove_outliers(
 
     A list of point ids to be processed can be given in ``points``.
     """
-    if points is None:
-        points = reconstruction.points
-    threshold_sqr = get_actual_threshold(config, reconstruction.points) ** 2
+    point_ids = [] if points is None else list(points)
+    if points is not None and not point_ids:
+        return 0
+    threshold_sqr = get_actual_threshold(config, reconstruction) ** 2
+    rec_map = reconstruction.map
+    tracks, shots, errors = rec_map.get_landmarks_reprojection_errors(point_ids)
     outliers = []
-    for point_id in points:
-        for shot_id, error in reconstruction.points[
-            point_id
-        ].reprojection_errors.items():
-            error_sqr = error[0] ** 2 + error[1] ** 2
-            if error_sqr > threshold_sqr:
-                outliers.append((point_id, shot_id))
+    if len(errors):
+        errors_sqr = errors[:, 0] ** 2 + errors[:, 1] ** 2
+        for i in np.flatnonzero(errors_sqr > threshold_sqr):
+            outliers.append((tracks[i], shots[i]))
 
     track_ids = set()
     for track, shot_id in outliers:
@@ -1425,7 +1451,14 @@ def grow_reconstruction(
     paint_reconstruction(data, tracks_manager, reconstruction)
     align_reconstruction(reconstruction, gcp, config)
 
-    bundle(reconstruction, camera_priors, rig_camera_priors, None, config)
+    # Bundles share their adjuster and problem, unchanged parts being reused
+    session = None
+    if config["bundle_use_session"]:
+        session = pysfm.BundleSession(
+            reconstruction.map, dict(camera_priors), dict(rig_camera_priors)
+        )
+
+    bundle(reconstruction, camera_priors, rig_camera_priors, None, config, session)
     remove_outliers(reconstruction, config)
     paint_reconstruction(data, tracks_manager, reconstruction)
 
@@ -1488,11 +1521,21 @@ def grow_reconstruction(
                 logger.info("Re-triangulating")
                 align_reconstruction(reconstruction, gcp, config)
                 b1rep = bundle(
-                    reconstruction, camera_priors, rig_camera_priors, None, config
+                    reconstruction,
+                    camera_priors,
+                    rig_camera_priors,
+                    None,
+                    config,
+                    session,
                 )
                 rrep = retriangulate(tracks_manager, reconstruction, config)
                 b2rep = bundle(
-                    reconstruction, camera_priors, rig_camera_priors, None, config
+                    reconstruction,
+                    camera_priors,
+                    rig_camera_priors,
+                    None,
+                    config,
+                    session,
                 )
                 remove_outliers(reconstruction, config)
                 step["bundle"] = b1rep
@@ -1503,7 +1546,12 @@ def grow_reconstruction(
             elif should_bundle.should():
                 align_reconstruction(reconstruction, gcp, config)
                 brep = bundle(
-                    reconstruction, camera_priors, rig_camera_priors, None, config
+                    reconstruction,
+                    camera_priors,
+                    rig_camera_priors,
+                    None,
+                    config,
+                    session,
                 )
                 remove_outliers(reconstruction, config)
                 step["bundle"] = brep
@@ -1516,6 +1564,7 @@ def grow_reconstruction(
                     None,
                     image,
                     config,
+                    session,
                 )
                 remove_outliers(reconstruction, config, bundled_points)
                 step["local_bundle"] = brep
@@ -1535,7 +1584,7 @@ def grow_reconstruction(
         overidden_config["bundle_compensate_gps_bias"] = False
         config = overidden_config
 
-    bundle(reconstruction, camera_priors, rig_camera_priors, gcp, config)
+    bundle(reconstruction, camera_priors, rig_camera_priors, gcp, config, session)
     remove_outliers(reconstruction, config)
     paint_reconstruction(data, tracks_manager, reconstruction)
     return reconstruction, report
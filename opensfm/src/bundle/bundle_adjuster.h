@@ -16,8 +16,11 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "ceres/ceres.h"
@@ -62,10 +65,22 @@ struct PointProjectionObservation {
   Point *point;
   Shot *shot;
   Camera *camera;
+  int point_index;
+  int shot_index;
   double std_deviation;
   std::optional<map::Depth> depth_prior;
 };
 
+// Point projection observations as structure-of-arrays, with shots and points
+// given by their index (see BundleAdjuster::GetShotIndex)
+struct PointProjectionObservations {
+  std::vector<int> shots;
+  std::vector<int> points;
+  AlignedVector<Vec2d> coordinates;
+  std::vector<double> std_deviations;
+  std::vector<std::optional<map::Depth>> depth_priors;
+};
+
 struct RelativeMotion {
   RelativeMotion(const std::string &rig_instance_i,
                  const std::string &rig_instance_j, const Vec3d &rotation,
@@ -164,9 +179,16 @@ struct LinearMotion {
   double orientation_std_deviation;
 };
 
+// Cost functions are owned by the bundle adjuster rather than by the ceres
+// problem, so that they can outlive it and be reused across runs
+using CostFunctions = std::vector<std::unique_ptr<ceres::CostFunction>>;
+using LossFunctions = std::vector<std::unique_ptr<ceres::LossFunction>>;
+
 class BundleAdjuster {
  public:
   BundleAdjuster();
+  BundleAdjuster(const BundleAdjuster &) = delete;
+  BundleAdjuster &operator=(const BundleAdjuster &) = delete;
   virtual ~BundleAdjuster() = default;
 
   // Bundle variables
@@ -174,10 +196,13 @@ class BundleAdjuster {
   // Basic
   void AddCamera(const std::string &id, const geometry::Camera &camera,
                  const geometry::Camera &prior, bool constant);
-  void AddPoint(const std::string &id, const Vec3d &position, bool constant);
+  // Return the index of the point, see GetPointIndex
+  int AddPoint(const std::string &id, const Vec3d &position, bool constant);
   void AddPointPrior(const std::string &id, const Vec3d &position,
                      const Vec3d &std_deviation, bool has_altitude_prior);
   void SetCameraBias(const std::string &id, const geometry::Similarity &bias);
+  // Back to the default constant identity bias
+  void ResetCameraBias(const std::string &id);
 
   // Rigs
   void AddRigInstance(
@@ -205,6 +230,35 @@ class BundleAdjuster {
       const Vec2d &observation, double std_deviation,
       const std::optional<map::Depth> &depth_prior = std::nullopt);
 
+  // Shots and points have dense indexes, in the order they were added, so
+  // that callers adding many observations or reading many points back can
+  // resolve their identifiers once instead of once per access
+  int GetShotIndex(const std::string &shot_id) const;
+  int GetPointIndex(const std::string &point_id) const;
+  void AddPointProjectionObservation(
+      int shot_index, int point_index, const Vec2d &observation,
+      double std_deviation,
+      const std::optional<map::Depth> &depth_prior = std::nullopt);
+  void AddPointProjectionObservations(
+      const PointProjectionObservations &observations);
+  // Replace all the point projection observations. The cost functions of the
+  // observations left unchanged are kept for the next run.
+  void SetPointProjectionObservations(
+      const PointProjectionObservations &observations);
+
+  // Updates of existing parameters, for adjusters run several times. Only
+  // the projection observations having some non-constant parameter are
+  // adjusted and get reprojection errors, so that fixing most of the
+  // parameters gives a local bundle.
+  void SetCamera(const std::string &id, const geometry::Camera &camera,
+                 bool constant);
+  void SetRigCamera(const std::string &rig_camera_id,
+                    const geometry::Pose &pose, bool constant);
+  void SetRigInstance(const std::string &id, const geometry::Pose &pose,
+                      bool constant);
+  void SetPoint(int point_index, const Vec3d &position, bool constant);
+  void ClearAbsoluteUpVectors();
+
   // Relative motion constraints
   void AddRelativeMotion(const RelativeMotion &rm);
   void AddRelativeRotation(const RelativeRotation &rr);
@@ -250,7 +304,14 @@ class BundleAdjuster {
   void SetNumThreads(int n);
   void SetUseAnalyticDerivatives(bool use);
   void SetLinearSolverType(std::string t);
+  // Any ceres::CovarianceAlgorithmType, or SCHUR_BLOCK_DIAGONAL which
+  // approximates the covariance of each rig instance by the inverse of its
+  // diagonal block of the reduced camera system, ie. its covariance when
+  // the other instances are known. These are computed in parallel, without
+  // the memory cost of ceres::Covariance on large problems.
   void SetCovarianceAlgorithmType(std::string t);
+  // Restrict covariances to the rig instances of some shots, all if empty
+  void SetCovarianceShots(const std::vector<std::string> &shot_ids);
 
   void SetInternalParametersPriorSD(double focal_sd, double c_sd, double k1_sd,
                                     double k2_sd, double p1_sd, double p2_sd,
@@ -262,6 +323,12 @@ class BundleAdjuster {
   bool GetCovarianceEstimationValid() const;
   void SetComputeReprojectionErrors(bool v);
 
+  // Keep the ceres problem across runs : the residual blocks of the
+  // observations are only added once, removed with their observations, and
+  // the parameter blocks are switched between constant and variable, instead
+  // of adding all of them to a new problem on each run
+  void SetKeepProblem(bool keep);
+
   // Minimization
   void Run();
   void ComputeCovariances(ceres::Problem *problem);
@@ -269,26 +336,59 @@ class BundleAdjuster {
 
   // Getters
   int GetProjectionsCount() const;
+  // Projection cost functions built by the last run, the others being reused
+  int GetBuiltProjectionCostFunctionsCount() const;
   int GetRelativeMotionsCount() const;
   geometry::Camera GetCamera(const std::string &id) const;
   geometry::Similarity GetBias(const std::string &id) const;
   Reconstruction GetReconstruction(const std::string &reconstruction_id) const;
   Point GetPoint(const std::string &id) const;
+  const Point &GetPoint(int point_index) const;
   bool HasPoint(const std::string &id) const;
+  bool HasCamera(const std::string &id) const;
+  bool HasRigCamera(const std::string &rig_camera_id) const;
+  bool HasRigInstance(const std::string &instance_id) const;
   RigCamera GetRigCamera(const std::string &rig_camera_id) const;
   RigInstance GetRigInstance(const std::string &instance_id) const;
+  MatXd GetRigInstanceCovariance(const std::string &instance_id) const;
   std::map<std::string, RigCamera> GetRigCameras() const;
+
+  // Reprojection errors of the last run, grouped by point, and the range
+  // of entries of a point in them
+  std::shared_ptr<const map::ReprojectionErrors> GetReprojectionErrors() const;
+  std::pair<int, int> GetPointReprojectionErrorsRange(int point_index) const;
   std::map<std::string, RigInstance> GetRigInstances() const;
 
   // Minimization details
   std::string BriefReport() const;
   std::string FullReport() const;
+  double GetInitialCost() const;
+  double GetFinalCost() const;
 
  private:
   // default sigmas
   geometry::Camera GetDefaultCameraSigma(const geometry::Camera &camera) const;
   geometry::Pose GetDefaultRigPoseSigma() const;
 
+  // Build in parallel the projection and relative depth cost functions of
+  // the observations which don't have valid ones from a previous run
+  void CreateProjectionCostFunctions();
+  void CheckPointProjectionObservations(
+      const PointProjectionObservations &observations) const;
+  bool ComputeSchurBlockDiagonalCovariances(
+      ceres::Problem *problem, const std::vector<RigInstance *> &instances);
+
+  // Update the problem for the current parameters and observations, and
+  // solve it. The cost functions and losses of the constraints added for this
+  // run only are given to run_cost_functions and run_losses, and their blocks
+  // are removed from a kept problem at the end.
+  void Solve(CostFunctions *run_cost_functions, LossFunctions *run_losses);
+  void ResetProblem();
+  // Remove the residual blocks of a projection observation, if any
+  void RemoveProjectionBlocks(int point_index,
+                              ceres::ResidualBlockId *projection_block,
+                              ceres::ResidualBlockId *depth_block);
+
   // minimized data
   std::map<std::string, Camera> cameras_;
   std::map<std::string, Similarity> bias_;
@@ -299,12 +399,42 @@ class BundleAdjuster {
   std::map<std::string, RigCamera> rig_cameras_;
   std::map<std::string, RigInstance> rig_instances_;
 
+  // shots and points by index, with the camera of each shot
+  std::vector<Shot *> shots_by_index_;
+  std::vector<Camera *> shots_cameras_by_index_;
+  std::vector<Point *> points_by_index_;
+  std::unordered_map<std::string, int> shots_indexes_;
+  std::unordered_map<std::string, int> points_indexes_;
+  // Parameter blocks of the points, by index. It has some spare columns, so
+  // that adding points doesn't move the blocks of a kept problem.
+  Eigen::Matrix3Xd points_parameters_;
+
   bool use_analytic_{false};
 
   // minimization constraints
 
   // reprojection observation
   std::vector<PointProjectionObservation> point_projection_observations_;
+  // Cost functions of the observations, with nullptr depth ones for the
+  // observations without depth prior, and the setup they were built with.
+  // Observations added since the last run have nullptr cost functions.
+  CostFunctions projection_cost_functions_;
+  CostFunctions depth_cost_functions_;
+  std::vector<bool> projection_rig_cameras_useful_;
+  bool projection_cost_functions_analytic_{false};
+  int built_projection_cost_functions_count_{0};
+  // Problem kept across runs, with the residual blocks of the observations,
+  // nullptr for the ones not added yet, and their count for each point
+  bool keep_problem_{false};
+  std::unique_ptr<ceres::Problem> problem_;
+  std::unique_ptr<ceres::LossFunction> projection_loss_;
+  std::vector<ceres::ResidualBlockId> projection_blocks_;
+  std::vector<ceres::ResidualBlockId> depth_blocks_;
+  std::vector<int> points_blocks_count_;
+  // Reprojection errors, and offsets of the entries of each point in them
+  std::shared_ptr<map::ReprojectionErrors> reprojection_errors_;
+  std::shared_ptr<const std::vector<std::string>> shot_ids_;
+  std::vector<int> points_reprojection_errors_;
   std::map<std::string, std::shared_ptr<HeatmapInterpolator>> heatmaps_;
 
   // relative motion between shots
@@ -353,6 +483,7 @@ class BundleAdjuster {
   int num_threads_;
   std::string linear_solver_type_;
   std::string covariance_algorithm_type_;
+  std::vector<std::string> covariance_shots_;
 
   // internal
   ceres::Solver::Summary last_run_summary_;
@@ -14,7 +14,10 @@ struct Camera : public Data<geometry::Camera> {
 
  private:
   void ValueToData(const geometry::Camera &value, VecXd &data) const final {
-    data = value.GetParametersValues();
+    // Copied rather than moved, as ceres problems kept by the bundle
+    // adjuster refer to the data
+    const VecXd values = value.GetParametersValues();
+    data = values;
   }
 
   void DataToValue(const VecXd &data, geometry::Camera &value) const final {
@@ -33,6 +33,10 @@ struct Data : public DataNode {
     DataToValue(value_data_, v);
     return v;
   }
+  void SetValue(const T &value) {
+    value_ = value;
+    ValueToData(value_, value_data_);
+  }
 
   bool HasPrior() const { return prior_.HasValue(); }
   VecXd GetPriorData() const {
@@ -72,6 +76,12 @@ struct Data : public DataNode {
   void SetParametersToOptimize(const std::vector<int> &parameters) {
     parameters_to_optimize_ = parameters;
   }
+  // Optimize all the parameters, or none of them
+  void SetConstant(bool constant) {
+    parameters_to_optimize_.resize(constant ? 0 : value_data_.size());
+    std::iota(parameters_to_optimize_.begin(), parameters_to_optimize_.end(),
+              0);
+  }
 
   virtual void ValueToData(const T &value, VecXd &data) const = 0;
   virtual void DataToValue(const VecXd &data, T &value) const = 0;
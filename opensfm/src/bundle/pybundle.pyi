@@ -54,10 +54,11 @@ class BundleAdjuster:
     def add_linear_motion(
         self, arg0: str, arg1: str, arg2: str, arg3: float, arg4: float, arg5: float
     ) -> None: ...
-    def add_point(self, arg0: str, arg1: numpy.ndarray, arg2: bool) -> None: ...
+    def add_point(self, arg0: str, arg1: numpy.ndarray, arg2: bool) -> int: ...
     def add_point_prior(
         self, arg0: str, arg1: numpy.ndarray, arg2: numpy.ndarray, arg3: bool
     ) -> None: ...
+    @overload
     def add_point_projection_observation(
         self,
         shot: str,
@@ -66,6 +67,15 @@ class BundleAdjuster:
         std_deviation: float,
         depth_prior: Optional[opensfm.pymap.Depth] = None,
     ) -> None: ...
+    @overload
+    def add_point_projection_observation(
+        self,
+        shot: int,
+        point: int,
+        observation: numpy.ndarray,
+        std_deviation: float,
+        depth_prior: Optional[opensfm.pymap.Depth] = None,
+    ) -> None: ...
     def add_reconstruction(self, arg0: str, arg1: bool) -> None: ...
     def add_reconstruction_instance(
         self, arg0: str, arg1: float, arg2: str
@@ -94,15 +104,28 @@ class BundleAdjuster:
     def full_report(self) -> str: ...
     def get_camera(self, arg0: str) -> opensfm.pygeometry.Camera: ...
     def get_covariance_estimation_valid(self) -> bool: ...
+    def get_final_cost(self) -> float: ...
+    def get_initial_cost(self) -> float: ...
+    @overload
     def get_point(self, arg0: str) -> Point: ...
+    @overload
+    def get_point(self, arg0: int) -> Point: ...
+    def get_point_index(self, arg0: str) -> int: ...
+    def get_point_reprojection_errors(
+        self, arg0: str
+    ) -> Dict[str, numpy.ndarray]: ...
     def get_reconstruction(self, arg0: str) -> Reconstruction: ...
     def get_rig_camera_pose(self, arg0: str) -> opensfm.pygeometry.Pose: ...
+    def get_rig_instance_covariance(self, arg0: str) -> numpy.ndarray: ...
     def get_rig_instance_pose(self, arg0: str) -> opensfm.pygeometry.Pose: ...
+    def get_shot_index(self, arg0: str) -> int: ...
     def has_point(self, arg0: str) -> bool: ...
     def run(self) -> None: ...
     def set_adjust_absolute_position_std(self, arg0: bool) -> None: ...
     def set_compute_covariances(self, arg0: bool) -> None: ...
     def set_compute_reprojection_errors(self, arg0: bool) -> None: ...
+    def set_covariance_algorithm_type(self, arg0: str) -> None: ...
+    def set_covariance_shots(self, arg0: List[str]) -> None: ...
     def set_gauge_fix_shots(self, arg0: str, arg1: str) -> None: ...
     def set_internal_parameters_prior_sd(
         self,
@@ -128,10 +151,6 @@ class Point:
     def id(self) -> str: ...
     @property
     def p(self) -> numpy.ndarray: ...
-    @property
-    def reprojection_errors(self) -> Dict[str, numpy.ndarray]: ...
-    @reprojection_errors.setter
-    def reprojection_errors(self, arg0: Dict[str, numpy.ndarray]) -> None: ...
 
 class RAReconstruction:
     def __init__(self) -> None: ...
@@ -38,9 +38,7 @@ PYBIND11_MODULE(pybundle, m) {
       .def_property_readonly(
           "p", [](const bundle::Point &p) { return p.GetValue(); })
       .def_property_readonly("id",
-                             [](const bundle::Point &p) { return p.GetID(); })
-      .def_readwrite("reprojection_errors",
-                     &bundle::Point::reprojection_errors);
+                             [](const bundle::Point &p) { return p.GetID(); });
 
   py::class_<bundle::BundleAdjuster>(m, "BundleAdjuster")
       .def(py::init())
@@ -70,13 +68,40 @@ PYBIND11_MODULE(pybundle, m) {
       .def("get_reconstruction", &bundle::BundleAdjuster::GetReconstruction)
       .def("add_point", &bundle::BundleAdjuster::AddPoint)
       .def("add_point_prior", &bundle::BundleAdjuster::AddPointPrior)
-      .def("get_point", &bundle::BundleAdjuster::GetPoint)
+      .def("get_point", py::overload_cast<const std::string &>(
+                            &bundle::BundleAdjuster::GetPoint, py::const_))
+      .def("get_point",
+           py::overload_cast<int>(&bundle::BundleAdjuster::GetPoint,
+                                  py::const_),
+           py::return_value_policy::copy)
+      .def("get_shot_index", &bundle::BundleAdjuster::GetShotIndex)
+      .def("get_point_index", &bundle::BundleAdjuster::GetPointIndex)
+      .def("get_point_reprojection_errors",
+           [](const bundle::BundleAdjuster &ba, const std::string &point_id) {
+             std::map<std::string, VecXd> errors;
+             const auto all_errors = ba.GetReprojectionErrors();
+             const auto range =
+                 ba.GetPointReprojectionErrorsRange(ba.GetPointIndex(point_id));
+             for (int e = range.first; e < range.second; ++e) {
+               errors[all_errors->EntryShotId(e)] = all_errors->Residual(e);
+             }
+             return errors;
+           })
       .def("has_point", &bundle::BundleAdjuster::HasPoint)
       .def("add_reconstruction", &bundle::BundleAdjuster::AddReconstruction)
       .def("add_reconstruction_instance",
            &bundle::BundleAdjuster::AddReconstructionInstance)
       .def("add_point_projection_observation",
-           &bundle::BundleAdjuster::AddPointProjectionObservation,
+           py::overload_cast<const std::string &, const std::string &,
+                             const Vec2d &, double,
+                             const std::optional<map::Depth> &>(
+               &bundle::BundleAdjuster::AddPointProjectionObservation),
+           py::arg("shot"), py::arg("point"), py::arg("observation"),
+           py::arg("std_deviation"), py::arg("depth_prior") = std::nullopt)
+      .def("add_point_projection_observation",
+           py::overload_cast<int, int, const Vec2d &, double,
+                             const std::optional<map::Depth> &>(
+               &bundle::BundleAdjuster::AddPointProjectionObservation),
            py::arg("shot"), py::arg("point"), py::arg("observation"),
            py::arg("std_deviation"), py::arg("depth_prior") = std::nullopt)
       .def("add_relative_motion", &bundle::BundleAdjuster::AddRelativeMotion)
@@ -97,8 +122,13 @@ PYBIND11_MODULE(pybundle, m) {
            &bundle::BundleAdjuster::SetInternalParametersPriorSD)
       .def("set_compute_covariances",
            &bundle::BundleAdjuster::SetComputeCovariances)
+      .def("set_covariance_algorithm_type",
+           &bundle::BundleAdjuster::SetCovarianceAlgorithmType)
+      .def("set_covariance_shots", &bundle::BundleAdjuster::SetCovarianceShots)
       .def("get_covariance_estimation_valid",
            &bundle::BundleAdjuster::GetCovarianceEstimationValid)
+      .def("get_rig_instance_covariance",
+           &bundle::BundleAdjuster::GetRigInstanceCovariance)
       .def("set_compute_reprojection_errors",
            &bundle::BundleAdjuster::SetComputeReprojectionErrors)
       .def("set_max_num_iterations",
@@ -111,7 +141,9 @@ PYBIND11_MODULE(pybundle, m) {
       .def("set_linear_solver_type",
            &bundle::BundleAdjuster::SetLinearSolverType)
       .def("brief_report", &bundle::BundleAdjuster::BriefReport)
-      .def("full_report", &bundle::BundleAdjuster::FullReport);
+      .def("full_report", &bundle::BundleAdjuster::FullReport)
+      .def("get_initial_cost", &bundle::BundleAdjuster::GetInitialCost)
+      .def("get_final_cost", &bundle::BundleAdjuster::GetFinalCost);
 
   ///////////////////////////////////
   // Reconstruction Alignment
@@ -9,6 +9,9 @@
 #include <bundle/error/relative_motion_errors.h>
 #include <foundation/types.h>
 
+#include <algorithm>
+#include <numeric>
+#include <set>
 #include <stdexcept>
 #include <string>
 
@@ -19,6 +22,44 @@ bool IsRigCameraUseful(bundle::RigCamera &rig_camera) {
   return !(rig_camera.GetParametersToOptimize().empty() &&
            rig_camera.GetValueData().isConstant(0.));
 }
+
+bool IsSameDepthPrior(const std::optional<map::Depth> &a,
+                      const std::optional<map::Depth> &b) {
+  if (!a.has_value() || !b.has_value()) {
+    return a.has_value() == b.has_value();
+  }
+  return a->value == b->value && a->std_deviation == b->std_deviation &&
+         a->is_radial == b->is_radial;
+}
+
+bool IsSameProjectionObservation(const bundle::PointProjectionObservation &a,
+                                 const bundle::PointProjectionObservation &b) {
+  return a.shot == b.shot && a.point == b.point && a.camera == b.camera &&
+         a.coordinates == b.coordinates &&
+         a.std_deviation == b.std_deviation &&
+         IsSameDepthPrior(a.depth_prior, b.depth_prior);
+}
+
+MatXd DefaultRigInstanceCovariance() {
+  MatXd default_covariance_matrix = MatXd::Zero(6, 6);
+  double default_rotation_variance = 1e-5;
+  double default_translation_variance = 1e-2;
+  default_covariance_matrix.diagonal().segment<3>(0).setConstant(
+      default_rotation_variance);
+  default_covariance_matrix.diagonal().segment<3>(3).setConstant(
+      default_translation_variance);
+  return default_covariance_matrix;
+}
+
+// Observations whose parameters are all constant don't change the
+// minimization, and are left out of it
+bool IsProjectionObservationConstant(
+    const bundle::PointProjectionObservation &o) {
+  return o.camera->GetParametersToOptimize().empty() &&
+         o.shot->GetRigInstance()->GetParametersToOptimize().empty() &&
+         o.shot->GetRigCamera()->GetParametersToOptimize().empty() &&
+         o.point->GetParametersToOptimize().empty();
+}
 }  // namespace
 
 namespace bundle {
@@ -103,7 +144,18 @@ void BundleAdjuster::SetCameraBias(const std::string &camera_id,
   if (bias_exists == bias_.end()) {
     throw std::runtime_error("Camera " + camera_id + " doesn't exist.");
   }
-  bias_exists->second = Similarity(camera_id, bias);
+  bias_exists->second.SetValue(bias);
+  bias_exists->second.SetConstant(false);
+}
+
+void BundleAdjuster::ResetCameraBias(const std::string &camera_id) {
+  auto bias_exists = bias_.find(camera_id);
+  if (bias_exists == bias_.end()) {
+    throw std::runtime_error("Camera " + camera_id + " doesn't exist.");
+  }
+  bias_exists->second.SetValue(
+      geometry::Similarity(Vec3d::Zero().eval(), Vec3d::Zero().eval(), 1.0));
+  bias_exists->second.SetConstant(true);
 }
 
 void BundleAdjuster::AddRigInstance(
@@ -136,10 +188,16 @@ void BundleAdjuster::AddRigInstance(
       throw std::runtime_error("Rig camera " + rig_camera_id +
                                " doesn't exist.");
     }
-    shots_.emplace(std::piecewise_construct, std::forward_as_tuple(shot_id),
-                   std::forward_as_tuple(shot_id, &camera_exists->second,
-                                         &rig_camera_exists->second,
-                                         &rig_instances_.at(rig_instance_id)));
+    const auto shot = shots_.emplace(
+        std::piecewise_construct, std::forward_as_tuple(shot_id),
+        std::forward_as_tuple(shot_id, &camera_exists->second,
+                              &rig_camera_exists->second,
+                              &rig_instances_.at(rig_instance_id)));
+    if (shot.second) {
+      shots_indexes_[shot_id] = shots_by_index_.size();
+      shots_by_index_.push_back(&shot.first->second);
+      shots_cameras_by_index_.push_back(&camera_exists->second);
+    }
   }
 }
 
@@ -210,17 +268,21 @@ void BundleAdjuster::AddReconstructionInstance(
   reconstructions_assignments_[instance_id] = reconstruction_id;
 }
 
-void BundleAdjuster::AddPoint(const std::string &id, const Vec3d &position,
-                              bool constant) {
-  auto point =
-      &points_
-           .emplace(std::piecewise_construct, std::forward_as_tuple(id),
-                    std::forward_as_tuple(id, position))
-           .first->second;
+int BundleAdjuster::AddPoint(const std::string &id, const Vec3d &position,
+                             bool constant) {
+  const auto inserted =
+      points_.emplace(std::piecewise_construct, std::forward_as_tuple(id),
+                      std::forward_as_tuple(id, position));
+  auto point = &inserted.first->second;
+  if (inserted.second) {
+    points_indexes_[id] = points_by_index_.size();
+    points_by_index_.push_back(point);
+  }
 
   if (constant) {
     point->SetParametersToOptimize({});
   }
+  return points_indexes_.at(id);
 }
 
 void BundleAdjuster::AddPointPrior(const std::string &point_id,
@@ -240,14 +302,192 @@ void BundleAdjuster::AddPointPrior(const std::string &point_id,
 void BundleAdjuster::AddPointProjectionObservation(
     const std::string &shot, const std::string &point, const Vec2d &observation,
     double std_deviation, const std::optional<map::Depth> &depth_prior) {
+  AddPointProjectionObservation(GetShotIndex(shot), GetPointIndex(point),
+                                observation, std_deviation, depth_prior);
+}
+
+int BundleAdjuster::GetShotIndex(const std::string &shot_id) const {
+  const auto it = shots_indexes_.find(shot_id);
+  if (it == shots_indexes_.end()) {
+    throw std::runtime_error("Shot " + shot_id + " doesn't exist.");
+  }
+  return it->second;
+}
+
+int BundleAdjuster::GetPointIndex(const std::string &point_id) const {
+  const auto it = points_indexes_.find(point_id);
+  if (it == points_indexes_.end()) {
+    throw std::runtime_error("Point " + point_id + " doesn't exist.");
+  }
+  return it->second;
+}
+
+void BundleAdjuster::AddPointProjectionObservation(
+    int shot_index, int point_index, const Vec2d &observation,
+    double std_deviation, const std::optional<map::Depth> &depth_prior) {
   PointProjectionObservation o;
-  o.shot = &shots_.at(shot);
-  o.camera = &cameras_.at(o.shot->GetCamera()->GetID());
-  o.point = &points_.at(point);
+  o.shot = shots_by_index_.at(shot_index);
+  o.camera = shots_cameras_by_index_.at(shot_index);
+  o.point = points_by_index_.at(point_index);
+  o.shot_index = shot_index;
+  o.point_index = point_index;
   o.coordinates = observation;
   o.std_deviation = std_deviation;
   o.depth_prior = depth_prior;
   point_projection_observations_.push_back(o);
+  projection_cost_functions_.emplace_back();
+  depth_cost_functions_.emplace_back();
+  projection_rig_cameras_useful_.push_back(false);
+  projection_blocks_.push_back(nullptr);
+  depth_blocks_.push_back(nullptr);
+}
+
+void BundleAdjuster::CheckPointProjectionObservations(
+    const PointProjectionObservations &observations) const {
+  const int count = observations.shots.size();
+  if (observations.points.size() != count ||
+      observations.coordinates.size() != count ||
+      observations.std_deviations.size() != count ||
+      observations.depth_priors.size() != count) {
+    throw std::runtime_error("Inconsistent point projection observations");
+  }
+  const int shots_count = shots_by_index_.size();
+  const int points_count = points_by_index_.size();
+  for (int i = 0; i < count; ++i) {
+    const int shot = observations.shots[i];
+    const int point = observations.points[i];
+    if (shot < 0 || shot >= shots_count || point < 0 ||
+        point >= points_count) {
+      throw std::runtime_error("Invalid shot or point index");
+    }
+  }
+}
+
+void BundleAdjuster::AddPointProjectionObservations(
+    const PointProjectionObservations &observations) {
+  CheckPointProjectionObservations(observations);
+
+  const int count = observations.shots.size();
+  const int offset = point_projection_observations_.size();
+  point_projection_observations_.resize(offset + count);
+#pragma omp parallel for schedule(static) \
+    num_threads(std::max(num_threads_, 1))
+  for (int i = 0; i < count; ++i) {
+    auto &o = point_projection_observations_[offset + i];
+    o.shot = shots_by_index_[observations.shots[i]];
+    o.camera = shots_cameras_by_index_[observations.shots[i]];
+    o.point = points_by_index_[observations.points[i]];
+    o.shot_index = observations.shots[i];
+    o.point_index = observations.points[i];
+    o.coordinates = observations.coordinates[i];
+    o.std_deviation = observations.std_deviations[i];
+    o.depth_prior = observations.depth_priors[i];
+  }
+  projection_cost_functions_.resize(offset + count);
+  depth_cost_functions_.resize(offset + count);
+  projection_rig_cameras_useful_.resize(offset + count);
+  projection_blocks_.resize(offset + count, nullptr);
+  depth_blocks_.resize(offset + count, nullptr);
+}
+
+void BundleAdjuster::SetPointProjectionObservations(
+    const PointProjectionObservations &observations) {
+  CheckPointProjectionObservations(observations);
+
+  using ObservationKey = std::pair<const Shot *, const Point *>;
+  std::map<ObservationKey, int> previous_indexes;
+  for (int i = 0; i < point_projection_observations_.size(); ++i) {
+    const auto &o = point_projection_observations_[i];
+    previous_indexes.emplace(ObservationKey(o.shot, o.point), i);
+  }
+  const auto previous_observations = std::move(point_projection_observations_);
+  auto previous_projections = std::move(projection_cost_functions_);
+  auto previous_depths = std::move(depth_cost_functions_);
+  const auto previous_useful = std::move(projection_rig_cameras_useful_);
+  auto previous_projection_blocks = std::move(projection_blocks_);
+  auto previous_depth_blocks = std::move(depth_blocks_);
+  point_projection_observations_.clear();
+  projection_cost_functions_.clear();
+  depth_cost_functions_.clear();
+  projection_rig_cameras_useful_.clear();
+  projection_blocks_.clear();
+  depth_blocks_.clear();
+  AddPointProjectionObservations(observations);
+
+  for (int i = 0; i < point_projection_observations_.size(); ++i) {
+    const auto &o = point_projection_observations_[i];
+    const auto previous =
+        previous_indexes.find(ObservationKey(o.shot, o.point));
+    if (previous == previous_indexes.end()) {
+      continue;
+    }
+    const int j = previous->second;
+    if (!IsSameProjectionObservation(o, previous_observations[j])) {
+      continue;
+    }
+    projection_cost_functions_[i] = std::move(previous_projections[j]);
+    depth_cost_functions_[i] = std::move(previous_depths[j]);
+    projection_rig_cameras_useful_[i] = previous_useful[j];
+    projection_blocks_[i] = previous_projection_blocks[j];
+    depth_blocks_[i] = previous_depth_blocks[j];
+    previous_projection_blocks[j] = nullptr;
+    previous_depth_blocks[j] = nullptr;
+  }
+
+  // The blocks of the removed observations, such as outliers, are removed
+  // from the kept problem before their cost functions are deleted
+  for (int j = 0; j < previous_observations.size(); ++j) {
+    RemoveProjectionBlocks(previous_observations[j].point_index,
+                           &previous_projection_blocks[j],
+                           &previous_depth_blocks[j]);
+  }
+
+  // Errors of removed observations would otherwise remain
+  reprojection_errors_.reset();
+  points_reprojection_errors_.clear();
+}
+
+void BundleAdjuster::SetCamera(const std::string &id,
+                               const geometry::Camera &camera, bool constant) {
+  const auto camera_exists = cameras_.find(id);
+  if (camera_exists == cameras_.end()) {
+    throw std::runtime_error("Camera " + id + " doesn't exist.");
+  }
+  camera_exists->second.SetValue(camera);
+  camera_exists->second.SetConstant(constant);
+}
+
+void BundleAdjuster::SetRigCamera(const std::string &rig_camera_id,
+                                  const geometry::Pose &pose, bool constant) {
+  const auto rig_camera = rig_cameras_.find(rig_camera_id);
+  if (rig_camera == rig_cameras_.end()) {
+    throw std::runtime_error("Rig camera " + rig_camera_id +
+                             " doesn't exist.");
+  }
+  rig_camera->second.SetValue(pose);
+  rig_camera->second.SetConstant(constant);
+}
+
+void BundleAdjuster::SetRigInstance(const std::string &id,
+                                    const geometry::Pose &pose,
+                                    bool constant) {
+  const auto rig_instance = rig_instances_.find(id);
+  if (rig_instance == rig_instances_.end()) {
+    throw std::runtime_error("Rig instance " + id + " doesn't exist.");
+  }
+  rig_instance->second.SetValue(pose);
+  rig_instance->second.SetConstant(constant);
+}
+
+void BundleAdjuster::SetPoint(int point_index, const Vec3d &position,
+                              bool constant) {
+  auto *point = points_by_index_.at(point_index);
+  point->SetValue(position);
+  point->SetConstant(constant);
+}
+
+void BundleAdjuster::ClearAbsoluteUpVectors() {
+  absolute_up_vectors_.clear();
 }
 
 void BundleAdjuster::AddRelativeMotion(const RelativeMotion &rm) {
@@ -345,6 +585,11 @@ void BundleAdjuster::SetGaugeFixShots(const std::string &shot_origin,
 
 void BundleAdjuster::SetPointProjectionLossFunction(std::string name,
                                                     double threshold) {
+  // The loss is shared by the projection blocks of the kept problem
+  if (problem_ && (name != point_projection_loss_name_ ||
+                   threshold != point_projection_loss_threshold_)) {
+    ResetProblem();
+  }
   point_projection_loss_name_ = name;
   point_projection_loss_threshold_ = threshold;
 }
@@ -377,6 +622,16 @@ void BundleAdjuster::SetCovarianceAlgorithmType(std::string t) {
   covariance_algorithm_type_ = t;
 }
 
+void BundleAdjuster::SetCovarianceShots(
+    const std::vector<std::string> &shot_ids) {
+  for (const auto &shot_id : shot_ids) {
+    if (shots_.find(shot_id) == shots_.end()) {
+      throw std::runtime_error("Shot " + shot_id + " doesn't exist.");
+    }
+  }
+  covariance_shots_ = shot_ids;
+}
+
 void BundleAdjuster::SetInternalParametersPriorSD(double focal_sd, double c_sd,
                                                   double k1_sd, double k2_sd,
                                                   double p1_sd, double p2_sd,
@@ -413,6 +668,13 @@ void BundleAdjuster::SetComputeReprojectionErrors(bool v) {
   compute_reprojection_errors_ = v;
 }
 
+void BundleAdjuster::SetKeepProblem(bool keep) {
+  if (!keep) {
+    ResetProblem();
+  }
+  keep_problem_ = keep;
+}
+
 ceres::LossFunction *CreateLossFunction(std::string name, double threshold) {
   if (name.compare("TrivialLoss") == 0) {
     return new ceres::TrivialLoss();
@@ -462,112 +724,88 @@ struct ErrorTraitsAnalytic<geometry::SphericalCamera, 1> {
   using Type = ReprojectionError3DAnalytic;
 };
 
-struct AddProjectionError {
+struct CreateProjectionError {
   template <class T>
-  static void Apply(bool use_analytical, const PointProjectionObservation &obs,
-                    ceres::LossFunction *loss, ceres::Problem *problem) {
+  static void Apply(bool use_analytical, bool is_rig_camera_useful,
+                    const PointProjectionObservation &obs,
+                    ceres::CostFunction **cost_function) {
     constexpr static int ErrorSize = ErrorTraits<T>::Type::Size;
     constexpr static int CameraSize = T::Size;
     constexpr static int ShotSize = 6;
 
-    const bool is_rig_camera_useful =
-        IsRigCameraUseful(*obs.shot->GetRigCamera());
-    ceres::CostFunction *cost_function = nullptr;
     if (use_analytical) {
       using ErrorType = typename ErrorTraitsAnalytic<T, CameraSize>::Type;
-      cost_function = new ErrorType(obs.camera->GetValue().GetProjectionType(),
-                                    obs.coordinates, obs.std_deviation,
-                                    is_rig_camera_useful);
+      *cost_function = new ErrorType(obs.camera->GetValue().GetProjectionType(),
+                                     obs.coordinates, obs.std_deviation,
+                                     is_rig_camera_useful);
     } else {
       using ErrorType = typename ErrorTraits<T>::Type;
-      cost_function =
+      *cost_function =
           new ceres::AutoDiffCostFunction<ErrorType, ErrorSize, CameraSize,
                                           ShotSize, ShotSize, 3>(new ErrorType(
               obs.camera->GetValue().GetProjectionType(), obs.coordinates,
               obs.std_deviation, is_rig_camera_useful));
     }
-    problem->AddResidualBlock(cost_function, loss,
-                              obs.camera->GetValueData().data(),
-                              obs.shot->GetRigInstance()->GetValueData().data(),
-                              obs.shot->GetRigCamera()->GetValueData().data(),
-                              obs.point->GetValueData().data());
   }
 };
 
-struct AddRelativeDepthError {
-  template <class T>
-  static void Apply(const PointProjectionObservation &obs,
-                    ceres::LossFunction *loss, ceres::Problem *problem) {
-    constexpr static int ShotSize = 6;
-    constexpr static int PointSize = 3;
-
-    if (!obs.depth_prior.has_value()) {
-      return;
-    }
-    const auto &depth = obs.depth_prior.value();
-    if (!std::isfinite(depth.value)) {
-      throw std::runtime_error(obs.shot->GetID() +
-                               " has non-finite depth prior");
-    }
-
-    const bool is_rig_camera_useful =
-        IsRigCameraUseful(*obs.shot->GetRigCamera());
-    ceres::CostFunction *cost_function = nullptr;
-
-    cost_function =
-        new ceres::AutoDiffCostFunction<RelativeDepthError,
-                                        RelativeDepthError::Size, ShotSize,
-                                        ShotSize, PointSize>(
-            new RelativeDepthError(depth.value, depth.std_deviation,
-                                   is_rig_camera_useful, depth.is_radial));
+ceres::CostFunction *CreateRelativeDepthError(
+    bool is_rig_camera_useful, const PointProjectionObservation &obs) {
+  constexpr static int ShotSize = 6;
+  constexpr static int PointSize = 3;
+
+  const auto &depth = obs.depth_prior.value();
+  return new ceres::AutoDiffCostFunction<RelativeDepthError,
+                                         RelativeDepthError::Size, ShotSize,
+                                         ShotSize, PointSize>(
+      new RelativeDepthError(depth.value, depth.std_deviation,
+                             is_rig_camera_useful, depth.is_radial));
+}
 
-    problem->AddResidualBlock(cost_function, loss,
-                              obs.shot->GetRigInstance()->GetValueData().data(),
-                              obs.shot->GetRigCamera()->GetValueData().data(),
-                              obs.point->GetValueData().data());
+struct ResidualErrorSize {
+  template <class T>
+  static void Apply(int *size) {
+    *size = ErrorTraits<T>::Type::Size;
   }
 };
 
 struct ComputeResidualError {
   template <class T>
   static void Apply(bool use_analytical,
-                    const PointProjectionObservation &obs) {
+                    const geometry::ProjectionType &projection_type,
+                    const PointProjectionObservation &obs, double *residuals) {
     const bool is_rig_camera_useful =
         IsRigCameraUseful(*obs.shot->GetRigCamera());
     if (use_analytical) {
       constexpr static int CameraSize = T::Size;
       using ErrorType = typename ErrorTraitsAnalytic<T, CameraSize>::Type;
-      constexpr static int ErrorSize = ErrorType::Size;
 
-      VecNd<ErrorSize> residuals;
-      ErrorType error(obs.camera->GetValue().GetProjectionType(),
-                      obs.coordinates, 1.0, is_rig_camera_useful);
+      ErrorType error(projection_type, obs.coordinates, 1.0,
+                      is_rig_camera_useful);
       const double *params[] = {
           obs.camera->GetValueData().data(),
           obs.shot->GetRigInstance()->GetValueData().data(),
           obs.shot->GetRigCamera()->GetValueData().data(),
           obs.point->GetValueData().data()};
-      error.Evaluate(params, residuals.data(), nullptr);
-      obs.point->reprojection_errors[obs.shot->GetID()] = residuals;
+      error.Evaluate(params, residuals, nullptr);
     } else {
       using ErrorType = typename ErrorTraits<T>::Type;
-      constexpr static int ErrorSize = ErrorType::Size;
 
-      VecNd<ErrorSize> residuals;
-      ErrorType error(obs.camera->GetValue().GetProjectionType(),
-                      obs.coordinates, 1.0, is_rig_camera_useful);
+      ErrorType error(projection_type, obs.coordinates, 1.0,
+                      is_rig_camera_useful);
       error(obs.camera->GetValueData().data(),
             obs.shot->GetRigInstance()->GetValueData().data(),
             obs.shot->GetRigCamera()->GetValueData().data(),
-            obs.point->GetValueData().data(), residuals.data());
-      obs.point->reprojection_errors[obs.shot->GetID()] = residuals;
+            obs.point->GetValueData().data(), residuals);
     }
   }
 };
 
 struct AddCameraPriorError {
   template <class T>
-  static void Apply(Camera &camera, ceres::Problem *problem) {
+  static void Apply(Camera &camera, ceres::Problem *problem,
+                    CostFunctions *cost_functions,
+                    std::vector<ceres::ResidualBlockId> *blocks) {
     auto *prior_function = new DataPriorError<geometry::Camera>(&camera);
 
     // Set some logarithmic prior for Focal and Aspect ratio (if any)
@@ -587,13 +825,162 @@ struct AddCameraPriorError {
         DataPriorError<geometry::Camera>>(prior_function);
     cost_function->SetNumResiduals(CameraSize);
     cost_function->AddParameterBlock(CameraSize);
-    problem->AddResidualBlock(cost_function, nullptr,
-                              camera.GetValueData().data());
+    cost_functions->emplace_back(cost_function);
+    blocks->push_back(problem->AddResidualBlock(
+        cost_function, nullptr, camera.GetValueData().data()));
   }
 };
 
+void BundleAdjuster::CreateProjectionCostFunctions() {
+  const int count = point_projection_observations_.size();
+  if (projection_cost_functions_analytic_ != use_analytic_) {
+    for (int i = 0; i < count; ++i) {
+      RemoveProjectionBlocks(point_projection_observations_[i].point_index,
+                             &projection_blocks_[i], &depth_blocks_[i]);
+      projection_cost_functions_[i].reset();
+      depth_cost_functions_[i].reset();
+    }
+    projection_cost_functions_analytic_ = use_analytic_;
+  }
+
+  // Observations without cost functions, or built for another rig setup
+  std::vector<int> outdated;
+  for (int i = 0; i < count; ++i) {
+    const bool is_rig_camera_useful = IsRigCameraUseful(
+        *point_projection_observations_[i].shot->GetRigCamera());
+    if (!projection_cost_functions_[i] ||
+        projection_rig_cameras_useful_[i] != is_rig_camera_useful) {
+      RemoveProjectionBlocks(point_projection_observations_[i].point_index,
+                             &projection_blocks_[i], &depth_blocks_[i]);
+      projection_rig_cameras_useful_[i] = is_rig_camera_useful;
+      outdated.push_back(i);
+    }
+  }
+
+  // Exceptions can't leave the parallel loop : keep the first observation
+  // having an invalid depth prior, and throw afterwards. Its projection cost
+  // function is left empty so that it is checked again on the next run.
+  const int outdated_count = outdated.size();
+  built_projection_cost_functions_count_ = outdated_count;
+  int invalid_depth = count;
+#pragma omp parallel for schedule(dynamic, 256) \
+    num_threads(std::max(num_threads_, 1)) reduction(min : invalid_depth)
+  for (int j = 0; j < outdated_count; ++j) {
+    const int i = outdated[j];
+    const auto &observation = point_projection_observations_[i];
+    const bool is_rig_camera_useful = projection_rig_cameras_useful_[i];
+
+    depth_cost_functions_[i].reset();
+    projection_cost_functions_[i].reset();
+    if (observation.depth_prior.has_value()) {
+      if (!std::isfinite(observation.depth_prior.value().value)) {
+        invalid_depth = std::min(invalid_depth, i);
+        continue;
+      }
+      depth_cost_functions_[i].reset(
+          CreateRelativeDepthError(is_rig_camera_useful, observation));
+    }
+
+    ceres::CostFunction *cost_function = nullptr;
+    geometry::Dispatch<CreateProjectionError>(
+        observation.camera->GetValue().GetProjectionType(), use_analytic_,
+        is_rig_camera_useful, observation, &cost_function);
+    projection_cost_functions_[i].reset(cost_function);
+  }
+
+  if (invalid_depth < count) {
+    throw std::runtime_error(
+        point_projection_observations_[invalid_depth].shot->GetID() +
+        " has non-finite depth prior");
+  }
+}
+
+void BundleAdjuster::ResetProblem() {
+  problem_.reset();
+  projection_loss_.reset();
+  std::fill(projection_blocks_.begin(), projection_blocks_.end(), nullptr);
+  std::fill(depth_blocks_.begin(), depth_blocks_.end(), nullptr);
+  std::fill(points_blocks_count_.begin(), points_blocks_count_.end(), 0);
+}
+
+void BundleAdjuster::RemoveProjectionBlocks(
+    int point_index, ceres::ResidualBlockId *projection_block,
+    ceres::ResidualBlockId *depth_block) {
+  if (*projection_block == nullptr) {
+    return;
+  }
+  problem_->RemoveResidualBlock(*projection_block);
+  if (*depth_block != nullptr) {
+    problem_->RemoveResidualBlock(*depth_block);
+  }
+  *projection_block = nullptr;
+  *depth_block = nullptr;
+  --points_blocks_count_[point_index];
+}
+
 void BundleAdjuster::Run() {
-  ceres::Problem problem;
+  // The problem owns neither the cost functions nor the losses : the ones
+  // created for this run only are kept here, so that they outlive the
+  // problem if it isn't kept or if the run fails
+  CostFunctions run_cost_functions;
+  LossFunctions run_losses;
+  try {
+    Solve(&run_cost_functions, &run_losses);
+  } catch (...) {
+    // Blocks of this run might be left in the problem
+    ResetProblem();
+    throw;
+  }
+  if (!keep_problem_) {
+    ResetProblem();
+  }
+}
+
+void BundleAdjuster::Solve(CostFunctions *run_cost_functions,
+                           LossFunctions *run_losses) {
+  // Build the costly projection cost functions first, then add the missing
+  // residual blocks serially. The blocks of the other constraints are added
+  // for this run only, and removed from the problem at its end.
+  CreateProjectionCostFunctions();
+
+  const auto own = [run_cost_functions](ceres::CostFunction *cost_function) {
+    run_cost_functions->emplace_back(cost_function);
+    return cost_function;
+  };
+  const auto own_loss = [run_losses](ceres::LossFunction *loss) {
+    run_losses->emplace_back(loss);
+    return loss;
+  };
+  std::vector<ceres::ResidualBlockId> run_blocks;
+
+  // Points are adjusted in a contiguous array, by index, for the locality of
+  // the residuals evaluations, and written back to the points after solving.
+  // Growing it moves the point blocks, which are then added to a new problem.
+  const int points_count = points_by_index_.size();
+  if (points_parameters_.cols() < points_count) {
+    ResetProblem();
+    const int capacity =
+        keep_problem_
+            ? std::max<int>(points_count, 2 * points_parameters_.cols())
+            : points_count;
+    points_parameters_.resize(Point::Parameter::NUM_PARAMS, capacity);
+  }
+  points_blocks_count_.resize(points_count, 0);
+  for (int p = 0; p < points_count; ++p) {
+    points_parameters_.col(p) = points_by_index_[p]->GetValueData();
+  }
+
+  if (!problem_) {
+    ceres::Problem::Options problem_options;
+    problem_options.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    // Removing blocks is otherwise linear in the size of the problem
+    problem_options.enable_fast_removal = keep_problem_;
+    problem_ = std::make_unique<ceres::Problem>(problem_options);
+    projection_loss_.reset(CreateLossFunction(
+        point_projection_loss_name_, point_projection_loss_threshold_));
+  }
+  auto &problem = *problem_;
 
   // Add cameras
   for (auto &[_, cam] : cameras_) {
@@ -603,6 +990,8 @@ void BundleAdjuster::Run() {
     // Lock parameters based on bitmask of parameters : only constant for now
     if (cam.GetParametersToOptimize().empty()) {
       problem.SetParameterBlockConstant(data.data());
+    } else {
+      problem.SetParameterBlockVariable(data.data());
     }
 
     // Add a barrier for constraining transition of dual to stay in [0, 1]
@@ -620,7 +1009,8 @@ void BundleAdjuster::Run() {
             new ceres::AutoDiffCostFunction<ParameterBarrier, 1,
                                             geometry::DualCamera::Size>(
                 new ParameterBarrier(0.0, 1.0, index));
-        problem.AddResidualBlock(transition_barrier, nullptr, data.data());
+        run_blocks.push_back(problem.AddResidualBlock(
+            own(transition_barrier), nullptr, data.data()));
       }
     }
   }
@@ -633,6 +1023,8 @@ void BundleAdjuster::Run() {
     // Lock parameters based on bitmask of parameters : only constant for now
     if (b.second.GetParametersToOptimize().empty()) {
       problem.SetParameterBlockConstant(data.data());
+    } else {
+      problem.SetParameterBlockVariable(data.data());
     }
   }
 
@@ -644,6 +1036,8 @@ void BundleAdjuster::Run() {
     // Lock parameters based on bitmask of parameters : only constant for now
     if (rc.second.GetParametersToOptimize().empty()) {
       problem.SetParameterBlockConstant(data.data());
+    } else {
+      problem.SetParameterBlockVariable(data.data());
     }
   }
 
@@ -655,17 +1049,8 @@ void BundleAdjuster::Run() {
     // Lock parameters based on bitmask of parameters : only constant for now
     if (ri.second.GetParametersToOptimize().empty()) {
       problem.SetParameterBlockConstant(data.data());
-    }
-  }
-
-  // Add points
-  for (auto &p : points_) {
-    auto &data = p.second.GetValueData();
-    problem.AddParameterBlock(data.data(), data.size());
-
-    // Lock parameters based on bitmask of parameters : only constant for now
-    if (p.second.GetParametersToOptimize().empty()) {
-      problem.SetParameterBlockConstant(data.data());
+    } else {
+      problem.SetParameterBlockVariable(data.data());
     }
   }
 
@@ -677,6 +1062,7 @@ void BundleAdjuster::Run() {
         problem.SetParameterBlockConstant(&s.second);
       } else {
         problem.AddParameterBlock(&s.second, 1);
+        problem.SetParameterBlockVariable(&s.second);
         problem.SetParameterLowerBound(&s.second, 0, 0.0);
         problem.SetParameterUpperBound(&s.second, 0,
                                        std::numeric_limits<double>::max());
@@ -685,12 +1071,13 @@ void BundleAdjuster::Run() {
   }
 
   // New generic prior errors (only rig instances + rig models + points for now)
-  for (auto &i : points_) {
-    if (!i.second.HasPrior()) {
+  for (int p = 0; p < points_count; ++p) {
+    auto *point = points_by_index_[p];
+    if (!point->HasPrior()) {
       continue;
     }
-    auto *position_prior = new DataPriorError<Vec3d>(&i.second);
-    if (i.second.has_altitude_prior) {
+    auto *position_prior = new DataPriorError<Vec3d>(point);
+    if (point->has_altitude_prior) {
       position_prior->SetConstrainedDataIndexes(
           {Point::Parameter::PX, Point::Parameter::PY, Point::Parameter::PZ});
     } else {
@@ -700,11 +1087,11 @@ void BundleAdjuster::Run() {
     auto *cost_function =
         new ceres::DynamicAutoDiffCostFunction<DataPriorError<Vec3d>>(
             position_prior);
-    cost_function->SetNumResiduals(i.second.has_altitude_prior ? 3 : 2);
+    cost_function->SetNumResiduals(point->has_altitude_prior ? 3 : 2);
     cost_function->AddParameterBlock(3);
 
-    problem.AddResidualBlock(cost_function, nullptr,
-                             i.second.GetValueData().data());
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), nullptr, points_parameters_.col(p).data()));
   }
 
   // Gather scale groups for rig instance priors
@@ -730,8 +1117,8 @@ void BundleAdjuster::Run() {
       ceres::CostFunction *std_dev_cost_function =
           new ceres::AutoDiffCostFunction<StdDeviationConstraint, 1, 1>(
               new StdDeviationConstraint());
-      problem.AddResidualBlock(std_dev_cost_function, nullptr,
-                               &std_deviations[i]);
+      run_blocks.push_back(problem.AddResidualBlock(
+          own(std_dev_cost_function), nullptr, &std_deviations[i]));
     }
   } else {
     for (int i = 0; i < std_deviations.size(); ++i) {
@@ -770,9 +1157,9 @@ void BundleAdjuster::Run() {
     cost_function->AddParameterBlock(Pose::Parameter::NUM_PARAMS);
     cost_function->AddParameterBlock(Similarity::Parameter::NUM_PARAMS);
     cost_function->AddParameterBlock(1);
-    problem.AddResidualBlock(
-        cost_function, nullptr, i.second.GetValueData().data(),
-        maybe_bias->second.GetValueData().data(), scale_param);
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), nullptr, i.second.GetValueData().data(),
+        maybe_bias->second.GetValueData().data(), scale_param));
   }
   for (auto &rc : rig_cameras_) {
     if (!rc.second.HasPrior()) {
@@ -784,40 +1171,74 @@ void BundleAdjuster::Run() {
             pose_prior);
     cost_function->SetNumResiduals(Pose::Parameter::NUM_PARAMS);
     cost_function->AddParameterBlock(Pose::Parameter::NUM_PARAMS);
-    problem.AddResidualBlock(cost_function, nullptr,
-                             rc.second.GetValueData().data());
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), nullptr, rc.second.GetValueData().data()));
   }
   // Add internal parameter priors blocks
   for (auto &i : cameras_) {
     const auto projection_type = i.second.GetValue().GetProjectionType();
     geometry::Dispatch<AddCameraPriorError>(projection_type, i.second,
-                                            &problem);
+                                            &problem, run_cost_functions,
+                                            &run_blocks);
   }
 
-  // Add reprojection error blocks
-  ceres::LossFunction *projection_loss =
-      point_projection_observations_.empty()
-          ? nullptr
-          : CreateLossFunction(point_projection_loss_name_,
-                               point_projection_loss_threshold_);
-
-  for (auto &observation : point_projection_observations_) {
-    const auto projection_type =
-        observation.camera->GetValue().GetProjectionType();
-    geometry::Dispatch<AddProjectionError>(
-        projection_type, use_analytic_, observation, projection_loss, &problem);
+  // Only the observations having some non-constant parameter have blocks :
+  // the missing ones are added, and the ones whose parameters all became
+  // constant, such as outside of a local bundle, are removed, so that the
+  // problem of local bundles stays as small as their neighborhood
+  for (int i = 0; i < point_projection_observations_.size(); ++i) {
+    const auto &observation = point_projection_observations_[i];
+    if (IsProjectionObservationConstant(observation)) {
+      RemoveProjectionBlocks(observation.point_index, &projection_blocks_[i],
+                             &depth_blocks_[i]);
+      continue;
+    }
+    if (projection_blocks_[i] != nullptr) {
+      continue;
+    }
+    auto *rig_instance_data =
+        observation.shot->GetRigInstance()->GetValueData().data();
+    auto *rig_camera_data =
+        observation.shot->GetRigCamera()->GetValueData().data();
+    auto *point_data = points_parameters_.col(observation.point_index).data();
+    projection_blocks_[i] = problem.AddResidualBlock(
+        projection_cost_functions_[i].get(), projection_loss_.get(),
+        observation.camera->GetValueData().data(), rig_instance_data,
+        rig_camera_data, point_data);
+    ++points_blocks_count_[observation.point_index];
 
     // Add relative depth error blocks
-    geometry::Dispatch<AddRelativeDepthError>(projection_type, observation,
-                                              projection_loss, &problem);
+    if (depth_cost_functions_[i]) {
+      depth_blocks_[i] = problem.AddResidualBlock(
+          depth_cost_functions_[i].get(), projection_loss_.get(),
+          rig_instance_data, rig_camera_data, point_data);
+    }
+  }
+
+  // Points are only added along with their residual blocks, so that the
+  // ones unused by runs adjusting a small part of the problem cost nothing,
+  // and removed once their observations are
+  for (int p = 0; p < points_count; ++p) {
+    auto *data = points_parameters_.col(p).data();
+    if (!problem.HasParameterBlock(data)) {
+      continue;
+    }
+    const auto *point = points_by_index_[p];
+    if (points_blocks_count_[p] == 0 && !point->HasPrior()) {
+      problem.RemoveParameterBlock(data);
+    } else if (point->GetParametersToOptimize().empty()) {
+      problem.SetParameterBlockConstant(data);
+    } else {
+      problem.SetParameterBlockVariable(data);
+    }
   }
 
   // Add relative motion errors
   for (auto &rp : relative_motions_) {
     double robust_threshold =
         relative_motion_loss_threshold_ * rp.robust_multiplier;
-    ceres::LossFunction *relative_motion_loss =
-        CreateLossFunction(relative_motion_loss_name_, robust_threshold);
+    ceres::LossFunction *relative_motion_loss = own_loss(
+        CreateLossFunction(relative_motion_loss_name_, robust_threshold));
 
     auto *relative_motion = new RelativeMotionError(
         rp.parameters, rp.scale_matrix, rp.observed_scale);
@@ -848,16 +1269,16 @@ void BundleAdjuster::Run() {
       parameter_blocks.push_back(scale_j);
     }
 
-    problem.AddResidualBlock(cost_function, relative_motion_loss,
-                             parameter_blocks);
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), relative_motion_loss, parameter_blocks));
   }
 
   // Add relative rotation errors
   ceres::LossFunction *relative_rotation_loss =
       relative_rotations_.empty()
           ? nullptr
-          : CreateLossFunction(relative_motion_loss_name_,
-                               relative_motion_loss_threshold_);
+          : own_loss(CreateLossFunction(relative_motion_loss_name_,
+                                        relative_motion_loss_threshold_));
   for (auto &rr : relative_rotations_) {
     auto *relative_rotation =
         new RelativeRotationError(rr.rotation, rr.scale_matrix);
@@ -893,15 +1314,15 @@ void BundleAdjuster::Run() {
             relative_rotation->shot_i_rig_camera_index_;
       }
     }
-    problem.AddResidualBlock(cost_function, relative_rotation_loss,
-                             parameter_blocks);
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), relative_rotation_loss, parameter_blocks));
   }
 
   // Add common position errors
   ceres::LossFunction *common_position_loss = nullptr;
   for (auto &c : common_positions_) {
     if (common_position_loss == nullptr) {
-      common_position_loss = new ceres::TukeyLoss(1);
+      common_position_loss = own_loss(new ceres::TukeyLoss(1));
     }
     auto *common_position = new CommonPositionError(c.margin, c.std_deviation);
     auto *cost_function =
@@ -936,8 +1357,8 @@ void BundleAdjuster::Run() {
             common_position->shot_i_rig_camera_index_;
       }
     }
-    problem.AddResidualBlock(cost_function, common_position_loss,
-                             parameter_blocks);
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), common_position_loss, parameter_blocks));
   }
 
   // Add heatmap cost
@@ -946,9 +1367,10 @@ void BundleAdjuster::Run() {
         a.heatmap->interpolator, a.x_offset, a.y_offset, a.heatmap->height,
         a.heatmap->width, a.heatmap->resolution, a.std_deviation);
     auto &shot = shots_.at(a.shot_id);
-    problem.AddResidualBlock(cost_function, nullptr,
-                             shot.GetRigInstance()->GetValueData().data(),
-                             shot.GetRigCamera()->GetValueData().data());
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), nullptr,
+        shot.GetRigInstance()->GetValueData().data(),
+        shot.GetRigCamera()->GetValueData().data()));
   }
 
   // Add absolute up vector errors
@@ -956,16 +1378,17 @@ void BundleAdjuster::Run() {
   for (auto &a : absolute_up_vectors_) {
     if (a.std_deviation > 0) {
       if (up_vector_loss == nullptr) {
-        up_vector_loss = new ceres::CauchyLoss(1);
+        up_vector_loss = own_loss(new ceres::CauchyLoss(1));
       }
 
       ceres::CostFunction *up_cost_function =
           new ceres::AutoDiffCostFunction<UpVectorError, 3, 6, 6>(
               new UpVectorError(a.up_vector, a.std_deviation));
       auto &shot = shots_.at(a.shot_id);
-      problem.AddResidualBlock(up_cost_function, up_vector_loss,
-                               shot.GetRigInstance()->GetValueData().data(),
-                               shot.GetRigCamera()->GetValueData().data());
+      run_blocks.push_back(problem.AddResidualBlock(
+          own(up_cost_function), up_vector_loss,
+          shot.GetRigInstance()->GetValueData().data(),
+          shot.GetRigCamera()->GetValueData().data()));
     }
   }
 
@@ -974,15 +1397,16 @@ void BundleAdjuster::Run() {
   for (auto &a : absolute_pans_) {
     if (a.std_deviation > 0) {
       if (pan_loss == nullptr) {
-        pan_loss = new ceres::CauchyLoss(1);
+        pan_loss = own_loss(new ceres::CauchyLoss(1));
       }
       ceres::CostFunction *pan_cost_function =
           new ceres::AutoDiffCostFunction<PanAngleError, 1, 6, 6>(
               new PanAngleError(a.angle, a.std_deviation));
       auto &shot = shots_.at(a.shot_id);
-      problem.AddResidualBlock(pan_cost_function, pan_loss,
-                               shot.GetRigInstance()->GetValueData().data(),
-                               shot.GetRigCamera()->GetValueData().data());
+      run_blocks.push_back(problem.AddResidualBlock(
+          own(pan_cost_function), pan_loss,
+          shot.GetRigInstance()->GetValueData().data(),
+          shot.GetRigCamera()->GetValueData().data()));
     }
   }
 
@@ -991,15 +1415,16 @@ void BundleAdjuster::Run() {
   for (auto &a : absolute_tilts_) {
     if (a.std_deviation > 0) {
       if (tilt_loss == nullptr) {
-        tilt_loss = new ceres::CauchyLoss(1);
+        tilt_loss = own_loss(new ceres::CauchyLoss(1));
       }
       ceres::CostFunction *tilt_cost_function =
           new ceres::AutoDiffCostFunction<TiltAngleError, 1, 6, 6>(
               new TiltAngleError(a.angle, a.std_deviation));
       auto &shot = shots_.at(a.shot_id);
-      problem.AddResidualBlock(tilt_cost_function, tilt_loss,
-                               shot.GetRigInstance()->GetValueData().data(),
-                               shot.GetRigCamera()->GetValueData().data());
+      run_blocks.push_back(problem.AddResidualBlock(
+          own(tilt_cost_function), tilt_loss,
+          shot.GetRigInstance()->GetValueData().data(),
+          shot.GetRigCamera()->GetValueData().data()));
     }
   }
 
@@ -1008,15 +1433,16 @@ void BundleAdjuster::Run() {
   for (auto &a : absolute_rolls_) {
     if (a.std_deviation > 0) {
       if (roll_loss == nullptr) {
-        roll_loss = new ceres::CauchyLoss(1);
+        roll_loss = own_loss(new ceres::CauchyLoss(1));
       }
       ceres::CostFunction *roll_cost_function =
           new ceres::AutoDiffCostFunction<RollAngleError, 1, 6, 6>(
               new RollAngleError(a.angle, a.std_deviation));
       auto &shot = shots_.at(a.shot_id);
-      problem.AddResidualBlock(roll_cost_function, roll_loss,
-                               shot.GetRigInstance()->GetValueData().data(),
-                               shot.GetRigCamera()->GetValueData().data());
+      run_blocks.push_back(problem.AddResidualBlock(
+          own(roll_cost_function), roll_loss,
+          shot.GetRigInstance()->GetValueData().data(),
+          shot.GetRigCamera()->GetValueData().data()));
     }
   }
 
@@ -1024,7 +1450,7 @@ void BundleAdjuster::Run() {
   ceres::LossFunction *linear_motion_prior_loss_ = nullptr;
   for (auto &a : linear_motion_prior_) {
     if (linear_motion_prior_loss_ == nullptr) {
-      linear_motion_prior_loss_ = new ceres::CauchyLoss(1);
+      linear_motion_prior_loss_ = own_loss(new ceres::CauchyLoss(1));
     }
 
     auto *linear_motion = new LinearMotionError(
@@ -1077,8 +1503,8 @@ void BundleAdjuster::Run() {
             linear_motion->shot0_rig_camera_index;
       }
     }
-    problem.AddResidualBlock(cost_function, linear_motion_prior_loss_,
-                             parameter_blocks);
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), linear_motion_prior_loss_, parameter_blocks));
   }
 
   // Gauge fix
@@ -1094,9 +1520,9 @@ void BundleAdjuster::Run() {
         new ceres::AutoDiffCostFunction<TranslationPriorError, 1, 6, 6>(
             new TranslationPriorError(norm));
 
-    problem.AddResidualBlock(cost_function, nullptr,
-                             instance1->GetValueData().data(),
-                             instance2->GetValueData().data());
+    run_blocks.push_back(problem.AddResidualBlock(
+        own(cost_function), nullptr, instance1->GetValueData().data(),
+        instance2->GetValueData().data()));
   }
 
   // Solve
@@ -1111,18 +1537,53 @@ void BundleAdjuster::Run() {
 
   ceres::Solve(options, &problem, &last_run_summary_);
 
+  for (int p = 0; p < points_count; ++p) {
+    points_by_index_[p]->GetValueData() = points_parameters_.col(p);
+  }
+
   if (compute_covariances_) {
     ComputeCovariances(&problem);
   }
+
+  // The blocks of the other constraints are rebuilt on each run
+  if (keep_problem_) {
+    for (auto *block : run_blocks) {
+      problem.RemoveResidualBlock(block);
+    }
+    for (auto &std_deviation : std_deviations) {
+      problem.RemoveParameterBlock(&std_deviation);
+    }
+  }
+
   if (compute_reprojection_errors_) {
     ComputeReprojectionErrors();
   }
 }
 
 void BundleAdjuster::ComputeCovariances(ceres::Problem *problem) {
-  bool computed = false;
+  std::vector<RigInstance *> instances;
+  if (covariance_shots_.empty()) {
+    for (auto &i : rig_instances_) {
+      instances.push_back(&i.second);
+    }
+  } else {
+    std::set<RigInstance *> shots_instances;
+    for (const auto &shot_id : covariance_shots_) {
+      shots_instances.insert(shots_.at(shot_id).GetRigInstance());
+    }
+    instances.assign(shots_instances.begin(), shots_instances.end());
+  }
 
+  bool computed = false;
   if (last_run_summary_.termination_type != ceres::FAILURE) {
+    if (covariance_algorithm_type_ == "SCHUR_BLOCK_DIAGONAL") {
+      // Instances are checked individually, and get a default covariance
+      // on failure
+      covariance_estimation_valid_ =
+          ComputeSchurBlockDiagonalCovariances(problem, instances);
+      return;
+    }
+
     ceres::Covariance::Options options;
     if (!ceres::StringToCovarianceAlgorithmType(covariance_algorithm_type_,
                                                 &options.algorithm_type)) {
@@ -1132,24 +1593,22 @@ void BundleAdjuster::ComputeCovariances(ceres::Problem *problem) {
     ceres::Covariance covariance(options);
 
     std::vector<std::pair<const double *, const double *>> covariance_blocks;
-    for (auto &i : shots_) {
-      covariance_blocks.emplace_back(
-          i.second.GetRigInstance()->GetValueData().data(),
-          i.second.GetRigInstance()->GetValueData().data());
+    for (auto *instance : instances) {
+      covariance_blocks.emplace_back(instance->GetValueData().data(),
+                                     instance->GetValueData().data());
     }
 
     bool worked = covariance.Compute(covariance_blocks, problem);
 
     if (worked) {
-      for (auto &i : shots_) {
+      for (auto *instance : instances) {
         covariance_estimation_valid_ = true;
 
         MatXd covariance_matrix(6, 6);
-        if (covariance.GetCovarianceBlock(
-                i.second.GetRigInstance()->GetValueData().data(),
-                i.second.GetRigInstance()->GetValueData().data(),
-                covariance_matrix.data())) {
-          i.second.GetRigInstance()->SetCovariance(covariance_matrix);
+        if (covariance.GetCovarianceBlock(instance->GetValueData().data(),
+                                          instance->GetValueData().data(),
+                                          covariance_matrix.data())) {
+          instance->SetCovariance(covariance_matrix);
         }
       }
       computed = true;
@@ -1160,55 +1619,256 @@ void BundleAdjuster::ComputeCovariances(ceres::Problem *problem) {
   //       So maybe we can find a better solution
   if (computed) {
     // Check for NaNs
-    for (auto &i : shots_) {
-      if (!i.second.GetRigInstance()->HasCovariance() ||
-          !i.second.GetRigInstance()->GetCovariance().allFinite()) {
+    for (auto *instance : instances) {
+      if (!instance->HasCovariance() ||
+          !instance->GetCovariance().allFinite()) {
         covariance_estimation_valid_ = false;
         computed = false;
         break;
       }
-      // stop after first Nan value
-      if (!computed) {
-        break;
-      }
     }
   }
 
   // If covariance estimation failed, use a default value
   if (!computed) {
     covariance_estimation_valid_ = false;
+    for (auto *instance : instances) {
+      instance->SetCovariance(DefaultRigInstanceCovariance());
+    }
+  }
+}
 
-    MatXd default_covariance_matrix = MatXd::Zero(6, 6);
-    double default_rotation_variance = 1e-5;
-    double default_translation_variance = 1e-2;
-    default_covariance_matrix.diagonal().segment<3>(0).setConstant(
-        default_rotation_variance);
-    default_covariance_matrix.diagonal().segment<3>(3).setConstant(
-        default_translation_variance);
-    for (auto &i : shots_) {
-      i.second.GetRigInstance()->SetCovariance(default_covariance_matrix);
+bool BundleAdjuster::ComputeSchurBlockDiagonalCovariances(
+    ceres::Problem *problem, const std::vector<RigInstance *> &instances) {
+  constexpr int InstanceSize = 6;
+  constexpr int PointSize = 3;
+
+  // Jacobian of the residuals wrt. the adjusted instances and points, the
+  // other parameters being held constant. Constant instances are known, and
+  // instances without residuals are unconstrained.
+  bool valid = true;
+  std::vector<RigInstance *> adjusted_instances;
+  for (auto *instance : instances) {
+    if (instance->GetParametersToOptimize().empty()) {
+      instance->SetCovariance(MatXd::Zero(InstanceSize, InstanceSize));
+    } else if (!problem->HasParameterBlock(instance->GetValueData().data())) {
+      instance->SetCovariance(DefaultRigInstanceCovariance());
+      valid = false;
+    } else {
+      adjusted_instances.push_back(instance);
+    }
+  }
+  ceres::Problem::EvaluateOptions options;
+  for (auto *instance : adjusted_instances) {
+    options.parameter_blocks.push_back(instance->GetValueData().data());
+  }
+  const int instances_count = adjusted_instances.size();
+  for (int p = 0; p < points_by_index_.size(); ++p) {
+    auto *data = points_parameters_.col(p).data();
+    if (!points_by_index_[p]->GetParametersToOptimize().empty() &&
+        problem->HasParameterBlock(data)) {
+      options.parameter_blocks.push_back(data);
+    }
+  }
+  options.num_threads = num_threads_;
+  ceres::CRSMatrix jacobian;
+  if (instances_count == 0 ||
+      !problem->Evaluate(options, nullptr, nullptr, nullptr, &jacobian)) {
+    for (auto *instance : adjusted_instances) {
+      instance->SetCovariance(DefaultRigInstanceCovariance());
+    }
+    return valid && instances_count == 0;
+  }
+
+  // Parameter block of each column : instances, then points
+  const int blocks_count = options.parameter_blocks.size();
+  std::vector<int> columns_blocks(jacobian.num_cols);
+  for (int b = 0; b < blocks_count; ++b) {
+    const int begin = b < instances_count
+                          ? b * InstanceSize
+                          : instances_count * InstanceSize +
+                                (b - instances_count) * PointSize;
+    const int size = b < instances_count ? InstanceSize : PointSize;
+    std::fill(columns_blocks.begin() + begin,
+              columns_blocks.begin() + begin + size, b);
+  }
+
+  // Blocks of each row, as (block, first value) entries, and rows of each
+  // block. The columns of a block are contiguous in a row.
+  std::vector<int> rows_entries(jacobian.num_rows + 1, 0);
+  std::vector<std::pair<int, int>> entries;
+  std::vector<int> blocks_entries_count(blocks_count + 1, 0);
+  for (int r = 0; r < jacobian.num_rows; ++r) {
+    for (int k = jacobian.rows[r]; k < jacobian.rows[r + 1]; ++k) {
+      const int block = columns_blocks[jacobian.cols[k]];
+      if (k == jacobian.rows[r] || block != entries.back().first) {
+        entries.emplace_back(block, k);
+        ++blocks_entries_count[block + 1];
+      }
+    }
+    rows_entries[r + 1] = entries.size();
+  }
+  std::vector<int> blocks_entries_offsets(blocks_count + 1, 0);
+  std::partial_sum(blocks_entries_count.begin(), blocks_entries_count.end(),
+                   blocks_entries_offsets.begin());
+  std::vector<std::pair<int, int>> blocks_entries(entries.size());
+  {
+    auto next = blocks_entries_offsets;
+    for (int r = 0; r < jacobian.num_rows; ++r) {
+      for (int e = rows_entries[r]; e < rows_entries[r + 1]; ++e) {
+        blocks_entries[next[entries[e].first]++] =
+            std::make_pair(r, entries[e].second);
+      }
+    }
+  }
+
+  // Pseudo-inverse of the information of each point, as points seen once
+  // are not constrained along their ray
+  const int points_count = blocks_count - instances_count;
+  std::vector<Mat3d> points_covariances(points_count);
+#pragma omp parallel for schedule(dynamic, 256) \
+    num_threads(std::max(num_threads_, 1))
+  for (int p = 0; p < points_count; ++p) {
+    const int block = instances_count + p;
+    Mat3d information = Mat3d::Zero();
+    for (int e = blocks_entries_offsets[block];
+         e < blocks_entries_offsets[block + 1]; ++e) {
+      const Eigen::Map<const Vec3d> j(
+          &jacobian.values[blocks_entries[e].second]);
+      information += j * j.transpose();
+    }
+    const Eigen::SelfAdjointEigenSolver<Mat3d> solver(information);
+    const Vec3d &values = solver.eigenvalues();
+    const double threshold = 1e-12 * std::max(values.maxCoeff(), 1e-300);
+    const Vec3d inverse_values =
+        (values.array() > threshold).select(values.cwiseInverse(), 0.);
+    points_covariances[p] = solver.eigenvectors() *
+                            inverse_values.asDiagonal() *
+                            solver.eigenvectors().transpose();
+  }
+
+  // Schur complement of the points in the diagonal block of each instance
+  using Vec6d = Eigen::Matrix<double, InstanceSize, 1>;
+  using Mat6d = Eigen::Matrix<double, InstanceSize, InstanceSize>;
+  using Mat63d = Eigen::Matrix<double, InstanceSize, PointSize>;
+  int all_valid = valid;
+#pragma omp parallel for schedule(dynamic) \
+    num_threads(std::max(num_threads_, 1)) reduction(min : all_valid)
+  for (int i = 0; i < instances_count; ++i) {
+    Mat6d reduced = Mat6d::Zero();
+    std::map<int, Mat63d, std::less<int>,
+             Eigen::aligned_allocator<std::pair<const int, Mat63d>>>
+        cross_informations;
+    for (int e = blocks_entries_offsets[i]; e < blocks_entries_offsets[i + 1];
+         ++e) {
+      const int r = blocks_entries[e].first;
+      const Eigen::Map<const Vec6d> j(
+          &jacobian.values[blocks_entries[e].second]);
+      reduced += j * j.transpose();
+      for (int f = rows_entries[r]; f < rows_entries[r + 1]; ++f) {
+        const int block = entries[f].first;
+        if (block < instances_count) {
+          continue;
+        }
+        const Eigen::Map<const Vec3d> j_point(
+            &jacobian.values[entries[f].second]);
+        auto cross = cross_informations.find(block);
+        if (cross == cross_informations.end()) {
+          cross = cross_informations.emplace(block, Mat63d::Zero()).first;
+        }
+        cross->second += j * j_point.transpose();
+      }
+    }
+    for (const auto &[block, cross] : cross_informations) {
+      reduced -= cross * points_covariances[block - instances_count] *
+                 cross.transpose();
+    }
+
+    const Eigen::LLT<Mat6d> llt(reduced);
+    MatXd covariance = llt.solve(Mat6d::Identity());
+    if (llt.info() != Eigen::Success || !covariance.allFinite()) {
+      covariance = DefaultRigInstanceCovariance();
+      all_valid = 0;
     }
+    adjusted_instances[i]->SetCovariance(covariance);
   }
+  return all_valid;
 }
 
 void BundleAdjuster::ComputeReprojectionErrors() {
-  // Init errors
-  for (auto &i : points_) {
-    i.second.reprojection_errors.clear();
+  const int shots_count = shots_by_index_.size();
+  const int points_count = points_by_index_.size();
+  const int count = point_projection_observations_.size();
+
+  // Shots can only be added, so the ids of the previous runs are kept until
+  // new shots appear
+  if (!shot_ids_ || static_cast<int>(shot_ids_->size()) != shots_count) {
+    auto shot_ids = std::make_shared<std::vector<std::string>>();
+    shot_ids->reserve(shots_count);
+    for (const auto *shot : shots_by_index_) {
+      shot_ids->push_back(shot->GetID());
+    }
+    shot_ids_ = std::move(shot_ids);
+  }
+
+  auto errors = std::make_shared<map::ReprojectionErrors>();
+  errors->shot_ids = shot_ids_;
+  std::vector<geometry::ProjectionType> shots_projection_types(shots_count);
+  std::vector<int> shots_residuals_sizes(shots_count);
+  for (int i = 0; i < shots_count; ++i) {
+    shots_projection_types[i] =
+        shots_cameras_by_index_[i]->GetValue().GetProjectionType();
+    geometry::Dispatch<ResidualErrorSize>(shots_projection_types[i],
+                                          &shots_residuals_sizes[i]);
   }
 
-  for (auto &observation : point_projection_observations_) {
-    const auto projection_type =
-        observation.camera->GetValue().GetProjectionType();
-    geometry::Dispatch<ComputeResidualError>(projection_type, use_analytic_,
-                                             observation);
+  // Entries of the observations, grouped by point. Constant observations,
+  // which aren't adjusted, have one as well for outliers to be detected.
+  points_reprojection_errors_.assign(points_count + 1, 0);
+  for (const auto &observation : point_projection_observations_) {
+    ++points_reprojection_errors_[observation.point_index + 1];
+  }
+  std::partial_sum(points_reprojection_errors_.begin(),
+                   points_reprojection_errors_.end(),
+                   points_reprojection_errors_.begin());
+  const int entries_count = points_reprojection_errors_.back();
+  std::vector<int> observations_entries(count);
+  errors->shots.resize(entries_count);
+  errors->offsets.assign(entries_count + 1, 0);
+  auto next_entries = points_reprojection_errors_;
+  for (int i = 0; i < count; ++i) {
+    const auto &observation = point_projection_observations_[i];
+    const int entry = next_entries[observation.point_index]++;
+    observations_entries[i] = entry;
+    errors->shots[entry] = observation.shot_index;
+    errors->offsets[entry + 1] = shots_residuals_sizes[observation.shot_index];
   }
+  std::partial_sum(errors->offsets.begin(), errors->offsets.end(),
+                   errors->offsets.begin());
+  errors->values.resize(errors->offsets.back());
+
+#pragma omp parallel for schedule(static) \
+    num_threads(std::max(num_threads_, 1))
+  for (int i = 0; i < count; ++i) {
+    const int entry = observations_entries[i];
+    const auto &observation = point_projection_observations_[i];
+    const auto &projection_type =
+        shots_projection_types[observation.shot_index];
+    geometry::Dispatch<ComputeResidualError>(
+        projection_type, use_analytic_, projection_type, observation,
+        errors->values.data() + errors->offsets[entry]);
+  }
+  reprojection_errors_ = std::move(errors);
 }
 
 int BundleAdjuster::GetProjectionsCount() const {
   return point_projection_observations_.size();
 }
 
+int BundleAdjuster::GetBuiltProjectionCostFunctionsCount() const {
+  return built_projection_cost_functions_count_;
+}
+
 int BundleAdjuster::GetRelativeMotionsCount() const {
   return relative_motions_.size();
 }
@@ -1234,10 +1894,26 @@ Point BundleAdjuster::GetPoint(const std::string &id) const {
   return points_.at(id);
 }
 
+const Point &BundleAdjuster::GetPoint(int point_index) const {
+  return *points_by_index_.at(point_index);
+}
+
 bool BundleAdjuster::HasPoint(const std::string &id) const {
   return points_.find(id) != points_.end();
 }
 
+bool BundleAdjuster::HasCamera(const std::string &id) const {
+  return cameras_.find(id) != cameras_.end();
+}
+
+bool BundleAdjuster::HasRigCamera(const std::string &rig_camera_id) const {
+  return rig_cameras_.find(rig_camera_id) != rig_cameras_.end();
+}
+
+bool BundleAdjuster::HasRigInstance(const std::string &instance_id) const {
+  return rig_instances_.find(instance_id) != rig_instances_.end();
+}
+
 Reconstruction BundleAdjuster::GetReconstruction(
     const std::string &reconstruction_id) const {
   const auto it = reconstructions_.find(reconstruction_id);
@@ -1263,6 +1939,26 @@ RigInstance BundleAdjuster::GetRigInstance(
   return rig_instances_.at(instance_id);
 }
 
+MatXd BundleAdjuster::GetRigInstanceCovariance(
+    const std::string &instance_id) const {
+  return GetRigInstance(instance_id).GetCovariance();
+}
+
+std::shared_ptr<const map::ReprojectionErrors>
+BundleAdjuster::GetReprojectionErrors() const {
+  return reprojection_errors_;
+}
+
+std::pair<int, int> BundleAdjuster::GetPointReprojectionErrorsRange(
+    int point_index) const {
+  if (point_index < 0 ||
+      point_index + 1 >= static_cast<int>(points_reprojection_errors_.size())) {
+    return std::make_pair(0, 0);
+  }
+  return std::make_pair(points_reprojection_errors_[point_index],
+                        points_reprojection_errors_[point_index + 1]);
+}
+
 std::map<std::string, RigCamera> BundleAdjuster::GetRigCameras() const {
   return rig_cameras_;
 }
@@ -1277,4 +1973,12 @@ std::string BundleAdjuster::BriefReport() const {
 std::string BundleAdjuster::FullReport() const {
   return last_run_summary_.FullReport();
 }
+
+double BundleAdjuster::GetInitialCost() const {
+  return last_run_summary_.initial_cost;
+}
+
+double BundleAdjuster::GetFinalCost() const {
+  return last_run_summary_.final_cost;
+}
 }  // namespace bundle
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <features/neighbors.h>
+#include <foundation/python_types.h>
+#include <foundation/types.h>
+
+#include <utility>
+#include <vector>
+
+namespace features {
+
+using RowMatXf =
+    Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// Hierarchical k-means tree over the words of a vocabulary, for approximate
+// nearest words search. Words are recursively clustered in branching
+// clusters, until clusters have at most branching words.
+class VocabularyTree {
+ public:
+  VocabularyTree(const MatXf &words, int branching, int iterations);
+
+  int WordsCount() const { return words_.rows(); }
+  int WordsSize() const { return words_.cols(); }
+
+  // Indexes of the k nearest words of a descriptor, sorted by increasing
+  // distance and padded with -1. The tree is explored best-bin-first until
+  // at least max_checks words have been compared.
+  void NearestWords(const float *descriptor, int k, int max_checks,
+                    int *words) const;
+
+ private:
+  struct Node {
+    // Children are contiguous nodes, leaves have none
+    int first_child;
+    int children_count;
+    // Range of the node words in words_order_
+    int begin;
+    int end;
+  };
+
+  void Split(int node, int branching, int iterations);
+
+  RowMatXf words_;
+  // Mean of the words of each node
+  std::vector<float> centers_;
+  std::vector<Node> nodes_;
+  std::vector<int> words_order_;
+};
+
+// Sparse TF-IDF histogram of the words of an image : (word, weight) pairs
+// sorted by word, with weights summing to one
+using BowHistogram = std::vector<std::pair<int, float>>;
+
+// Inverted file of the BoW histograms of images, for retrieval. The distance
+// between two images is the L1 distance of their histograms which, since
+// these are normalized, is 2 - 2 * sum_w min(h1_w, h2_w). It only depends on
+// the common words of the images, so that an image is compared to all other
+// ones by walking the images lists of its words.
+class BowIndex {
+ public:
+  // weights are the inverse document frequencies of the words
+  explicit BowIndex(const VecXf &weights);
+
+  BowHistogram Histogram(const int *words, int count) const;
+
+  // Add an image given the words of its features and return its index
+  int AddImage(const int *words, int count);
+  int ImagesCount() const { return histograms_.size(); }
+
+  // k nearest candidates of reference images. Only the candidates sharing
+  // words with a reference are compared to it, the other ones being at the
+  // maximum distance of 2. Images are identified by their index, and groups
+  // and results are as in NearestNeighbors. Reference images are processed
+  // in parallel by num_threads threads.
+  void NearestImages(const std::vector<int> &references,
+                     const RetrievalCandidates &retrieval_candidates, int k,
+                     const int *groups, int num_threads,
+                     std::vector<int> *neighbors,
+                     std::vector<float> *distances) const;
+
+ private:
+  VecXf weights_;
+  std::vector<BowHistogram> histograms_;
+  // (image, weight) of the images having each word
+  std::vector<std::vector<std::pair<int, float>>> images_per_word_;
+};
+
+// k nearest words of each (N x size) descriptor, as an (N x k) array.
+// Descriptors are processed in parallel by num_threads threads.
+py::array_t<int> nearest_words(const VocabularyTree &tree,
+                               foundation::pyarray_f descriptors, int k,
+                               int max_checks, int num_threads);
+
+// Python wrapper of BowIndex::NearestImages, returning (R x K) neighbors
+// and distances arrays. Empty candidates offsets or groups are not used.
+std::pair<py::array_t<int>, py::array_t<float>> nearest_images(
+    const BowIndex &index, foundation::pyarray_int references,
+    foundation::pyarray_int candidates, int k,
+    foundation::pyarray_int candidates_offsets, foundation::pyarray_int groups,
+    int num_threads);
+
+}  // namespace features
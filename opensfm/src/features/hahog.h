@@ -2,9 +2,30 @@
 
 #include <foundation/python_types.h>
 
+extern "C" {
+#include <vl/covdet.h>
+}
+
 namespace features {
 
+// Remove the features that are not the strongest in a neighborhood of
+// non_extrema_suppression times their scale, keeping the others order.
+// Returns the number of features kept at the front of 'features'.
+vl_size run_non_maxima_suppression(VlCovDetFeature *features,
+                                   vl_size num_features,
+                                   double non_extrema_suppression);
+
+// Same selection, comparing every pair of features in O(N^2).
+vl_size run_non_maxima_suppression_brute_force(VlCovDetFeature *features,
+                                               vl_size num_features,
+                                               double non_extrema_suppression);
+
+// Hessian affine features with SIFT descriptors. If non_maxima_suppression
+// is positive, features that are not the strongest in a neighborhood of
+// non_maxima_suppression times their scale are removed. Orientations and
+// descriptors are computed by num_threads threads.
 py::tuple hahog(foundation::pyarray_f image, float peak_threshold,
-                float edge_threshold, int target_num_features);
+                float edge_threshold, int target_num_features,
+                float non_maxima_suppression, int num_threads);
 
 }
@@ -1,19 +1,97 @@
 #pragma once
 
+#include <features/neighbors.h>
 #include <foundation/python_types.h>
 #include <foundation/types.h>
 
+#include <cstdint>
 #include <set>
+#include <vector>
 
 namespace features {
 
+// Squared L2 distance between two n-dimensional descriptors, using AVX2 or
+// NEON when the build targets them
+float SquaredDistanceL2(const float *pa, const float *pb, int n);
+
+// Hamming distance between two n bytes binary descriptors, using AVX-512
+// or AVX2 when the build targets them
+int DistanceHamming(const uint8_t *pa, const uint8_t *pb, int n);
+
+// Match each feature of the first image to the features of the second one
+// sharing one of its words, using Lowe's ratio test. Features of the first
+// image are matched in parallel by num_threads threads.
 py::array_t<int> match_using_words(foundation::pyarray_f features1,
                                    foundation::pyarray_int words1,
                                    foundation::pyarray_f features2,
                                    foundation::pyarray_int words2,
-                                   float lowes_ratio, int max_checks);
+                                   float lowes_ratio, int max_checks,
+                                   int num_threads);
+
+// Match the features of one image to the ones of each candidate image, as
+// match_using_words does, in a single call. Words arrays hold the words of
+// each feature, and their first column indexes the features. The query image
+// index is built once and candidates are matched in parallel. If symmetric,
+// only matches found in both directions are kept.
+std::vector<py::array_t<int>> match_using_words_batch(
+    foundation::pyarray_f features, foundation::pyarray_int words,
+    std::vector<foundation::pyarray_f> candidates_features,
+    std::vector<foundation::pyarray_int> candidates_words, float lowes_ratio,
+    int max_checks, bool symmetric, int num_threads);
+
+// Brute force matching of binary descriptors (AKAZE MLDB, ORB, ...) using
+// their Hamming distance and Lowe's ratio test. If symmetric, only matches
+// found in both directions are kept. A non-empty mask, of size N1 x N2,
+// restricts the pairs considered. Features are matched in parallel by
+// num_threads threads.
+py::array_t<int> match_hamming(foundation::pyarray_uint8 descriptors1,
+                               foundation::pyarray_uint8 descriptors2,
+                               float lowes_ratio, bool symmetric,
+                               foundation::pyarray_uint8 mask,
+                               int num_threads);
+
+// Unnormalized VLAD descriptor of a set of features : the sum of the
+// residuals of the features to their nearest center. Blocks of features are
+// assigned to the centers in parallel by num_threads threads. uint8 features
+// are converted block by block instead of being copied to floats upfront.
+VecXf compute_vlad_descriptor(foundation::pyarray_f features,
+                              const MatXf &vlad_centers, int num_threads);
+VecXf compute_vlad_descriptor_uint8(foundation::pyarray_uint8 features,
+                                    const MatXf &vlad_centers,
+                                    int num_threads);
+
+// k nearest neighbors, by L2 distance, of the reference VLAD descriptors
+// among their candidate ones. descriptors is a row-major (N x size) matrix,
+// and references and candidates are row indexes into it. If groups (N) are
+// given, the k nearest candidates of the reference group and the k nearest
+// of the other groups are kept. Distances to candidates shared by all the
+// references are computed by blocks as matrix products, in parallel by
+// num_threads threads.
+//
+// Each reference gets (groups ? 2k : k) neighbors row indexes and distances,
+// sorted by increasing distance and padded with -1 and infinity.
+void ComputeVladNeighbors(const float *descriptors, int size,
+                          const std::vector<int> &references,
+                          const RetrievalCandidates &retrieval_candidates,
+                          int k, const int *groups, int num_threads,
+                          std::vector<int> *neighbors,
+                          std::vector<float> *distances);
+
+// Retrieval candidates of references_count references, among images_count
+// images, from their Python arrays. Empty offsets mean that the candidates
+// are shared by all references.
+RetrievalCandidates retrieval_candidates_from_arrays(
+    int images_count, int references_count,
+    foundation::pyarray_int candidates,
+    foundation::pyarray_int candidates_offsets);
 
-VecXf compute_vlad_descriptor(const MatXf &features, const MatXf &vlad_centers);
+// Python wrapper of ComputeVladNeighbors, returning (R x K) neighbors and
+// distances arrays. Empty candidates offsets or groups are not used.
+std::pair<py::array_t<int>, py::array_t<float>> compute_vlad_neighbors(
+    foundation::pyarray_f descriptors, foundation::pyarray_int references,
+    foundation::pyarray_int candidates, int k,
+    foundation::pyarray_int candidates_offsets, foundation::pyarray_int groups,
+    int num_threads);
 
 std::pair<std::vector<double>, std::vector<std::string>> compute_vlad_distances(
     const std::map<std::string, VecXf> &vlad_descriptors,
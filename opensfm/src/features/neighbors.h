@@ -0,0 +1,66 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace features {
+
+// Candidates of a set of reference images : either the same candidates for
+// all references or, if offsets (one more than the references) are given,
+// candidates[offsets[i], offsets[i + 1][ for the i-th reference.
+struct RetrievalCandidates {
+  std::vector<int> candidates;
+  std::vector<int> offsets;
+
+  bool PerReference() const { return !offsets.empty(); }
+
+  // [begin, end[ range of the candidates of the i-th reference
+  std::pair<const int *, const int *> Of(int i) const {
+    if (!PerReference()) {
+      return std::make_pair(candidates.data(),
+                            candidates.data() + candidates.size());
+    }
+    return std::make_pair(candidates.data() + offsets[i],
+                          candidates.data() + offsets[i + 1]);
+  }
+};
+
+// k nearest candidates of a set of reference images, for image retrieval.
+// Images are identified by indexes into the groups array. If groups (one per
+// image) are given, the k nearest candidates of the reference group and the
+// k nearest of the other groups are kept.
+//
+// Distances of different references can be added concurrently.
+class NearestNeighbors {
+ public:
+  NearestNeighbors(const std::vector<int> &references, int k,
+                   const int *groups);
+
+  // Neighbors kept per reference
+  int NeighborsCount() const { return groups_count_ * k_; }
+
+  // Add the distance of the i-th reference to a candidate. It is ignored if
+  // the candidate is the reference itself.
+  void Add(int i, int candidate, float distance);
+
+  // Whether the i-th reference has all its neighbors, so that a candidate
+  // is only kept if it is nearer than them
+  bool Full(int i) const;
+
+  // Neighbors indexes and distances of each reference, NeighborsCount() per
+  // reference, sorted by increasing distance and padded with -1 and
+  // infinity.
+  void Get(std::vector<int> *neighbors, std::vector<float> *distances) const;
+
+ private:
+  using Neighbor = std::pair<float, int>;
+
+  int k_;
+  int groups_count_;
+  std::vector<int> references_;
+  const int *groups_;
+  // Max-heaps of the k nearest candidates of each reference and group
+  std::vector<std::vector<Neighbor>> heaps_;
+};
+
+}  // namespace features
@@ -16,11 +16,16 @@ __all__  = [
 "AKAZEOptions",
 "AkazeDescriptorType",
 "AkazeDiffusivityType",
+"BowIndex",
+"VocabularyTree",
 "akaze",
 "compute_vlad_descriptor",
 "compute_vlad_distances",
+"compute_vlad_neighbors",
 "hahog",
-"match_using_words"
+"match_hamming",
+"match_using_words",
+"match_using_words_batch"
 ]
 class AKAZEOptions:
     def __init__(self) -> None: ...
@@ -138,8 +143,23 @@ class AkazeDiffusivityType:
     __members__: Dict[str, "AkazeDiffusivityType"]
     @property
     def name(self) -> str: ...
+class BowIndex:
+    def __init__(self, weights: numpy.ndarray) -> None: ...
+    def add_image(self, words: numpy.ndarray) -> int: ...
+    def images_count(self) -> int: ...
+    def nearest_images(self, references: numpy.ndarray, candidates: numpy.ndarray, k: int, candidates_offsets: numpy.ndarray = ..., groups: numpy.ndarray = ..., num_threads: int = 1) -> Tuple[numpy.ndarray, numpy.ndarray]: ...
+class VocabularyTree:
+    def __init__(self, words: numpy.ndarray, branching: int = 10, iterations: int = 10) -> None: ...
+    def nearest_words(self, descriptors: numpy.ndarray, k: int, max_checks: int, num_threads: int = 1) -> numpy.ndarray: ...
+    def words_count(self) -> int: ...
 def akaze(arg0: numpy.ndarray, arg1: AKAZEOptions) -> tuple:...
-def compute_vlad_descriptor(arg0: numpy.ndarray, arg1: numpy.ndarray) -> numpy.ndarray:...
+@overload
+def compute_vlad_descriptor(features: numpy.ndarray, vlad_centers: numpy.ndarray, num_threads: int = 1) -> numpy.ndarray:...
+@overload
+def compute_vlad_descriptor(features: numpy.ndarray, vlad_centers: numpy.ndarray, num_threads: int = 1) -> numpy.ndarray:...
 def compute_vlad_distances(arg0: Dict[str, numpy.ndarray], arg1: str, arg2: Set[str]) -> Tuple[List[float], List[str]]:...
-def hahog(image: numpy.ndarray, peak_threshold: float = 0.003, edge_threshold: float = 10, target_num_features: int = 0) -> tuple:...
-def match_using_words(arg0: numpy.ndarray, arg1: numpy.ndarray, arg2: numpy.ndarray, arg3: numpy.ndarray, arg4: float, arg5: int) -> numpy.ndarray:...
+def compute_vlad_neighbors(descriptors: numpy.ndarray, references: numpy.ndarray, candidates: numpy.ndarray, k: int, candidates_offsets: numpy.ndarray = ..., groups: numpy.ndarray = ..., num_threads: int = 1) -> Tuple[numpy.ndarray, numpy.ndarray]:...
+def hahog(image: numpy.ndarray, peak_threshold: float = 0.003, edge_threshold: float = 10, target_num_features: int = 0, non_maxima_suppression: float = 0, num_threads: int = 1) -> tuple:...
+def match_hamming(descriptors1: numpy.ndarray, descriptors2: numpy.ndarray, lowes_ratio: float, symmetric: bool = False, mask: numpy.ndarray = ..., num_threads: int = 1) -> numpy.ndarray:...
+def match_using_words(features1: numpy.ndarray, words1: numpy.ndarray, features2: numpy.ndarray, words2: numpy.ndarray, lowes_ratio: float, max_checks: int, num_threads: int = 1) -> numpy.ndarray:...
+def match_using_words_batch(features: numpy.ndarray, words: numpy.ndarray, candidates_features: List[numpy.ndarray], candidates_words: List[numpy.ndarray], lowes_ratio: float, max_checks: int, symmetric: bool = False, num_threads: int = 1) -> List[numpy.ndarray]:...
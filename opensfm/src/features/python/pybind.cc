@@ -1,4 +1,5 @@
 #include <features/akaze_bind.h>
+#include <features/bow.h>
 #include <features/hahog.h>
 #include <features/matching.h>
 #include <foundation/python_types.h>
@@ -55,11 +56,58 @@ PYBIND11_MODULE(pyfeatures, m) {
 
   m.def("hahog", features::hahog, py::arg("image"),
         py::arg("peak_threshold") = 0.003, py::arg("edge_threshold") = 10,
-        py::arg("target_num_features") = 0);
+        py::arg("target_num_features") = 0,
+        py::arg("non_maxima_suppression") = 0, py::arg("num_threads") = 1);
 
-  m.def("match_using_words", features::match_using_words);
+  m.def("match_using_words", features::match_using_words, py::arg("features1"),
+        py::arg("words1"), py::arg("features2"), py::arg("words2"),
+        py::arg("lowes_ratio"), py::arg("max_checks"),
+        py::arg("num_threads") = 1);
+  m.def("match_using_words_batch", features::match_using_words_batch,
+        py::arg("features"), py::arg("words"), py::arg("candidates_features"),
+        py::arg("candidates_words"), py::arg("lowes_ratio"),
+        py::arg("max_checks"), py::arg("symmetric") = false,
+        py::arg("num_threads") = 1);
+  m.def("match_hamming", features::match_hamming, py::arg("descriptors1"),
+        py::arg("descriptors2"), py::arg("lowes_ratio"),
+        py::arg("symmetric") = false,
+        py::arg("mask") = foundation::pyarray_uint8(),
+        py::arg("num_threads") = 1);
   m.def("compute_vlad_descriptor", features::compute_vlad_descriptor,
-        py::call_guard<py::gil_scoped_release>());
+        py::arg("features"), py::arg("vlad_centers"),
+        py::arg("num_threads") = 1);
+  m.def("compute_vlad_descriptor", features::compute_vlad_descriptor_uint8,
+        py::arg("features"), py::arg("vlad_centers"),
+        py::arg("num_threads") = 1);
   m.def("compute_vlad_distances", features::compute_vlad_distances,
         py::call_guard<py::gil_scoped_release>());
+  m.def("compute_vlad_neighbors", features::compute_vlad_neighbors,
+        py::arg("descriptors"), py::arg("references"), py::arg("candidates"),
+        py::arg("k"),
+        py::arg("candidates_offsets") = foundation::pyarray_int(),
+        py::arg("groups") = foundation::pyarray_int(),
+        py::arg("num_threads") = 1);
+
+  py::class_<features::VocabularyTree>(m, "VocabularyTree")
+      .def(py::init<const MatXf &, int, int>(), py::arg("words"),
+           py::arg("branching") = 10, py::arg("iterations") = 10,
+           py::call_guard<py::gil_scoped_release>())
+      .def("words_count", &features::VocabularyTree::WordsCount)
+      .def("nearest_words", features::nearest_words, py::arg("descriptors"),
+           py::arg("k"), py::arg("max_checks"), py::arg("num_threads") = 1);
+
+  py::class_<features::BowIndex>(m, "BowIndex")
+      .def(py::init<const VecXf &>(), py::arg("weights"))
+      .def(
+          "add_image",
+          [](features::BowIndex &index, foundation::pyarray_int words) {
+            return index.AddImage(words.data(), words.size());
+          },
+          py::arg("words"))
+      .def("images_count", &features::BowIndex::ImagesCount)
+      .def("nearest_images", features::nearest_images,
+           py::arg("references"), py::arg("candidates"), py::arg("k"),
+           py::arg("candidates_offsets") = foundation::pyarray_int(),
+           py::arg("groups") = foundation::pyarray_int(),
+           py::arg("num_threads") = 1);
 }
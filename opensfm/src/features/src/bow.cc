@@ -0,0 +1,378 @@
+#include <features/bow.h>
+#include <features/matching.h>
+#include <features/neighbors.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <stdexcept>
+
+namespace features {
+
+VocabularyTree::VocabularyTree(const MatXf &words, int branching,
+                               int iterations)
+    : words_(words) {
+  if (words_.rows() == 0 || words_.cols() == 0) {
+    throw std::runtime_error("Empty vocabulary");
+  }
+  if (branching < 2) {
+    throw std::runtime_error("Vocabulary tree branching must be at least 2");
+  }
+
+  words_order_.resize(words_.rows());
+  for (int i = 0; i < words_.rows(); ++i) {
+    words_order_[i] = i;
+  }
+  nodes_.push_back({-1, 0, 0, static_cast<int>(words_.rows())});
+  centers_.resize(words_.cols());
+  Eigen::Map<VecXf>(centers_.data(), words_.cols()) =
+      words_.colwise().mean().transpose();
+
+  // Children are appended to the nodes as they are split
+  for (int node = 0; node < static_cast<int>(nodes_.size()); ++node) {
+    Split(node, branching, iterations);
+  }
+}
+
+void VocabularyTree::Split(int node, int branching, int iterations) {
+  const int begin = nodes_[node].begin;
+  const int count = nodes_[node].end - begin;
+  const int size = words_.cols();
+  if (count <= branching) {
+    return;
+  }
+
+  // k-means of the node words, initialized with random ones
+  std::mt19937 generator(node);
+  std::vector<int> initial(words_order_.begin() + begin,
+                           words_order_.begin() + begin + count);
+  std::shuffle(initial.begin(), initial.end(), generator);
+  RowMatXf centers(branching, size);
+  for (int c = 0; c < branching; ++c) {
+    centers.row(c) = words_.row(initial[c]);
+  }
+
+  std::vector<int> labels(count, 0);
+  RowMatXf sums(branching, size);
+  std::vector<int> sizes(branching);
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    bool changed = false;
+    for (int i = 0; i < count; ++i) {
+      const float *word = words_.row(words_order_[begin + i]).data();
+      float best_distance = std::numeric_limits<float>::max();
+      int best_center = 0;
+      for (int c = 0; c < branching; ++c) {
+        const float distance =
+            SquaredDistanceL2(word, centers.row(c).data(), size);
+        if (distance < best_distance) {
+          best_distance = distance;
+          best_center = c;
+        }
+      }
+      changed |= labels[i] != best_center;
+      labels[i] = best_center;
+    }
+    if (!changed && iteration > 0) {
+      break;
+    }
+
+    sums.setZero();
+    std::fill(sizes.begin(), sizes.end(), 0);
+    for (int i = 0; i < count; ++i) {
+      sums.row(labels[i]) += words_.row(words_order_[begin + i]);
+      ++sizes[labels[i]];
+    }
+    for (int c = 0; c < branching; ++c) {
+      // Empty clusters keep their center
+      if (sizes[c] > 0) {
+        centers.row(c) = sums.row(c) / sizes[c];
+      }
+    }
+  }
+
+  // Clusters become contiguous children, unless the words couldn't be split
+  std::fill(sizes.begin(), sizes.end(), 0);
+  for (const int label : labels) {
+    ++sizes[label];
+  }
+  if (*std::max_element(sizes.begin(), sizes.end()) == count) {
+    return;
+  }
+  std::vector<int> order(count);
+  for (int i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&labels](int a, int b) { return labels[a] < labels[b]; });
+  std::vector<int> sorted_words(count);
+  for (int i = 0; i < count; ++i) {
+    sorted_words[i] = words_order_[begin + order[i]];
+  }
+  std::copy(sorted_words.begin(), sorted_words.end(),
+            words_order_.begin() + begin);
+
+  nodes_[node].first_child = nodes_.size();
+  int child_begin = begin;
+  for (int c = 0; c < branching; ++c) {
+    if (sizes[c] == 0) {
+      continue;
+    }
+    nodes_.push_back({-1, 0, child_begin, child_begin + sizes[c]});
+    centers_.insert(centers_.end(), centers.row(c).data(),
+                    centers.row(c).data() + size);
+    ++nodes_[node].children_count;
+    child_begin += sizes[c];
+  }
+}
+
+void VocabularyTree::NearestWords(const float *descriptor, int k,
+                                  int max_checks, int *words) const {
+  const int size = words_.cols();
+  using Candidate = std::pair<float, int>;
+
+  // Nodes left to explore, nearest first, and max-heap of the nearest words
+  std::priority_queue<Candidate, std::vector<Candidate>,
+                      std::greater<Candidate>>
+      branches;
+  std::vector<Candidate> nearest;
+  nearest.reserve(k + 1);
+
+  int checks = 0;
+  branches.emplace(0.0f, 0);
+  while (!branches.empty() && (checks == 0 || checks < max_checks)) {
+    int node = branches.top().second;
+    branches.pop();
+
+    // Descend to the nearest leaf, remembering the other branches
+    while (nodes_[node].children_count > 0) {
+      const Node &parent = nodes_[node];
+      int best_child = -1;
+      float best_distance = std::numeric_limits<float>::max();
+      for (int c = 0; c < parent.children_count; ++c) {
+        const int child = parent.first_child + c;
+        const float distance = SquaredDistanceL2(
+            descriptor, centers_.data() + static_cast<size_t>(child) * size,
+            size);
+        if (distance < best_distance) {
+          if (best_child >= 0) {
+            branches.emplace(best_distance, best_child);
+          }
+          best_distance = distance;
+          best_child = child;
+        } else {
+          branches.emplace(distance, child);
+        }
+      }
+      node = best_child;
+    }
+
+    for (int i = nodes_[node].begin; i < nodes_[node].end; ++i) {
+      const int word = words_order_[i];
+      const Candidate candidate(
+          SquaredDistanceL2(descriptor, words_.row(word).data(), size), word);
+      if (static_cast<int>(nearest.size()) < k) {
+        nearest.push_back(candidate);
+        std::push_heap(nearest.begin(), nearest.end());
+      } else if (k > 0 && candidate < nearest.front()) {
+        std::pop_heap(nearest.begin(), nearest.end());
+        nearest.back() = candidate;
+        std::push_heap(nearest.begin(), nearest.end());
+      }
+      ++checks;
+    }
+  }
+
+  std::sort_heap(nearest.begin(), nearest.end());
+  for (int i = 0; i < k; ++i) {
+    words[i] = i < static_cast<int>(nearest.size()) ? nearest[i].second : -1;
+  }
+}
+
+BowIndex::BowIndex(const VecXf &weights)
+    : weights_(weights), images_per_word_(weights.size()) {}
+
+BowHistogram BowIndex::Histogram(const int *words, int count) const {
+  std::vector<int> sorted_words(words, words + count);
+  std::sort(sorted_words.begin(), sorted_words.end());
+  if (!sorted_words.empty() &&
+      (sorted_words.front() < 0 || sorted_words.back() >= weights_.size())) {
+    throw std::runtime_error("Word index out of range");
+  }
+
+  BowHistogram histogram;
+  float sum = 0;
+  for (size_t i = 0; i < sorted_words.size();) {
+    const int word = sorted_words[i];
+    size_t j = i;
+    while (j < sorted_words.size() && sorted_words[j] == word) {
+      ++j;
+    }
+    const float weight = (j - i) * weights_[word];
+    histogram.emplace_back(word, weight);
+    sum += weight;
+    i = j;
+  }
+  if (sum > 0) {
+    for (auto &bin : histogram) {
+      bin.second /= sum;
+    }
+  }
+  return histogram;
+}
+
+int BowIndex::AddImage(const int *words, int count) {
+  const int image = histograms_.size();
+  histograms_.push_back(Histogram(words, count));
+  for (const auto &bin : histograms_.back()) {
+    images_per_word_[bin.first].emplace_back(image, bin.second);
+  }
+  return image;
+}
+
+void BowIndex::NearestImages(const std::vector<int> &references,
+                             const RetrievalCandidates &retrieval_candidates,
+                             int k, const int *groups, int num_threads,
+                             std::vector<int> *neighbors,
+                             std::vector<float> *distances) const {
+  const int images_count = ImagesCount();
+  const auto out_of_range = [images_count](int image) {
+    return image < 0 || image >= images_count;
+  };
+  const auto &candidates = retrieval_candidates.candidates;
+  if (std::any_of(references.begin(), references.end(), out_of_range) ||
+      std::any_of(candidates.begin(), candidates.end(), out_of_range)) {
+    throw std::runtime_error("Image index out of range");
+  }
+  const bool per_reference = retrieval_candidates.PerReference();
+  std::vector<char> shared_is_candidate(images_count, 0);
+  if (!per_reference) {
+    for (const int candidate : candidates) {
+      shared_is_candidate[candidate] = 1;
+    }
+  }
+
+  NearestNeighbors nearest(references, k, groups);
+#pragma omp parallel num_threads(std::max(num_threads, 1))
+  {
+    // Sum of min(h1_w, h2_w) over the common words of each candidate
+    std::vector<float> similarities(images_count, 0.0f);
+    std::vector<char> visited(images_count, 0);
+    std::vector<int> visited_images;
+    std::vector<char> reference_is_candidate(per_reference ? images_count : 0,
+                                             0);
+    std::vector<char> &is_candidate =
+        per_reference ? reference_is_candidate : shared_is_candidate;
+
+#pragma omp for schedule(dynamic)
+    for (int i = 0; i < static_cast<int>(references.size()); ++i) {
+      const auto range = retrieval_candidates.Of(i);
+      if (per_reference) {
+        for (const int *candidate = range.first; candidate != range.second;
+             ++candidate) {
+          is_candidate[*candidate] = 1;
+        }
+      }
+
+      for (const auto &bin : histograms_[references[i]]) {
+        for (const auto &image : images_per_word_[bin.first]) {
+          if (!is_candidate[image.first]) {
+            continue;
+          }
+          if (!visited[image.first]) {
+            visited[image.first] = 1;
+            visited_images.push_back(image.first);
+          }
+          similarities[image.first] += std::min(bin.second, image.second);
+        }
+      }
+
+      for (const int image : visited_images) {
+        nearest.Add(i, image, std::max(2 - 2 * similarities[image], 0.0f));
+      }
+
+      // Candidates without common words are at the maximum distance of 2,
+      // and are only kept if there are not enough nearer ones
+      for (const int *candidate = range.first;
+           candidate != range.second && !nearest.Full(i); ++candidate) {
+        if (!visited[*candidate]) {
+          nearest.Add(i, *candidate, 2.0f);
+        }
+      }
+
+      for (const int image : visited_images) {
+        similarities[image] = 0;
+        visited[image] = 0;
+      }
+      visited_images.clear();
+      if (per_reference) {
+        for (const int *candidate = range.first; candidate != range.second;
+             ++candidate) {
+          is_candidate[*candidate] = 0;
+        }
+      }
+    }
+  }
+  nearest.Get(neighbors, distances);
+}
+
+py::array_t<int> nearest_words(const VocabularyTree &tree,
+                               foundation::pyarray_f descriptors, int k,
+                               int max_checks, int num_threads) {
+  if (descriptors.ndim() != 2 || descriptors.shape(1) != tree.WordsSize()) {
+    throw std::runtime_error(
+        "Descriptors must be a (N x size) array of the words size");
+  }
+  const int count = descriptors.shape(0);
+  k = std::max(k, 0);
+  std::vector<int> words(static_cast<size_t>(count) * k);
+  {
+    py::gil_scoped_release release;
+    const float *data = descriptors.data();
+    const int size = tree.WordsSize();
+#pragma omp parallel for num_threads(std::max(num_threads, 1)) \
+    schedule(dynamic, 64)
+    for (int i = 0; i < count; ++i) {
+      tree.NearestWords(data + static_cast<size_t>(i) * size, k, max_checks,
+                        words.data() + static_cast<size_t>(i) * k);
+    }
+  }
+  return foundation::py_array_from_data(words.data(), count, k);
+}
+
+std::pair<py::array_t<int>, py::array_t<float>> nearest_images(
+    const BowIndex &index, foundation::pyarray_int references,
+    foundation::pyarray_int candidates, int k,
+    foundation::pyarray_int candidates_offsets, foundation::pyarray_int groups,
+    int num_threads) {
+  const int images_count = index.ImagesCount();
+  const bool has_groups = groups.size() > 0;
+  if (has_groups && groups.size() != images_count) {
+    throw std::runtime_error("Groups must have one element per image");
+  }
+  const std::vector<int> references_indexes(
+      references.data(), references.data() + references.size());
+  const RetrievalCandidates retrieval_candidates =
+      retrieval_candidates_from_arrays(images_count, references_indexes.size(),
+                                       candidates, candidates_offsets);
+
+  std::vector<int> neighbors;
+  std::vector<float> distances;
+  {
+    py::gil_scoped_release release;
+    index.NearestImages(references_indexes, retrieval_candidates, k,
+                        has_groups ? groups.data() : nullptr, num_threads,
+                        &neighbors, &distances);
+  }
+  const size_t neighbors_count = (has_groups ? 2 : 1) * std::max(k, 0);
+  return std::make_pair(
+      foundation::py_array_from_data(neighbors.data(),
+                                     references_indexes.size(),
+                                     neighbors_count),
+      foundation::py_array_from_data(distances.data(),
+                                     references_indexes.size(),
+                                     neighbors_count));
+}
+
+}  // namespace features
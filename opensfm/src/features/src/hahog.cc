@@ -1,8 +1,17 @@
 #include <features/hahog.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <new>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 extern "C" {
 #include <time.h>
 #include <vl/covdet.h>
@@ -30,46 +39,168 @@ vl_size select_best_features(VlCovDet *covdet, vl_size num_features,
   }
 }
 
+// Remove features whose score was set to zero, keeping the others order
+vl_size remove_suppressed_features(VlCovDetFeature *features,
+                                   vl_size num_features) {
+  vl_size j = 0;
+  for (vl_size i = 0; i < num_features; ++i) {
+    VlCovDetFeature feature = features[i];
+    if (features[i].peakScore != 0) {
+      features[j++] = feature;
+    }
+  }
+  return j;
+}
+
+// Whether feature 'j' is suppressed by feature 'i'
+inline bool is_suppressed_by(const VlCovDetFeature &i,
+                             const VlCovDetFeature &j, double tol) {
+  double dx_ = j.frame.x - i.frame.x;
+  double dy_ = j.frame.y - i.frame.y;
+  double sigma = i.frame.a11;
+  double sigma_ = j.frame.a11;
+  return sigma < (1 + tol) * sigma_ && sigma_ < (1 + tol) * sigma &&
+         vl_abs_d(dx_) < tol * sigma && vl_abs_d(dy_) < tol * sigma &&
+         vl_abs_d(i.peakScore) > vl_abs_d(j.peakScore);
+}
+
 // select 'target_num_features' that have a maximum score in their neighbhood.
 // The neighborhood is computing using the feature's scale and
 // 'non_extrema_suppression' as : neighborhood = non_extrema_suppression * scale
-vl_size run_non_maxima_suppression(VlCovDet *covdet, vl_size num_features,
-                                   double non_extrema_suppression) {
-  vl_index i, j;
+//
+// Reference O(N^2) implementation, compares every pair of features.
+vl_size run_non_maxima_suppression_brute_force(VlCovDetFeature *features,
+                                               vl_size num_features,
+                                               double non_extrema_suppression) {
   double tol = non_extrema_suppression;
-  VlCovDetFeature *features = (VlCovDetFeature *)vl_covdet_get_features(covdet);
-  for (i = 0; i < (signed)num_features; ++i) {
-    double x = features[i].frame.x;
-    double y = features[i].frame.y;
-    double sigma = features[i].frame.a11;
-    double score = features[i].peakScore;
-
-    for (j = 0; j < (signed)num_features; ++j) {
-      double dx_ = features[j].frame.x - x;
-      double dy_ = features[j].frame.y - y;
-      double sigma_ = features[j].frame.a11;
-      double score_ = features[j].peakScore;
-      if (score_ == 0) {
+  for (vl_size i = 0; i < num_features; ++i) {
+    for (vl_size j = 0; j < num_features; ++j) {
+      if (features[j].peakScore == 0) {
         continue;
       }
-      if (sigma < (1 + tol) * sigma_ && sigma_ < (1 + tol) * sigma &&
-          vl_abs_d(dx_) < tol * sigma && vl_abs_d(dy_) < tol * sigma &&
-          vl_abs_d(score) > vl_abs_d(score_)) {
+      if (is_suppressed_by(features[i], features[j], tol)) {
         features[j].peakScore = 0;
       }
     }
   }
-  j = 0;
-  for (i = 0; i < (signed)num_features; ++i) {
-    VlCovDetFeature feature = features[i];
-    if (features[i].peakScore != 0) {
-      features[j++] = feature;
+  return remove_suppressed_features(features, num_features);
+}
+
+// Same selection as run_non_maxima_suppression_brute_force, but features are
+// bucketed by scale band and by position, so each feature is only compared
+// to the ones that can be in its neighborhood.
+vl_size run_non_maxima_suppression(VlCovDetFeature *features,
+                                   vl_size num_features,
+                                   double non_extrema_suppression) {
+  const double tol = non_extrema_suppression;
+  if (num_features == 0) {
+    return 0;
+  }
+
+  // Scale bands are [(1 + tol)^k, (1 + tol)^(k + 1)[ : neighbors of a
+  // feature are in its band or in the adjacent ones
+  const double log_base = std::log(1 + tol);
+  double min_x = std::numeric_limits<double>::infinity();
+  double min_y = min_x;
+  double max_x = -min_x;
+  double max_y = -min_x;
+  std::vector<int> feature_bands(num_features);
+  for (vl_size i = 0; i < num_features; ++i) {
+    const VlFrameOrientedEllipse &frame = features[i].frame;
+    const double band = std::floor(std::log(frame.a11) / log_base);
+    if (!std::isfinite(band) || !std::isfinite(frame.x) ||
+        !std::isfinite(frame.y) || std::abs(band) > (1 << 20)) {
+      return run_non_maxima_suppression_brute_force(features, num_features,
+                                                    non_extrema_suppression);
     }
+    feature_bands[i] = band;
+    min_x = std::min<double>(min_x, frame.x);
+    min_y = std::min<double>(min_y, frame.y);
+    max_x = std::max<double>(max_x, frame.x);
+    max_y = std::max<double>(max_y, frame.y);
   }
-  return j;
+  const auto band_range =
+      std::minmax_element(feature_bands.begin(), feature_bands.end());
+  const int min_band = *band_range.first;
+  const int num_bands = *band_range.second - min_band + 1;
+
+  // Each band is a grid whose cells are as large as its biggest features'
+  // neighborhoods, stored as (cell, feature) pairs sorted by cell
+  struct Band {
+    double cell_size;
+    int64_t num_columns;
+    int64_t num_rows;
+    std::vector<std::pair<int64_t, vl_size>> cells;
+  };
+  std::vector<Band> bands(num_bands);
+  for (int k = 0; k < num_bands; ++k) {
+    Band &band = bands[k];
+    // Cells are never so small that cell indexes could overflow
+    band.cell_size =
+        std::max(tol * std::exp((min_band + k + 1) * log_base),
+                 std::max(max_x - min_x, max_y - min_y) / (1 << 30));
+    band.num_columns =
+        static_cast<int64_t>((max_x - min_x) / band.cell_size) + 1;
+    band.num_rows = static_cast<int64_t>((max_y - min_y) / band.cell_size) + 1;
+  }
+  for (vl_size i = 0; i < num_features; ++i) {
+    Band &band = bands[feature_bands[i] - min_band];
+    const int64_t column =
+        static_cast<int64_t>((features[i].frame.x - min_x) / band.cell_size);
+    const int64_t row =
+        static_cast<int64_t>((features[i].frame.y - min_y) / band.cell_size);
+    band.cells.emplace_back(row * band.num_columns + column, i);
+  }
+  for (auto &band : bands) {
+    std::sort(band.cells.begin(), band.cells.end());
+  }
+
+  // Features are processed in the same order as the brute force version, so
+  // the same ones suppress the same others. Bands at distance 2 are also
+  // visited in case the bands computation rounds differently.
+  for (vl_size i = 0; i < num_features; ++i) {
+    if (features[i].peakScore == 0) {
+      continue;
+    }
+    const double x = features[i].frame.x - min_x;
+    const double y = features[i].frame.y - min_y;
+    const double radius = tol * features[i].frame.a11;
+    const int band_i = feature_bands[i] - min_band;
+    for (int k = std::max(band_i - 2, 0);
+         k <= std::min(band_i + 2, num_bands - 1); ++k) {
+      const Band &band = bands[k];
+      const auto cell = [&band](double v) {
+        return static_cast<int64_t>(std::floor(v / band.cell_size));
+      };
+      const int64_t first_column = std::max<int64_t>(cell(x - radius), 0);
+      const int64_t last_column =
+          std::min<int64_t>(cell(x + radius), band.num_columns - 1);
+      const int64_t first_row = std::max<int64_t>(cell(y - radius), 0);
+      const int64_t last_row =
+          std::min<int64_t>(cell(y + radius), band.num_rows - 1);
+      for (int64_t row = first_row; row <= last_row; ++row) {
+        const int64_t last_key = row * band.num_columns + last_column;
+        auto it = std::lower_bound(
+            band.cells.begin(), band.cells.end(),
+            std::make_pair(row * band.num_columns + first_column,
+                           vl_size(0)));
+        for (; it != band.cells.end() && it->first <= last_key; ++it) {
+          VlCovDetFeature &feature = features[it->second];
+          if (feature.peakScore == 0) {
+            continue;
+          }
+          if (is_suppressed_by(features[i], feature, tol)) {
+            feature.peakScore = 0;
+          }
+        }
+      }
+    }
+  }
+  return remove_suppressed_features(features, num_features);
 }
 
-vl_size run_features_selection(VlCovDet *covdet, vl_size target_num_features) {
+vl_size run_features_selection(VlCovDet *covdet, vl_size target_num_features,
+                               double non_maxima_suppression) {
   vl_size numFeaturesKept = vl_covdet_get_num_features(covdet);
 
   // keep only 1.5 x targetNumFeatures for speeding-up duplicate detection
@@ -79,54 +210,108 @@ vl_size run_features_selection(VlCovDet *covdet, vl_size target_num_features) {
   }
 
   // Remove non-maxima-in-their-neighborhood features
-  const double nonMaximaSuppressionTol =
-      vl_covdet_get_non_extrema_suppression_threshold(covdet);
-  if (nonMaximaSuppressionTol > 0.) {
-    numFeaturesKept = run_non_maxima_suppression(covdet, numFeaturesKept,
-                                                 nonMaximaSuppressionTol);
+  if (non_maxima_suppression > 0.) {
+    numFeaturesKept = run_non_maxima_suppression(
+        (VlCovDetFeature *)vl_covdet_get_features(covdet), numFeaturesKept,
+        non_maxima_suppression);
   }
 
   // Keep the N best
   return select_best_features(covdet, numFeaturesKept, target_num_features);
 }
 
+// Each thread works on its own copy of the detector, sharing its scale space
+// but not its patches and orientations buffers
+class CovDetThreadCopies {
+ public:
+  CovDetThreadCopies(VlCovDet *covdet, int num_threads) {
+    for (int i = 0; i < num_threads; ++i) {
+      VlCovDet *copy = vl_covdet_new_shared_copy(covdet);
+      if (!copy) {
+        Clear();
+        throw std::bad_alloc();
+      }
+      copies_.push_back(copy);
+    }
+  }
+  ~CovDetThreadCopies() { Clear(); }
+  CovDetThreadCopies(const CovDetThreadCopies &) = delete;
+  CovDetThreadCopies &operator=(const CovDetThreadCopies &) = delete;
+
+  VlCovDet *Get(int thread) { return copies_[thread]; }
+
+ private:
+  void Clear() {
+    for (auto copy : copies_) {
+      vl_covdet_delete_shared_copy(copy);
+    }
+    copies_.clear();
+  }
+
+  std::vector<VlCovDet *> copies_;
+};
+
+int ThreadNum() {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
 std::vector<VlCovDetFeature> vlfeat_covdet_extract_orientations(
-    VlCovDet *covdet, vl_size num_features) {
+    VlCovDet *covdet, vl_size num_features, int num_threads) {
   VlCovDetFeature *features = (VlCovDetFeature *)vl_covdet_get_features(covdet);
+  CovDetThreadCopies copies(covdet, num_threads);
+
+  // Threads process contiguous ranges of features (static schedule), so
+  // concatenating their outputs keeps the features order
+  std::vector<std::vector<VlCovDetFeature>> thread_features(num_threads);
+#pragma omp parallel num_threads(num_threads)
+  {
+    const int thread = ThreadNum();
+    std::vector<VlCovDetFeature> &vecFeatures = thread_features[thread];
+#pragma omp for schedule(static)
+    for (vl_index i = 0; i < (signed)num_features; ++i) {
+      vl_size numOrientations;
+      VlCovDetFeature feature = features[i];
+      VlCovDetFeatureOrientation *orientations =
+          vl_covdet_extract_orientations_for_frame(
+              copies.Get(thread), &numOrientations, feature.frame);
+
+      for (vl_index j = 0; j < (signed)numOrientations; ++j) {
+        double A[2 * 2] = {feature.frame.a11, feature.frame.a21,
+                           feature.frame.a12, feature.frame.a22};
+        double r1 = cos(orientations[j].angle);
+        double r2 = sin(orientations[j].angle);
+
+        vecFeatures.emplace_back(features[i]);
+        VlCovDetFeature &oriented = vecFeatures.back();
+
+        oriented.orientationScore = orientations[j].score;
+        oriented.frame.a11 = +A[0] * r1 + A[2] * r2;
+        oriented.frame.a21 = +A[1] * r1 + A[3] * r2;
+        oriented.frame.a12 = -A[0] * r2 + A[2] * r1;
+        oriented.frame.a22 = -A[1] * r2 + A[3] * r1;
+      }
+    }
+  }
+
   std::vector<VlCovDetFeature> vecFeatures;
   vecFeatures.reserve(num_features);
-  vl_index i, j;
-  for (i = 0; i < (signed)num_features; ++i) {
-    vl_size numOrientations;
-    VlCovDetFeature feature = features[i];
-    VlCovDetFeatureOrientation *orientations =
-        vl_covdet_extract_orientations_for_frame(covdet, &numOrientations,
-                                                 feature.frame);
-
-    for (j = 0; j < (signed)numOrientations; ++j) {
-      double A[2 * 2] = {feature.frame.a11, feature.frame.a21,
-                         feature.frame.a12, feature.frame.a22};
-      double r1 = cos(orientations[j].angle);
-      double r2 = sin(orientations[j].angle);
-
-      vecFeatures.emplace_back(features[i]);
-      VlCovDetFeature &oriented = vecFeatures.back();
-
-      oriented.orientationScore = orientations[j].score;
-      oriented.frame.a11 = +A[0] * r1 + A[2] * r2;
-      oriented.frame.a21 = +A[1] * r1 + A[3] * r2;
-      oriented.frame.a12 = -A[0] * r2 + A[2] * r1;
-      oriented.frame.a22 = -A[1] * r2 + A[3] * r1;
-    }
+  for (const auto &features : thread_features) {
+    vecFeatures.insert(vecFeatures.end(), features.begin(), features.end());
   }
   return vecFeatures;
 }
 
 py::tuple hahog(foundation::pyarray_f image, float peak_threshold,
-                float edge_threshold, int target_num_features) {
+                float edge_threshold, int target_num_features,
+                float non_maxima_suppression, int num_threads) {
   if (!image.size()) {
     return py::none();
   }
+  num_threads = std::max(num_threads, 1);
 
   std::vector<float> points;
   std::vector<float> desc;
@@ -149,16 +334,16 @@ py::tuple hahog(foundation::pyarray_f image, float peak_threshold,
     vl_covdet_detect(covdet, std::numeric_limits<vl_size>::max());
 
     // select the best features to keep
-    numFeatures = run_features_selection(covdet, target_num_features);
+    numFeatures = run_features_selection(covdet, target_num_features,
+                                         non_maxima_suppression);
 
     // compute the orientation of the features (optional)
     std::vector<VlCovDetFeature> vecFeatures =
-        vlfeat_covdet_extract_orientations(covdet, numFeatures);
+        vlfeat_covdet_extract_orientations(covdet, numFeatures, num_threads);
     numFeatures = vecFeatures.size();
 
-    // get feature descriptors
-    VlSiftFilt *sift = vl_sift_new(16, 16, 1, 3, 0);
-    vl_index i;
+    // get feature descriptors, each thread using its own SIFT filter and
+    // buffers
     vl_index patchResolution = 15;
     double patchRelativeExtent = 7.5;
     double patchRelativeSmoothing = 1;
@@ -166,35 +351,47 @@ py::tuple hahog(foundation::pyarray_f image, float peak_threshold,
     double patchStep = (double)patchRelativeExtent / patchResolution;
     points.resize(4 * numFeatures);
     desc.resize(dimension * numFeatures);
-    std::vector<float> patch(patchSide * patchSide);
-    std::vector<float> patchXY(2 * patchSide * patchSide);
-
-    vl_sift_set_magnif(sift, 3.0);
-    for (i = 0; i < (signed)numFeatures; ++i) {
-      const VlFrameOrientedEllipse &frame = vecFeatures.at(i).frame;
-      float det = frame.a11 * frame.a22 - frame.a12 * frame.a21;
-      float size = sqrt(fabs(det));
-      float angle = atan2(frame.a21, frame.a11) * 180.0f / M_PI;
-      points[4 * i + 0] = frame.x;
-      points[4 * i + 1] = frame.y;
-      points[4 * i + 2] = size;
-      points[4 * i + 3] = angle;
-
-      vl_covdet_extract_patch_for_frame(covdet, patch.data(), patchResolution,
-                                        patchRelativeExtent,
-                                        patchRelativeSmoothing, frame);
-
-      vl_imgradient_polar_f(patchXY.data(), &patchXY[1], 2, 2 * patchSide,
-                            patch.data(), patchSide, patchSide, patchSide);
-
-      vl_sift_calc_raw_descriptor(
-          sift, patchXY.data(), &desc[dimension * i], (int)patchSide,
-          (int)patchSide, (double)(patchSide - 1) / 2,
-          (double)(patchSide - 1) / 2,
-          (double)patchRelativeExtent / (3.0 * (4 + 1) / 2) / patchStep,
-          VL_PI / 2);
+
+    {
+      CovDetThreadCopies copies(covdet, num_threads);
+#pragma omp parallel num_threads(num_threads)
+      {
+        VlSiftFilt *sift = vl_sift_new(16, 16, 1, 3, 0);
+        vl_sift_set_magnif(sift, 3.0);
+        std::vector<float> patch(patchSide * patchSide);
+        std::vector<float> patchXY(2 * patchSide * patchSide);
+        VlCovDet *thread_covdet = copies.Get(ThreadNum());
+
+#pragma omp for schedule(dynamic, 64)
+        for (vl_index i = 0; i < (signed)numFeatures; ++i) {
+          const VlFrameOrientedEllipse &frame = vecFeatures[i].frame;
+          float det = frame.a11 * frame.a22 - frame.a12 * frame.a21;
+          float size = sqrt(fabs(det));
+          float angle = atan2(frame.a21, frame.a11) * 180.0f / M_PI;
+          points[4 * i + 0] = frame.x;
+          points[4 * i + 1] = frame.y;
+          points[4 * i + 2] = size;
+          points[4 * i + 3] = angle;
+
+          vl_covdet_extract_patch_for_frame(thread_covdet, patch.data(),
+                                            patchResolution,
+                                            patchRelativeExtent,
+                                            patchRelativeSmoothing, frame);
+
+          vl_imgradient_polar_f(patchXY.data(), &patchXY[1], 2,
+                                2 * patchSide, patch.data(), patchSide,
+                                patchSide, patchSide);
+
+          vl_sift_calc_raw_descriptor(
+              sift, patchXY.data(), &desc[dimension * i], (int)patchSide,
+              (int)patchSide, (double)(patchSide - 1) / 2,
+              (double)(patchSide - 1) / 2,
+              (double)patchRelativeExtent / (3.0 * (4 + 1) / 2) / patchStep,
+              VL_PI / 2);
+        }
+        vl_sift_delete(sift);
+      }
     }
-    vl_sift_delete(sift);
     vl_covdet_delete(covdet);
   }
 
@@ -1,20 +1,44 @@
 #include <features/matching.h>
+#include <features/neighbors.h>
 #include <foundation/optional.h>
 #include <foundation/python_types.h>
 #include <foundation/types.h>
 #include <pybind11/pybind11.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <map>
 #include <opencv2/core/core.hpp>
 #include <stdexcept>
 #include <vector>
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 namespace py = pybind11;
 
 namespace features {
 
+namespace {
+int PopCount64(uint64_t x) {
+#if defined(_MSC_VER)
+  return static_cast<int>(__popcnt64(x));
+#else
+  return __builtin_popcountll(x);
+#endif
+}
+}  // namespace
+
 float DistanceL1(const float *pa, const float *pb, int n) {
   float distance = 0;
   for (int i = 0; i < n; ++i) {
@@ -23,49 +47,118 @@ float DistanceL1(const float *pa, const float *pb, int n) {
   return distance;
 }
 
-float DistanceL2(const float *pa, const float *pb, int n) {
+float SquaredDistanceL2(const float *pa, const float *pb, int n) {
+  int i = 0;
   float distance = 0;
-  for (int i = 0; i < n; ++i) {
+#if defined(__AVX2__)
+  __m256 sum = _mm256_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    const __m256 d =
+        _mm256_sub_ps(_mm256_loadu_ps(pa + i), _mm256_loadu_ps(pb + i));
+#if defined(__FMA__)
+    sum = _mm256_fmadd_ps(d, d, sum);
+#else
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(d, d));
+#endif
+  }
+  __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum),
+                           _mm256_extractf128_ps(sum, 1));
+  sum4 = _mm_hadd_ps(sum4, sum4);
+  sum4 = _mm_hadd_ps(sum4, sum4);
+  distance = _mm_cvtss_f32(sum4);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  float32x4_t sum = vdupq_n_f32(0);
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t d = vsubq_f32(vld1q_f32(pa + i), vld1q_f32(pb + i));
+    sum = vfmaq_f32(sum, d, d);
+  }
+  distance = vaddvq_f32(sum);
+#else
+  // Independent partial sums, so the compiler can vectorize the loop
+  float sums[8] = {0};
+  for (; i + 8 <= n; i += 8) {
+    for (int j = 0; j < 8; ++j) {
+      const float d = pa[i + j] - pb[i + j];
+      sums[j] += d * d;
+    }
+  }
+  for (int j = 0; j < 8; ++j) {
+    distance += sums[j];
+  }
+#endif
+  for (; i < n; ++i) {
     distance += (pa[i] - pb[i]) * (pa[i] - pb[i]);
   }
-  return sqrt(distance);
+  return distance;
 }
 
-void MatchUsingWords(const cv::Mat &f1, const cv::Mat &w1, const cv::Mat &f2,
-                     const cv::Mat &w2, float lowes_ratio, int max_checks,
-                     cv::Mat *matches) {
-  // Index features on the second image.
-  std::multimap<int, int> index2;
-  const int *pw2 = &w2.at<int>(0, 0);
-  for (unsigned int i = 0; i < w2.rows * w2.cols; ++i) {
-    index2.insert(std::pair<int, int>(pw2[i], i));
-  }
-
-  std::vector<int> best_match(f1.rows, -1), second_best_match(f1.rows, -1);
-  std::vector<float> best_distance(f1.rows,
-                                   std::numeric_limits<float>::infinity());
-  std::vector<float> second_best_distance(
-      f1.rows, std::numeric_limits<float>::infinity());
-  *matches = cv::Mat(0, 2, CV_32S);
-  cv::Mat tmp_match(1, 2, CV_32S);
-  for (unsigned int i = 0; i < w1.rows; ++i) {
+float DistanceL2(const float *pa, const float *pb, int n) {
+  return sqrt(SquaredDistanceL2(pa, pb, n));
+}
+
+namespace {
+// Features of an image indexed by word : features having the same word are
+// contiguous, in increasing order
+class WordsIndex {
+ public:
+  // words[i * stride] is the word of feature i
+  WordsIndex(const int *words, int count, int stride) {
+    std::vector<std::pair<int, int>> index(count);
+    for (int i = 0; i < count; ++i) {
+      index[i] = std::make_pair(words[i * stride], i);
+    }
+    std::sort(index.begin(), index.end());
+    words_.resize(count);
+    features_.resize(count);
+    for (int i = 0; i < count; ++i) {
+      words_[i] = index[i].first;
+      features_[i] = index[i].second;
+    }
+  }
+
+  std::pair<const int *, const int *> Features(int word) const {
+    const auto begin = std::lower_bound(words_.begin(), words_.end(), word);
+    const auto end = std::upper_bound(begin, words_.end(), word);
+    return std::make_pair(features_.data() + (begin - words_.begin()),
+                          features_.data() + (end - words_.begin()));
+  }
+
+ private:
+  std::vector<int> words_;
+  std::vector<int> features_;
+};
+
+// Best match of each feature of the first image among the second image
+// ones, or -1 if it doesn't pass the ratio test
+std::vector<int> MatchUsingWordsIndex(const cv::Mat &f1, const cv::Mat &w1,
+                                      const cv::Mat &f2,
+                                      const WordsIndex &index2,
+                                      float lowes_ratio, int max_checks,
+                                      int num_threads) {
+  // Distances are compared squared, and the ratio test is applied on the
+  // actual distances
+  std::vector<int> best_match(w1.rows, -1);
+#pragma omp parallel for schedule(dynamic, 64) \
+    num_threads(std::max(num_threads, 1))
+  for (int i = 0; i < w1.rows; ++i) {
+    const float *pa = f1.ptr<float>(i);
+    const int *pw1 = w1.ptr<int>(i);
+    int best = -1;
+    float best_distance = std::numeric_limits<float>::infinity();
+    float second_best_distance = std::numeric_limits<float>::infinity();
     int checks = 0;
-    for (unsigned int j = 0; j < w1.cols; ++j) {
-      int word = w1.at<int>(i, j);
-      auto range = index2.equal_range(word);
-      for (auto it = range.first; it != range.second; ++it) {
-        int match = it->second;
-        const float *pa = f1.ptr<float>(i);
-        const float *pb = f2.ptr<float>(match);
-        float distance = DistanceL2(pa, pb, f1.cols);
-        if (distance < best_distance[i]) {
-          second_best_distance[i] = best_distance[i];
-          second_best_match[i] = best_match[i];
-          best_distance[i] = distance;
-          best_match[i] = match;
-        } else if (distance < second_best_distance[i]) {
-          second_best_distance[i] = distance;
-          second_best_match[i] = match;
+    for (int j = 0; j < w1.cols; ++j) {
+      const auto candidates = index2.Features(pw1[j]);
+      for (auto it = candidates.first; it != candidates.second; ++it) {
+        const int match = *it;
+        const float distance =
+            SquaredDistanceL2(pa, f2.ptr<float>(match), f1.cols);
+        if (distance < best_distance) {
+          second_best_distance = best_distance;
+          best_distance = distance;
+          best = match;
+        } else if (distance < second_best_distance) {
+          second_best_distance = distance;
         }
         checks++;
       }
@@ -73,60 +166,340 @@ void MatchUsingWords(const cv::Mat &f1, const cv::Mat &w1, const cv::Mat &f2,
         break;
       }
     }
-    if (best_distance[i] < lowes_ratio * second_best_distance[i]) {
+    if (std::sqrt(best_distance) <
+        lowes_ratio * std::sqrt(second_best_distance)) {
+      best_match[i] = best;
+    }
+  }
+  return best_match;
+}
+
+// Best match of each descriptor of the first set among the second set ones,
+// or -1 if it doesn't pass the ratio test. Pairs (i, j) are only considered
+// if mask[i * mask_stride_1 + j * mask_stride_2] is set, when mask is given.
+std::vector<int> MatchHammingBruteForce(const uint8_t *d1, int n1,
+                                        const uint8_t *d2, int n2, int size,
+                                        float lowes_ratio, const uint8_t *mask,
+                                        int mask_stride_1, int mask_stride_2,
+                                        int num_threads) {
+  std::vector<int> best_match(n1, -1);
+#pragma omp parallel for schedule(dynamic, 64) \
+    num_threads(std::max(num_threads, 1))
+  for (int i = 0; i < n1; ++i) {
+    const uint8_t *pa = d1 + static_cast<size_t>(i) * size;
+    int best = -1;
+    int best_distance = std::numeric_limits<int>::max();
+    int second_best_distance = std::numeric_limits<int>::max();
+    int candidates = 0;
+    for (int j = 0; j < n2; ++j) {
+      if (mask && !mask[static_cast<size_t>(i) * mask_stride_1 +
+                        static_cast<size_t>(j) * mask_stride_2]) {
+        continue;
+      }
+      const int distance =
+          DistanceHamming(pa, d2 + static_cast<size_t>(j) * size, size);
+      if (distance < best_distance) {
+        second_best_distance = best_distance;
+        best_distance = distance;
+        best = j;
+      } else if (distance < second_best_distance) {
+        second_best_distance = distance;
+      }
+      ++candidates;
+    }
+    // Same as a 2-nearest neighbors search followed by a ratio test
+    if (candidates >= 2 && static_cast<float>(best_distance) <
+                               lowes_ratio * second_best_distance) {
+      best_match[i] = best;
+    }
+  }
+  return best_match;
+}
+
+cv::Mat BestMatchesToMat(const std::vector<int> &best_match) {
+  cv::Mat matches(0, 2, CV_32S);
+  cv::Mat tmp_match(1, 2, CV_32S);
+  for (size_t i = 0; i < best_match.size(); ++i) {
+    if (best_match[i] >= 0) {
       tmp_match.at<int>(0, 0) = i;
       tmp_match.at<int>(0, 1) = best_match[i];
-      matches->push_back(tmp_match);
+      matches.push_back(tmp_match);
     }
   }
+  return matches;
+}
+}  // namespace
+
+int DistanceHamming(const uint8_t *pa, const uint8_t *pb, int n) {
+  int i = 0;
+  int distance = 0;
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+  __m512i sum = _mm512_setzero_si512();
+  for (; i + 64 <= n; i += 64) {
+    const __m512i x = _mm512_xor_si512(_mm512_loadu_si512(pa + i),
+                                       _mm512_loadu_si512(pb + i));
+    sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(x));
+  }
+  distance += _mm512_reduce_add_epi64(sum);
+#elif defined(__AVX2__)
+  // Per-nibble lookup table popcount, summed by bytes groups
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1,
+                       1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i sum = _mm256_setzero_si256();
+  for (; i + 32 <= n; i += 32) {
+    const __m256i x = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pa + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pb + i)));
+    const __m256i counts = _mm256_add_epi8(
+        _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, low_mask)),
+        _mm256_shuffle_epi8(
+            lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask)));
+    sum = _mm256_add_epi64(sum,
+                           _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+  }
+  distance += _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) +
+              _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3);
+#endif
+  for (; i + 8 <= n; i += 8) {
+    uint64_t a, b;
+    std::memcpy(&a, pa + i, sizeof(a));
+    std::memcpy(&b, pb + i, sizeof(b));
+    distance += PopCount64(a ^ b);
+  }
+  for (; i < n; ++i) {
+    distance += PopCount64(pa[i] ^ pb[i]);
+  }
+  return distance;
+}
+
+void MatchUsingWords(const cv::Mat &f1, const cv::Mat &w1, const cv::Mat &f2,
+                     const cv::Mat &w2, float lowes_ratio, int max_checks,
+                     int num_threads, cv::Mat *matches) {
+  const WordsIndex index2(w2.ptr<int>(), w2.rows * w2.cols, 1);
+  *matches = BestMatchesToMat(MatchUsingWordsIndex(
+      f1, w1, f2, index2, lowes_ratio, max_checks, num_threads));
 }
 
 py::array_t<int> match_using_words(foundation::pyarray_f features1,
                                    foundation::pyarray_int words1,
                                    foundation::pyarray_f features2,
                                    foundation::pyarray_int words2,
-                                   float lowes_ratio, int max_checks) {
+                                   float lowes_ratio, int max_checks,
+                                   int num_threads) {
   cv::Mat cv_f1 = foundation::pyarray_cv_mat_view(features1);
   cv::Mat cv_w1 = foundation::pyarray_cv_mat_view(words1);
   cv::Mat cv_f2 = foundation::pyarray_cv_mat_view(features2);
   cv::Mat cv_w2 = foundation::pyarray_cv_mat_view(words2);
   cv::Mat matches;
 
-  MatchUsingWords(cv_f1, cv_w1, cv_f2, cv_w2, lowes_ratio, max_checks,
-                  &matches);
+  {
+    py::gil_scoped_release release;
+    MatchUsingWords(cv_f1, cv_w1, cv_f2, cv_w2, lowes_ratio, max_checks,
+                    num_threads, &matches);
+  }
 
   return foundation::py_array_from_cvmat<int>(matches);
 }
 
-VecXf compute_vlad_descriptor(const MatXf &features,
-                              const MatXf &vlad_centers) {
-  const auto vlad_center_size = vlad_centers.cols();
-  const auto vlad_center_count = vlad_centers.rows();
+std::vector<py::array_t<int>> match_using_words_batch(
+    foundation::pyarray_f features, foundation::pyarray_int words,
+    std::vector<foundation::pyarray_f> candidates_features,
+    std::vector<foundation::pyarray_int> candidates_words, float lowes_ratio,
+    int max_checks, bool symmetric, int num_threads) {
+  const int num_candidates = candidates_features.size();
+  if (candidates_words.size() != candidates_features.size()) {
+    throw std::runtime_error("Candidates features and words count mismatch");
+  }
+  if (words.ndim() != 2) {
+    throw std::runtime_error("Words must be a (features x words) array");
+  }
+  cv::Mat cv_f = foundation::pyarray_cv_mat_view(features);
+  cv::Mat cv_w = foundation::pyarray_cv_mat_view(words);
+  std::vector<cv::Mat> cv_candidates_f(num_candidates);
+  std::vector<cv::Mat> cv_candidates_w(num_candidates);
+  for (int i = 0; i < num_candidates; ++i) {
+    if (candidates_words[i].ndim() != 2) {
+      throw std::runtime_error("Words must be a (features x words) array");
+    }
+    cv_candidates_f[i] =
+        foundation::pyarray_cv_mat_view(candidates_features[i]);
+    cv_candidates_w[i] =
+        foundation::pyarray_cv_mat_view(candidates_words[i]);
+  }
+
+  std::vector<cv::Mat> matches(num_candidates);
+  {
+    py::gil_scoped_release release;
+
+    // Candidates matching back to the query image share its index
+    const WordsIndex index(cv_w.ptr<int>(), cv_w.rows, cv_w.cols);
+#pragma omp parallel for schedule(dynamic) \
+    num_threads(std::max(num_threads, 1))
+    for (int i = 0; i < num_candidates; ++i) {
+      const auto &cv_candidate_f = cv_candidates_f[i];
+      const auto &cv_candidate_w = cv_candidates_w[i];
+      const WordsIndex candidate_index(cv_candidate_w.ptr<int>(),
+                                       cv_candidate_w.rows,
+                                       cv_candidate_w.cols);
+      auto best_match =
+          MatchUsingWordsIndex(cv_f, cv_w, cv_candidate_f, candidate_index,
+                               lowes_ratio, max_checks, 1);
+      if (symmetric) {
+        const auto best_match_back =
+            MatchUsingWordsIndex(cv_candidate_f, cv_candidate_w, cv_f, index,
+                                 lowes_ratio, max_checks, 1);
+        for (size_t j = 0; j < best_match.size(); ++j) {
+          const int match = best_match[j];
+          if (match >= 0 && best_match_back[match] != static_cast<int>(j)) {
+            best_match[j] = -1;
+          }
+        }
+      }
+      matches[i] = BestMatchesToMat(best_match);
+    }
+  }
+
+  std::vector<py::array_t<int>> results;
+  results.reserve(num_candidates);
+  for (const auto &m : matches) {
+    results.push_back(foundation::py_array_from_cvmat<int>(m));
+  }
+  return results;
+}
+
+py::array_t<int> match_hamming(foundation::pyarray_uint8 descriptors1,
+                               foundation::pyarray_uint8 descriptors2,
+                               float lowes_ratio, bool symmetric,
+                               foundation::pyarray_uint8 mask,
+                               int num_threads) {
+  if (descriptors1.ndim() != 2 || descriptors2.ndim() != 2 ||
+      descriptors1.shape(1) != descriptors2.shape(1)) {
+    throw std::runtime_error("Descriptors must be (N x bytes) arrays");
+  }
+  const int n1 = descriptors1.shape(0);
+  const int n2 = descriptors2.shape(0);
+  const int size = descriptors1.shape(1);
+  const uint8_t *mask_data = nullptr;
+  if (mask.size() > 0) {
+    if (mask.ndim() != 2 || mask.shape(0) != n1 || mask.shape(1) != n2) {
+      throw std::runtime_error("Mask must be a (N1 x N2) array");
+    }
+    mask_data = mask.data();
+  }
+
+  cv::Mat matches;
+  {
+    py::gil_scoped_release release;
+    auto best_match = MatchHammingBruteForce(
+        descriptors1.data(), n1, descriptors2.data(), n2, size, lowes_ratio,
+        mask_data, n2, 1, num_threads);
+    if (symmetric) {
+      const auto best_match_back = MatchHammingBruteForce(
+          descriptors2.data(), n2, descriptors1.data(), n1, size, lowes_ratio,
+          mask_data, 1, n2, num_threads);
+      for (size_t i = 0; i < best_match.size(); ++i) {
+        const int match = best_match[i];
+        if (match >= 0 && best_match_back[match] != static_cast<int>(i)) {
+          best_match[i] = -1;
+        }
+      }
+    }
+    matches = BestMatchesToMat(best_match);
+  }
+  return foundation::py_array_from_cvmat<int>(matches);
+}
+
+namespace {
+// Number of features assigned to the VLAD centers at once. A block of
+// 128-dimensional features and its distances to a few hundred centers stay
+// within L2 cache.
+constexpr int kVladBlockSize = 256;
+
+// Accumulate the residuals of row-major features to their nearest center.
+// The nearest center of each feature of a block is found by computing its
+// dot products with all centers as a single matrix product, since
+// ||f - c||^2 = ||f||^2 - 2 f.c + ||c||^2 and ||f||^2 does not change the
+// argmin.
+template <class T>
+VecXf ComputeVladDescriptor(const T *features, int features_count,
+                            int features_size, const MatXf &vlad_centers,
+                            int num_threads) {
+  const int vlad_center_size = vlad_centers.cols();
+  const int vlad_center_count = vlad_centers.rows();
 
   if (vlad_center_count == 0 || vlad_center_size == 0) {
     throw std::runtime_error("Zero VLAD centers or zero length VLAD words.");
   }
+  if (features_count > 0 && features_size != vlad_center_size) {
+    throw std::runtime_error(
+        "Features and VLAD centers have different dimensions.");
+  }
+
+  using RowMatXf =
+      Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  using RowMatXT =
+      Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  const RowMatXf centers = vlad_centers;
+  const VecXf centers_half_norms = 0.5f * centers.rowwise().squaredNorm();
 
-  VecXf vlad_descriptor(vlad_center_count * vlad_center_size);
-  vlad_descriptor.setZero();
+  RowMatXf vlad_descriptor =
+      RowMatXf::Zero(vlad_center_count, vlad_center_size);
+  const int blocks_count =
+      (features_count + kVladBlockSize - 1) / kVladBlockSize;
+#pragma omp parallel num_threads(std::max(num_threads, 1))
+  {
+    RowMatXf residuals = RowMatXf::Zero(vlad_center_count, vlad_center_size);
+    RowMatXf block(kVladBlockSize, vlad_center_size);
+    MatXf dots(kVladBlockSize, vlad_center_count);
 
-  for (int i = 0; i < features.rows(); ++i) {
-    const auto &feature = features.row(i);
+#pragma omp for schedule(dynamic) nowait
+    for (int b = 0; b < blocks_count; ++b) {
+      const int begin = b * kVladBlockSize;
+      const int rows = std::min(kVladBlockSize, features_count - begin);
+      block.topRows(rows) =
+          Eigen::Map<const RowMatXT>(
+              features + static_cast<size_t>(begin) * features_size, rows,
+              features_size)
+              .template cast<float>();
+      dots.topRows(rows).noalias() = block.topRows(rows) * centers.transpose();
 
-    float best_distance = std::numeric_limits<float>::max();
-    int best_center = -1;
-    for (int j = 0; j < vlad_center_count; ++j) {
-      const float squared_norm = (feature - vlad_centers.row(j)).squaredNorm();
-      if (squared_norm < best_distance) {
-        best_distance = squared_norm;
-        best_center = j;
+      for (int i = 0; i < rows; ++i) {
+        // Minimizing ||c||^2 / 2 - f.c is minimizing ||f - c||^2
+        int best_center = 0;
+        (centers_half_norms.transpose() - dots.row(i)).minCoeff(&best_center);
+        residuals.row(best_center) += block.row(i) - centers.row(best_center);
       }
     }
 
-    vlad_descriptor.segment(best_center * vlad_center_size, vlad_center_size) +=
-        (feature - vlad_centers.row(best_center));
+#pragma omp critical
+    vlad_descriptor += residuals;
+  }
+  return Eigen::Map<const VecXf>(vlad_descriptor.data(),
+                                 vlad_descriptor.size());
+}
+}  // namespace
+
+VecXf compute_vlad_descriptor(foundation::pyarray_f features,
+                              const MatXf &vlad_centers, int num_threads) {
+  if (features.ndim() != 2) {
+    throw std::runtime_error("Features must be a (N x size) array");
+  }
+  py::gil_scoped_release release;
+  return ComputeVladDescriptor(features.data(), features.shape(0),
+                               features.shape(1), vlad_centers, num_threads);
+}
+
+VecXf compute_vlad_descriptor_uint8(foundation::pyarray_uint8 features,
+                                    const MatXf &vlad_centers,
+                                    int num_threads) {
+  if (features.ndim() != 2) {
+    throw std::runtime_error("Features must be a (N x size) array");
   }
-  return vlad_descriptor;
+  py::gil_scoped_release release;
+  return ComputeVladDescriptor(features.data(), features.shape(0),
+                               features.shape(1), vlad_centers, num_threads);
 }
 
 std::pair<std::vector<double>, std::vector<std::string>> compute_vlad_distances(
@@ -152,4 +525,183 @@ std::pair<std::vector<double>, std::vector<std::string>> compute_vlad_distances(
   }
   return std::make_pair(distances, others);
 }
+
+namespace {
+// Number of references and candidates whose VLAD distances are computed at
+// once, as a single matrix product
+constexpr int kVladReferencesBlockSize = 64;
+constexpr int kVladCandidatesBlockSize = 512;
+}  // namespace
+
+void ComputeVladNeighbors(const float *descriptors, int size,
+                          const std::vector<int> &references,
+                          const RetrievalCandidates &retrieval_candidates,
+                          int k, const int *groups, int num_threads,
+                          std::vector<int> *neighbors,
+                          std::vector<float> *distances) {
+  NearestNeighbors nearest(references, k, groups);
+  const int references_count = references.size();
+  const std::vector<int> &candidates = retrieval_candidates.candidates;
+  const int candidates_count = candidates.size();
+  if (nearest.NeighborsCount() == 0 || candidates_count == 0) {
+    nearest.Get(neighbors, distances);
+    return;
+  }
+
+  // Each reference has a few candidates of its own : distances are computed
+  // one by one
+  if (retrieval_candidates.PerReference()) {
+#pragma omp parallel for num_threads(std::max(num_threads, 1)) \
+    schedule(dynamic)
+    for (int i = 0; i < references_count; ++i) {
+      const Eigen::Map<const VecXf> reference(
+          descriptors + static_cast<size_t>(references[i]) * size, size);
+      const auto range = retrieval_candidates.Of(i);
+      for (const int *candidate = range.first; candidate != range.second;
+           ++candidate) {
+        const Eigen::Map<const VecXf> candidate_descriptor(
+            descriptors + static_cast<size_t>(*candidate) * size, size);
+        nearest.Add(i, *candidate,
+                    (reference - candidate_descriptor).squaredNorm());
+      }
+    }
+    nearest.Get(neighbors, distances);
+    for (size_t n = 0; n < neighbors->size(); ++n) {
+      if ((*neighbors)[n] >= 0) {
+        (*distances)[n] = std::sqrt((*distances)[n]);
+      }
+    }
+    return;
+  }
+
+  // Gather the candidates once, so that blocks of them are contiguous
+  using RowMatXf =
+      Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  RowMatXf candidates_descriptors(candidates_count, size);
+  VecXf candidates_norms(candidates_count);
+  for (int j = 0; j < candidates_count; ++j) {
+    candidates_descriptors.row(j) = Eigen::Map<const VecXf>(
+        descriptors + static_cast<size_t>(candidates[j]) * size, size);
+    candidates_norms[j] = candidates_descriptors.row(j).squaredNorm();
+  }
+
+  const int blocks_count =
+      (references_count + kVladReferencesBlockSize - 1) /
+      kVladReferencesBlockSize;
+#pragma omp parallel num_threads(std::max(num_threads, 1))
+  {
+    RowMatXf block(kVladReferencesBlockSize, size);
+    VecXf block_norms(kVladReferencesBlockSize);
+    MatXf dots(kVladReferencesBlockSize, kVladCandidatesBlockSize);
+
+#pragma omp for schedule(dynamic)
+    for (int b = 0; b < blocks_count; ++b) {
+      const int begin = b * kVladReferencesBlockSize;
+      const int rows = std::min(kVladReferencesBlockSize,
+                                references_count - begin);
+      for (int i = 0; i < rows; ++i) {
+        block.row(i) = Eigen::Map<const VecXf>(
+            descriptors + static_cast<size_t>(references[begin + i]) * size,
+            size);
+        block_norms[i] = block.row(i).squaredNorm();
+      }
+
+      for (int c = 0; c < candidates_count; c += kVladCandidatesBlockSize) {
+        const int cols =
+            std::min(kVladCandidatesBlockSize, candidates_count - c);
+        dots.topLeftCorner(rows, cols).noalias() =
+            block.topRows(rows) *
+            candidates_descriptors.middleRows(c, cols).transpose();
+
+        // ||r - c||^2 = ||r||^2 - 2 r.c + ||c||^2
+        for (int i = 0; i < rows; ++i) {
+          for (int j = 0; j < cols; ++j) {
+            const float squared_distance =
+                block_norms[i] - 2 * dots(i, j) + candidates_norms[c + j];
+            nearest.Add(begin + i, candidates[c + j], squared_distance);
+          }
+        }
+      }
+    }
+  }
+
+  nearest.Get(neighbors, distances);
+  for (size_t n = 0; n < neighbors->size(); ++n) {
+    if ((*neighbors)[n] >= 0) {
+      (*distances)[n] = std::sqrt(std::max((*distances)[n], 0.0f));
+    }
+  }
+}
+
+RetrievalCandidates retrieval_candidates_from_arrays(
+    int images_count, int references_count,
+    foundation::pyarray_int candidates,
+    foundation::pyarray_int candidates_offsets) {
+  RetrievalCandidates retrieval_candidates;
+  retrieval_candidates.candidates.assign(
+      candidates.data(), candidates.data() + candidates.size());
+  retrieval_candidates.offsets.assign(
+      candidates_offsets.data(),
+      candidates_offsets.data() + candidates_offsets.size());
+
+  const auto &indexes = retrieval_candidates.candidates;
+  if (std::any_of(indexes.begin(), indexes.end(), [images_count](int index) {
+        return index < 0 || index >= images_count;
+      })) {
+    throw std::runtime_error("Candidate index out of range");
+  }
+  const auto &offsets = retrieval_candidates.offsets;
+  if (retrieval_candidates.PerReference() &&
+      (static_cast<int>(offsets.size()) != references_count + 1 ||
+       offsets.front() != 0 ||
+       offsets.back() != static_cast<int>(indexes.size()) ||
+       !std::is_sorted(offsets.begin(), offsets.end()))) {
+    throw std::runtime_error(
+        "Candidates offsets must be increasing from 0 to the candidates "
+        "count, with one more element than the references");
+  }
+  return retrieval_candidates;
+}
+
+std::pair<py::array_t<int>, py::array_t<float>> compute_vlad_neighbors(
+    foundation::pyarray_f descriptors, foundation::pyarray_int references,
+    foundation::pyarray_int candidates, int k,
+    foundation::pyarray_int candidates_offsets, foundation::pyarray_int groups,
+    int num_threads) {
+  if (descriptors.ndim() != 2) {
+    throw std::runtime_error("VLAD descriptors must be a (N x size) array");
+  }
+  const int rows = descriptors.shape(0);
+  const bool has_groups = groups.size() > 0;
+  if (has_groups && groups.size() != rows) {
+    throw std::runtime_error("Groups must have one element per descriptor");
+  }
+  const std::vector<int> references_indexes(
+      references.data(), references.data() + references.size());
+  if (std::any_of(references_indexes.begin(), references_indexes.end(),
+                  [rows](int index) { return index < 0 || index >= rows; })) {
+    throw std::runtime_error("VLAD descriptor index out of range");
+  }
+  const RetrievalCandidates retrieval_candidates =
+      retrieval_candidates_from_arrays(rows, references_indexes.size(),
+                                       candidates, candidates_offsets);
+
+  std::vector<int> neighbors;
+  std::vector<float> distances;
+  {
+    py::gil_scoped_release release;
+    ComputeVladNeighbors(descriptors.data(), descriptors.shape(1),
+                         references_indexes, retrieval_candidates, k,
+                         has_groups ? groups.data() : nullptr, num_threads,
+                         &neighbors, &distances);
+  }
+  const size_t neighbors_count = (has_groups ? 2 : 1) * std::max(k, 0);
+  return std::make_pair(
+      foundation::py_array_from_data(neighbors.data(),
+                                     references_indexes.size(),
+                                     neighbors_count),
+      foundation::py_array_from_data(distances.data(),
+                                     references_indexes.size(),
+                                     neighbors_count));
+}
 }  // namespace features
@@ -0,0 +1,66 @@
+#include <features/neighbors.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace features {
+
+NearestNeighbors::NearestNeighbors(const std::vector<int> &references, int k,
+                                   const int *groups)
+    : k_(std::max(k, 0)),
+      groups_count_(groups ? 2 : 1),
+      references_(references),
+      groups_(groups),
+      heaps_(references.size() * groups_count_) {}
+
+void NearestNeighbors::Add(int i, int candidate, float distance) {
+  const int reference = references_[i];
+  if (candidate == reference || k_ == 0) {
+    return;
+  }
+
+  const int group = groups_ && groups_[candidate] != groups_[reference] ? 1 : 0;
+  auto &heap = heaps_[i * groups_count_ + group];
+  const Neighbor neighbor(distance, candidate);
+  if (static_cast<int>(heap.size()) < k_) {
+    heap.push_back(neighbor);
+    std::push_heap(heap.begin(), heap.end());
+  } else if (neighbor < heap.front()) {
+    std::pop_heap(heap.begin(), heap.end());
+    heap.back() = neighbor;
+    std::push_heap(heap.begin(), heap.end());
+  }
+}
+
+bool NearestNeighbors::Full(int i) const {
+  for (int g = 0; g < groups_count_; ++g) {
+    if (static_cast<int>(heaps_[i * groups_count_ + g].size()) < k_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void NearestNeighbors::Get(std::vector<int> *neighbors,
+                           std::vector<float> *distances) const {
+  const size_t neighbors_count = NeighborsCount();
+  neighbors->assign(references_.size() * neighbors_count, -1);
+  distances->assign(references_.size() * neighbors_count,
+                    std::numeric_limits<float>::infinity());
+
+  std::vector<Neighbor> nearest;
+  for (size_t i = 0; i < references_.size(); ++i) {
+    nearest.clear();
+    for (int g = 0; g < groups_count_; ++g) {
+      const auto &heap = heaps_[i * groups_count_ + g];
+      nearest.insert(nearest.end(), heap.begin(), heap.end());
+    }
+    std::sort(nearest.begin(), nearest.end());
+    for (size_t n = 0; n < nearest.size(); ++n) {
+      (*neighbors)[i * neighbors_count + n] = nearest[n].second;
+      (*distances)[i * neighbors_count + n] = nearest[n].first;
+    }
+  }
+}
+
+}  // namespace features
@@ -0,0 +1,64 @@
+#include <features/hahog.h>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<VlCovDetFeature> RandomFeatures(int count, double extent,
+                                            std::mt19937* generator) {
+  std::uniform_real_distribution<double> position(0., extent);
+  std::lognormal_distribution<double> scale(1., 0.5);
+  std::uniform_real_distribution<float> score(-1.f, 1.f);
+
+  std::vector<VlCovDetFeature> features(count);
+  for (auto& feature : features) {
+    feature = VlCovDetFeature();
+    feature.frame.x = position(*generator);
+    feature.frame.y = position(*generator);
+    feature.frame.a11 = scale(*generator);
+    feature.frame.a22 = feature.frame.a11;
+    feature.peakScore = score(*generator);
+  }
+  return features;
+}
+
+void ExpectSameFeatures(const std::vector<VlCovDetFeature>& features,
+                        double tol) {
+  auto grid = features;
+  auto brute_force = features;
+  const vl_size num_grid = features::run_non_maxima_suppression(
+      grid.data(), grid.size(), tol);
+  const vl_size num_brute_force =
+      features::run_non_maxima_suppression_brute_force(
+          brute_force.data(), brute_force.size(), tol);
+
+  ASSERT_EQ(num_brute_force, num_grid);
+  ASSERT_LT(num_grid, features.size());
+  for (vl_size i = 0; i < num_grid; ++i) {
+    EXPECT_EQ(brute_force[i].frame.x, grid[i].frame.x);
+    EXPECT_EQ(brute_force[i].frame.y, grid[i].frame.y);
+    EXPECT_EQ(brute_force[i].frame.a11, grid[i].frame.a11);
+    EXPECT_EQ(brute_force[i].peakScore, grid[i].peakScore);
+  }
+}
+
+}  // namespace
+
+TEST(HahogNonMaximaSuppression, GridMatchesBruteForce) {
+  std::mt19937 generator(42);
+  for (const double tol : {0.5, 1., 2., 5.}) {
+    ExpectSameFeatures(RandomFeatures(5000, 500., &generator), tol);
+  }
+}
+
+TEST(HahogNonMaximaSuppression, GridMatchesBruteForceOnDenseFeatures) {
+  std::mt19937 generator(7);
+  ExpectSameFeatures(RandomFeatures(5000, 20., &generator), 1.);
+}
+
+TEST(HahogNonMaximaSuppression, GridHandlesNoFeatures) {
+  std::vector<VlCovDetFeature> features;
+  EXPECT_EQ(0, features::run_non_maxima_suppression(features.data(), 0, 1.));
+}
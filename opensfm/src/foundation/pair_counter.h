@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace foundation {
+
+// Count occurrences of (first, second) pairs of non-negative integers by
+// buffering them, then periodically sorting and run-length encoding the
+// buffer. Cheaper than a hash map when counting billions of pairs, and
+// counters from different threads can be merged linearly.
+class PairCounter {
+ public:
+  using Key = uint64_t;
+  using KeyCount = std::pair<Key, int>;
+
+  explicit PairCounter(size_t max_pending = 1 << 22)
+      : max_pending_(max_pending) {}
+
+  static Key MakeKey(int first, int second) {
+    return (static_cast<Key>(first) << 32) | static_cast<uint32_t>(second);
+  }
+  static std::pair<int, int> FromKey(Key key) {
+    return {static_cast<int>(key >> 32), static_cast<int>(key & 0xFFFFFFFF)};
+  }
+
+  void Add(int first, int second) {
+    pending_.push_back(MakeKey(first, second));
+    if (pending_.size() >= max_pending_) {
+      Compact();
+    }
+  }
+
+  void Merge(PairCounter& other) {
+    Compact();
+    counts_ = MergeCounts(counts_, other.Counts());
+  }
+
+  // Counts sorted by key
+  const std::vector<KeyCount>& Counts() {
+    Compact();
+    return counts_;
+  }
+
+  void Compact() {
+    if (pending_.empty()) {
+      return;
+    }
+    std::sort(pending_.begin(), pending_.end());
+    std::vector<KeyCount> encoded;
+    for (const auto key : pending_) {
+      if (encoded.empty() || encoded.back().first != key) {
+        encoded.emplace_back(key, 0);
+      }
+      ++encoded.back().second;
+    }
+    pending_.clear();
+    counts_ = MergeCounts(counts_, encoded);
+  }
+
+ private:
+  static std::vector<KeyCount> MergeCounts(const std::vector<KeyCount>& a,
+                                           const std::vector<KeyCount>& b) {
+    std::vector<KeyCount> merged;
+    merged.reserve(a.size() + b.size());
+    auto it_a = a.begin();
+    auto it_b = b.begin();
+    while (it_a != a.end() || it_b != b.end()) {
+      if (it_b == b.end() || (it_a != a.end() && it_a->first < it_b->first)) {
+        merged.push_back(*it_a++);
+      } else if (it_a == a.end() || it_b->first < it_a->first) {
+        merged.push_back(*it_b++);
+      } else {
+        merged.emplace_back(it_a->first, it_a->second + it_b->second);
+        ++it_a;
+        ++it_b;
+      }
+    }
+    return merged;
+  }
+
+  size_t max_pending_;
+  std::vector<Key> pending_;
+  std::vector<KeyCount> counts_;
+};
+}  // namespace foundation
@@ -0,0 +1,34 @@
+#include <foundation/pair_counter.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+TEST(PairCounter, CountsPairs) {
+  foundation::PairCounter counter(2);
+  counter.Add(0, 1);
+  counter.Add(2, 1);
+  counter.Add(0, 1);
+  counter.Add(1, 2);
+  counter.Add(0, 1);
+
+  using KeyCount = foundation::PairCounter::KeyCount;
+  const auto key = &foundation::PairCounter::MakeKey;
+  EXPECT_THAT(counter.Counts(),
+              ::testing::ElementsAre(KeyCount(key(0, 1), 3),
+                                     KeyCount(key(1, 2), 1),
+                                     KeyCount(key(2, 1), 1)));
+}
+
+TEST(PairCounter, MergesCounters) {
+  foundation::PairCounter counter1, counter2;
+  counter1.Add(3, 4);
+  counter1.Add(0, 1);
+  counter2.Add(3, 4);
+  counter2.Add(5, 6);
+  counter1.Merge(counter2);
+
+  const auto& counts = counter1.Counts();
+  ASSERT_EQ(counts.size(), 3u);
+  EXPECT_EQ(foundation::PairCounter::FromKey(counts[1].first),
+            std::make_pair(3, 4));
+  EXPECT_EQ(counts[1].second, 2);
+}
@@ -38,3 +38,19 @@ TEST_F(UnionFindFixture, IsCorrect) {
   ASSERT_EQ(5, clusters[3].size());
   ASSERT_EQ(4, clusters.size());
 }
+
+TEST(FlatUnionFind, IsCorrect) {
+  FlatUnionFind union_find(8);
+  union_find.Union(0, 5);
+  union_find.Union(5, 2);
+  union_find.Union(7, 3);
+  union_find.Union(2, 0);
+
+  EXPECT_EQ(union_find.Find(2), union_find.Find(0));
+  EXPECT_NE(union_find.Find(3), union_find.Find(0));
+
+  std::vector<int> offsets, members;
+  union_find.GetClusters(&offsets, &members);
+  EXPECT_THAT(offsets, ::testing::ElementsAre(0, 3, 4, 6, 7, 8));
+  EXPECT_THAT(members, ::testing::ElementsAre(0, 2, 5, 1, 3, 7, 4, 6));
+}
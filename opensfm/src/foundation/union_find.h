@@ -1,7 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <numeric>
 #include <unordered_map>
 #include <vector>
 
@@ -63,3 +65,70 @@ std::vector<std::vector<UnionFindElement<T>*>> GetUnionFindClusters(
 
   return clusters;
 }
+
+// Union-find over the integers [0, size[, stored in flat arrays instead of
+// one heap-allocated element per item
+class FlatUnionFind {
+ public:
+  explicit FlatUnionFind(int size) : parents_(size), ranks_(size, 0) {
+    std::iota(parents_.begin(), parents_.end(), 0);
+  }
+
+  int Size() const { return parents_.size(); }
+
+  int Find(int e) {
+    // Path halving
+    while (parents_[e] != e) {
+      parents_[e] = parents_[parents_[e]];
+      e = parents_[e];
+    }
+    return e;
+  }
+
+  void Union(int e1, int e2) {
+    const auto root_e1 = Find(e1);
+    const auto root_e2 = Find(e2);
+    if (root_e1 == root_e2) {
+      return;
+    }
+    if (ranks_[root_e1] < ranks_[root_e2]) {
+      parents_[root_e1] = root_e2;
+    } else {
+      parents_[root_e2] = root_e1;
+      if (ranks_[root_e1] == ranks_[root_e2]) {
+        ++ranks_[root_e1];
+      }
+    }
+  }
+
+  // Clusters as compressed sparse rows : elements of cluster i are
+  // members[offsets[i]] to members[offsets[i + 1] - 1], sorted. Clusters are
+  // ordered by their smallest element.
+  void GetClusters(std::vector<int>* offsets, std::vector<int>* members) {
+    std::vector<int> cluster_per_root(Size(), -1);
+    std::vector<int> cluster_per_element(Size());
+    int num_clusters = 0;
+    for (int e = 0; e < Size(); ++e) {
+      auto& cluster = cluster_per_root[Find(e)];
+      if (cluster < 0) {
+        cluster = num_clusters++;
+      }
+      cluster_per_element[e] = cluster;
+    }
+
+    offsets->assign(num_clusters + 1, 0);
+    for (const auto cluster : cluster_per_element) {
+      ++(*offsets)[cluster + 1];
+    }
+    std::partial_sum(offsets->begin(), offsets->end(), offsets->begin());
+    members->resize(Size());
+    auto next = *offsets;
+    for (int e = 0; e < Size(); ++e) {
+      (*members)[next[cluster_per_element[e]]++] = e;
+    }
+  }
+
+ private:
+  std::vector<int> parents_;
+  std::vector<uint8_t> ranks_;
+};
@@ -72,9 +72,24 @@ inline void EncodeEpipolarEquation(IT begin, IT end, MAT *A) {
   }
 }
 
+// Fixed-size types of the five points solver, so that it doesn't allocate.
+using FivePointsPolynomial = Eigen::Matrix<double, 20, 1>;
+using FivePointsBasis = Eigen::Matrix<double, 9, 4>;
+using FivePointsConstraints = Eigen::Matrix<double, 10, 20>;
+
 // Compute the nullspace of the linear constraints given by the matches.
 template <class IT>
-Eigen::MatrixXd FivePointsNullspaceBasis(IT begin, IT end) {
+FivePointsBasis FivePointsNullspaceBasis(IT begin, IT end) {
+  // With five matches, the nullspace is exact and spanned by the last
+  // columns of Q in the QR decomposition of the transposed constraints.
+  if (end - begin == 5) {
+    Eigen::Matrix<double, 5, 9> A;
+    EncodeEpipolarEquation(begin, end, &A);
+    const Eigen::HouseholderQR<Eigen::Matrix<double, 9, 5>> qr(A.transpose());
+    const Eigen::Matrix<double, 9, 9> Q = qr.householderQ();
+    return Q.rightCols<4>();
+  }
+
   Eigen::Matrix<double, 9, 9> A;
   A.setZero();  // Make A square until Eigen supports rectangular SVD.
   EncodeEpipolarEquation(begin, end, &A);
@@ -83,84 +98,44 @@ Eigen::MatrixXd FivePointsNullspaceBasis(IT begin, IT end) {
 }
 
 // Multiply two polynomials of degree 1.
-Eigen::Matrix<double, -1, 1> o1(const Eigen::Matrix<double, -1, 1> &a,
-                                const Eigen::Matrix<double, -1, 1> &b);
+FivePointsPolynomial o1(const FivePointsPolynomial &a,
+                        const FivePointsPolynomial &b);
 
 // Multiply a polynomial of degree 2, a, by a polynomial of degree 1, b.
-Eigen::Matrix<double, -1, 1> o2(const Eigen::Matrix<double, -1, 1> &a,
-                                const Eigen::Matrix<double, -1, 1> &b);
+FivePointsPolynomial o2(const FivePointsPolynomial &a,
+                        const FivePointsPolynomial &b);
 
 // Builds the polynomial constraint matrix M.
-Eigen::MatrixXd FivePointsPolynomialConstraints(const Eigen::MatrixXd &E_basis);
+FivePointsConstraints FivePointsPolynomialConstraints(
+    const FivePointsBasis &E_basis);
 
 // Gauss--Jordan elimination for the constraint matrix.
-bool FivePointsGaussJordan(Eigen::MatrixXd *Mp);
+bool FivePointsGaussJordan(FivePointsConstraints *Mp);
 
+// Solve the reduced constraints for their real roots, the real eigenvalues of
+// the action matrix, and write the corresponding essential matrices (up to
+// 10) in Es. Returns the number of essential matrices.
+int FivePointsRealSolutions(const FivePointsBasis &E_basis,
+                            const FivePointsConstraints &M,
+                            Eigen::Matrix<double, 3, 3> *Es);
+
+// Write the essential matrices (up to 10) of five matches in Es, and return
+// their number.
 template <class IT>
-std::vector<Eigen::Matrix<double, 3, 3>> EssentialFivePoints(IT begin, IT end) {
+int EssentialFivePoints(IT begin, IT end, Eigen::Matrix<double, 3, 3> *Es) {
   // Step 1: Nullspace exrtraction.
-  Eigen::MatrixXd E_basis = FivePointsNullspaceBasis(begin, end);
+  const FivePointsBasis E_basis = FivePointsNullspaceBasis(begin, end);
 
   // Step 2: Constraint expansion.
-  Eigen::MatrixXd M = FivePointsPolynomialConstraints(E_basis);
+  FivePointsConstraints M = FivePointsPolynomialConstraints(E_basis);
 
   // Step 3: Gauss-Jordan elimination.
   if (!FivePointsGaussJordan(&M)) {
-    return std::vector<Eigen::Matrix<double, 3, 3>>();
+    return 0;
   }
 
-  // For the next steps, follow the matlab code given in Stewenius et al [1].
-
-  // Build the action matrix.
-  Eigen::MatrixXd B = M.topRightCorner<10, 10>();
-  Eigen::MatrixXd At = Eigen::MatrixXd::Zero(10, 10);
-  At.row(0) = -B.row(0);
-  At.row(1) = -B.row(1);
-  At.row(2) = -B.row(2);
-  At.row(3) = -B.row(4);
-  At.row(4) = -B.row(5);
-  At.row(5) = -B.row(7);
-  At(6, 0) = 1;
-  At(7, 1) = 1;
-  At(8, 3) = 1;
-  At(9, 6) = 1;
-
-  // Compute the solutions from action matrix's eigenvectors.
-  Eigen::EigenSolver<Eigen::MatrixXd> es(At);
-  typedef Eigen::EigenSolver<Eigen::MatrixXd>::EigenvectorsType Matc;
-  Matc V = es.eigenvectors();
-  Matc solutions(4, 10);
-  solutions.row(0) = V.row(6).array() / V.row(9).array();
-  solutions.row(1) = V.row(7).array() / V.row(9).array();
-  solutions.row(2) = V.row(8).array() / V.row(9).array();
-  solutions.row(3).setOnes();
-
-  // Get the ten candidate E matrices in vector form.
-  Matc Evec = E_basis * solutions;
-
-  // Build the essential matrices for the real solutions.
-  std::vector<Eigen::Matrix<double, 3, 3>> Es;
-  Es.reserve(10);
-  for (int s = 0; s < 10; ++s) {
-    Evec.col(s) /= Evec.col(s).norm();
-    bool is_real = true;
-    for (int i = 0; i < 9; ++i) {
-      if (Evec(i, s).imag() != 0) {
-        is_real = false;
-        break;
-      }
-    }
-    if (is_real) {
-      Eigen::Matrix<double, 3, 3> E;
-      for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < 3; ++j) {
-          E(i, j) = Evec(3 * i + j, s).real();
-        }
-      }
-      Es.push_back(E);
-    }
-  }
-  return Es;
+  // Step 4: Roots of the constraints.
+  return FivePointsRealSolutions(E_basis, M, Es);
 }
 
 template <class IT>
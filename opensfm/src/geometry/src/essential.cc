@@ -1,9 +1,9 @@
 #include "../essential.h"
 
 // Multiply two polynomials of degree 1.
-Eigen::Matrix<double, -1, 1> o1(const Eigen::Matrix<double, -1, 1> &a,
-                                const Eigen::Matrix<double, -1, 1> &b) {
-  Eigen::Matrix<double, -1, 1> res = Eigen::Matrix<double, -1, 1>::Zero(20);
+FivePointsPolynomial o1(const FivePointsPolynomial &a,
+                        const FivePointsPolynomial &b) {
+  FivePointsPolynomial res = FivePointsPolynomial::Zero();
 
   res(coef_xx) = a(coef_x) * b(coef_x);
   res(coef_xy) = a(coef_x) * b(coef_y) + a(coef_y) * b(coef_x);
@@ -20,9 +20,9 @@ Eigen::Matrix<double, -1, 1> o1(const Eigen::Matrix<double, -1, 1> &a,
 }
 
 // Multiply a polynomial of degree 2, a, by a polynomial of degree 1, b.
-Eigen::Matrix<double, -1, 1> o2(const Eigen::Matrix<double, -1, 1> &a,
-                                const Eigen::Matrix<double, -1, 1> &b) {
-  Eigen::Matrix<double, -1, 1> res(20);
+FivePointsPolynomial o2(const FivePointsPolynomial &a,
+                        const FivePointsPolynomial &b) {
+  FivePointsPolynomial res;
 
   res(coef_xxx) = a(coef_xx) * b(coef_x);
   res(coef_xxy) = a(coef_xx) * b(coef_y) + a(coef_xy) * b(coef_x);
@@ -53,13 +53,13 @@ Eigen::Matrix<double, -1, 1> o2(const Eigen::Matrix<double, -1, 1> &a,
 }
 
 // Builds the polynomial constraint matrix M.
-Eigen::MatrixXd FivePointsPolynomialConstraints(
-    const Eigen::MatrixXd &E_basis) {
+FivePointsConstraints FivePointsPolynomialConstraints(
+    const FivePointsBasis &E_basis) {
   // Build the polynomial form of E (equation (8) in Stewenius et al. [1])
-  Eigen::Matrix<double, -1, 1> E[3][3];
+  FivePointsPolynomial E[3][3];
   for (int i = 0; i < 3; ++i) {
     for (int j = 0; j < 3; ++j) {
-      E[i][j] = Eigen::Matrix<double, -1, 1>::Zero(20);
+      E[i][j].setZero();
       E[i][j](coef_x) = E_basis(3 * i + j, 0);
       E[i][j](coef_y) = E_basis(3 * i + j, 1);
       E[i][j](coef_z) = E_basis(3 * i + j, 2);
@@ -68,7 +68,7 @@ Eigen::MatrixXd FivePointsPolynomialConstraints(
   }
 
   // The constraint matrix.
-  Eigen::MatrixXd M(10, 20);
+  FivePointsConstraints M;
   int mrow = 0;
 
   // Determinant constraint det(E) = 0; equation (19) of Nister [2].
@@ -78,7 +78,7 @@ Eigen::MatrixXd FivePointsPolynomialConstraints(
 
   // Cubic singular values constraint.
   // Equation (20).
-  Eigen::Matrix<double, -1, 1> EET[3][3];
+  FivePointsPolynomial EET[3][3];
   for (int i = 0; i < 3; ++i) {    // Since EET is symmetric, we only compute
     for (int j = 0; j < 3; ++j) {  // its upper triangular part.
       if (i <= j) {
@@ -91,8 +91,8 @@ Eigen::MatrixXd FivePointsPolynomialConstraints(
   }
 
   // Equation (21).
-  Eigen::Matrix<double, -1, 1>(&L)[3][3] = EET;
-  Eigen::Matrix<double, -1, 1> trace =
+  FivePointsPolynomial(&L)[3][3] = EET;
+  const FivePointsPolynomial trace =
       0.5 * (EET[0][0] + EET[1][1] + EET[2][2]);
   for (int i = 0; i < 3; ++i) {
     L[i][i] -= trace;
@@ -101,7 +101,7 @@ Eigen::MatrixXd FivePointsPolynomialConstraints(
   // Equation (23).
   for (int i = 0; i < 3; ++i) {
     for (int j = 0; j < 3; ++j) {
-      Eigen::Matrix<double, -1, 1> LEij =
+      const FivePointsPolynomial LEij =
           o2(L[i][0], E[0][j]) + o2(L[i][1], E[1][j]) + o2(L[i][2], E[2][j]);
       M.row(mrow++) = LEij;
     }
@@ -111,8 +111,8 @@ Eigen::MatrixXd FivePointsPolynomialConstraints(
 }
 
 // Gauss--Jordan elimination for the constraint matrix.
-bool FivePointsGaussJordan(Eigen::MatrixXd *Mp) {
-  Eigen::MatrixXd &M = *Mp;
+bool FivePointsGaussJordan(FivePointsConstraints *Mp) {
+  FivePointsConstraints &M = *Mp;
 
   // Gauss Elimination.
   for (int i = 0; i < 10; ++i) {
@@ -139,6 +139,248 @@ bool FivePointsGaussJordan(Eigen::MatrixXd *Mp) {
   return true;
 }
 
+namespace {
+using ActionMatrix = Eigen::Matrix<double, 10, 10>;
+
+// Polynomial of degree up to 10, by increasing degree.
+using ActionPolynomial = Eigen::Matrix<double, 11, 1>;
+
+double EvaluatePolynomial(const ActionPolynomial &p, int degree, double x) {
+  double value = p(degree);
+  for (int i = degree - 1; i >= 0; --i) {
+    value = value * x + p(i);
+  }
+  return value;
+}
+
+// Characteristic polynomial det(H - lambda * I) of an upper Hessenberg
+// matrix, from the recurrence on its leading principal minors.
+ActionPolynomial HessenbergCharacteristicPolynomial(const ActionMatrix &H) {
+  ActionPolynomial minors[11];
+  minors[0].setZero();
+  minors[0](0) = 1.0;
+  for (int k = 1; k <= 10; ++k) {
+    ActionPolynomial &p = minors[k];
+    p.setZero();
+    p.head(k) += H(k - 1, k - 1) * minors[k - 1].head(k);
+    p.segment(1, k) -= minors[k - 1].head(k);
+    double subdiagonal_product = 1.0;
+    for (int i = 1; i < k; ++i) {
+      subdiagonal_product *= -H(k - i, k - i - 1);
+      p.head(k - i) += H(k - i - 1, k - 1) * subdiagonal_product *
+                       minors[k - i - 1].head(k - i);
+    }
+  }
+  return minors[10];
+}
+
+// Sturm sequence of a polynomial : the polynomial, its derivative, and the
+// negated remainders of the successive divisions. The number of distinct
+// real roots in ]a, b] is SignChanges(a) - SignChanges(b).
+class SturmSequence {
+ public:
+  SturmSequence(const ActionPolynomial &p, int degree) {
+    sequence_[0] = p;
+    degrees_[0] = degree;
+    sequence_[1].setZero();
+    for (int i = 1; i <= degree; ++i) {
+      sequence_[1](i - 1) = i * p(i);
+    }
+    degrees_[1] = degree - 1;
+    count_ = 2;
+
+    while (degrees_[count_ - 1] > 0) {
+      const ActionPolynomial &a = sequence_[count_ - 2];
+      const ActionPolynomial &b = sequence_[count_ - 1];
+      const int degree_a = degrees_[count_ - 2];
+      const int degree_b = degrees_[count_ - 1];
+
+      ActionPolynomial r = a;
+      for (int k = degree_a - degree_b; k >= 0; --k) {
+        const double q = r(degree_b + k) / b(degree_b);
+        r.segment(k, degree_b + 1) -= q * b.head(degree_b + 1);
+        r(degree_b + k) = 0.0;
+      }
+
+      // Leading coefficients lost to cancellation are dropped. A null
+      // remainder means multiple roots, still counted once.
+      const double epsilon = 1e-12 * a.head(degree_a + 1).cwiseAbs().maxCoeff();
+      int degree_r = degree_b - 1;
+      while (degree_r >= 0 && std::abs(r(degree_r)) <= epsilon) {
+        --degree_r;
+      }
+      if (degree_r < 0) {
+        break;
+      }
+      sequence_[count_] = -r;
+      degrees_[count_] = degree_r;
+      ++count_;
+    }
+  }
+
+  int SignChanges(double x) const {
+    int changes = 0;
+    double previous = 0.0;
+    for (int i = 0; i < count_; ++i) {
+      const double value = EvaluatePolynomial(sequence_[i], degrees_[i], x);
+      if (value == 0.0) {
+        continue;
+      }
+      if (previous * value < 0.0) {
+        ++changes;
+      }
+      previous = value;
+    }
+    return changes;
+  }
+
+ private:
+  ActionPolynomial sequence_[11];
+  int degrees_[11];
+  int count_{0};
+};
+
+// Root isolated in ]lower, upper], refined by Newton's iterations, which
+// fall back to bisection when they leave the interval.
+double RefineRoot(const ActionPolynomial &p, int degree, double lower,
+                  double upper) {
+  ActionPolynomial derivative = ActionPolynomial::Zero();
+  for (int i = 1; i <= degree; ++i) {
+    derivative(i - 1) = i * p(i);
+  }
+
+  const bool increasing = EvaluatePolynomial(p, degree, upper) > 0.0;
+  double x = 0.5 * (lower + upper);
+  for (int i = 0; i < 100; ++i) {
+    const double value = EvaluatePolynomial(p, degree, x);
+    if (value == 0.0) {
+      return x;
+    }
+    if ((value > 0.0) == increasing) {
+      upper = x;
+    } else {
+      lower = x;
+    }
+
+    const double slope = EvaluatePolynomial(derivative, degree - 1, x);
+    double next = x - value / slope;
+    if (!(next > lower && next < upper)) {
+      next = 0.5 * (lower + upper);
+    }
+    if (std::abs(next - x) <= 1e-15 * std::abs(x) ||
+        next <= lower || next >= upper) {
+      return next;
+    }
+    x = next;
+  }
+  return x;
+}
+
+// Isolate the roots in ]lower, upper] by bisection of the interval, given
+// the sign changes of the Sturm sequence at its bounds.
+void IsolateRoots(const ActionPolynomial &p, int degree,
+                  const SturmSequence &sturm, double lower, double upper,
+                  int changes_lower, int changes_upper, int depth,
+                  double *roots, int *count) {
+  const int roots_count = changes_lower - changes_upper;
+  if (roots_count <= 0) {
+    return;
+  }
+  const double middle = 0.5 * (lower + upper);
+  const int max_depth = 60;
+  if (roots_count == 1 || depth == max_depth || middle <= lower ||
+      middle >= upper) {
+    roots[(*count)++] = RefineRoot(p, degree, lower, upper);
+    return;
+  }
+  const int changes_middle = sturm.SignChanges(middle);
+  IsolateRoots(p, degree, sturm, lower, middle, changes_lower, changes_middle,
+               depth + 1, roots, count);
+  IsolateRoots(p, degree, sturm, middle, upper, changes_middle, changes_upper,
+               depth + 1, roots, count);
+}
+
+// Distinct real roots of a polynomial with a non-null leading coefficient.
+int PolynomialRealRoots(const ActionPolynomial &p, int degree,
+                        double *roots) {
+  // Fujiwara's bound on the roots
+  double bound = 0.0;
+  for (int i = 0; i < degree; ++i) {
+    const double ratio = std::abs(p(i) / p(degree));
+    const double factor = (i == 0) ? 0.5 : 1.0;
+    bound = std::max(bound, std::pow(factor * ratio, 1.0 / (degree - i)));
+  }
+  bound *= 2.0;
+
+  const SturmSequence sturm(p, degree);
+  int count = 0;
+  IsolateRoots(p, degree, sturm, -bound, bound, sturm.SignChanges(-bound),
+               sturm.SignChanges(bound), 0, roots, &count);
+  return count;
+}
+}  // namespace
+
+int FivePointsRealSolutions(const FivePointsBasis &E_basis,
+                            const FivePointsConstraints &M,
+                            Eigen::Matrix<double, 3, 3> *Es) {
+  // For the next steps, follow the matlab code given in Stewenius et al [1].
+
+  // Build the action matrix.
+  const ActionMatrix B = M.topRightCorner<10, 10>();
+  ActionMatrix At = ActionMatrix::Zero();
+  At.row(0) = -B.row(0);
+  At.row(1) = -B.row(1);
+  At.row(2) = -B.row(2);
+  At.row(3) = -B.row(4);
+  At.row(4) = -B.row(5);
+  At.row(5) = -B.row(7);
+  At(6, 0) = 1;
+  At(7, 1) = 1;
+  At(8, 3) = 1;
+  At(9, 6) = 1;
+
+  // The eigenvalues of the action matrix are the x of the solutions. Its
+  // real eigenvalues are the real roots of its characteristic polynomial,
+  // found with a Sturm sequence.
+  const Eigen::HessenbergDecomposition<ActionMatrix> hessenberg(At);
+  const ActionPolynomial characteristic =
+      HessenbergCharacteristicPolynomial(hessenberg.matrixH());
+  double xs[10];
+  const int xs_count = PolynomialRealRoots(characteristic, 10, xs);
+
+  // The eigenvector of x is the vector of monomials
+  //
+  //   [xx xy yy xz yz zz x y z 1]
+  //
+  // Given x, the first six rows of (At - x * I) * v = 0 are linear in
+  // [yy yz zz y z], solved in the least squares sense.
+  int count = 0;
+  for (int s = 0; s < xs_count; ++s) {
+    const double x = xs[s];
+    Eigen::Matrix<double, 6, 10> C = At.topRows<6>();
+    C.leftCols<6>().diagonal().array() -= x;
+
+    Eigen::Matrix<double, 6, 5> A;
+    A.col(0) = C.col(2);
+    A.col(1) = C.col(4);
+    A.col(2) = C.col(5);
+    A.col(3) = C.col(7) + x * C.col(1);
+    A.col(4) = C.col(8) + x * C.col(3);
+    const Eigen::Matrix<double, 6, 1> b =
+        -(x * x * C.col(0) + x * C.col(6) + C.col(9));
+    const Eigen::Matrix<double, 5, 1> monomials =
+        A.colPivHouseholderQr().solve(b);
+
+    const Eigen::Vector4d solution(x, monomials(3), monomials(4), 1.0);
+    const Eigen::Matrix<double, 9, 1> Evec =
+        (E_basis * solution).normalized();
+    Es[count++] =
+        Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(
+            Evec.data());
+  }
+  return count;
+}
+
 namespace geometry {
 std::vector<Eigen::Matrix<double, 3, 3>> EssentialFivePoints(
     const Eigen::Matrix<double, -1, 3> &x1,
@@ -151,7 +393,9 @@ std::vector<Eigen::Matrix<double, 3, 3>> EssentialFivePoints(
     samples[i].first = x1.row(i);
     samples[i].second = x2.row(i);
   }
-  return ::EssentialFivePoints(samples.begin(), samples.end());
+  Eigen::Matrix<double, 3, 3> Es[10];
+  const int count = ::EssentialFivePoints(samples.begin(), samples.end(), Es);
+  return std::vector<Eigen::Matrix<double, 3, 3>>(Es, Es + count);
 }
 
 std::vector<Eigen::Matrix<double, 3, 3>> EssentialNPoints(
@@ -0,0 +1,340 @@
+#include <geometry/essential.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+namespace reference {
+// The previous five points solver, with dynamic-size polynomials and an
+// eigen-decomposition of the action matrix, kept as a reference for the
+// benchmark below.
+
+// Compute the nullspace of the linear constraints given by the matches.
+template <class IT>
+Eigen::MatrixXd NullspaceBasis(IT begin, IT end) {
+  Eigen::Matrix<double, 9, 9> A;
+  A.setZero();  // Make A square until Eigen supports rectangular SVD.
+  EncodeEpipolarEquation(begin, end, &A);
+  Eigen::JacobiSVD<Eigen::Matrix<double, 9, 9>> svd;
+  return svd.compute(A, Eigen::ComputeFullV).matrixV().topRightCorner<9, 4>();
+}
+
+// Multiply two polynomials of degree 1.
+Eigen::VectorXd o1(const Eigen::VectorXd &a, const Eigen::VectorXd &b) {
+  Eigen::VectorXd res = Eigen::VectorXd::Zero(20);
+
+  res(coef_xx) = a(coef_x) * b(coef_x);
+  res(coef_xy) = a(coef_x) * b(coef_y) + a(coef_y) * b(coef_x);
+  res(coef_xz) = a(coef_x) * b(coef_z) + a(coef_z) * b(coef_x);
+  res(coef_yy) = a(coef_y) * b(coef_y);
+  res(coef_yz) = a(coef_y) * b(coef_z) + a(coef_z) * b(coef_y);
+  res(coef_zz) = a(coef_z) * b(coef_z);
+  res(coef_x) = a(coef_x) * b(coef_1) + a(coef_1) * b(coef_x);
+  res(coef_y) = a(coef_y) * b(coef_1) + a(coef_1) * b(coef_y);
+  res(coef_z) = a(coef_z) * b(coef_1) + a(coef_1) * b(coef_z);
+  res(coef_1) = a(coef_1) * b(coef_1);
+
+  return res;
+}
+
+// Multiply a polynomial of degree 2, a, by a polynomial of degree 1, b.
+Eigen::VectorXd o2(const Eigen::VectorXd &a, const Eigen::VectorXd &b) {
+  Eigen::VectorXd res(20);
+
+  res(coef_xxx) = a(coef_xx) * b(coef_x);
+  res(coef_xxy) = a(coef_xx) * b(coef_y) + a(coef_xy) * b(coef_x);
+  res(coef_xxz) = a(coef_xx) * b(coef_z) + a(coef_xz) * b(coef_x);
+  res(coef_xyy) = a(coef_xy) * b(coef_y) + a(coef_yy) * b(coef_x);
+  res(coef_xyz) =
+      a(coef_xy) * b(coef_z) + a(coef_yz) * b(coef_x) + a(coef_xz) * b(coef_y);
+  res(coef_xzz) = a(coef_xz) * b(coef_z) + a(coef_zz) * b(coef_x);
+  res(coef_yyy) = a(coef_yy) * b(coef_y);
+  res(coef_yyz) = a(coef_yy) * b(coef_z) + a(coef_yz) * b(coef_y);
+  res(coef_yzz) = a(coef_yz) * b(coef_z) + a(coef_zz) * b(coef_y);
+  res(coef_zzz) = a(coef_zz) * b(coef_z);
+  res(coef_xx) = a(coef_xx) * b(coef_1) + a(coef_x) * b(coef_x);
+  res(coef_xy) =
+      a(coef_xy) * b(coef_1) + a(coef_x) * b(coef_y) + a(coef_y) * b(coef_x);
+  res(coef_xz) =
+      a(coef_xz) * b(coef_1) + a(coef_x) * b(coef_z) + a(coef_z) * b(coef_x);
+  res(coef_yy) = a(coef_yy) * b(coef_1) + a(coef_y) * b(coef_y);
+  res(coef_yz) =
+      a(coef_yz) * b(coef_1) + a(coef_y) * b(coef_z) + a(coef_z) * b(coef_y);
+  res(coef_zz) = a(coef_zz) * b(coef_1) + a(coef_z) * b(coef_z);
+  res(coef_x) = a(coef_x) * b(coef_1) + a(coef_1) * b(coef_x);
+  res(coef_y) = a(coef_y) * b(coef_1) + a(coef_1) * b(coef_y);
+  res(coef_z) = a(coef_z) * b(coef_1) + a(coef_1) * b(coef_z);
+  res(coef_1) = a(coef_1) * b(coef_1);
+
+  return res;
+}
+
+// Builds the polynomial constraint matrix M.
+Eigen::MatrixXd FivePointsPolynomialConstraints(
+    const Eigen::MatrixXd &E_basis) {
+  // Build the polynomial form of E (equation (8) in Stewenius et al. [1])
+  Eigen::VectorXd E[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      E[i][j] = Eigen::VectorXd::Zero(20);
+      E[i][j](coef_x) = E_basis(3 * i + j, 0);
+      E[i][j](coef_y) = E_basis(3 * i + j, 1);
+      E[i][j](coef_z) = E_basis(3 * i + j, 2);
+      E[i][j](coef_1) = E_basis(3 * i + j, 3);
+    }
+  }
+
+  // The constraint matrix.
+  Eigen::MatrixXd M(10, 20);
+  int mrow = 0;
+
+  // Determinant constraint det(E) = 0; equation (19) of Nister [2].
+  M.row(mrow++) = o2(o1(E[0][1], E[1][2]) - o1(E[0][2], E[1][1]), E[2][0]) +
+                  o2(o1(E[0][2], E[1][0]) - o1(E[0][0], E[1][2]), E[2][1]) +
+                  o2(o1(E[0][0], E[1][1]) - o1(E[0][1], E[1][0]), E[2][2]);
+
+  // Cubic singular values constraint.
+  // Equation (20).
+  Eigen::VectorXd EET[3][3];
+  for (int i = 0; i < 3; ++i) {    // Since EET is symmetric, we only compute
+    for (int j = 0; j < 3; ++j) {  // its upper triangular part.
+      if (i <= j) {
+        EET[i][j] =
+            o1(E[i][0], E[j][0]) + o1(E[i][1], E[j][1]) + o1(E[i][2], E[j][2]);
+      } else {
+        EET[i][j] = EET[j][i];
+      }
+    }
+  }
+
+  // Equation (21).
+  Eigen::VectorXd(&L)[3][3] = EET;
+  Eigen::VectorXd trace =
+      0.5 * (EET[0][0] + EET[1][1] + EET[2][2]);
+  for (int i = 0; i < 3; ++i) {
+    L[i][i] -= trace;
+  }
+
+  // Equation (23).
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      Eigen::VectorXd LEij =
+          o2(L[i][0], E[0][j]) + o2(L[i][1], E[1][j]) + o2(L[i][2], E[2][j]);
+      M.row(mrow++) = LEij;
+    }
+  }
+
+  return M;
+}
+
+// Gauss--Jordan elimination for the constraint matrix.
+bool FivePointsGaussJordan(Eigen::MatrixXd *Mp) {
+  Eigen::MatrixXd &M = *Mp;
+
+  // Gauss Elimination.
+  for (int i = 0; i < 10; ++i) {
+    const auto diagonal = M(i, i);
+    if (diagonal == 0.0) {
+      return false;
+    }
+    M.row(i) /= diagonal;
+    for (int j = i + 1; j < 10; ++j) {
+      const auto elem = M(j, i);
+      if (elem == 0.0) {
+        return false;
+      }
+      M.row(j) = M.row(j) / elem - M.row(i);
+    }
+  }
+
+  // Backsubstitution.
+  for (int i = 9; i >= 0; --i) {
+    for (int j = 0; j < i; ++j) {
+      M.row(j) = M.row(j) - M(j, i) * M.row(i);
+    }
+  }
+  return true;
+}
+
+template <class IT>
+std::vector<Eigen::Matrix<double, 3, 3>> EssentialFivePoints(IT begin, IT end) {
+  // Step 1: Nullspace exrtraction.
+  Eigen::MatrixXd E_basis = NullspaceBasis(begin, end);
+
+  // Step 2: Constraint expansion.
+  Eigen::MatrixXd M = FivePointsPolynomialConstraints(E_basis);
+
+  // Step 3: Gauss-Jordan elimination.
+  if (!FivePointsGaussJordan(&M)) {
+    return std::vector<Eigen::Matrix<double, 3, 3>>();
+  }
+
+  // For the next steps, follow the matlab code given in Stewenius et al [1].
+
+  // Build the action matrix.
+  Eigen::MatrixXd B = M.topRightCorner<10, 10>();
+  Eigen::MatrixXd At = Eigen::MatrixXd::Zero(10, 10);
+  At.row(0) = -B.row(0);
+  At.row(1) = -B.row(1);
+  At.row(2) = -B.row(2);
+  At.row(3) = -B.row(4);
+  At.row(4) = -B.row(5);
+  At.row(5) = -B.row(7);
+  At(6, 0) = 1;
+  At(7, 1) = 1;
+  At(8, 3) = 1;
+  At(9, 6) = 1;
+
+  // Compute the solutions from action matrix's eigenvectors.
+  Eigen::EigenSolver<Eigen::MatrixXd> es(At);
+  typedef Eigen::EigenSolver<Eigen::MatrixXd>::EigenvectorsType Matc;
+  Matc V = es.eigenvectors();
+  Matc solutions(4, 10);
+  solutions.row(0) = V.row(6).array() / V.row(9).array();
+  solutions.row(1) = V.row(7).array() / V.row(9).array();
+  solutions.row(2) = V.row(8).array() / V.row(9).array();
+  solutions.row(3).setOnes();
+
+  // Get the ten candidate E matrices in vector form.
+  Matc Evec = E_basis * solutions;
+
+  // Build the essential matrices for the real solutions.
+  std::vector<Eigen::Matrix<double, 3, 3>> Es;
+  Es.reserve(10);
+  for (int s = 0; s < 10; ++s) {
+    Evec.col(s) /= Evec.col(s).norm();
+    bool is_real = true;
+    for (int i = 0; i < 9; ++i) {
+      if (Evec(i, s).imag() != 0) {
+        is_real = false;
+        break;
+      }
+    }
+    if (is_real) {
+      Eigen::Matrix<double, 3, 3> E;
+      for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+          E(i, j) = Evec(3 * i + j, s).real();
+        }
+      }
+      Es.push_back(E);
+    }
+  }
+  return Es;
+}
+}  // namespace reference
+}  // namespace
+
+class EssentialFivePointsFixture : public ::testing::Test {
+ public:
+  EssentialFivePointsFixture() {
+    std::srand(42);
+    for (int i = 0; i < count; ++i) {
+      const Eigen::Matrix3d R =
+          Eigen::AngleAxisd(0.3, Eigen::Vector3d::Random().normalized())
+              .toRotationMatrix();
+      const Eigen::Vector3d t = Eigen::Vector3d::Random().normalized();
+      Eigen::Matrix3d t_x;
+      t_x << 0.0, -t(2), t(1), t(2), 0.0, -t(0), -t(1), t(0), 0.0;
+      essentials.push_back((t_x * R).normalized());
+
+      std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>> pair_samples;
+      for (int j = 0; j < 5; ++j) {
+        const Eigen::Vector3d point =
+            Eigen::Vector3d(0.0, 0.0, 5.0) + 2.0 * Eigen::Vector3d::Random();
+        pair_samples.emplace_back(point.normalized(),
+                                  (R * point + t).normalized());
+      }
+      samples.push_back(pair_samples);
+    }
+  }
+
+  const int count = 100;
+  std::vector<Eigen::Matrix3d> essentials;
+  std::vector<std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d>>>
+      samples;
+};
+
+TEST_F(EssentialFivePointsFixture, FindsTheEssentialMatrix) {
+  for (int i = 0; i < count; ++i) {
+    Eigen::Matrix3d Es[10];
+    const int solutions =
+        EssentialFivePoints(samples[i].begin(), samples[i].end(), Es);
+    ASSERT_GT(solutions, 0);
+    ASSERT_LE(solutions, 10);
+
+    double best_error = std::numeric_limits<double>::max();
+    for (int j = 0; j < solutions; ++j) {
+      best_error = std::min({best_error, (Es[j] - essentials[i]).norm(),
+                             (Es[j] + essentials[i]).norm()});
+    }
+    EXPECT_NEAR(0.0, best_error, 1e-6);
+  }
+}
+
+TEST_F(EssentialFivePointsFixture, SolutionsAreEssentialMatrices) {
+  for (int i = 0; i < count; ++i) {
+    Eigen::Matrix3d Es[10];
+    const int solutions =
+        EssentialFivePoints(samples[i].begin(), samples[i].end(), Es);
+    for (int j = 0; j < solutions; ++j) {
+      const Eigen::Matrix3d& E = Es[j];
+      for (const auto& sample : samples[i]) {
+        EXPECT_NEAR(0.0, sample.second.dot(E * sample.first), 1e-8);
+      }
+      const Eigen::Matrix3d EEt = E * E.transpose();
+      EXPECT_NEAR(0.0, E.determinant(), 1e-8);
+      EXPECT_NEAR(0.0, (2.0 * EEt * E - EEt.trace() * E).norm(), 1e-8);
+    }
+  }
+}
+
+// Micro-benchmark of the solver against the reference one on the same
+// problems, run with --gtest_also_run_disabled_tests.
+TEST_F(EssentialFivePointsFixture, DISABLED_Benchmark) {
+  const int repeats = 100;
+
+  int total_solutions = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; ++r) {
+    for (int i = 0; i < count; ++i) {
+      Eigen::Matrix3d Es[10];
+      total_solutions +=
+          EssentialFivePoints(samples[i].begin(), samples[i].end(), Es);
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  int reference_solutions = 0;
+  const auto reference_start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; ++r) {
+    for (int i = 0; i < count; ++i) {
+      reference_solutions +=
+          reference::EssentialFivePoints(samples[i].begin(), samples[i].end())
+              .size();
+    }
+  }
+  const auto reference_end = std::chrono::steady_clock::now();
+
+  const double calls = repeats * count;
+  const auto report = [calls](const std::string& name, double elapsed_us,
+                              int solutions) {
+    std::cout << name << ": " << elapsed_us / calls << " us per call, "
+              << solutions / calls << " solutions per call" << std::endl;
+  };
+  report("EssentialFivePoints",
+         std::chrono::duration<double, std::micro>(end - start).count(),
+         total_solutions);
+  report("Reference EssentialFivePoints",
+         std::chrono::duration<double, std::micro>(reference_end -
+                                                   reference_start)
+             .count(),
+         reference_solutions);
+  EXPECT_GT(total_solutions, 0);
+  EXPECT_EQ(reference_solutions, total_solutions);
+}
@@ -36,8 +36,9 @@ using DescriptorMatrix =
 struct HashPair {
   template <class T1, class T2>
   size_t operator()(const std::pair<T1, T2>& p) const {
-    auto hash1 = std::hash<T1>{}(p.first);
-    auto hash2 = std::hash<T2>{}(p.second);
-    return hash1 ^ hash2;
+    // Combined as in boost::hash_combine, so that (a, b) and (b, a) differ
+    const size_t hash1 = std::hash<T1>{}(p.first);
+    const size_t hash2 = std::hash<T2>{}(p.second);
+    return hash1 ^ (hash2 + 0x9e3779b9 + (hash1 << 6) + (hash1 >> 2));
   }
 };
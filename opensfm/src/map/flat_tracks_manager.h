@@ -0,0 +1,170 @@
+#pragma once
+
+#include <map/defines.h>
+#include <map/observation.h>
+#include <map/tracks_manager.h>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace map {
+
+// Column of values, either owned or pointing into a mapped binary file.
+// Writes go through Mutable(), which copies mapped values first.
+template <class T>
+class FlatColumn {
+ public:
+  using value_type = T;
+
+  const T* data() const { return mapped_ ? mapped_ : values_.data(); }
+  size_t size() const { return mapped_ ? mapped_size_ : values_.size(); }
+  const T* begin() const { return data(); }
+  const T* end() const { return data() + size(); }
+  const T& operator[](size_t index) const { return data()[index]; }
+  bool IsMapped() const { return mapped_ != nullptr; }
+
+  void Map(const T* data, size_t size) {
+    std::vector<T>().swap(values_);
+    mapped_ = data;
+    mapped_size_ = size;
+  }
+
+  std::vector<T>& Mutable() {
+    if (mapped_) {
+      values_.assign(mapped_, mapped_ + mapped_size_);
+      mapped_ = nullptr;
+      mapped_size_ = 0;
+    }
+    return values_;
+  }
+
+ private:
+  std::vector<T> values_;
+  const T* mapped_{nullptr};
+  size_t mapped_size_{0};
+};
+
+// Read-only tracks storage : shot and track IDs are interned to dense
+// indexes (in lexicographic order) and each observation is stored once, in
+// columns sorted by shot then by track. Observations are indexed by shot
+// and by track using compressed sparse rows.
+class FlatTracksManager {
+ public:
+  using ObservationIndex = int64_t;
+  using ObservationRange = std::pair<ObservationIndex, ObservationIndex>;
+
+  FlatTracksManager() = default;
+  explicit FlatTracksManager(const TracksManager& manager);
+  TracksManager ToTracksManager() const;
+
+  // Integer API
+  int NumShots() const { return shot_ids_.size(); }
+  int NumTracks() const { return track_ids_.size(); }
+  ObservationIndex NumObservations() const {
+    return observation_shots_.size();
+  }
+  // Whether observations columns point into a mapped binary file
+  bool IsMapped() const { return xs_.IsMapped(); }
+
+  // Return -1 for unknown IDs
+  int GetShotIndex(const ShotId& shot) const;
+  int GetTrackIndex(const TrackId& track) const;
+  const ShotId& GetShotId(int shot_index) const {
+    return shot_ids_[shot_index];
+  }
+  const TrackId& GetTrackId(int track_index) const {
+    return track_ids_[track_index];
+  }
+
+  // Observations of a shot are contiguous, [first, second[, sorted by track
+  ObservationRange GetShotObservationRange(int shot_index) const {
+    return {shot_offsets_[shot_index], shot_offsets_[shot_index + 1]};
+  }
+  // Observations of a track, [first, second[ of GetTrackObservationIndex,
+  // sorted by shot
+  ObservationRange GetTrackObservationRange(int track_index) const {
+    return {track_offsets_[track_index], track_offsets_[track_index + 1]};
+  }
+  ObservationIndex GetTrackObservationIndex(ObservationIndex i) const {
+    return track_observations_[i];
+  }
+  int GetObservationShot(ObservationIndex index) const {
+    return observation_shots_[index];
+  }
+  int GetObservationTrack(ObservationIndex index) const {
+    return observation_tracks_[index];
+  }
+  int GetObservationFeatureId(ObservationIndex index) const {
+    return feature_ids_[index];
+  }
+  Observation GetObservation(ObservationIndex index) const;
+
+  // String API, same as TracksManager's one
+  std::vector<ShotId> GetShotIds() const { return shot_ids_; }
+  std::vector<TrackId> GetTrackIds() const { return track_ids_; }
+  bool HasShotObservations(const ShotId& shot) const;
+  Observation GetObservation(const ShotId& shot, const TrackId& track) const;
+  std::unordered_map<TrackId, Observation> GetShotObservations(
+      const ShotId& shot) const;
+  std::unordered_map<ShotId, Observation> GetTrackObservations(
+      const TrackId& track) const;
+  std::vector<TracksManager::KeyPointTuple> GetAllCommonObservations(
+      const ShotId& shot1, const ShotId& shot2) const;
+  TracksManager ConstructSubTracksManager(
+      const std::vector<TrackId>& tracks,
+      const std::vector<ShotId>& shots) const;
+  std::unordered_map<TracksManager::ShotPair, int, HashPair>
+  GetAllPairsConnectivity(const std::vector<ShotId>& shots,
+                          const std::vector<TrackId>& tracks) const;
+
+  // I/O : binary files are memory-mapped and their observations columns are
+  // used in place, text files go through TracksManager
+  static FlatTracksManager InstanciateFromFile(const std::string& filename);
+  static FlatTracksManager InstanciateFromString(const std::string& str);
+  void WriteToBinaryFile(const std::string& filename) const;
+  std::string AsBinaryString() const;
+
+  static bool IsBinaryFile(const std::string& filename);
+  static bool IsBinaryString(const std::string& str);
+
+ private:
+  // Columns point into data if mapping (which owns it) is given, they are
+  // copied otherwise
+  static FlatTracksManager InstanciateFromBinary(
+      const char* data, size_t size, std::shared_ptr<const void> mapping);
+  void WriteToStreamBinary(std::ostream& ostream) const;
+  void PushObservation(int shot_index, int track_index,
+                       const Observation& observation);
+
+  // Sort IDs and observations, and build the shot and track indexes from
+  // the (possibly unsorted) observations columns
+  void Finalize();
+
+  std::vector<ShotId> shot_ids_;
+  std::vector<TrackId> track_ids_;
+  std::unordered_map<ShotId, int> shot_indexes_;
+  std::unordered_map<TrackId, int> track_indexes_;
+
+  // Observations columns, and the binary file they might point into
+  FlatColumn<int> observation_shots_;
+  FlatColumn<int> observation_tracks_;
+  FlatColumn<double> xs_;
+  FlatColumn<double> ys_;
+  FlatColumn<double> scales_;
+  FlatColumn<int> feature_ids_;
+  FlatColumn<int> segmentation_ids_;
+  FlatColumn<int> instance_ids_;
+  FlatColumn<uint8_t> colors_;  // RGB, 3 per observation
+  std::shared_ptr<const void> mapping_;
+  std::unordered_map<ObservationIndex, Depth> depth_priors_;
+
+  // Compressed sparse rows indexes
+  std::vector<ObservationIndex> shot_offsets_{0};
+  std::vector<ObservationIndex> track_offsets_{0};
+  std::vector<ObservationIndex> track_observations_;
+};
+}  // namespace map
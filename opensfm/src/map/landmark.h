@@ -1,11 +1,13 @@
 #pragma once
 #include <map/defines.h>
+#include <map/observation.h>
 
 #include <Eigen/Eigen>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 namespace map {
 class Shot;
 
@@ -39,9 +41,24 @@ class Landmark {
   // Reprojection Errors
   void SetReprojectionErrors(
       const std::map<ShotId, Eigen::VectorXd>& reproj_errors);
+  // Reference the entries [begin, end) of errors shared with other landmarks
+  void SetReprojectionErrors(std::shared_ptr<const ReprojectionErrors> errors,
+                             int begin, int end);
   std::map<ShotId, Eigen::VectorXd> GetReprojectionErrors() const;
   void RemoveReprojectionError(const ShotId& shot_id);
 
+  // Call f(shot_id, residual) for each reprojection error, without copies
+  template <class F>
+  void ForEachReprojectionError(F&& f) const {
+    for (int e = reproj_errors_begin_; e < reproj_errors_end_; ++e) {
+      if (!reproj_errors_removed_.empty() &&
+          reproj_errors_removed_[e - reproj_errors_begin_]) {
+        continue;
+      }
+      f(reproj_errors_->EntryShotId(e), reproj_errors_->Residual(e));
+    }
+  }
+
  public:
   const LandmarkId id_;
 
@@ -49,6 +66,11 @@ class Landmark {
   Vec3d global_pos_;  // point in global
   std::map<Shot*, FeatureId, KeyCompare> observations_;
   Vec3i color_;
-  std::map<ShotId, Eigen::VectorXd> reproj_errors_;
+  // Range of entries of reprojection errors shared with other landmarks,
+  // the ones of removed observations being masked
+  std::shared_ptr<const ReprojectionErrors> reproj_errors_;
+  int reproj_errors_begin_{0};
+  int reproj_errors_end_{0};
+  std::vector<bool> reproj_errors_removed_;
 };
 }  // namespace map
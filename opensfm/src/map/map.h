@@ -15,7 +15,9 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 namespace map {
 
 class Map {
@@ -163,6 +165,11 @@ class Map {
   size_t NumberOfCameras() const { return cameras_.size(); }
   size_t NumberOfBiases() const { return bias_.size(); }
 
+  // Revision of the shots, landmarks and observations of the map. It changes
+  // whenever one of them is added or removed and is never shared by two maps,
+  // so that data derived from them can be cached while it doesn't change.
+  size_t GetStructureRevision() const { return structure_revision_; }
+
   // Bias
   BiasView GetBiasView() { return BiasView(*this); }
   geometry::Similarity& GetBias(const CameraId& camera_id);
@@ -198,8 +205,16 @@ class Map {
   std::unordered_map<ShotId, std::unordered_map<LandmarkId, Observation> >
   GetValidObservations(const TracksManager& tracks_manager) const;
 
+  // Reprojection errors of the given landmarks (all if empty) as the
+  // landmark and shot of each error, and the residuals padded with zeros
+  // to the largest residual size
+  std::tuple<std::vector<LandmarkId>, std::vector<ShotId>, MatXd>
+  GetLandmarksReprojectionErrors(
+      const std::vector<LandmarkId>& landmark_ids) const;
+
  private:
   void UpdateShotWithRig(const Shot& other_shot, bool is_panoshot = false);
+  static size_t NewStructureRevision();
 
   std::unordered_map<CameraId, geometry::Camera> cameras_;
   std::unordered_map<CameraId, geometry::Similarity> bias_;
@@ -210,6 +225,7 @@ class Map {
   std::unordered_map<RigCameraId, RigCamera> rig_cameras_;
 
   geo::TopocentricConverter topo_conv_;
+  size_t structure_revision_{NewStructureRevision()};
 };
 
 }  // namespace map
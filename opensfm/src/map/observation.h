@@ -3,7 +3,9 @@
 #include <map/defines.h>
 
 #include <Eigen/Dense>
+#include <memory>
 #include <optional>
+#include <vector>
 
 namespace map {
 
@@ -17,6 +19,29 @@ struct Depth {
       : value(value_), is_radial(is_radial_), std_deviation(std_deviation_) {}
 };
 
+// Reprojection errors of the observations of a set of landmarks, in a flat
+// layout shared by the landmarks. Each entry is the residual of the
+// observation of a landmark by a shot, the entries of a landmark being
+// contiguous.
+struct ReprojectionErrors {
+  // Shot of each entry, as an index in shot_ids, which can be shared by the
+  // errors of several runs
+  std::shared_ptr<const std::vector<ShotId>> shot_ids;
+  std::vector<int> shots;
+  // Offset of the residual of each entry in values, plus the values count
+  std::vector<int> offsets;
+  std::vector<double> values;
+
+  int EntriesCount() const { return shots.size(); }
+  const ShotId& EntryShotId(int entry) const {
+    return (*shot_ids)[shots[entry]];
+  }
+  Eigen::Map<const Eigen::VectorXd> Residual(int entry) const {
+    return Eigen::Map<const Eigen::VectorXd>(
+        values.data() + offsets[entry], offsets[entry + 1] - offsets[entry]);
+  }
+};
+
 struct Observation {
   Observation() = default;
   Observation(double x, double y, double s, int r, int g, int b, int feature,
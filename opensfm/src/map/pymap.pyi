@@ -20,6 +20,7 @@ __all__ = [
     "CameraView",
     "Depth",
     "ErrorType",
+    "FlatTracksManager",
     "GroundControlPoint",
     "GroundControlPointObservation",
     "GroundControlPointRole",
@@ -103,6 +104,38 @@ class ErrorType:
     __members__: Dict[str, "ErrorType"]
     __entries: "dict"
 
+class FlatTracksManager:
+    @overload
+    def __init__(self) -> None: ...
+    @overload
+    def __init__(self, arg0: TracksManager) -> None: ...
+    def as_binary(self) -> bytes: ...
+    def construct_sub_tracks_manager(
+        self, arg0: List[str], arg1: List[str]
+    ) -> TracksManager: ...
+    def get_all_common_observations(
+        self, arg0: str, arg1: str
+    ) -> List[Tuple[str, Observation, Observation]]: ...
+    def get_all_pairs_connectivity(
+        self, shots: List[str] = [], tracks: List[str] = []
+    ) -> Dict[Tuple[str, str], int]: ...
+    def get_observation(self, arg0: str, arg1: str) -> Observation: ...
+    def get_shot_ids(self) -> List[str]: ...
+    def get_shot_index(self, arg0: str) -> int: ...
+    def get_shot_observations(self, arg0: str) -> Dict[str, Observation]: ...
+    def get_track_ids(self) -> List[str]: ...
+    def get_track_index(self, arg0: str) -> int: ...
+    def get_track_observations(self, arg0: str) -> Dict[str, Observation]: ...
+    @staticmethod
+    def instanciate_from_file(arg0: str) -> FlatTracksManager: ...
+    @staticmethod
+    def instanciate_from_string(arg0: Union[str, bytes]) -> FlatTracksManager: ...
+    def num_observations(self) -> int: ...
+    def num_shots(self) -> int: ...
+    def num_tracks(self) -> int: ...
+    def to_tracks_manager(self) -> TracksManager: ...
+    def write_to_binary_file(self, arg0: str) -> None: ...
+
 class GroundControlPoint:
     def __init__(self) -> None: ...
     def add_observation(self, arg0: GroundControlPointObservation) -> None: ...
@@ -242,6 +275,9 @@ class Map:
     def get_landmark(self, arg0: str) -> Landmark: ...
     def get_landmark_view(self) -> LandmarkView: ...
     def get_landmarks(self) -> LandmarkView: ...
+    def get_landmarks_reprojection_errors(
+        self, landmark_ids: List[str] = ...
+    ) -> Tuple[List[str], List[str], numpy.ndarray]: ...
     def get_pano_shot(self, arg0: str) -> Shot: ...
     def get_pano_shots(self) -> PanoShotView: ...
     def get_reference(self) -> opensfm.pygeo.TopocentricConverter: ...
@@ -561,7 +597,12 @@ class ShotView:
 class TracksManager:
     def __init__(self) -> None: ...
     def add_observation(self, arg0: str, arg1: str, arg2: Observation) -> None: ...
+    def as_binary(self) -> bytes: ...
     def as_string(self) -> str: ...
+    @staticmethod
+    def convert_file(
+        input_filename: str, output_filename: str, binary: bool
+    ) -> None: ...
     def construct_sub_tracks_manager(
         self, arg0: List[str], arg1: List[str]
     ) -> TracksManager: ...
@@ -579,12 +620,17 @@ class TracksManager:
     @staticmethod
     def instanciate_from_file(arg0: str) -> TracksManager: ...
     @staticmethod
-    def instanciate_from_string(arg0: str) -> TracksManager: ...
+    def instanciate_from_string(arg0: Union[str, bytes]) -> TracksManager: ...
+    @overload
     @staticmethod
     def merge_tracks_manager(arg0: List[TracksManager]) -> TracksManager: ...
+    @overload
+    @staticmethod
+    def merge_tracks_manager(arg0: List[TracksManager], arg1: str) -> None: ...
     def num_shots(self) -> int: ...
     def num_tracks(self) -> int: ...
     def remove_observation(self, arg0: str, arg1: str) -> None: ...
+    def write_to_binary_file(self, arg0: str) -> None: ...
     def write_to_file(self, arg0: str) -> None: ...
 
 Angular: "ErrorType"
@@ -5,6 +5,7 @@
 #include <geometry/pose.h>
 #include <map/dataviews.h>
 #include <map/defines.h>
+#include <map/flat_tracks_manager.h>
 #include <map/ground_control_points.h>
 #include <map/landmark.h>
 #include <map/map.h>
@@ -287,8 +288,17 @@ PYBIND11_MODULE(pymap, m) {
       .def_static("instanciate_from_string",
                   &map::TracksManager::InstanciateFromString,
                   py::call_guard<py::gil_scoped_release>())
-      .def_static("merge_tracks_manager",
-                  &map::TracksManager::MergeTracksManager)
+      .def_static(
+          "merge_tracks_manager",
+          py::overload_cast<const std::vector<const map::TracksManager *> &>(
+              &map::TracksManager::MergeTracksManager),
+          py::call_guard<py::gil_scoped_release>())
+      .def_static(
+          "merge_tracks_manager",
+          py::overload_cast<const std::vector<const map::TracksManager *> &,
+                            const std::string &>(
+              &map::TracksManager::MergeTracksManager),
+          py::call_guard<py::gil_scoped_release>())
       .def("add_observation", &map::TracksManager::AddObservation)
       .def("remove_observation", &map::TracksManager::RemoveObservation)
       .def("num_shots", &map::TracksManager::NumShots)
@@ -301,7 +311,21 @@ PYBIND11_MODULE(pymap, m) {
       .def("construct_sub_tracks_manager",
            &map::TracksManager::ConstructSubTracksManager)
       .def("write_to_file", &map::TracksManager::WriteToFile)
+      .def("write_to_binary_file", &map::TracksManager::WriteToBinaryFile,
+           py::call_guard<py::gil_scoped_release>())
       .def("as_string", &map::TracksManager::AsString)
+      .def("as_binary",
+           [](const map::TracksManager &manager) {
+             std::string serialized;
+             {
+               py::gil_scoped_release release;
+               serialized = manager.AsBinaryString();
+             }
+             return py::bytes(serialized);
+           })
+      .def_static("convert_file", &map::TracksManager::ConvertFile,
+                  py::arg("input_filename"), py::arg("output_filename"),
+                  py::arg("binary"), py::call_guard<py::gil_scoped_release>())
       .def("get_all_common_observations",
            &map::TracksManager::GetAllCommonObservations,
            py::call_guard<py::gil_scoped_release>())
@@ -311,6 +335,55 @@ PYBIND11_MODULE(pymap, m) {
            py::arg("tracks") = std::vector<map::TrackId>(),
            py::call_guard<py::gil_scoped_release>());
 
+  py::class_<map::FlatTracksManager>(m, "FlatTracksManager")
+      .def(py::init())
+      .def(py::init<const map::TracksManager &>(),
+           py::call_guard<py::gil_scoped_release>())
+      .def_static("instanciate_from_file",
+                  &map::FlatTracksManager::InstanciateFromFile,
+                  py::call_guard<py::gil_scoped_release>())
+      .def_static("instanciate_from_string",
+                  &map::FlatTracksManager::InstanciateFromString,
+                  py::call_guard<py::gil_scoped_release>())
+      .def("to_tracks_manager", &map::FlatTracksManager::ToTracksManager,
+           py::call_guard<py::gil_scoped_release>())
+      .def("num_shots", &map::FlatTracksManager::NumShots)
+      .def("num_tracks", &map::FlatTracksManager::NumTracks)
+      .def("num_observations", &map::FlatTracksManager::NumObservations)
+      .def("get_shot_ids", &map::FlatTracksManager::GetShotIds)
+      .def("get_track_ids", &map::FlatTracksManager::GetTrackIds)
+      .def("get_shot_index", &map::FlatTracksManager::GetShotIndex)
+      .def("get_track_index", &map::FlatTracksManager::GetTrackIndex)
+      .def("get_observation",
+           py::overload_cast<const map::ShotId &, const map::TrackId &>(
+               &map::FlatTracksManager::GetObservation, py::const_))
+      .def("get_shot_observations",
+           &map::FlatTracksManager::GetShotObservations)
+      .def("get_track_observations",
+           &map::FlatTracksManager::GetTrackObservations)
+      .def("construct_sub_tracks_manager",
+           &map::FlatTracksManager::ConstructSubTracksManager)
+      .def("write_to_binary_file",
+           &map::FlatTracksManager::WriteToBinaryFile,
+           py::call_guard<py::gil_scoped_release>())
+      .def("as_binary",
+           [](const map::FlatTracksManager &manager) {
+             std::string serialized;
+             {
+               py::gil_scoped_release release;
+               serialized = manager.AsBinaryString();
+             }
+             return py::bytes(serialized);
+           })
+      .def("get_all_common_observations",
+           &map::FlatTracksManager::GetAllCommonObservations,
+           py::call_guard<py::gil_scoped_release>())
+      .def("get_all_pairs_connectivity",
+           &map::FlatTracksManager::GetAllPairsConnectivity,
+           py::arg("shots") = std::vector<map::ShotId>(),
+           py::arg("tracks") = std::vector<map::TrackId>(),
+           py::call_guard<py::gil_scoped_release>());
+
   py::class_<map::PanoShotView>(m, "PanoShotView")
       .def(py::init<map::Map &>(),
            py::keep_alive<1, 2>())  // Keep map alive while view is used
@@ -678,5 +751,8 @@ PYBIND11_MODULE(pymap, m) {
       // Tracks manager x Reconstruction intersection
       .def("compute_reprojection_errors", &map::Map::ComputeReprojectionErrors)
       .def("get_valid_observations", &map::Map::GetValidObservations)
+      .def("get_landmarks_reprojection_errors",
+           &map::Map::GetLandmarksReprojectionErrors,
+           py::arg("landmark_ids") = std::vector<map::LandmarkId>())
       .def("to_tracks_manager", &map::Map::ToTracksManager);
 }
@@ -0,0 +1,517 @@
+#include <foundation/pair_counter.h>
+#include <map/flat_tracks_manager.h>
+#include <map/tracks_binary.h>
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+// Sort IDs and return the old to new indexes mapping, or an empty one if
+// they were already sorted
+template <class T>
+std::vector<int> SortIds(std::vector<T>* ids) {
+  if (std::is_sorted(ids->begin(), ids->end())) {
+    return {};
+  }
+  std::vector<int> order(ids->size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [ids](int a, int b) { return (*ids)[a] < (*ids)[b]; });
+
+  std::vector<int> remap(ids->size());
+  std::vector<T> sorted(ids->size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    remap[order[i]] = i;
+    sorted[i] = std::move((*ids)[order[i]]);
+  }
+  ids->swap(sorted);
+  return remap;
+}
+
+template <class T>
+void Permute(const std::vector<int64_t>& order, int stride,
+             std::vector<T>* column) {
+  std::vector<T> permuted(column->size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    for (int j = 0; j < stride; ++j) {
+      permuted[i * stride + j] = (*column)[order[i] * stride + j];
+    }
+  }
+  column->swap(permuted);
+}
+
+template <class T>
+std::unordered_map<T, int> IndexIds(const std::vector<T>& ids) {
+  std::unordered_map<T, int> indexes;
+  indexes.reserve(ids.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    indexes.emplace(ids[i], i);
+  }
+  return indexes;
+}
+
+}  // namespace
+
+namespace map {
+FlatTracksManager::FlatTracksManager(const TracksManager& manager) {
+  shot_ids_.reserve(manager.tracks_per_shot_.size());
+  size_t num_observations = 0;
+  for (const auto& shot : manager.tracks_per_shot_) {
+    shot_ids_.push_back(shot.first);
+    num_observations += shot.second.size();
+  }
+  track_ids_.reserve(manager.shots_per_track_.size());
+  for (const auto& track : manager.shots_per_track_) {
+    track_ids_.push_back(track.first);
+  }
+  std::sort(shot_ids_.begin(), shot_ids_.end());
+  std::sort(track_ids_.begin(), track_ids_.end());
+  track_indexes_ = IndexIds(track_ids_);
+
+  observation_shots_.Mutable().reserve(num_observations);
+  observation_tracks_.Mutable().reserve(num_observations);
+  xs_.Mutable().reserve(num_observations);
+  ys_.Mutable().reserve(num_observations);
+  scales_.Mutable().reserve(num_observations);
+  feature_ids_.Mutable().reserve(num_observations);
+  segmentation_ids_.Mutable().reserve(num_observations);
+  instance_ids_.Mutable().reserve(num_observations);
+  colors_.Mutable().reserve(3 * num_observations);
+
+  std::vector<std::pair<int, const Observation*>> shot_observations;
+  for (size_t i = 0; i < shot_ids_.size(); ++i) {
+    shot_observations.clear();
+    for (const auto& track_obs : manager.tracks_per_shot_.at(shot_ids_[i])) {
+      shot_observations.emplace_back(track_indexes_.at(track_obs.first),
+                                     &track_obs.second);
+    }
+    std::sort(shot_observations.begin(), shot_observations.end());
+    for (const auto& track_obs : shot_observations) {
+      PushObservation(i, track_obs.first, *track_obs.second);
+    }
+  }
+  Finalize();
+}
+
+void FlatTracksManager::PushObservation(int shot_index, int track_index,
+                                        const Observation& observation) {
+  if (observation.depth_prior) {
+    depth_priors_[observation_shots_.size()] = *observation.depth_prior;
+  }
+  observation_shots_.Mutable().push_back(shot_index);
+  observation_tracks_.Mutable().push_back(track_index);
+  xs_.Mutable().push_back(observation.point(0));
+  ys_.Mutable().push_back(observation.point(1));
+  scales_.Mutable().push_back(observation.scale);
+  feature_ids_.Mutable().push_back(observation.feature_id);
+  segmentation_ids_.Mutable().push_back(observation.segmentation_id);
+  instance_ids_.Mutable().push_back(observation.instance_id);
+  auto& colors = colors_.Mutable();
+  for (int i = 0; i < 3; ++i) {
+    colors.push_back(observation.color(i));
+  }
+}
+
+void FlatTracksManager::Finalize() {
+  const auto shot_remap = SortIds(&shot_ids_);
+  if (!shot_remap.empty()) {
+    for (auto& shot : observation_shots_.Mutable()) {
+      shot = shot_remap[shot];
+    }
+  }
+  const auto track_remap = SortIds(&track_ids_);
+  if (!track_remap.empty()) {
+    for (auto& track : observation_tracks_.Mutable()) {
+      track = track_remap[track];
+    }
+  }
+  shot_indexes_ = IndexIds(shot_ids_);
+  track_indexes_ = IndexIds(track_ids_);
+
+  const ObservationIndex num_observations = NumObservations();
+  shot_offsets_.assign(NumShots() + 1, 0);
+  for (const auto shot : observation_shots_) {
+    ++shot_offsets_[shot + 1];
+  }
+  std::partial_sum(shot_offsets_.begin(), shot_offsets_.end(),
+                   shot_offsets_.begin());
+
+  // Sort observations by shot then track, unless they already are
+  const auto is_before = [this](ObservationIndex a, ObservationIndex b) {
+    return std::make_pair(observation_shots_[a], observation_tracks_[a]) <
+           std::make_pair(observation_shots_[b], observation_tracks_[b]);
+  };
+  bool is_sorted = true;
+  for (ObservationIndex i = 1; i < num_observations && is_sorted; ++i) {
+    is_sorted = !is_before(i, i - 1);
+  }
+  if (!is_sorted) {
+    std::vector<ObservationIndex> order(num_observations);
+    auto next = shot_offsets_;
+    for (ObservationIndex i = 0; i < num_observations; ++i) {
+      order[next[observation_shots_[i]]++] = i;
+    }
+    for (int i = 0; i < NumShots(); ++i) {
+      std::sort(order.begin() + shot_offsets_[i],
+                order.begin() + shot_offsets_[i + 1], is_before);
+    }
+
+    if (!depth_priors_.empty()) {
+      std::vector<ObservationIndex> inverse(num_observations);
+      for (ObservationIndex i = 0; i < num_observations; ++i) {
+        inverse[order[i]] = i;
+      }
+      std::unordered_map<ObservationIndex, Depth> depth_priors;
+      for (const auto& depth : depth_priors_) {
+        depth_priors[inverse[depth.first]] = depth.second;
+      }
+      depth_priors_.swap(depth_priors);
+    }
+    Permute(order, 1, &observation_shots_.Mutable());
+    Permute(order, 1, &observation_tracks_.Mutable());
+    Permute(order, 1, &xs_.Mutable());
+    Permute(order, 1, &ys_.Mutable());
+    Permute(order, 1, &scales_.Mutable());
+    Permute(order, 1, &feature_ids_.Mutable());
+    Permute(order, 1, &segmentation_ids_.Mutable());
+    Permute(order, 1, &instance_ids_.Mutable());
+    Permute(order, 3, &colors_.Mutable());
+  }
+
+  // Observations are sorted by shot, so are they within each track
+  track_offsets_.assign(NumTracks() + 1, 0);
+  for (const auto track : observation_tracks_) {
+    ++track_offsets_[track + 1];
+  }
+  std::partial_sum(track_offsets_.begin(), track_offsets_.end(),
+                   track_offsets_.begin());
+  track_observations_.resize(num_observations);
+  auto next = track_offsets_;
+  for (ObservationIndex i = 0; i < num_observations; ++i) {
+    track_observations_[next[observation_tracks_[i]]++] = i;
+  }
+}
+
+TracksManager FlatTracksManager::ToTracksManager() const {
+  TracksManager manager;
+  manager.tracks_per_shot_.reserve(NumShots());
+  for (int i = 0; i < NumShots(); ++i) {
+    const auto range = GetShotObservationRange(i);
+    auto& observations = manager.tracks_per_shot_[shot_ids_[i]];
+    observations.reserve(range.second - range.first);
+    for (auto j = range.first; j < range.second; ++j) {
+      observations.emplace(track_ids_[observation_tracks_[j]],
+                           GetObservation(j));
+    }
+  }
+  manager.shots_per_track_.reserve(NumTracks());
+  for (int i = 0; i < NumTracks(); ++i) {
+    const auto range = GetTrackObservationRange(i);
+    auto& observations = manager.shots_per_track_[track_ids_[i]];
+    observations.reserve(range.second - range.first);
+    for (auto j = range.first; j < range.second; ++j) {
+      const auto index = track_observations_[j];
+      observations.emplace(shot_ids_[observation_shots_[index]],
+                           GetObservation(index));
+    }
+  }
+  return manager;
+}
+
+int FlatTracksManager::GetShotIndex(const ShotId& shot) const {
+  const auto find_shot = shot_indexes_.find(shot);
+  return find_shot == shot_indexes_.end() ? -1 : find_shot->second;
+}
+
+int FlatTracksManager::GetTrackIndex(const TrackId& track) const {
+  const auto find_track = track_indexes_.find(track);
+  return find_track == track_indexes_.end() ? -1 : find_track->second;
+}
+
+Observation FlatTracksManager::GetObservation(ObservationIndex index) const {
+  Observation observation(xs_[index], ys_[index], scales_[index],
+                          colors_[3 * index], colors_[3 * index + 1],
+                          colors_[3 * index + 2], feature_ids_[index],
+                          segmentation_ids_[index], instance_ids_[index]);
+  if (!depth_priors_.empty()) {
+    const auto find_depth = depth_priors_.find(index);
+    if (find_depth != depth_priors_.end()) {
+      observation.depth_prior = find_depth->second;
+    }
+  }
+  return observation;
+}
+
+bool FlatTracksManager::HasShotObservations(const ShotId& shot) const {
+  return shot_indexes_.count(shot) > 0;
+}
+
+Observation FlatTracksManager::GetObservation(const ShotId& shot,
+                                              const TrackId& track) const {
+  const auto shot_index = GetShotIndex(shot);
+  if (shot_index < 0) {
+    throw std::runtime_error("Accessing invalid shot ID");
+  }
+  const auto track_index = GetTrackIndex(track);
+  const auto range = GetShotObservationRange(shot_index);
+  const auto begin = observation_tracks_.begin() + range.first;
+  const auto end = observation_tracks_.begin() + range.second;
+  const auto find_track = std::lower_bound(begin, end, track_index);
+  if (track_index < 0 || find_track == end || *find_track != track_index) {
+    throw std::runtime_error("Accessing invalid track ID");
+  }
+  return GetObservation(find_track - observation_tracks_.begin());
+}
+
+std::unordered_map<TrackId, Observation>
+FlatTracksManager::GetShotObservations(const ShotId& shot) const {
+  const auto shot_index = GetShotIndex(shot);
+  if (shot_index < 0) {
+    throw std::runtime_error("Accessing invalid shot ID");
+  }
+  const auto range = GetShotObservationRange(shot_index);
+  std::unordered_map<TrackId, Observation> observations;
+  observations.reserve(range.second - range.first);
+  for (auto i = range.first; i < range.second; ++i) {
+    observations.emplace(track_ids_[observation_tracks_[i]],
+                         GetObservation(i));
+  }
+  return observations;
+}
+
+std::unordered_map<ShotId, Observation>
+FlatTracksManager::GetTrackObservations(const TrackId& track) const {
+  const auto track_index = GetTrackIndex(track);
+  if (track_index < 0) {
+    throw std::runtime_error("Accessing invalid track ID");
+  }
+  const auto range = GetTrackObservationRange(track_index);
+  std::unordered_map<ShotId, Observation> observations;
+  observations.reserve(range.second - range.first);
+  for (auto i = range.first; i < range.second; ++i) {
+    const auto index = track_observations_[i];
+    observations.emplace(shot_ids_[observation_shots_[index]],
+                         GetObservation(index));
+  }
+  return observations;
+}
+
+std::vector<TracksManager::KeyPointTuple>
+FlatTracksManager::GetAllCommonObservations(const ShotId& shot1,
+                                            const ShotId& shot2) const {
+  const auto shot_index1 = GetShotIndex(shot1);
+  const auto shot_index2 = GetShotIndex(shot2);
+  if (shot_index1 < 0 || shot_index2 < 0) {
+    throw std::runtime_error("Accessing invalid shot ID");
+  }
+
+  // Both ranges are sorted by track : merge them
+  std::vector<TracksManager::KeyPointTuple> tuples;
+  auto range1 = GetShotObservationRange(shot_index1);
+  auto range2 = GetShotObservationRange(shot_index2);
+  while (range1.first < range1.second && range2.first < range2.second) {
+    const auto track1 = observation_tracks_[range1.first];
+    const auto track2 = observation_tracks_[range2.first];
+    if (track1 < track2) {
+      ++range1.first;
+    } else if (track2 < track1) {
+      ++range2.first;
+    } else {
+      tuples.emplace_back(track_ids_[track1], GetObservation(range1.first),
+                          GetObservation(range2.first));
+      ++range1.first;
+      ++range2.first;
+    }
+  }
+  return tuples;
+}
+
+TracksManager FlatTracksManager::ConstructSubTracksManager(
+    const std::vector<TrackId>& tracks,
+    const std::vector<ShotId>& shots) const {
+  std::vector<bool> use_shot(NumShots(), false);
+  for (const auto& shot : shots) {
+    const auto shot_index = GetShotIndex(shot);
+    if (shot_index >= 0) {
+      use_shot[shot_index] = true;
+    }
+  }
+
+  TracksManager subset;
+  for (const auto& track : tracks) {
+    const auto track_index = GetTrackIndex(track);
+    if (track_index < 0) {
+      continue;
+    }
+    const auto range = GetTrackObservationRange(track_index);
+    for (auto i = range.first; i < range.second; ++i) {
+      const auto index = track_observations_[i];
+      const auto shot_index = observation_shots_[index];
+      if (use_shot[shot_index]) {
+        subset.AddObservation(shot_ids_[shot_index], track,
+                              GetObservation(index));
+      }
+    }
+  }
+  return subset;
+}
+
+std::unordered_map<TracksManager::ShotPair, int, HashPair>
+FlatTracksManager::GetAllPairsConnectivity(
+    const std::vector<ShotId>& shots,
+    const std::vector<TrackId>& tracks) const {
+  std::vector<bool> use_shot(NumShots(), shots.empty());
+  for (const auto& shot : shots) {
+    const auto shot_index = GetShotIndex(shot);
+    if (shot_index >= 0) {
+      use_shot[shot_index] = true;
+    }
+  }
+
+  std::vector<int> tracks_to_use;
+  if (tracks.empty()) {
+    tracks_to_use.resize(NumTracks());
+    std::iota(tracks_to_use.begin(), tracks_to_use.end(), 0);
+  } else {
+    for (const auto& track : tracks) {
+      const auto track_index = GetTrackIndex(track);
+      if (track_index >= 0) {
+        tracks_to_use.push_back(track_index);
+      }
+    }
+  }
+
+  // Shot indexes follow IDs ordering and tracks are sorted by shot, so
+  // pairs are always (smallest ID, largest ID). Each thread counts its own
+  // tracks pairs, then counts are merged.
+  const int64_t num_tracks = tracks_to_use.size();
+  foundation::PairCounter counter;
+#pragma omp parallel
+  {
+    foundation::PairCounter thread_counter;
+    std::vector<int> track_shots;
+#pragma omp for schedule(dynamic, 256) nowait
+    for (int64_t i = 0; i < num_tracks; ++i) {
+      track_shots.clear();
+      const auto range = GetTrackObservationRange(tracks_to_use[i]);
+      for (auto j = range.first; j < range.second; ++j) {
+        const auto shot_index = observation_shots_[track_observations_[j]];
+        if (use_shot[shot_index]) {
+          track_shots.push_back(shot_index);
+        }
+      }
+      for (size_t j = 0; j < track_shots.size(); ++j) {
+        for (size_t k = j + 1; k < track_shots.size(); ++k) {
+          thread_counter.Add(track_shots[j], track_shots[k]);
+        }
+      }
+    }
+#pragma omp critical
+    counter.Merge(thread_counter);
+  }
+
+  const auto& counts = counter.Counts();
+  std::unordered_map<TracksManager::ShotPair, int, HashPair> connectivity;
+  connectivity.reserve(counts.size());
+  for (const auto& count : counts) {
+    const auto pair = foundation::PairCounter::FromKey(count.first);
+    connectivity.emplace(
+        std::make_pair(shot_ids_[pair.first], shot_ids_[pair.second]),
+        count.second);
+  }
+  return connectivity;
+}
+
+void FlatTracksManager::WriteToStreamBinary(std::ostream& ostream) const {
+  binary::Columns columns;
+  columns.size = NumObservations();
+  columns.xs = xs_.data();
+  columns.ys = ys_.data();
+  columns.scales = scales_.data();
+  columns.shots = observation_shots_.data();
+  columns.tracks = observation_tracks_.data();
+  columns.features = feature_ids_.data();
+  columns.segmentations = segmentation_ids_.data();
+  columns.instances = instance_ids_.data();
+  columns.colors = colors_.data();
+  binary::Write(ostream, shot_ids_, track_ids_, columns);
+}
+
+FlatTracksManager FlatTracksManager::InstanciateFromBinary(
+    const char* data, size_t size, std::shared_ptr<const void> mapping) {
+  binary::Reader reader(data, size);
+  const auto header = reader.ReadHeader();
+
+  FlatTracksManager manager;
+  manager.shot_ids_ = reader.StringTable(header.num_shots);
+  manager.track_ids_ = reader.StringTable(header.num_tracks);
+
+  const size_t n = header.num_observations;
+  const bool in_place = mapping != nullptr;
+  reader.ReadColumn(n, in_place, &manager.xs_);
+  reader.ReadColumn(n, in_place, &manager.ys_);
+  reader.ReadColumn(n, in_place, &manager.scales_);
+  reader.ReadColumn(n, in_place, &manager.observation_shots_);
+  reader.ReadColumn(n, in_place, &manager.observation_tracks_);
+  reader.ReadColumn(n, in_place, &manager.feature_ids_);
+  reader.ReadColumn(n, in_place, &manager.segmentation_ids_);
+  reader.ReadColumn(n, in_place, &manager.instance_ids_);
+  reader.ReadColumn(3 * n, in_place, &manager.colors_);
+  manager.mapping_ = std::move(mapping);
+
+  for (size_t i = 0; i < n; ++i) {
+    const auto shot = manager.observation_shots_[i];
+    const auto track = manager.observation_tracks_[i];
+    if (shot < 0 || shot >= manager.NumShots() || track < 0 ||
+        track >= manager.NumTracks()) {
+      throw std::runtime_error("Invalid binary tracks manager observation");
+    }
+  }
+  manager.Finalize();
+  return manager;
+}
+
+FlatTracksManager FlatTracksManager::InstanciateFromFile(
+    const std::string& filename) {
+  if (IsBinaryFile(filename)) {
+    // The mapping lives as long as the columns pointing into it
+    const auto file = std::make_shared<const binary::MappedFile>(filename);
+    return InstanciateFromBinary(file->Data(), file->Size(), file);
+  }
+  return FlatTracksManager(TracksManager::InstanciateFromFile(filename));
+}
+
+FlatTracksManager FlatTracksManager::InstanciateFromString(
+    const std::string& str) {
+  if (IsBinaryString(str)) {
+    return InstanciateFromBinary(str.data(), str.size(), nullptr);
+  }
+  return FlatTracksManager(TracksManager::InstanciateFromString(str));
+}
+
+void FlatTracksManager::WriteToBinaryFile(const std::string& filename) const {
+  std::ofstream ostream(filename, std::ios::binary);
+  if (ostream.is_open()) {
+    WriteToStreamBinary(ostream);
+  } else {
+    throw std::runtime_error("Can't write tracks manager file");
+  }
+}
+
+std::string FlatTracksManager::AsBinaryString() const {
+  std::ostringstream sstream(std::ios::binary);
+  WriteToStreamBinary(sstream);
+  return sstream.str();
+}
+
+bool FlatTracksManager::IsBinaryFile(const std::string& filename) {
+  return binary::IsBinaryFile(filename);
+}
+
+bool FlatTracksManager::IsBinaryString(const std::string& str) {
+  return binary::HasMagic(str.data(), str.size());
+}
+}  // namespace map
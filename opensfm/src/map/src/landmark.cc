@@ -10,7 +10,26 @@ Landmark::Landmark(const LandmarkId& lm_id, const Vec3d& global_pos)
 
 void Landmark::SetReprojectionErrors(
     const std::map<ShotId, Eigen::VectorXd>& reproj_errors) {
-  reproj_errors_ = reproj_errors;
+  auto errors = std::make_shared<ReprojectionErrors>();
+  auto shot_ids = std::make_shared<std::vector<ShotId>>();
+  errors->offsets.push_back(0);
+  for (const auto& error : reproj_errors) {
+    errors->shots.push_back(shot_ids->size());
+    shot_ids->push_back(error.first);
+    errors->values.insert(errors->values.end(), error.second.data(),
+                          error.second.data() + error.second.size());
+    errors->offsets.push_back(errors->values.size());
+  }
+  errors->shot_ids = std::move(shot_ids);
+  SetReprojectionErrors(errors, 0, errors->EntriesCount());
+}
+
+void Landmark::SetReprojectionErrors(
+    std::shared_ptr<const ReprojectionErrors> errors, int begin, int end) {
+  reproj_errors_ = std::move(errors);
+  reproj_errors_begin_ = begin;
+  reproj_errors_end_ = end;
+  reproj_errors_removed_.clear();
 }
 
 void Landmark::RemoveObservation(Shot* shot) {
@@ -36,12 +55,22 @@ const std::map<Shot*, FeatureId, KeyCompare>& Landmark::GetObservations()
 }
 
 std::map<ShotId, Eigen::VectorXd> Landmark::GetReprojectionErrors() const {
-  return reproj_errors_;
+  std::map<ShotId, Eigen::VectorXd> reproj_errors;
+  ForEachReprojectionError(
+      [&reproj_errors](const ShotId& shot_id, const auto& residual) {
+        reproj_errors[shot_id] = residual;
+      });
+  return reproj_errors;
 }
 void Landmark::RemoveReprojectionError(const ShotId& shot_id) {
-  auto it = reproj_errors_.find(shot_id);
-  if (it != reproj_errors_.end()) {
-    reproj_errors_.erase(it);
+  for (int e = reproj_errors_begin_; e < reproj_errors_end_; ++e) {
+    if (reproj_errors_->EntryShotId(e) != shot_id) {
+      continue;
+    }
+    if (reproj_errors_removed_.empty()) {
+      reproj_errors_removed_.resize(reproj_errors_end_ - reproj_errors_begin_);
+    }
+    reproj_errors_removed_[e - reproj_errors_begin_] = true;
   }
 }
 
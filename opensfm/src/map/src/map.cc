@@ -5,6 +5,8 @@
 #include <map/rig.h>
 #include <map/shot.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <stdexcept>
@@ -17,6 +19,8 @@ void AssignShot(map::Shot& to, const map::Shot& from) {
   to.SetShotMeasurements(from.GetShotMeasurements());
   to.SetCovariance(from.GetCovariance());
 }
+
+std::atomic<size_t> structure_revisions_count{0};
 }  // namespace
 namespace map {
 
@@ -64,8 +68,11 @@ std::unique_ptr<Map> Map::DeepCopy(const Map& map, bool copy_observations) {
   return map_copy;
 }
 
+size_t Map::NewStructureRevision() { return ++structure_revisions_count; }
+
 void Map::AddObservation(Shot* const shot, Landmark* const lm,
                          const Observation& obs) {
+  structure_revision_ = NewStructureRevision();
   lm->AddObservation(shot, obs.feature_id);
   shot->CreateObservation(lm, obs);
 }
@@ -82,6 +89,7 @@ void Map::RemoveObservation(const ShotId& shot_id, const LandmarkId& lm_id) {
   auto& lm = GetLandmark(lm_id);
   shot.RemoveLandmarkObservation(lm.GetObservationIdInShot(&shot));
   lm.RemoveObservation(&shot);
+  structure_revision_ = NewStructureRevision();
 }
 
 const Shot& Map::GetShot(const ShotId& shot_id) const {
@@ -141,9 +149,11 @@ void Map::ClearObservationsAndLandmarks() {
   }
   // then clear the landmarks_
   landmarks_.clear();
+  structure_revision_ = NewStructureRevision();
 }
 
 void Map::CleanLandmarksBelowMinObservations(const size_t min_observations) {
+  structure_revision_ = NewStructureRevision();
   for (auto it = landmarks_.begin(); it != landmarks_.end();) {
     const auto& landmark = it->second;
     if (landmark.NumberOfObservations() < min_observations) {
@@ -187,6 +197,7 @@ Shot& Map::CreateShot(const ShotId& shot_id, const CameraId& camera_id,
         shots_.emplace(std::piecewise_construct, std::forward_as_tuple(shot_id),
                        std::forward_as_tuple(shot_id, &camera, &rig_instance,
                                              &rig_camera, pose));
+    structure_revision_ = NewStructureRevision();
     return it.first->second;
   } else {
     throw std::runtime_error("Shot " + shot_id + " already exists.");
@@ -204,6 +215,7 @@ Shot& Map::CreateShot(const ShotId& shot_id, const CameraId& camera_id,
     auto it = shots_.emplace(
         std::piecewise_construct, std::forward_as_tuple(shot_id),
         std::forward_as_tuple(shot_id, &camera, &rig_instance, &rig_camera));
+    structure_revision_ = NewStructureRevision();
     return it.first->second;
   } else {
     throw std::runtime_error("Shot " + shot_id + " already exists.");
@@ -223,6 +235,7 @@ void Map::RemoveShot(const ShotId& shot_id) {
     }
     // 3) Remove from shots
     shots_.erase(shot_it);
+    structure_revision_ = NewStructureRevision();
   } else {
     throw std::runtime_error("Accessing invalid ShotID " + shot_id);
   }
@@ -284,6 +297,7 @@ Landmark& Map::CreateLandmark(const LandmarkId& lm_id,
     auto it = landmarks_.emplace(std::piecewise_construct,
                                  std::forward_as_tuple(lm_id),
                                  std::forward_as_tuple(lm_id, global_pos));
+    structure_revision_ = NewStructureRevision();
     return it.first->second;
   } else {
     throw std::runtime_error("Landmark " + lm_id + " already exists.");
@@ -314,6 +328,7 @@ void Map::RemoveLandmark(const LandmarkId& lm_id) {
 
     // 3) Remove from landmarks
     landmarks_.erase(lm_it);
+    structure_revision_ = NewStructureRevision();
   } else {
     throw std::runtime_error("Accessing invalid LandmarkId " + lm_id);
   }
@@ -547,6 +562,49 @@ Map::ComputeReprojectionErrors(const TracksManager& tracks_manager,
   return errors;
 }
 
+std::tuple<std::vector<LandmarkId>, std::vector<ShotId>, MatXd>
+Map::GetLandmarksReprojectionErrors(
+    const std::vector<LandmarkId>& landmark_ids) const {
+  std::vector<const Landmark*> landmarks;
+  if (landmark_ids.empty()) {
+    landmarks.reserve(landmarks_.size());
+    for (const auto& landmark : landmarks_) {
+      landmarks.push_back(&landmark.second);
+    }
+  } else {
+    landmarks.reserve(landmark_ids.size());
+    for (const auto& landmark_id : landmark_ids) {
+      landmarks.push_back(&GetLandmark(landmark_id));
+    }
+  }
+
+  int count = 0;
+  int size = 0;
+  for (const auto* landmark : landmarks) {
+    landmark->ForEachReprojectionError(
+        [&count, &size](const ShotId&, const auto& residual) {
+          ++count;
+          size = std::max<int>(size, residual.size());
+        });
+  }
+
+  std::vector<LandmarkId> errors_landmarks;
+  std::vector<ShotId> errors_shots;
+  errors_landmarks.reserve(count);
+  errors_shots.reserve(count);
+  MatXd residuals = MatXd::Zero(count, size);
+  for (const auto* landmark : landmarks) {
+    landmark->ForEachReprojectionError(
+        [&](const ShotId& shot_id, const auto& residual) {
+          residuals.row(errors_shots.size()).head(residual.size()) = residual;
+          errors_landmarks.push_back(landmark->id_);
+          errors_shots.push_back(shot_id);
+        });
+  }
+  return std::make_tuple(std::move(errors_landmarks), std::move(errors_shots),
+                         std::move(residuals));
+}
+
 std::unordered_map<ShotId, std::unordered_map<LandmarkId, Observation> >
 Map::GetValidObservations(const TracksManager& tracks_manager) const {
   std::unordered_map<ShotId, std::unordered_map<LandmarkId, Observation> >
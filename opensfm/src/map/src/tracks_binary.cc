@@ -0,0 +1,155 @@
+#include <map/tracks_binary.h>
+#include <map/tracks_manager.h>
+
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void WriteBytes(std::ostream& ostream, const void* data, size_t size) {
+  static const char zeros[map::binary::kAlignment] = {0};
+  ostream.write(static_cast<const char*>(data), size);
+  ostream.write(zeros, map::binary::PaddedSize(size) - size);
+}
+
+template <class T>
+void WriteColumn(std::ostream& ostream, const T* data, size_t size) {
+  WriteBytes(ostream, data, size * sizeof(T));
+}
+
+void WriteStringTable(std::ostream& ostream,
+                      const std::vector<std::string>& strings) {
+  std::vector<uint64_t> offsets;
+  offsets.reserve(strings.size() + 1);
+  offsets.push_back(0);
+  std::string characters;
+  for (const auto& string : strings) {
+    offsets.push_back(offsets.back() + string.size());
+    characters += string;
+  }
+  WriteColumn(ostream, offsets.data(), offsets.size());
+  WriteBytes(ostream, characters.data(), characters.size());
+}
+
+}  // namespace
+
+namespace map {
+namespace binary {
+
+bool HasMagic(const char* data, size_t size) {
+  const auto& magic = TracksManager::TRACKS_BINARY_HEADER;
+  return size >= kMagicSize && std::memcmp(data, magic.data(), kMagicSize) == 0;
+}
+
+bool IsBinaryFile(const std::string& filename) {
+  std::ifstream istream(filename, std::ios::binary);
+  if (!istream.is_open()) {
+    throw std::runtime_error("Can't read tracks manager file");
+  }
+  char magic[kMagicSize];
+  istream.read(magic, kMagicSize);
+  return HasMagic(magic, istream.gcount());
+}
+
+void Write(std::ostream& ostream, const std::vector<ShotId>& shot_ids,
+           const std::vector<TrackId>& track_ids, const Columns& columns) {
+  Header header;
+  std::memcpy(header.magic, TracksManager::TRACKS_BINARY_HEADER.data(),
+              kMagicSize);
+  header.version = TracksManager::TRACKS_BINARY_VERSION;
+  header.reserved = 0;
+  header.num_shots = shot_ids.size();
+  header.num_tracks = track_ids.size();
+  header.num_observations = columns.size;
+  WriteBytes(ostream, &header, sizeof(header));
+
+  const size_t n = columns.size;
+  WriteStringTable(ostream, shot_ids);
+  WriteStringTable(ostream, track_ids);
+  WriteColumn(ostream, columns.xs, n);
+  WriteColumn(ostream, columns.ys, n);
+  WriteColumn(ostream, columns.scales, n);
+  WriteColumn(ostream, columns.shots, n);
+  WriteColumn(ostream, columns.tracks, n);
+  WriteColumn(ostream, columns.features, n);
+  WriteColumn(ostream, columns.segmentations, n);
+  WriteColumn(ostream, columns.instances, n);
+  WriteColumn(ostream, columns.colors, 3 * n);
+}
+
+Header Reader::ReadHeader() {
+  const auto header = Value<Header>(Column<Header>(1), 0);
+  if (header.version >
+      static_cast<uint32_t>(TracksManager::TRACKS_BINARY_VERSION)) {
+    throw std::runtime_error("Unknown tracks manager binary version");
+  }
+  return header;
+}
+
+std::vector<std::string> Reader::StringTable(size_t count) {
+  const char* offsets = Column<uint64_t>(count + 1);
+  const auto total_size = Value<uint64_t>(offsets, count);
+  const char* characters = Column<char>(total_size);
+
+  std::vector<std::string> strings(count);
+  for (size_t i = 0; i < count; ++i) {
+    const auto begin = Value<uint64_t>(offsets, i);
+    const auto end = Value<uint64_t>(offsets, i + 1);
+    if (begin > end || end > total_size) {
+      throw std::runtime_error("Invalid binary tracks manager string table");
+    }
+    strings[i].assign(characters + begin, end - begin);
+  }
+  return strings;
+}
+
+MappedFile::MappedFile(const std::string& filename) {
+#ifdef _WIN32
+  std::ifstream istream(filename, std::ios::binary);
+  if (!istream.is_open()) {
+    throw std::runtime_error("Can't read tracks manager file");
+  }
+  buffer_.assign(std::istreambuf_iterator<char>(istream),
+                 std::istreambuf_iterator<char>());
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#else
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Can't read tracks manager file");
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    throw std::runtime_error("Can't read tracks manager file");
+  }
+  size_ = file_stat.st_size;
+  if (size_ > 0) {
+    void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Can't map tracks manager file");
+    }
+    data_ = static_cast<const char*>(mapped);
+  }
+  close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (size_ > 0) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+}
+
+}  // namespace binary
+}  // namespace map
@@ -1,8 +1,14 @@
+#include <foundation/pair_counter.h>
 #include <foundation/union_find.h>
+#include <map/tracks_binary.h>
 #include <map/tracks_manager.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
 #include <optional>
 #include <sstream>
+#include <tuple>
 #include <unordered_set>
 
 namespace {
@@ -179,6 +185,54 @@ map::TracksManager InstanciateFromStreamT(S& fstream) {
   }
 }
 
+// Write observations sorted by shot, IDs in lexicographic order
+void WriteToStreamBinary(std::ostream& ostream,
+                         const map::TracksManager& manager) {
+  auto shot_ids = manager.GetShotIds();
+  auto track_ids = manager.GetTrackIds();
+  std::sort(shot_ids.begin(), shot_ids.end());
+  std::sort(track_ids.begin(), track_ids.end());
+
+  std::unordered_map<map::TrackId, int32_t> track_indexes;
+  track_indexes.reserve(track_ids.size());
+  for (size_t i = 0; i < track_ids.size(); ++i) {
+    track_indexes[track_ids[i]] = i;
+  }
+
+  std::vector<double> xs, ys, scales;
+  std::vector<int32_t> shots, tracks, features, segmentations, instances;
+  std::vector<uint8_t> colors;
+  for (size_t i = 0; i < shot_ids.size(); ++i) {
+    for (const auto& track_obs : manager.GetShotObservations(shot_ids[i])) {
+      const auto& obs = track_obs.second;
+      xs.push_back(obs.point(0));
+      ys.push_back(obs.point(1));
+      scales.push_back(obs.scale);
+      shots.push_back(i);
+      tracks.push_back(track_indexes.at(track_obs.first));
+      features.push_back(obs.feature_id);
+      segmentations.push_back(obs.segmentation_id);
+      instances.push_back(obs.instance_id);
+      for (int j = 0; j < 3; ++j) {
+        colors.push_back(obs.color(j));
+      }
+    }
+  }
+
+  map::binary::Columns columns;
+  columns.size = xs.size();
+  columns.xs = xs.data();
+  columns.ys = ys.data();
+  columns.scales = scales.data();
+  columns.shots = shots.data();
+  columns.tracks = tracks.data();
+  columns.features = features.data();
+  columns.segmentations = segmentations.data();
+  columns.instances = instances.data();
+  columns.colors = colors.data();
+  map::binary::Write(ostream, shot_ids, track_ids, columns);
+}
+
 }  // namespace
 
 namespace map {
@@ -309,117 +363,469 @@ std::unordered_map<TracksManager::ShotPair, int, HashPair>
 TracksManager::GetAllPairsConnectivity(
     const std::vector<ShotId>& shots,
     const std::vector<TrackId>& tracks) const {
-  std::unordered_map<ShotPair, int, HashPair> common_per_pair;
+  // Index shots in IDs order, so pairs of indexes are ordered as pairs of IDs
+  std::vector<ShotId> shots_to_use = shots.empty() ? GetShotIds() : shots;
+  std::sort(shots_to_use.begin(), shots_to_use.end());
+  shots_to_use.erase(std::unique(shots_to_use.begin(), shots_to_use.end()),
+                     shots_to_use.end());
+  std::unordered_map<ShotId, int> shot_indexes;
+  shot_indexes.reserve(shots_to_use.size());
+  for (size_t i = 0; i < shots_to_use.size(); ++i) {
+    shot_indexes.emplace(shots_to_use[i], i);
+  }
 
-  std::vector<TrackId> tracks_to_use;
+  std::vector<const std::unordered_map<ShotId, Observation>*> tracks_to_use;
   if (tracks.empty()) {
+    tracks_to_use.reserve(shots_per_track_.size());
     for (const auto& track : shots_per_track_) {
-      tracks_to_use.push_back(track.first);
+      tracks_to_use.push_back(&track.second);
     }
   } else {
-    tracks_to_use = tracks;
+    for (const auto& track_id : tracks) {
+      const auto find_track = shots_per_track_.find(track_id);
+      if (find_track != shots_per_track_.end()) {
+        tracks_to_use.push_back(&find_track->second);
+      }
+    }
   }
 
-  std::unordered_set<ShotId> shots_to_use;
-  if (shots.empty()) {
-    for (const auto& shot : tracks_per_shot_) {
-      shots_to_use.insert(shot.first);
+  // Each thread counts its own tracks pairs, then counts are merged
+  const int64_t num_tracks = tracks_to_use.size();
+  foundation::PairCounter counter;
+#pragma omp parallel
+  {
+    foundation::PairCounter thread_counter;
+    std::vector<int> track_shots;
+#pragma omp for schedule(dynamic, 256) nowait
+    for (int64_t i = 0; i < num_tracks; ++i) {
+      track_shots.clear();
+      for (const auto& shot_obs : *tracks_to_use[i]) {
+        const auto find_shot = shot_indexes.find(shot_obs.first);
+        if (find_shot != shot_indexes.end()) {
+          track_shots.push_back(find_shot->second);
+        }
+      }
+      std::sort(track_shots.begin(), track_shots.end());
+      for (size_t j = 0; j < track_shots.size(); ++j) {
+        for (size_t k = j + 1; k < track_shots.size(); ++k) {
+          thread_counter.Add(track_shots[j], track_shots[k]);
+        }
+      }
     }
-  } else {
-    for (const auto& shot : shots) {
-      shots_to_use.insert(shot);
+#pragma omp critical
+    counter.Merge(thread_counter);
+  }
+
+  const auto& counts = counter.Counts();
+  std::unordered_map<ShotPair, int, HashPair> common_per_pair;
+  common_per_pair.reserve(counts.size());
+  for (const auto& count : counts) {
+    const auto pair = foundation::PairCounter::FromKey(count.first);
+    common_per_pair.emplace(
+        std::make_pair(shots_to_use[pair.first], shots_to_use[pair.second]),
+        count.second);
+  }
+  return common_per_pair;
+}
+
+// Tracks of the managers to merge, and how they cluster into merged tracks
+struct TracksManager::MergeClusters {
+  using TrackObservations = std::unordered_map<ShotId, Observation>;
+  using ShotObservations = std::unordered_map<TrackId, Observation>;
+
+  // Tracks of all managers, and each manager's track IDs to indexes in it
+  std::vector<const TrackObservations*> tracks;
+  std::vector<std::unordered_map<TrackId, int>> track_indexes;
+
+  // Shots of all managers, along with their observations in each manager
+  std::vector<const ShotId*> shot_ids;
+  std::vector<std::vector<std::pair<int, const ShotObservations*>>>
+      shot_sources;
+
+  // Tracks of merged track i are cluster_tracks[cluster_offsets[i] ..
+  // cluster_offsets[i + 1][, and track_clusters is the inverse mapping
+  std::vector<int> cluster_offsets;
+  std::vector<int> cluster_tracks;
+  std::vector<int> track_clusters;
+
+  int NumClusters() const { return cluster_offsets.size() - 1; }
+  int NumShots() const { return shot_ids.size(); }
+};
+
+TracksManager::MergeClusters TracksManager::ClusterTracks(
+    const std::vector<const TracksManager*>& tracks_managers) {
+  MergeClusters clusters;
+  auto& tracks = clusters.tracks;
+  auto& track_indexes = clusters.track_indexes;
+
+  // Number tracks of all managers one after the other, each manager's ones
+  // in IDs order. Observations are read in place from the managers.
+  track_indexes.resize(tracks_managers.size());
+  using TrackObservations = MergeClusters::TrackObservations;
+  std::vector<std::pair<const TrackId*, const TrackObservations*>>
+      manager_tracks;
+  for (size_t i = 0; i < tracks_managers.size(); ++i) {
+    manager_tracks.clear();
+    for (const auto& track : tracks_managers[i]->shots_per_track_) {
+      manager_tracks.emplace_back(&track.first, &track.second);
+    }
+    std::sort(manager_tracks.begin(), manager_tracks.end(),
+              [](const auto& a, const auto& b) { return *a.first < *b.first; });
+    track_indexes[i].reserve(manager_tracks.size());
+    for (const auto& track : manager_tracks) {
+      track_indexes[i].emplace(*track.first, tracks.size());
+      tracks.push_back(track.second);
     }
   }
 
-  for (const auto& track_id : tracks_to_use) {
-    const auto find_track = shots_per_track_.find(track_id);
-    if (find_track == shots_per_track_.end()) {
-      continue;
+  // Intern shots, along with their observations in each manager
+  std::unordered_map<ShotId, int> shot_indexes;
+  for (size_t i = 0; i < tracks_managers.size(); ++i) {
+    for (const auto& shot : tracks_managers[i]->tracks_per_shot_) {
+      const auto inserted =
+          shot_indexes.emplace(shot.first, clusters.shot_ids.size());
+      if (inserted.second) {
+        clusters.shot_ids.push_back(&shot.first);
+        clusters.shot_sources.emplace_back();
+      }
+      clusters.shot_sources[inserted.first->second].emplace_back(
+          i, &shot.second);
     }
-    const auto& track = find_track->second;
-    for (const auto& it1 : track) {
-      const auto& shot_id1 = it1.first;
-      if (shots_to_use.find(shot_id1) != shots_to_use.end()) {
-        for (const auto& it2 : track) {
-          const auto& shot_id2 = it2.first;
-          if (shot_id1 < shot_id2 &&
-              shots_to_use.find(shot_id2) != shots_to_use.end()) {
-            ++common_per_pair[std::make_pair(shot_id1, shot_id2)];
-          }
+  }
+  const int num_shots = clusters.NumShots();
+
+  // Tracks sharing a (shot, feature ID) are linked : each thread sorts the
+  // observations of its shots by feature ID and emits the links
+  std::vector<std::pair<int, int>> links;
+#pragma omp parallel
+  {
+    std::vector<std::pair<int, int>> thread_links;
+    std::vector<std::pair<int, int>> features;
+#pragma omp for schedule(dynamic) nowait
+    for (int i = 0; i < num_shots; ++i) {
+      features.clear();
+      for (const auto& source : clusters.shot_sources[i]) {
+        const auto& indexes = track_indexes[source.first];
+        for (const auto& track_obs : *source.second) {
+          features.emplace_back(track_obs.second.feature_id,
+                                indexes.at(track_obs.first));
+        }
+      }
+      std::sort(features.begin(), features.end());
+      for (size_t j = 1; j < features.size(); ++j) {
+        if (features[j].first == features[j - 1].first) {
+          thread_links.emplace_back(features[j - 1].second,
+                                    features[j].second);
         }
       }
     }
+#pragma omp critical
+    links.insert(links.end(), thread_links.begin(), thread_links.end());
   }
-  return common_per_pair;
+
+  // Merged tracks are numbered in the order of their first track
+  FlatUnionFind union_find(tracks.size());
+  for (const auto& link : links) {
+    union_find.Union(link.first, link.second);
+  }
+  union_find.GetClusters(&clusters.cluster_offsets, &clusters.cluster_tracks);
+  clusters.track_clusters.resize(tracks.size());
+  for (int i = 0; i < clusters.NumClusters(); ++i) {
+    for (int j = clusters.cluster_offsets[i];
+         j < clusters.cluster_offsets[i + 1]; ++j) {
+      clusters.track_clusters[clusters.cluster_tracks[j]] = i;
+    }
+  }
+  return clusters;
 }
 
 TracksManager TracksManager::MergeTracksManager(
     const std::vector<const TracksManager*>& tracks_managers) {
-  // Some typedefs claryfying the aggregations
-  using FeatureId_2 = std::pair<ShotId, int>;
-  using SingleTrackId = std::pair<TrackId, int>;
-
-  // Union-find main data
-  std::vector<std::unique_ptr<UnionFindElement<SingleTrackId>>>
-      union_find_elements;
-
-  // Aggregate tracks be merged using (shot_id, feature_id)
-  std::unordered_map<FeatureId_2, std::vector<int>, HashPair>
-      observations_per_feature_id;
-  for (int i = 0; i < tracks_managers.size(); ++i) {
-    const auto& manager = tracks_managers[i];
-    for (const auto& track_obses : manager->shots_per_track_) {
-      const auto element_id = union_find_elements.size();
-      for (const auto& shot_obs : track_obses.second) {
-        observations_per_feature_id[std::make_pair(shot_obs.first,
-                                                   shot_obs.second.feature_id)]
-            .push_back(element_id);
+  const auto clusters = ClusterTracks(tracks_managers);
+  const auto& tracks = clusters.tracks;
+  const auto& cluster_offsets = clusters.cluster_offsets;
+  const auto& cluster_tracks = clusters.cluster_tracks;
+  const int num_clusters = clusters.NumClusters();
+  const int num_shots = clusters.NumShots();
+
+  // Create all merged tracks and shots first, then fill them in parallel.
+  // When merged tracks disagree on a shot, the last one wins.
+  TracksManager merged;
+  std::vector<MergeClusters::TrackObservations*> merged_tracks(num_clusters,
+                                                               nullptr);
+  merged.shots_per_track_.reserve(num_clusters);
+  for (int i = 0; i < num_clusters; ++i) {
+    for (int j = cluster_offsets[i]; j < cluster_offsets[i + 1]; ++j) {
+      if (!tracks[cluster_tracks[j]]->empty()) {
+        merged_tracks[i] = &merged.shots_per_track_[std::to_string(i)];
+        break;
+      }
+    }
+  }
+  std::vector<MergeClusters::ShotObservations*> merged_shots(num_shots,
+                                                             nullptr);
+  merged.tracks_per_shot_.reserve(num_shots);
+  for (int i = 0; i < num_shots; ++i) {
+    for (const auto& source : clusters.shot_sources[i]) {
+      if (!source.second->empty()) {
+        merged_shots[i] = &merged.tracks_per_shot_[*clusters.shot_ids[i]];
+        break;
       }
-      union_find_elements.emplace_back(
-          std::unique_ptr<UnionFindElement<SingleTrackId>>(
-              new UnionFindElement<SingleTrackId>(
-                  std::make_pair(track_obses.first, i))));
     }
   }
 
-  TracksManager merged;
-  if (union_find_elements.empty()) {
-    return merged;
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int i = 0; i < num_clusters; ++i) {
+    if (!merged_tracks[i]) {
+      continue;
+    }
+    for (int j = cluster_offsets[i]; j < cluster_offsets[i + 1]; ++j) {
+      for (const auto& shot_obs : *tracks[cluster_tracks[j]]) {
+        (*merged_tracks[i])[shot_obs.first] = shot_obs.second;
+      }
+    }
   }
 
-  // Union-find any two tracks sharing a common FeatureId_2
-  // For N tracks, make 0 the parent of [1, ... N-1[
-  for (const auto& tracks_agg : observations_per_feature_id) {
-    if (tracks_agg.second.empty()) {
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int i = 0; i < num_shots; ++i) {
+    if (!merged_shots[i]) {
       continue;
     }
-    const auto e1 = union_find_elements[tracks_agg.second[0]].get();
-    for (int i = 1; i < tracks_agg.second.size(); ++i) {
-      const auto e2 = union_find_elements[tracks_agg.second[i]].get();
-      Union(e1, e2);
-    }
-  }
-
-  // Get clusters and construct new tracks
-  const auto clusters = GetUnionFindClusters(&union_find_elements);
-  for (int i = 0; i < clusters.size(); ++i) {
-    const auto& tracks_agg = clusters[i];
-    const auto merged_track_id = std::to_string(i);
-    // Run over tracks to merged into a new single track
-    for (const auto& manager_n_track_id : tracks_agg) {
-      const auto manager_id = manager_n_track_id->data.second;
-      const auto track_id = manager_n_track_id->data.first;
-      const auto track =
-          tracks_managers[manager_id]->shots_per_track_.at(track_id);
-      for (const auto& shot_obs : track) {
-        merged.AddObservation(shot_obs.first, merged_track_id, shot_obs.second);
+    const auto& shot_id = *clusters.shot_ids[i];
+    for (const auto& source : clusters.shot_sources[i]) {
+      const auto& indexes = clusters.track_indexes[source.first];
+      for (const auto& track_obs : *source.second) {
+        const auto cluster =
+            clusters.track_clusters[indexes.at(track_obs.first)];
+        merged_shots[i]->emplace(std::to_string(cluster),
+                                 merged_tracks[cluster]->at(shot_id));
       }
     }
   }
   return merged;
 }
 
+void TracksManager::MergeTracksManager(
+    const std::vector<const TracksManager*>& tracks_managers,
+    const std::string& filename) {
+  const auto clusters = ClusterTracks(tracks_managers);
+  const int num_shots = clusters.NumShots();
+
+  // Position of each track in its cluster : when merged tracks disagree on
+  // a shot, the last one wins, as when merging in memory
+  std::vector<int> track_positions(clusters.tracks.size());
+  for (size_t i = 0; i < clusters.cluster_tracks.size(); ++i) {
+    track_positions[clusters.cluster_tracks[i]] = i;
+  }
+
+  // Shots in IDs order, with one observation per merged track. Only shots
+  // and merged tracks having observations are kept.
+  std::vector<int> shot_order(num_shots);
+  std::iota(shot_order.begin(), shot_order.end(), 0);
+  std::sort(shot_order.begin(), shot_order.end(), [&clusters](int a, int b) {
+    return *clusters.shot_ids[a] < *clusters.shot_ids[b];
+  });
+  const auto position_cluster = [&clusters](int position) {
+    return clusters.track_clusters[clusters.cluster_tracks[position]];
+  };
+  std::vector<ShotId> shot_ids;
+  std::vector<std::tuple<int32_t, int32_t, const Observation*>> entries;
+  std::vector<std::pair<int, const Observation*>> shot_observations;
+  for (const int shot : shot_order) {
+    shot_observations.clear();
+    for (const auto& source : clusters.shot_sources[shot]) {
+      const auto& indexes = clusters.track_indexes[source.first];
+      for (const auto& track_obs : *source.second) {
+        shot_observations.emplace_back(
+            track_positions[indexes.at(track_obs.first)], &track_obs.second);
+      }
+    }
+    if (shot_observations.empty()) {
+      continue;
+    }
+    std::sort(shot_observations.begin(), shot_observations.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 0; i < shot_observations.size(); ++i) {
+      const auto cluster = position_cluster(shot_observations[i].first);
+      if (i + 1 < shot_observations.size() &&
+          position_cluster(shot_observations[i + 1].first) == cluster) {
+        continue;
+      }
+      entries.emplace_back(shot_ids.size(), cluster,
+                           shot_observations[i].second);
+    }
+    shot_ids.push_back(*clusters.shot_ids[shot]);
+  }
+
+  // Merged track IDs are the clusters numbers, tabled in IDs order
+  std::vector<int32_t> cluster_indexes(clusters.NumClusters(), -1);
+  for (const auto& entry : entries) {
+    cluster_indexes[std::get<1>(entry)] = 0;
+  }
+  std::vector<TrackId> track_ids;
+  for (int i = 0; i < clusters.NumClusters(); ++i) {
+    if (cluster_indexes[i] == 0) {
+      track_ids.push_back(std::to_string(i));
+    }
+  }
+  std::sort(track_ids.begin(), track_ids.end());
+  for (size_t i = 0; i < track_ids.size(); ++i) {
+    cluster_indexes[std::stoi(track_ids[i])] = i;
+  }
+  for (auto& entry : entries) {
+    std::get<1>(entry) = cluster_indexes[std::get<1>(entry)];
+  }
+  std::sort(entries.begin(), entries.end());
+
+  const size_t n = entries.size();
+  std::vector<double> xs(n), ys(n), scales(n);
+  std::vector<int32_t> shots(n), tracks(n), features(n), segmentations(n),
+      instances(n);
+  std::vector<uint8_t> colors(3 * n);
+  for (size_t i = 0; i < n; ++i) {
+    const auto& obs = *std::get<2>(entries[i]);
+    shots[i] = std::get<0>(entries[i]);
+    tracks[i] = std::get<1>(entries[i]);
+    xs[i] = obs.point(0);
+    ys[i] = obs.point(1);
+    scales[i] = obs.scale;
+    features[i] = obs.feature_id;
+    segmentations[i] = obs.segmentation_id;
+    instances[i] = obs.instance_id;
+    for (int j = 0; j < 3; ++j) {
+      colors[3 * i + j] = obs.color(j);
+    }
+  }
+
+  std::ofstream ostream(filename, std::ios::binary);
+  if (!ostream.is_open()) {
+    throw std::runtime_error("Can't write tracks manager file");
+  }
+  binary::Columns columns;
+  columns.size = n;
+  columns.xs = xs.data();
+  columns.ys = ys.data();
+  columns.scales = scales.data();
+  columns.shots = shots.data();
+  columns.tracks = tracks.data();
+  columns.features = features.data();
+  columns.segmentations = segmentations.data();
+  columns.instances = instances.data();
+  columns.colors = colors.data();
+  binary::Write(ostream, shot_ids, track_ids, columns);
+}
+
+TracksManager TracksManager::InstanciateFromBinary(const char* data,
+                                                    size_t size) {
+  binary::Reader reader(data, size);
+  const auto header = reader.ReadHeader();
+
+  const auto shot_ids = reader.StringTable(header.num_shots);
+  const auto track_ids = reader.StringTable(header.num_tracks);
+  const int64_t num_shots = shot_ids.size();
+  const int64_t num_tracks = track_ids.size();
+
+  const int64_t n = header.num_observations;
+  const char* xs = reader.Column<double>(n);
+  const char* ys = reader.Column<double>(n);
+  const char* scales = reader.Column<double>(n);
+  const char* shots = reader.Column<int32_t>(n);
+  const char* tracks = reader.Column<int32_t>(n);
+  const char* features = reader.Column<int32_t>(n);
+  const char* segmentations = reader.Column<int32_t>(n);
+  const char* instances = reader.Column<int32_t>(n);
+  const char* colors = reader.Column<uint8_t>(3 * n);
+
+  // Group observations by shot and by track with a (stable) counting sort,
+  // so each map is created once with its final number of buckets
+  std::vector<int64_t> shot_offsets(num_shots + 1, 0);
+  std::vector<int64_t> track_offsets(num_tracks + 1, 0);
+  for (int64_t i = 0; i < n; ++i) {
+    const auto shot = binary::Reader::Value<int32_t>(shots, i);
+    const auto track = binary::Reader::Value<int32_t>(tracks, i);
+    if (shot < 0 || shot >= num_shots || track < 0 || track >= num_tracks) {
+      throw std::runtime_error("Invalid binary tracks manager observation");
+    }
+    ++shot_offsets[shot + 1];
+    ++track_offsets[track + 1];
+  }
+  std::partial_sum(shot_offsets.begin(), shot_offsets.end(),
+                   shot_offsets.begin());
+  std::partial_sum(track_offsets.begin(), track_offsets.end(),
+                   track_offsets.begin());
+  std::vector<int64_t> shot_observations(n), track_observations(n);
+  {
+    std::vector<int64_t> shot_ends(shot_offsets.begin(), shot_offsets.end());
+    std::vector<int64_t> track_ends(track_offsets.begin(),
+                                    track_offsets.end());
+    for (int64_t i = 0; i < n; ++i) {
+      const auto shot = binary::Reader::Value<int32_t>(shots, i);
+      const auto track = binary::Reader::Value<int32_t>(tracks, i);
+      shot_observations[shot_ends[shot]++] = i;
+      track_observations[track_ends[track]++] = i;
+    }
+  }
+
+  TracksManager manager;
+  std::vector<std::unordered_map<TrackId, Observation>*> shot_maps(num_shots,
+                                                                  nullptr);
+  manager.tracks_per_shot_.reserve(num_shots);
+  for (int64_t i = 0; i < num_shots; ++i) {
+    const auto count = shot_offsets[i + 1] - shot_offsets[i];
+    if (count > 0) {
+      shot_maps[i] = &manager.tracks_per_shot_[shot_ids[i]];
+      shot_maps[i]->reserve(count);
+    }
+  }
+  std::vector<std::unordered_map<ShotId, Observation>*> track_maps(num_tracks,
+                                                                  nullptr);
+  manager.shots_per_track_.reserve(num_tracks);
+  for (int64_t i = 0; i < num_tracks; ++i) {
+    const auto count = track_offsets[i + 1] - track_offsets[i];
+    if (count > 0) {
+      track_maps[i] = &manager.shots_per_track_[track_ids[i]];
+      track_maps[i]->reserve(count);
+    }
+  }
+
+  const auto observation = [&](int64_t i) {
+    return Observation(binary::Reader::Value<double>(xs, i),
+                       binary::Reader::Value<double>(ys, i),
+                       binary::Reader::Value<double>(scales, i),
+                       binary::Reader::Value<uint8_t>(colors, 3 * i),
+                       binary::Reader::Value<uint8_t>(colors, 3 * i + 1),
+                       binary::Reader::Value<uint8_t>(colors, 3 * i + 2),
+                       binary::Reader::Value<int32_t>(features, i),
+                       binary::Reader::Value<int32_t>(segmentations, i),
+                       binary::Reader::Value<int32_t>(instances, i));
+  };
+
+  // Maps are now only filled, each by a single thread. When a (shot, track)
+  // pair is repeated, the last observation wins as with AddObservation.
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int64_t i = 0; i < num_shots; ++i) {
+    for (int64_t j = shot_offsets[i]; j < shot_offsets[i + 1]; ++j) {
+      const auto index = shot_observations[j];
+      const auto track = binary::Reader::Value<int32_t>(tracks, index);
+      (*shot_maps[i])[track_ids[track]] = observation(index);
+    }
+  }
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int64_t i = 0; i < num_tracks; ++i) {
+    for (int64_t j = track_offsets[i]; j < track_offsets[i + 1]; ++j) {
+      const auto index = track_observations[j];
+      const auto shot = binary::Reader::Value<int32_t>(shots, index);
+      (*track_maps[i])[shot_ids[shot]] = observation(index);
+    }
+  }
+  return manager;
+}
+
 TracksManager TracksManager::InstanciateFromFile(const std::string& filename) {
+  if (binary::IsBinaryFile(filename)) {
+    const binary::MappedFile file(filename);
+    return InstanciateFromBinary(file.Data(), file.Size());
+  }
   std::ifstream istream(filename);
   if (istream.is_open()) {
     return InstanciateFromStreamT(istream);
@@ -437,7 +843,19 @@ void TracksManager::WriteToFile(const std::string& filename) const {
   }
 }
 
+void TracksManager::WriteToBinaryFile(const std::string& filename) const {
+  std::ofstream ostream(filename, std::ios::binary);
+  if (ostream.is_open()) {
+    WriteToStreamBinary(ostream, *this);
+  } else {
+    throw std::runtime_error("Can't write tracks manager file");
+  }
+}
+
 TracksManager TracksManager::InstanciateFromString(const std::string& str) {
+  if (binary::HasMagic(str.data(), str.size())) {
+    return InstanciateFromBinary(str.data(), str.size());
+  }
   std::stringstream sstream(str);
   return InstanciateFromStreamT(sstream);
 }
@@ -448,6 +866,25 @@ std::string TracksManager::AsString() const {
   return sstream.str();
 }
 
+std::string TracksManager::AsBinaryString() const {
+  std::ostringstream sstream(std::ios::binary);
+  WriteToStreamBinary(sstream, *this);
+  return sstream.str();
+}
+
+void TracksManager::ConvertFile(const std::string& input_filename,
+                                const std::string& output_filename,
+                                bool binary) {
+  const auto manager = InstanciateFromFile(input_filename);
+  if (binary) {
+    manager.WriteToBinaryFile(output_filename);
+  } else {
+    manager.WriteToFile(output_filename);
+  }
+}
+
 std::string TracksManager::TRACKS_HEADER = "OPENSFM_TRACKS_VERSION";
 int TracksManager::TRACKS_VERSION = 2;
+std::string TracksManager::TRACKS_BINARY_HEADER = "OSFMTRKB";
+int TracksManager::TRACKS_BINARY_VERSION = 1;
 }  // namespace map
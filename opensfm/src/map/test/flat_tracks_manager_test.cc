@@ -0,0 +1,141 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <map/flat_tracks_manager.h>
+
+namespace {
+
+class TempFile {
+ public:
+  TempFile() {
+    char tmpname[L_tmpnam];
+    tmpnam(tmpname);
+    filename = std::string(tmpname);
+  }
+
+  ~TempFile() { remove(filename.c_str()); }
+
+  std::string Name() const { return filename; }
+
+ private:
+  std::string filename;
+};
+
+class FlatTracksManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    manager.AddObservation("1", "1", o1);
+    manager.AddObservation("2", "1", o2);
+    manager.AddObservation("3", "1", o3);
+    manager.AddObservation("2", "2", o4);
+    manager.AddObservation("3", "2", o5);
+    manager.AddObservation("10", "2", o6);
+    flat = map::FlatTracksManager(manager);
+  }
+
+  const map::Observation o1{1.0, 1.0, 1.0, 1, 1, 1, 1, 1, 1};
+  const map::Observation o2{2.0, 2.0, 2.0, 2, 2, 2, 2, 2, 2};
+  const map::Observation o3{3.0, 3.0, 3.0, 3, 3, 3, 3};
+  const map::Observation o4{4.0, 4.0, 4.0, 4, 4, 4, 4};
+  const map::Observation o5{5.0, 5.0, 5.0, 5, 5, 5, 5};
+  const map::Observation o6{6.0, 6.0, 6.0, 6, 6, 6, 6};
+  map::TracksManager manager;
+  map::FlatTracksManager flat;
+};
+
+TEST_F(FlatTracksManagerTest, InternsIdsInOrder) {
+  EXPECT_THAT(flat.GetShotIds(), ::testing::ElementsAre("1", "10", "2", "3"));
+  EXPECT_THAT(flat.GetTrackIds(), ::testing::ElementsAre("1", "2"));
+  EXPECT_EQ(flat.NumObservations(), 6);
+  EXPECT_EQ(flat.GetShotIndex("2"), 2);
+  EXPECT_EQ(flat.GetShotIndex("4"), -1);
+}
+
+TEST_F(FlatTracksManagerTest, IndexesObservationsByShotAndTrack) {
+  const auto shot_range = flat.GetShotObservationRange(flat.GetShotIndex("2"));
+  EXPECT_EQ(shot_range.second - shot_range.first, 2);
+  EXPECT_EQ(flat.GetObservation(shot_range.first), o2);
+
+  const auto track_range =
+      flat.GetTrackObservationRange(flat.GetTrackIndex("2"));
+  std::vector<map::ShotId> shots;
+  for (auto i = track_range.first; i < track_range.second; ++i) {
+    const auto index = flat.GetTrackObservationIndex(i);
+    shots.push_back(flat.GetShotId(flat.GetObservationShot(index)));
+  }
+  EXPECT_THAT(shots, ::testing::ElementsAre("10", "2", "3"));
+}
+
+TEST_F(FlatTracksManagerTest, MatchesTracksManagerStringAPI) {
+  EXPECT_EQ(flat.GetObservation("3", "2"), o5);
+  EXPECT_THROW(flat.GetObservation("1", "2"), std::runtime_error);
+  for (const auto& shot : manager.GetShotIds()) {
+    EXPECT_EQ(flat.GetShotObservations(shot),
+              manager.GetShotObservations(shot));
+  }
+  for (const auto& track : manager.GetTrackIds()) {
+    EXPECT_EQ(flat.GetTrackObservations(track),
+              manager.GetTrackObservations(track));
+  }
+  EXPECT_THAT(flat.GetAllCommonObservations("2", "3"),
+              ::testing::UnorderedElementsAreArray(
+                  manager.GetAllCommonObservations("2", "3")));
+  EXPECT_EQ(flat.GetAllPairsConnectivity({}, {}),
+            manager.GetAllPairsConnectivity({}, {}));
+  EXPECT_EQ(flat.GetAllPairsConnectivity({"2", "3", "10"}, {"2"}),
+            manager.GetAllPairsConnectivity({"2", "3", "10"}, {"2"}));
+}
+
+TEST_F(FlatTracksManagerTest, ConvertsBackToTracksManager) {
+  const auto converted = flat.ToTracksManager();
+  EXPECT_THAT(converted.GetShotIds(),
+              ::testing::UnorderedElementsAreArray(manager.GetShotIds()));
+  for (const auto& track : manager.GetTrackIds()) {
+    EXPECT_EQ(converted.GetTrackObservations(track),
+              manager.GetTrackObservations(track));
+  }
+}
+
+TEST_F(FlatTracksManagerTest, HasIOBinaryStringConsistency) {
+  const auto loaded =
+      map::FlatTracksManager::InstanciateFromString(flat.AsBinaryString());
+  EXPECT_EQ(loaded.GetShotIds(), flat.GetShotIds());
+  EXPECT_EQ(loaded.GetTrackIds(), flat.GetTrackIds());
+  for (const auto& shot : manager.GetShotIds()) {
+    EXPECT_EQ(loaded.GetShotObservations(shot),
+              manager.GetShotObservations(shot));
+  }
+}
+
+TEST_F(FlatTracksManagerTest, MapsBinaryFileColumns) {
+  TempFile tmpfile;
+  flat.WriteToBinaryFile(tmpfile.Name());
+  const auto loaded =
+      map::FlatTracksManager::InstanciateFromFile(tmpfile.Name());
+#ifndef _WIN32
+  EXPECT_TRUE(loaded.IsMapped());
+#endif
+  EXPECT_FALSE(flat.IsMapped());
+
+  // Copies share the mapping, which outlives the loaded manager
+  map::FlatTracksManager copy;
+  {
+    const auto other =
+        map::FlatTracksManager::InstanciateFromFile(tmpfile.Name());
+    copy = other;
+  }
+  for (const auto& shot : manager.GetShotIds()) {
+    EXPECT_EQ(loaded.GetShotObservations(shot),
+              manager.GetShotObservations(shot));
+    EXPECT_EQ(copy.GetShotObservations(shot),
+              manager.GetShotObservations(shot));
+  }
+}
+
+TEST_F(FlatTracksManagerTest, ReadsTextString) {
+  const auto loaded =
+      map::FlatTracksManager::InstanciateFromString(manager.AsString());
+  EXPECT_EQ(loaded.GetTrackObservations("1"),
+            manager.GetTrackObservations("1"));
+}
+
+}  // namespace
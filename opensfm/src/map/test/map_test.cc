@@ -163,6 +163,27 @@ TEST_F(ToyMapFixture, ThrowsWhenRemovingLandmarkTwice) {
   ASSERT_THROW(map.RemoveLandmark("1"), std::runtime_error);
 }
 
+TEST_F(ToyMapFixture, UpdatesStructureRevisionOnStructureChanges) {
+  const auto initial = map.GetStructureRevision();
+  map.GetLandmark("1").SetGlobalPos(Vec3d::Random());
+  const Vec3d origin = Vec3d::Random();
+  map.GetRigInstance("1").SetPose(geometry::Pose(origin));
+  ASSERT_EQ(map.GetStructureRevision(), initial);
+
+  map::Observation obs(100, 200, 0.5, 255, 255, 255, 1);
+  map.AddObservation("1", "1", obs);
+  const auto observed = map.GetStructureRevision();
+  ASSERT_NE(observed, initial);
+
+  map.RemoveObservation("1", "1");
+  ASSERT_NE(map.GetStructureRevision(), observed);
+}
+
+TEST_F(ToyMapFixture, HasDistinctStructureRevisions) {
+  map::Map other;
+  ASSERT_NE(map.GetStructureRevision(), other.GetStructureRevision());
+}
+
 TEST_F(ToyMapFixture, ReturnNumberOfRigInstanceCorrectly) {
   ASSERT_EQ(map.NumberOfRigInstances(), 8);
 }
@@ -275,6 +296,45 @@ TEST_F(OneCameraMapFixture, ComputeReprojectionErrorNormalized) {
   ASSERT_NEAR(expected[1] / scale, computed[1], 1e-8);
 }
 
+TEST_F(OneCameraMapFixture, SharesLandmarksReprojectionErrors) {
+  auto& shot0 = map.CreateShot("0", "0", "0", "0", geometry::Pose());
+  map.CreateRigInstance("1");
+  auto& shot1 = map.CreateShot("1", "0", "0", "1", geometry::Pose());
+  auto& lm1 = map.CreateLandmark("1", Vec3d::Random());
+  auto& lm2 = map.CreateLandmark("2", Vec3d::Random());
+  const map::Observation o(0., 0., 1., 1, 1, 1, 1, 1, 1);
+  for (auto* lm : {&lm1, &lm2}) {
+    map.AddObservation(&shot0, lm, o);
+    map.AddObservation(&shot1, lm, o);
+  }
+
+  // Landmark 1 has entries 0 and 1, landmark 2 has entry 2
+  const std::vector<map::ShotId> shot_ids = {"0", "1"};
+  auto errors = std::make_shared<map::ReprojectionErrors>();
+  errors->shot_ids = std::make_shared<std::vector<map::ShotId>>(shot_ids);
+  errors->shots = {0, 1, 1};
+  errors->offsets = {0, 2, 4, 6};
+  errors->values = {1., 2., 3., 4., 5., 6.};
+  lm1.SetReprojectionErrors(errors, 0, 2);
+  lm2.SetReprojectionErrors(errors, 2, 3);
+
+  const auto lm1_errors = lm1.GetReprojectionErrors();
+  ASSERT_EQ(lm1_errors.size(), 2);
+  ASSERT_EQ(lm1_errors.at("1"), Vec2d(3., 4.));
+  ASSERT_EQ(lm2.GetReprojectionErrors().at("1"), Vec2d(5., 6.));
+
+  map.RemoveObservation("0", "1");
+  ASSERT_EQ(lm1.GetReprojectionErrors().count("0"), 0);
+
+  const auto [landmarks, shots, residuals] =
+      map.GetLandmarksReprojectionErrors({"1", "2"});
+  ASSERT_EQ(landmarks, std::vector<map::LandmarkId>({"1", "2"}));
+  ASSERT_EQ(shots, std::vector<map::ShotId>({"1", "1"}));
+  ASSERT_EQ(residuals.rows(), 2);
+  ASSERT_EQ(residuals.cols(), 2);
+  ASSERT_EQ(residuals(1, 0), 5.);
+}
+
 class OneRigMapFixture : public EmptyMapFixture {
  public:
   OneRigMapFixture() {
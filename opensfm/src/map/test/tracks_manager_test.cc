@@ -86,6 +86,26 @@ TEST_F(TracksManagerTest, ReturnsShotObservations) {
   EXPECT_EQ(manager.GetShotObservations("1"), shot);
 }
 
+TEST_F(TracksManagerTest, ReturnsAllPairsConnectivity) {
+  manager.AddObservation("2", "2", map::Observation());
+  manager.AddObservation("3", "2", map::Observation());
+  manager.AddObservation("4", "2", map::Observation());
+
+  std::unordered_map<map::TracksManager::ShotPair, int, HashPair> expected;
+  expected[std::make_pair("1", "2")] = 1;
+  expected[std::make_pair("1", "3")] = 1;
+  expected[std::make_pair("2", "3")] = 2;
+  expected[std::make_pair("2", "4")] = 1;
+  expected[std::make_pair("3", "4")] = 1;
+  EXPECT_EQ(manager.GetAllPairsConnectivity({}, {}), expected);
+
+  std::unordered_map<map::TracksManager::ShotPair, int, HashPair> subset;
+  subset[std::make_pair("2", "3")] = 1;
+  subset[std::make_pair("2", "4")] = 1;
+  subset[std::make_pair("3", "4")] = 1;
+  EXPECT_EQ(manager.GetAllPairsConnectivity({"4", "3", "2"}, {"2"}), subset);
+}
+
 TEST_F(TracksManagerTest, ConstructSubTracksManager) {
   const auto subset = manager.ConstructSubTracksManager({"1"}, {"2", "3"});
   EXPECT_THAT(subset.GetShotIds(),
@@ -149,10 +169,43 @@ TEST_F(TracksManagerTest, MergeThreeTracksManager) {
   EXPECT_THAT(
       merged.GetTrackIds(),
       ::testing::WhenSorted(::testing::ElementsAre("0", "1", "2", "3")));
-  EXPECT_EQ(merged.GetTrackObservations("0"), track2);
-  EXPECT_EQ(merged.GetTrackObservations("1"), track3);
+  EXPECT_EQ(merged.GetTrackObservations("0"), track3);
+  EXPECT_EQ(merged.GetTrackObservations("1"), track0);
   EXPECT_EQ(merged.GetTrackObservations("2"), track1);
-  EXPECT_EQ(merged.GetTrackObservations("3"), track0);
+  EXPECT_EQ(merged.GetTrackObservations("3"), track2);
+}
+
+TEST_F(TracksManagerTest, MergeTracksManagerToBinaryFile) {
+  map::TracksManager manager1;
+  manager1.AddObservation("1", "a", map::Observation(1, 1, 1, 1, 1, 1, 0));
+  manager1.AddObservation("2", "a", map::Observation(2, 2, 1, 1, 1, 1, 5));
+  manager1.AddObservation("3", "b", map::Observation(3, 3, 1, 1, 1, 1, 1));
+
+  // Track "c" merges with "a" through shot "1", and disagrees on shot "2"
+  map::TracksManager manager2;
+  manager2.AddObservation("1", "c", map::Observation(1, 1, 1, 1, 1, 1, 0));
+  manager2.AddObservation("2", "c", map::Observation(4, 4, 1, 1, 1, 1, 6));
+  manager2.AddObservation("4", "d", map::Observation(5, 5, 1, 1, 1, 1, 2));
+
+  const auto merged =
+      map::TracksManager::MergeTracksManager({&manager1, &manager2});
+  map::TracksManager::MergeTracksManager({&manager1, &manager2},
+                                         tmpfile.Name());
+  const auto written = map::TracksManager::InstanciateFromFile(tmpfile.Name());
+
+  EXPECT_THAT(written.GetTrackIds(),
+              ::testing::UnorderedElementsAreArray(merged.GetTrackIds()));
+  EXPECT_THAT(written.GetShotIds(),
+              ::testing::UnorderedElementsAreArray(merged.GetShotIds()));
+  for (const auto& track_id : merged.GetTrackIds()) {
+    EXPECT_EQ(merged.GetTrackObservations(track_id),
+              written.GetTrackObservations(track_id));
+  }
+  for (const auto& shot_id : merged.GetShotIds()) {
+    EXPECT_EQ(merged.GetShotObservations(shot_id),
+              written.GetShotObservations(shot_id));
+  }
+  EXPECT_EQ(written.GetObservation("2", "0").feature_id, 6);
 }
 
 TEST_F(TracksManagerTest, HasIOFileConsistency) {
@@ -179,4 +232,54 @@ TEST_F(TracksManagerTest, HasIOStringConsistency) {
   EXPECT_EQ(track, manager_new.GetTrackObservations("1"));
 }
 
+TEST_F(TracksManagerTest, HasIOBinaryFileConsistency) {
+  manager.WriteToBinaryFile(tmpfile.Name());
+  const map::TracksManager manager_new =
+      map::TracksManager::InstanciateFromFile(tmpfile.Name());
+
+  EXPECT_THAT(manager_new.GetShotIds(),
+              ::testing::WhenSorted(::testing::ElementsAre("1", "2", "3")));
+  EXPECT_THAT(manager_new.GetTrackIds(),
+              ::testing::WhenSorted(::testing::ElementsAre("1")));
+  EXPECT_EQ(track, manager_new.GetTrackObservations("1"));
+}
+
+TEST_F(TracksManagerTest, HasIOBinaryStringConsistency) {
+  const auto serialized = manager.AsBinaryString();
+  const map::TracksManager manager_new =
+      map::TracksManager::InstanciateFromString(serialized);
+
+  EXPECT_THAT(manager_new.GetShotIds(),
+              ::testing::WhenSorted(::testing::ElementsAre("1", "2", "3")));
+  EXPECT_EQ(track, manager_new.GetTrackObservations("1"));
+}
+
+TEST_F(TracksManagerTest, ThrowsOnTruncatedBinary) {
+  const auto serialized = manager.AsBinaryString();
+  EXPECT_THROW(map::TracksManager::InstanciateFromString(
+                   serialized.substr(0, serialized.size() / 2)),
+               std::runtime_error);
+}
+
+TEST_F(TracksManagerTest, ConvertsBetweenTextAndBinary) {
+  TempFile binary_file;
+  manager.WriteToFile(tmpfile.Name());
+  map::TracksManager::ConvertFile(tmpfile.Name(), binary_file.Name(), true);
+  map::TracksManager::ConvertFile(binary_file.Name(), tmpfile.Name(), false);
+
+  const auto binary =
+      map::TracksManager::InstanciateFromFile(binary_file.Name());
+  const auto text = map::TracksManager::InstanciateFromFile(tmpfile.Name());
+  EXPECT_EQ(track, binary.GetTrackObservations("1"));
+  EXPECT_EQ(track, text.GetTrackObservations("1"));
+  EXPECT_EQ(manager.AsString().substr(0, 24), text.AsString().substr(0, 24));
+}
+
+TEST_F(TracksManagerTest, ReadsTextVersion0) {
+  const std::string v0 = "1\t1\t1\t1.0\t1.0\t1\t1\t1\n";
+  const auto manager_v0 = map::TracksManager::InstanciateFromString(v0);
+  EXPECT_EQ(manager_v0.GetObservation("1", "1"),
+            map::Observation(1.0, 1.0, 0.0, 1, 1, 1, 1));
+}
+
 }  // namespace
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <map/defines.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Binary tracks files, shared by TracksManager and FlatTracksManager. They
+// are made of (all values little-endian) :
+//  - a header : magic, version, number of shots, tracks and observations
+//  - the shots and the tracks string tables : N + 1 offsets followed by the
+//    concatenated IDs characters
+//  - the observations, stored column by column and sorted by shot : x, y,
+//    scale, shot index, track index, feature ID, segmentation, instance and
+//    RGB color
+// Every section is padded to 8 bytes so columns can be read in-place.
+namespace map {
+namespace binary {
+
+constexpr size_t kAlignment = 8;
+constexpr size_t kMagicSize = 8;
+
+struct Header {
+  char magic[kMagicSize];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t num_shots;
+  uint64_t num_tracks;
+  uint64_t num_observations;
+};
+static_assert(sizeof(Header) == 40, "Binary tracks header must not be padded");
+static_assert(sizeof(int) == sizeof(int32_t),
+              "Binary tracks indexes columns are 32 bits integers");
+
+bool HasMagic(const char* data, size_t size);
+bool IsBinaryFile(const std::string& filename);
+
+inline size_t PaddedSize(size_t size) {
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Observations columns to be written, the shot and track ones indexing the
+// IDs tables. Observations must be sorted by shot.
+struct Columns {
+  size_t size{0};
+  const double* xs{nullptr};
+  const double* ys{nullptr};
+  const double* scales{nullptr};
+  const int32_t* shots{nullptr};
+  const int32_t* tracks{nullptr};
+  const int32_t* features{nullptr};
+  const int32_t* segmentations{nullptr};
+  const int32_t* instances{nullptr};
+  const uint8_t* colors{nullptr};  // RGB, 3 per observation
+};
+
+void Write(std::ostream& ostream, const std::vector<ShotId>& shot_ids,
+           const std::vector<TrackId>& track_ids, const Columns& columns);
+
+// Sequential, bounds-checked access to the sections of a binary buffer.
+// Values are memcpy'ed as the buffer might not be aligned, while columns
+// can be mapped in place when it is.
+class Reader {
+ public:
+  Reader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  // Read the header and check its version
+  Header ReadHeader();
+
+  template <class T>
+  const char* Column(size_t count) {
+    const size_t remaining = size_ - position_;
+    if (count > remaining / sizeof(T)) {
+      throw std::runtime_error("Truncated binary tracks manager data");
+    }
+    const char* start = data_ + position_;
+    position_ += std::min(remaining, PaddedSize(count * sizeof(T)));
+    return start;
+  }
+
+  template <class T>
+  static T Value(const char* column, size_t index) {
+    T value;
+    std::memcpy(&value, column + index * sizeof(T), sizeof(T));
+    return value;
+  }
+
+  // Map the next column into a FlatColumn-like one, or copy it
+  template <class C>
+  void ReadColumn(size_t count, bool in_place, C* column) {
+    using T = typename C::value_type;
+    const char* data = Column<T>(count);
+    if (in_place && reinterpret_cast<uintptr_t>(data) % alignof(T) == 0) {
+      column->Map(reinterpret_cast<const T*>(data), count);
+    } else {
+      auto& values = column->Mutable();
+      values.resize(count);
+      std::memcpy(values.data(), data, count * sizeof(T));
+    }
+  }
+
+  std::vector<std::string> StringTable(size_t count);
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t position_{0};
+};
+
+// Read-only view of a whole file : memory-mapped where available, read in a
+// buffer otherwise.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+ private:
+  const char* data_{nullptr};
+  size_t size_{0};
+#ifdef _WIN32
+  std::vector<char> buffer_;
+#endif
+};
+
+}  // namespace binary
+}  // namespace map
@@ -39,21 +39,45 @@ class TracksManager {
       const std::vector<ShotId>& shots,
       const std::vector<TrackId>& tracks) const;
 
+  // Text (V0 to V2) and binary files are both accepted, binary ones are
+  // memory-mapped and read without any per-field parsing
   static TracksManager InstanciateFromFile(const std::string& filename);
   void WriteToFile(const std::string& filename) const;
+  void WriteToBinaryFile(const std::string& filename) const;
 
   static TracksManager InstanciateFromString(const std::string& str);
   std::string AsString() const;
+  std::string AsBinaryString() const;
+
+  // Rewrite a tracks file (of any version) either as text or as binary
+  static void ConvertFile(const std::string& input_filename,
+                          const std::string& output_filename, bool binary);
 
   static TracksManager MergeTracksManager(
       const std::vector<const TracksManager*>& tracks_manager);
+  // Same as above, but write the merged tracks straight to a binary file
+  // instead of building their maps
+  static void MergeTracksManager(
+      const std::vector<const TracksManager*>& tracks_manager,
+      const std::string& filename);
 
   bool HasShotObservations(const ShotId& shot) const;
 
   static std::string TRACKS_HEADER;
   static int TRACKS_VERSION;
+  static std::string TRACKS_BINARY_HEADER;
+  static int TRACKS_BINARY_VERSION;
 
  private:
+  friend class FlatTracksManager;
+
+  struct MergeClusters;
+  static MergeClusters ClusterTracks(
+      const std::vector<const TracksManager*>& tracks_managers);
+
+  // Build the maps straight from the columns of a binary buffer
+  static TracksManager InstanciateFromBinary(const char* data, size_t size);
+
   std::unordered_map<ShotId, std::unordered_map<TrackId, Observation>>
       tracks_per_shot_;
   std::unordered_map<TrackId, std::unordered_map<ShotId, Observation>>
@@ -37,11 +37,7 @@ class EssentialMatrix : public Model<EssentialMatrix<E>, 1, 10> {
 
   template <class IT>
   static int Estimate(IT begin, IT end, Type* models) {
-    const auto essentials = EssentialFivePoints(begin, end);
-    for (int i = 0; i < essentials.size(); ++i) {
-      models[i] = essentials[i];
-    }
-    return essentials.size();
+    return EssentialFivePoints(begin, end, models);
   }
 
   template <class IT>
@@ -15,15 +15,21 @@ ScoreInfo<Line::Type> RANSACLine(const Eigen::Matrix<double, -1, 2>& points,
                                  const RansacType& ransac_type);
 
 using EssentialMatrixModel = EssentialMatrix<EpipolarGeodesic>;
+// The essential, relative pose and absolute pose estimations optionally take
+// a prior on each sample (e.g. a matching score, the bigger, the better),
+// used by PROSAC sampling. Their NAPSAC neighborhoods are computed over the
+// first bearings.
 ScoreInfo<EssentialMatrixModel::Type> RANSACEssential(
     const Eigen::Matrix<double, -1, 3>& x1,
     const Eigen::Matrix<double, -1, 3>& x2, double threshold,
-    const RobustEstimatorParams& parameters, const RansacType& ransac_type);
+    const RobustEstimatorParams& parameters, const RansacType& ransac_type,
+    const Eigen::VectorXd& priors = Eigen::VectorXd());
 
 ScoreInfo<RelativePose::Type> RANSACRelativePose(
     const Eigen::Matrix<double, -1, 3>& x1,
     const Eigen::Matrix<double, -1, 3>& x2, double threshold,
-    const RobustEstimatorParams& parameters, const RansacType& ransac_type);
+    const RobustEstimatorParams& parameters, const RansacType& ransac_type,
+    const Eigen::VectorXd& priors = Eigen::VectorXd());
 
 ScoreInfo<RelativeRotation::Type> RANSACRelativeRotation(
     const Eigen::Matrix<double, -1, 3>& x1,
@@ -33,7 +39,8 @@ ScoreInfo<RelativeRotation::Type> RANSACRelativeRotation(
 ScoreInfo<AbsolutePose::Type> RANSACAbsolutePose(
     const Eigen::Matrix<double, -1, 3>& bearings,
     const Eigen::Matrix<double, -1, 3>& points, double threshold,
-    const RobustEstimatorParams& parameters, const RansacType& ransac_type);
+    const RobustEstimatorParams& parameters, const RansacType& ransac_type,
+    const Eigen::VectorXd& priors = Eigen::VectorXd());
 
 ScoreInfo<AbsolutePoseKnownRotation::Type> RANSACAbsolutePoseKnownRotation(
     const Eigen::Matrix<double, -1, 3>& bearings,
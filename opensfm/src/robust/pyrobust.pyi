@@ -15,6 +15,7 @@ from typing import *
 __all__  = [
 "RansacType",
 "RobustEstimatorParams",
+"SamplingType",
 "ScoreInfoLine",
 "ScoreInfoMatrix34d",
 "ScoreInfoMatrix3d",
@@ -29,7 +30,10 @@ __all__  = [
 "ransac_similarity",
 "LMedS",
 "MSAC",
-"RANSAC"
+"NAPSAC",
+"PROSAC",
+"RANSAC",
+"UNIFORM"
 ]
 class RansacType:
     RANSAC: "RansacType"
@@ -45,10 +49,34 @@ class RobustEstimatorParams:
     @iterations.setter
     def iterations(self, arg0: int) -> None:...
     @property
+    def napsac_grid_size(self) -> int:...
+    @napsac_grid_size.setter
+    def napsac_grid_size(self, arg0: int) -> None:...
+    @property
+    def num_threads(self) -> int:...
+    @num_threads.setter
+    def num_threads(self, arg0: int) -> None:...
+    @property
     def probability(self) -> float:...
     @probability.setter
     def probability(self, arg0: float) -> None:...
     @property
+    def sampling(self) -> SamplingType:...
+    @sampling.setter
+    def sampling(self, arg0: SamplingType) -> None:...
+    @property
+    def sprt_delta(self) -> float:...
+    @sprt_delta.setter
+    def sprt_delta(self, arg0: float) -> None:...
+    @property
+    def sprt_epsilon(self) -> float:...
+    @sprt_epsilon.setter
+    def sprt_epsilon(self, arg0: float) -> None:...
+    @property
+    def sprt_time_model(self) -> float:...
+    @sprt_time_model.setter
+    def sprt_time_model(self, arg0: float) -> None:...
+    @property
     def use_iteration_reduction(self) -> bool:...
     @use_iteration_reduction.setter
     def use_iteration_reduction(self, arg0: bool) -> None:...
@@ -56,6 +84,17 @@ class RobustEstimatorParams:
     def use_local_optimization(self) -> bool:...
     @use_local_optimization.setter
     def use_local_optimization(self, arg0: bool) -> None:...
+    @property
+    def use_sprt(self) -> bool:...
+    @use_sprt.setter
+    def use_sprt(self, arg0: bool) -> None:...
+class SamplingType:
+    UNIFORM: "SamplingType"
+    PROSAC: "SamplingType"
+    NAPSAC: "SamplingType"
+    __members__: Dict[str, "SamplingType"]
+    @property
+    def name(self) -> str: ...
 class ScoreInfoLine:
     def __init__(self) -> None: ...
     @property
@@ -146,13 +185,16 @@ class ScoreInfoVector3d:
     def score(self) -> float:...
     @score.setter
     def score(self, arg0: float) -> None:...
-def ransac_absolute_pose(arg0: numpy.ndarray, arg1: numpy.ndarray, arg2: float, arg3: RobustEstimatorParams, arg4: RansacType) -> ScoreInfoMatrix34d:...
+def ransac_absolute_pose(bearings: numpy.ndarray, points: numpy.ndarray, threshold: float, parameters: RobustEstimatorParams, ransac_type: RansacType, priors: numpy.ndarray = ...) -> ScoreInfoMatrix34d:...
 def ransac_absolute_pose_known_rotation(arg0: numpy.ndarray, arg1: numpy.ndarray, arg2: float, arg3: RobustEstimatorParams, arg4: RansacType) -> ScoreInfoVector3d:...
-def ransac_essential(arg0: numpy.ndarray, arg1: numpy.ndarray, arg2: float, arg3: RobustEstimatorParams, arg4: RansacType) -> ScoreInfoMatrix3d:...
+def ransac_essential(x1: numpy.ndarray, x2: numpy.ndarray, threshold: float, parameters: RobustEstimatorParams, ransac_type: RansacType, priors: numpy.ndarray = ...) -> ScoreInfoMatrix3d:...
 def ransac_line(arg0: numpy.ndarray, arg1: float, arg2: RobustEstimatorParams, arg3: RansacType) -> ScoreInfoLine:...
-def ransac_relative_pose(arg0: numpy.ndarray, arg1: numpy.ndarray, arg2: float, arg3: RobustEstimatorParams, arg4: RansacType) -> ScoreInfoMatrix34d:...
+def ransac_relative_pose(x1: numpy.ndarray, x2: numpy.ndarray, threshold: float, parameters: RobustEstimatorParams, ransac_type: RansacType, priors: numpy.ndarray = ...) -> ScoreInfoMatrix34d:...
 def ransac_relative_rotation(arg0: numpy.ndarray, arg1: numpy.ndarray, arg2: float, arg3: RobustEstimatorParams, arg4: RansacType) -> ScoreInfoMatrix3d:...
 def ransac_similarity(arg0: numpy.ndarray, arg1: numpy.ndarray, arg2: float, arg3: RobustEstimatorParams, arg4: RansacType) -> ScoreInfoMatrix4d:...
 LMedS = ...
 MSAC = ...
-RANSAC = ...
\ No newline at end of file
+NAPSAC = ...
+PROSAC = ...
+RANSAC = ...
+UNIFORM = ...
\ No newline at end of file
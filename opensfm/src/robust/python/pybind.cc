@@ -30,17 +30,33 @@ PYBIND11_MODULE(pyrobust, m) {
       .def_readwrite("use_local_optimization",
                      &RobustEstimatorParams::use_local_optimization)
       .def_readwrite("use_iteration_reduction",
-                     &RobustEstimatorParams::use_iteration_reduction);
+                     &RobustEstimatorParams::use_iteration_reduction)
+      .def_readwrite("sampling", &RobustEstimatorParams::sampling)
+      .def_readwrite("napsac_grid_size",
+                     &RobustEstimatorParams::napsac_grid_size)
+      .def_readwrite("use_sprt", &RobustEstimatorParams::use_sprt)
+      .def_readwrite("sprt_epsilon", &RobustEstimatorParams::sprt_epsilon)
+      .def_readwrite("sprt_delta", &RobustEstimatorParams::sprt_delta)
+      .def_readwrite("sprt_time_model",
+                     &RobustEstimatorParams::sprt_time_model)
+      .def_readwrite("num_threads", &RobustEstimatorParams::num_threads);
 
   m.def("ransac_line", robust::RANSACLine,
         py::call_guard<py::gil_scoped_release>());
-  m.def("ransac_essential", robust::RANSACEssential,
+  m.def("ransac_essential", robust::RANSACEssential, py::arg("x1"),
+        py::arg("x2"), py::arg("threshold"), py::arg("parameters"),
+        py::arg("ransac_type"), py::arg("priors") = Eigen::VectorXd(),
         py::call_guard<py::gil_scoped_release>());
-  m.def("ransac_relative_pose", robust::RANSACRelativePose,
+  m.def("ransac_relative_pose", robust::RANSACRelativePose, py::arg("x1"),
+        py::arg("x2"), py::arg("threshold"), py::arg("parameters"),
+        py::arg("ransac_type"), py::arg("priors") = Eigen::VectorXd(),
         py::call_guard<py::gil_scoped_release>());
   m.def("ransac_relative_rotation", robust::RANSACRelativeRotation,
         py::call_guard<py::gil_scoped_release>());
   m.def("ransac_absolute_pose", robust::RANSACAbsolutePose,
+        py::arg("bearings"), py::arg("points"), py::arg("threshold"),
+        py::arg("parameters"), py::arg("ransac_type"),
+        py::arg("priors") = Eigen::VectorXd(),
         py::call_guard<py::gil_scoped_release>());
   m.def("ransac_absolute_pose_known_rotation",
         robust::RANSACAbsolutePoseKnownRotation,
@@ -53,4 +69,10 @@ PYBIND11_MODULE(pyrobust, m) {
       .value("MSAC", RansacType::MSAC)
       .value("LMedS", RansacType::LMedS)
       .export_values();
+
+  py::enum_<SamplingType>(m, "SamplingType")
+      .value("UNIFORM", SamplingType::UNIFORM)
+      .value("PROSAC", SamplingType::PROSAC)
+      .value("NAPSAC", SamplingType::NAPSAC)
+      .export_values();
 }
@@ -1,5 +1,14 @@
 #pragma once
 
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+enum SamplingType { UNIFORM = 0, PROSAC = 1, NAPSAC = 2 };
+
 template <class T>
 class RandomSamplesGenerator {
  public:
@@ -9,31 +18,178 @@ class RandomSamplesGenerator {
 
   RandomSamplesGenerator(int seed = 42) : generator_(seed) {}
 
-  template <class MODEL>
-  std::vector<typename MODEL::Data> GetRandomSamples(
-      const std::vector<typename MODEL::Data>& samples, int size) {
-    const auto random_sample_indices =
+  // Draw the minimal samples by decreasing prior (PROSAC) : the first
+  // samples are drawn among the best ones only, the pool of samples growing
+  // so that sampling becomes uniform after max_iterations samples.
+  void SetPriors(const std::vector<double>& priors, int size,
+                 int max_iterations) {
+    const int count = priors.size();
+    sampling_ = PROSAC;
+    prosac_order_.resize(count);
+    std::iota(prosac_order_.begin(), prosac_order_.end(), 0);
+    std::stable_sort(
+        prosac_order_.begin(), prosac_order_.end(),
+        [&priors](int a, int b) { return priors[a] > priors[b]; });
+    prosac_n_ = size;
+    prosac_t_ = 0;
+    prosac_T_n_ = max_iterations;
+    for (int i = 0; i < size; ++i) {
+      prosac_T_n_ *= double(prosac_n_ - i) / (count - i);
+    }
+    prosac_T_n_prime_ = 1;
+  }
+
+  // Draw the minimal samples among the neighbors of a random sample
+  // (NAPSAC), the neighbors of a sample being the ones in the same cell of a
+  // grid of grid_size^3 cells over positions in [-1, 1]^3 (e.g. bearings).
+  // Uniform samples are drawn when a cell has too few samples.
+  void SetPositions(const std::vector<Eigen::Vector3d>& positions,
+                    int grid_size) {
+    const int count = positions.size();
+    const int cells_count = grid_size * grid_size * grid_size;
+    sampling_ = NAPSAC;
+    napsac_samples_cells_.resize(count);
+    napsac_cells_offsets_.assign(cells_count + 1, 0);
+    for (int i = 0; i < count; ++i) {
+      int cell = 0;
+      for (int j = 0; j < 3; ++j) {
+        const int coordinate = std::floor((positions[i][j] + 1.0) * 0.5 *
+                                          grid_size);
+        cell = cell * grid_size + std::clamp(coordinate, 0, grid_size - 1);
+      }
+      napsac_samples_cells_[i] = cell;
+      ++napsac_cells_offsets_[cell + 1];
+    }
+    std::partial_sum(napsac_cells_offsets_.begin(),
+                     napsac_cells_offsets_.end(),
+                     napsac_cells_offsets_.begin());
+    napsac_cells_samples_.resize(count);
+    auto next = napsac_cells_offsets_;
+    for (int i = 0; i < count; ++i) {
+      napsac_cells_samples_[next[napsac_samples_cells_[i]]++] = i;
+    }
+  }
+
+  // Fill random_samples with size distinct samples drawn according to the
+  // sampling mode, reusing its memory
+  template <class DATA>
+  void GetMinimalSamples(const std::vector<DATA>& samples, int size,
+                         std::vector<DATA>* random_samples) {
+    switch (sampling_) {
+      case PROSAC:
+        GenerateProsacSample(size);
+        break;
+      case NAPSAC:
+        GenerateNapsacSample(size, samples.size());
+        break;
+      default:
         GenerateOneSample(size, samples.size() - 1);
-    std::vector<typename MODEL::Data> random_samples;
-    std::for_each(random_sample_indices.begin(), random_sample_indices.end(),
-                  [&random_samples, &samples](const int idx) {
-                    random_samples.push_back(samples[idx]);
-                  });
-    return random_samples;
+    }
+    random_samples->clear();
+    for (const int idx : indices_) {
+      random_samples->push_back(samples[idx]);
+    }
+  }
+
+  // Fill random_samples with size distinct random samples, reusing its
+  // memory
+  template <class DATA>
+  void GetRandomSamples(const std::vector<DATA>& samples, int size,
+                        std::vector<DATA>* random_samples) {
+    GenerateOneSample(size, samples.size() - 1);
+    random_samples->clear();
+    for (const int idx : indices_) {
+      random_samples->push_back(samples[idx]);
+    }
+  }
+
+  // Same as above, with the random samples picked among the samples of the
+  // given indexes
+  template <class DATA>
+  void GetRandomSamples(const std::vector<DATA>& samples,
+                        const std::vector<int>& samples_indices, int size,
+                        std::vector<DATA>* random_samples) {
+    GenerateOneSample(size, samples_indices.size() - 1);
+    random_samples->clear();
+    for (const int idx : indices_) {
+      random_samples->push_back(samples[samples_indices[idx]]);
+    }
   }
 
  private:
-  std::vector<int> GenerateOneSample(int size, int range_max) {
-    std::vector<int> indices(size);
+  void GenerateOneSample(int size, int range_max) {
+    indices_.resize(size);
     DISTRIBUTION distribution(0, range_max);
     for (int i = 0; i < size; ++i) {
       do {
-        indices[i] = distribution(generator_);
-      } while (std::find(indices.begin(), indices.begin() + i, indices[i]) !=
-               (indices.begin() + i));
+        indices_[i] = distribution(generator_);
+      } while (std::find(indices_.begin(), indices_.begin() + i,
+                         indices_[i]) != (indices_.begin() + i));
+    }
+  }
+
+  void GenerateProsacSample(int size) {
+    // Grow the pool of samples following PROSAC's growth function
+    const int count = prosac_order_.size();
+    ++prosac_t_;
+    if (prosac_t_ >= prosac_T_n_prime_ && prosac_n_ < count) {
+      const double T_n_next =
+          prosac_T_n_ * (prosac_n_ + 1.0) / (prosac_n_ + 1.0 - size);
+      prosac_T_n_prime_ +=
+          std::max(1, int(std::ceil(T_n_next - prosac_T_n_)));
+      prosac_T_n_ = T_n_next;
+      ++prosac_n_;
+    }
+
+    // Samples are drawn among the pool, with its last sample until the
+    // pool grows again
+    if (prosac_T_n_prime_ >= prosac_t_) {
+      GenerateOneSample(size - 1, prosac_n_ - 2);
+      indices_.push_back(prosac_n_ - 1);
+    } else {
+      GenerateOneSample(size, prosac_n_ - 1);
+    }
+    for (auto& idx : indices_) {
+      idx = prosac_order_[idx];
+    }
+  }
+
+  void GenerateNapsacSample(int size, int count) {
+    const int center = DISTRIBUTION(0, count - 1)(generator_);
+    const int cell = napsac_samples_cells_[center];
+    const int cell_begin = napsac_cells_offsets_[cell];
+    const int cell_size = napsac_cells_offsets_[cell + 1] - cell_begin;
+    if (cell_size < size) {
+      GenerateOneSample(size, count - 1);
+      return;
+    }
+
+    indices_.resize(size);
+    indices_[0] = center;
+    DISTRIBUTION distribution(0, cell_size - 1);
+    for (int i = 1; i < size; ++i) {
+      do {
+        indices_[i] =
+            napsac_cells_samples_[cell_begin + distribution(generator_)];
+      } while (std::find(indices_.begin(), indices_.begin() + i,
+                         indices_[i]) != (indices_.begin() + i));
     }
-    return indices;
   }
 
   RAND_GEN generator_;
+  std::vector<int> indices_;
+  SamplingType sampling_{UNIFORM};
+
+  // Samples by decreasing prior, size of the pool of samples and number of
+  // samples drawn, and PROSAC's T_n and T'_n
+  std::vector<int> prosac_order_;
+  int prosac_n_{0};
+  int prosac_t_{0};
+  double prosac_T_n_{0};
+  int prosac_T_n_prime_{0};
+
+  // Grid cell of each sample, and samples of each cell
+  std::vector<int> napsac_samples_cells_;
+  std::vector<int> napsac_cells_offsets_;
+  std::vector<int> napsac_cells_samples_;
 };
@@ -20,11 +20,12 @@ class RelativePose : public Model<RelativePose, 1, 10> {
 
   template <class IT>
   static int Estimate(IT begin, IT end, Type* models) {
-    const auto essentials = EssentialFivePoints(begin, end);
-    for (int i = 0; i < essentials.size(); ++i) {
+    Eigen::Matrix3d essentials[MAX_MODELS];
+    const int count = EssentialFivePoints(begin, end, essentials);
+    for (int i = 0; i < count; ++i) {
       models[i] = RelativePoseFromEssential(essentials[i], begin, end);
     }
-    return essentials.size();
+    return count;
   }
 
   template <class IT>
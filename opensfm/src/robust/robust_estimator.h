@@ -2,6 +2,8 @@
 
 #include <Eigen/Eigen>
 #include <algorithm>
+#include <memory>
+#include <numeric>
 #include <random>
 
 #include "random_sampler.h"
@@ -13,6 +15,23 @@ struct RobustEstimatorParams {
   bool use_local_optimization{true};
   bool use_iteration_reduction{true};
   int local_optimization_iterations{10};
+  // Sampling of the minimal samples : PROSAC needs priors on the samples,
+  // NAPSAC needs their positions, and both default to uniform sampling
+  // otherwise. NAPSAC neighborhoods are cells of a grid with
+  // napsac_grid_size cells per axis.
+  SamplingType sampling{UNIFORM};
+  int napsac_grid_size{8};
+  // Randomized verification of the models by SPRT, with the initial
+  // probabilities of a sample being consistent with a good and a bad model,
+  // and the time to estimate the models of a minimal sample, in samples
+  // evaluations. Only applies to RANSAC and MSAC.
+  bool use_sprt{false};
+  double sprt_epsilon{0.1};
+  double sprt_delta{0.01};
+  double sprt_time_model{200};
+  // Hypotheses are generated and scored in parallel by num_threads streams
+  // of random samples. Results are reproducible for a given num_threads.
+  int num_threads{1};
 
   RobustEstimatorParams() = default;
 };
@@ -20,98 +39,270 @@ struct RobustEstimatorParams {
 template <class MODEL>
 bool ShouldStop(const RobustEstimatorParams& params,
                 const ScoreInfo<typename MODEL::Type>& best_score,
-                int samples_count, int iteration) {
+                int samples_count, int iteration,
+                double rejection_probability = 0.0) {
   if (!params.use_iteration_reduction) {
     return false;
   }
+  // A good sample must also have its model not rejected by the verification
   const double inliers_ratio =
       double(best_score.inliers_indices.size()) / samples_count;
-  const double proba_one_outlier =
-      std::min(1.0 - std::numeric_limits<double>::epsilon(),
-               1.0 - std::pow(inliers_ratio, double(MODEL::MINIMAL_SAMPLES)));
+  const double proba_one_outlier = std::min(
+      1.0 - std::numeric_limits<double>::epsilon(),
+      1.0 - std::pow(inliers_ratio, double(MODEL::MINIMAL_SAMPLES)) *
+                (1.0 - rejection_probability));
   const auto max_iterations =
       std::log(1.0 - params.probability) / std::log(proba_one_outlier);
   return max_iterations < iteration;
 }
 
+// Hypotheses drawn from one stream of random samples, and the best of them
+// (bigger the score, the better)
 template <class SCORING, class MODEL>
-ScoreInfo<typename MODEL::Type> Estimate(
-    const std::vector<typename MODEL::Data>& samples, const SCORING& scorer,
-    const RobustEstimatorParams& params) {
-  // For now, we use this default one, we could be extended to PROSAC sampling
-  RandomSamplesGenerator<std::mt19937> random_generator;
+class EstimationStream {
+ public:
+  using Type = typename MODEL::Type;
+  using Data = typename MODEL::Data;
 
-  ScoreInfo<typename MODEL::Type> best_score;
-  bool should_stop = false;
-  for (int i = 0; i < params.iterations && !should_stop; ++i) {
+  // Models are estimated from samples, and scored on scored_samples, which
+  // are the same samples, possibly shuffled
+  EstimationStream(const std::vector<Data>& samples,
+                   const std::vector<Data>& scored_samples,
+                   const SCORING& scorer, const RobustEstimatorParams& params,
+                   int seed)
+      : samples_(samples),
+        scored_samples_(scored_samples),
+        scorer_(scorer),
+        params_(params),
+        random_generator_(seed),
+        sprt_(params.sprt_epsilon, params.sprt_delta,
+              params.sprt_time_model) {}
+
+  void SetSampling(const std::vector<double>& priors,
+                   const std::vector<Eigen::Vector3d>& positions,
+                   int iterations) {
+    if (params_.sampling == PROSAC && !priors.empty()) {
+      random_generator_.SetPriors(priors, MODEL::MINIMAL_SAMPLES, iterations);
+    } else if (params_.sampling == NAPSAC && !positions.empty()) {
+      random_generator_.SetPositions(positions, params_.napsac_grid_size);
+    }
+  }
+
+  // Start again from a best model found elsewhere
+  void SetBest(const ScoreInfo<Type>& best_score) {
+    best_score_ = best_score;
+    improved_ = false;
+    if (params_.use_sprt && !best_score_.inliers_indices.empty()) {
+      sprt_.SetEpsilon(double(best_score_.inliers_indices.size()) /
+                       samples_.size());
+    }
+  }
+
+  // Generate and score the models of one minimal sample, should_stop being
+  // checked after each of them. Returns true if it stopped.
+  template <class STOP>
+  bool RunIteration(const STOP& should_stop) {
     // Generate and compute some models
-    const auto random_samples = random_generator.GetRandomSamples<MODEL>(
-        samples, MODEL::MINIMAL_SAMPLES);
-    typename MODEL::Type models[MODEL::MAX_MODELS];
-    const auto models_count = MODEL::Estimate(random_samples.begin(),
-                                              random_samples.end(), &models[0]);
-
-    // Compute model's errors for each generated model
-    for (int j = 0; j < models_count && !should_stop; ++j) {
-      auto errors =
-          MODEL::EvaluateModel(models[j], samples.begin(), samples.end());
-
-      // Compute score based on errors
-      ScoreInfo<typename MODEL::Type> score =
-          scorer.Score(errors.begin(), errors.end(), best_score);
-      score.model = models[j];
-      score.lo_model = models[j];
-
-      // Keep the best score (bigger, the better)
-      best_score = std::max(score, best_score);
-      const bool best_found =
-          score.score == best_score.score &&
-          score.inliers_indices.size() >= MODEL::MINIMAL_SAMPLES;
+    random_generator_.GetMinimalSamples(samples_, MODEL::MINIMAL_SAMPLES,
+                                        &random_samples_);
+    Type models[MODEL::MAX_MODELS];
+    const auto models_count = MODEL::Estimate(
+        random_samples_.begin(), random_samples_.end(), &models[0]);
 
-      // Run local optimization (inner non-minimal RANSAC on inliers)
-      if (best_found && params.use_local_optimization) {
-        for (int k = 0; k < params.local_optimization_iterations; ++k) {
-          // Gather inliers and use them for getting random sample
-          std::vector<typename MODEL::Data> inliers_samples;
-          for (const auto idx : best_score.inliers_indices) {
-            inliers_samples.push_back(samples[idx]);
-          }
+    // Compute model's score for each generated model, hypotheses that can't
+    // beat the best one being abandoned early
+    for (int j = 0; j < models_count; ++j) {
+      bool best_found = false;
+      if (ScoreModel(models[j])) {
+        best_score_.model = models[j];
+        best_score_.lo_model = models[j];
+        best_found =
+            best_score_.inliers_indices.size() >= MODEL::MINIMAL_SAMPLES;
+      }
 
+      // Run local optimization (inner non-minimal RANSAC on inliers)
+      if (best_found && params_.use_local_optimization) {
+        for (int k = 0; k < params_.local_optimization_iterations; ++k) {
           // Same as Matas papers : min(inliers/2, 12)
           const int lo_sample_size_clamp = 12;
-          const int lo_sample_size =
-              std::max(std::min(lo_sample_size_clamp,
-                                int(best_score.inliers_indices.size() * 0.5)),
-                       MODEL::MINIMAL_SAMPLES);
-
-          const auto lo_random_samples =
-              random_generator.GetRandomSamples<MODEL>(inliers_samples,
-                                                       lo_sample_size);
-
-          typename MODEL::Type lo_models[MODEL::MAX_MODELS];
-          const auto lo_models_count =
-              MODEL::EstimateNonMinimal(lo_random_samples.begin(),
-                                        lo_random_samples.end(), &lo_models[0]);
+          const int lo_sample_size = std::max(
+              std::min(lo_sample_size_clamp,
+                       int(best_score_.inliers_indices.size() * 0.5)),
+              MODEL::MINIMAL_SAMPLES);
+
+          // Random sample of the inliers
+          random_generator_.GetRandomSamples(scored_samples_,
+                                             best_score_.inliers_indices,
+                                             lo_sample_size, &random_samples_);
+
+          Type lo_models[MODEL::MAX_MODELS];
+          const auto lo_models_count = MODEL::EstimateNonMinimal(
+              random_samples_.begin(), random_samples_.end(), &lo_models[0]);
           for (int l = 0; l < lo_models_count; ++l) {
-            // Compute LO model's errors on all samples
-            auto lo_errors = MODEL::EvaluateModel(lo_models[l], samples.begin(),
-                                                  samples.end());
-
-            // Compute LO score based on errors
-            ScoreInfo<typename MODEL::Type> lo_score =
-                scorer.Score(lo_errors.begin(), lo_errors.end(), best_score);
-            lo_score.model = best_score.model;
-            lo_score.lo_model = lo_models[l];
-
-            // Keep the best score (bigger, the better)
-            best_score = std::max(lo_score, best_score);
+            // Compute LO model's score on all samples
+            if (ScoreModel(lo_models[l])) {
+              best_score_.lo_model = lo_models[l];
+            }
           }
         }
       }
 
-      // Based on actual inliers ratio, we might stop here
-      should_stop = ShouldStop<MODEL>(params, best_score, samples.size(), i);
+      if (should_stop(*this)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const ScoreInfo<Type>& BestScore() const { return best_score_; }
+  ScoreInfo<Type>& BestScore() { return best_score_; }
+  bool Improved() const { return improved_; }
+
+  // Probability of rejecting a good model
+  double RejectionProbability() const {
+    return params_.use_sprt ? sprt_.RejectionProbability() : 0.0;
+  }
+
+ private:
+  // Score a model, and keep it if it is the best so far
+  bool ScoreModel(const Type& model) {
+    double score = 0;
+    if (!scorer_.template Score<MODEL>(
+            model, scored_samples_.begin(), scored_samples_.end(),
+            best_score_.score, &score, &buffers_,
+            params_.use_sprt ? &sprt_ : nullptr) ||
+        score < best_score_.score) {
+      if (params_.use_sprt) {
+        sprt_.AddRejectedModel(buffers_.inliers_indices.size(),
+                               buffers_.evaluated_count);
+      }
+      return false;
+    }
+    best_score_.score = score;
+    std::swap(best_score_.inliers_indices, buffers_.inliers_indices);
+    if (params_.use_sprt) {
+      sprt_.SetEpsilon(double(best_score_.inliers_indices.size()) /
+                       samples_.size());
+    }
+    improved_ = true;
+    return true;
+  }
+
+  const std::vector<Data>& samples_;
+  const std::vector<Data>& scored_samples_;
+  const SCORING& scorer_;
+  const RobustEstimatorParams& params_;
+
+  RandomSamplesGenerator<std::mt19937> random_generator_;
+  SprtTest sprt_;
+  ScoreInfo<Type> best_score_;
+  bool improved_{false};
+
+  // Buffers reused by all the hypotheses
+  std::vector<Data> random_samples_;
+  ScoringBuffers buffers_;
+};
+
+template <class SCORING, class MODEL>
+ScoreInfo<typename MODEL::Type> Estimate(
+    const std::vector<typename MODEL::Data>& samples, const SCORING& scorer,
+    const RobustEstimatorParams& params, const std::vector<double>& priors,
+    const std::vector<Eigen::Vector3d>& positions) {
+  using Stream = EstimationStream<SCORING, MODEL>;
+
+  // With SPRT, models are scored on the samples in a random order, so that
+  // a model is rejected after a random subset of them. Inliers indexes are
+  // then the ones of the shuffled samples until the end.
+  std::vector<int> scoring_order;
+  std::vector<typename MODEL::Data> shuffled_samples;
+  if (params.use_sprt) {
+    scoring_order.resize(samples.size());
+    std::iota(scoring_order.begin(), scoring_order.end(), 0);
+    std::shuffle(scoring_order.begin(), scoring_order.end(),
+                 std::mt19937(42));
+    shuffled_samples.reserve(samples.size());
+    for (const int idx : scoring_order) {
+      shuffled_samples.push_back(samples[idx]);
+    }
+  }
+  const auto& scored_samples = params.use_sprt ? shuffled_samples : samples;
+
+  ScoreInfo<typename MODEL::Type> best_score;
+  const int num_threads = std::max(params.num_threads, 1);
+  if (num_threads == 1) {
+    Stream stream(samples, scored_samples, scorer, params, 42);
+    stream.SetSampling(priors, positions, params.iterations);
+
+    // Based on actual inliers ratio, we might stop after any model
+    int iteration = 0;
+    const auto should_stop = [&](const Stream& stream) {
+      return ShouldStop<MODEL>(params, stream.BestScore(), samples.size(),
+                               iteration, stream.RejectionProbability());
+    };
+    for (; iteration < params.iterations; ++iteration) {
+      if (stream.RunIteration(should_stop)) {
+        break;
+      }
+    }
+    best_score = std::move(stream.BestScore());
+  } else {
+    // Each thread runs its own stream of random samples, seeded by its
+    // index, so that results only depend on the number of threads. Streams
+    // run batches of iterations from the best model so far, the best of the
+    // batch being then shared with all the streams.
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (int i = 0; i < num_threads; ++i) {
+      streams.push_back(std::make_unique<Stream>(samples, scored_samples,
+                                                 scorer, params, 42 + i));
+      streams.back()->SetSampling(
+          priors, positions, (params.iterations - 1) / num_threads + 1);
+    }
+
+    const int stream_batch_iterations = 4;
+    const auto never_stop = [](const Stream&) { return false; };
+    int iterations = 0;
+    bool should_stop = false;
+    while (iterations < params.iterations && !should_stop) {
+      const int batch_iterations =
+          std::min(stream_batch_iterations * num_threads,
+                   params.iterations - iterations);
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+      for (int i = 0; i < num_threads; ++i) {
+        auto& stream = *streams[i];
+        stream.SetBest(best_score);
+        for (int j = i; j < batch_iterations; j += num_threads) {
+          stream.RunIteration(never_stop);
+        }
+      }
+
+      // Streams are merged in order, ties replacing the best, as when run
+      // sequentially
+      for (auto& stream : streams) {
+        if (stream->Improved() &&
+            stream->BestScore().score >= best_score.score) {
+          std::swap(best_score, stream->BestScore());
+        }
+      }
+      iterations += batch_iterations;
+
+      // Streams verify hypotheses independently : the stopping criterion
+      // takes the most pessimistic of their rejection probabilities
+      double rejection_probability = 0.0;
+      for (const auto& stream : streams) {
+        rejection_probability =
+            std::max(rejection_probability, stream->RejectionProbability());
+      }
+      should_stop = ShouldStop<MODEL>(params, best_score, samples.size(),
+                                      iterations - 1, rejection_probability);
+    }
+  }
+
+  if (params.use_sprt) {
+    for (auto& idx : best_score.inliers_indices) {
+      idx = scoring_order[idx];
     }
+    std::sort(best_score.inliers_indices.begin(),
+              best_score.inliers_indices.end());
   }
   return best_score;
 }
@@ -121,20 +312,25 @@ enum RansacType { RANSAC = 0, MSAC = 1, LMedS = 2 };
 template <class MODEL>
 ScoreInfo<typename MODEL::Type> RunEstimation(
     const std::vector<typename MODEL::Data>& samples, double threshold,
-    const RobustEstimatorParams& parameters, const RansacType& ransac_type) {
+    const RobustEstimatorParams& parameters, const RansacType& ransac_type,
+    const std::vector<double>& priors = {},
+    const std::vector<Eigen::Vector3d>& positions = {}) {
   const double model_threshold = MODEL::ThresholdAdapter(threshold);
   switch (ransac_type) {
     case RANSAC: {
       RansacScoring scorer(model_threshold);
-      return Estimate<RansacScoring, MODEL>(samples, scorer, parameters);
+      return Estimate<RansacScoring, MODEL>(samples, scorer, parameters,
+                                            priors, positions);
     }
     case MSAC: {
       MSacScoring scorer(model_threshold);
-      return Estimate<MSacScoring, MODEL>(samples, scorer, parameters);
+      return Estimate<MSacScoring, MODEL>(samples, scorer, parameters,
+                                          priors, positions);
     }
     case LMedS: {
       LMedSScoring scorer(model_threshold);
-      return Estimate<LMedSScoring, MODEL>(samples, scorer, parameters);
+      return Estimate<LMedSScoring, MODEL>(samples, scorer, parameters,
+                                           priors, positions);
     }
     default:
       throw std::runtime_error("Unsupported RANSAC type.");
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 template <class MODEL, class LOMODEL = MODEL>
@@ -18,20 +20,128 @@ struct ScoreInfo {
   }
 };
 
+// Buffers reused by the scoring of the successive models of an estimation,
+// so that scoring doesn't allocate once they have grown
+struct ScoringBuffers {
+  std::vector<int> inliers_indices;
+  std::vector<double> norms;
+  std::vector<double> sorted_norms;
+  // Number of samples evaluated by the last scoring
+  int evaluated_count{0};
+};
+
+// Wald's sequential probability ratio test (SPRT) of models, as in "Optimal
+// Randomized RANSAC" (Chum, Matas). The samples being evaluated in a random
+// order, a model is rejected as soon as the likelihood ratio of it being bad
+// rather than good exceeds A. epsilon and delta are the probabilities of a
+// sample being consistent with a good and a bad model, and A is chosen to
+// minimize the verification time given the time to estimate the models of a
+// minimal sample, in samples evaluations.
+class SprtTest {
+ public:
+  SprtTest(double epsilon, double delta, double time_model)
+      : epsilon_(epsilon), delta_(delta), time_model_(time_model) {
+    Design();
+  }
+
+  // Update the likelihood ratio of a model with one more sample, returning
+  // false once the model is rejected
+  bool Update(bool consistent, double* lambda) const {
+    *lambda *= consistent ? ratio_consistent_ : ratio_inconsistent_;
+    return *lambda <= A_;
+  }
+
+  // epsilon is the inliers ratio of the best model so far
+  void SetEpsilon(double epsilon) {
+    epsilon_ = epsilon;
+    Design();
+  }
+
+  // delta is estimated from the samples consistent with the rejected models
+  void AddRejectedModel(int consistent_count, int evaluated_count) {
+    rejected_consistent_ += consistent_count;
+    rejected_evaluated_ += evaluated_count;
+    if (rejected_evaluated_ == 0) {
+      return;
+    }
+    const double eps = 1e-4;
+    const double delta =
+        std::max(eps, rejected_consistent_ / rejected_evaluated_);
+    if (std::abs(delta - delta_) > 0.05 * delta_) {
+      delta_ = delta;
+      Design();
+    }
+  }
+
+  // Probability of rejecting a good model
+  double RejectionProbability() const { return 1.0 / A_; }
+
+ private:
+  void Design() {
+    // Good models can't be told apart from bad ones
+    if (delta_ >= epsilon_) {
+      A_ = std::numeric_limits<double>::infinity();
+      ratio_consistent_ = ratio_inconsistent_ = 1.0;
+      return;
+    }
+    ratio_consistent_ = delta_ / epsilon_;
+    ratio_inconsistent_ = (1.0 - delta_) / (1.0 - epsilon_);
+
+    // A is the fixed point of A = K + log(A)
+    const double C = (1.0 - delta_) * std::log(ratio_inconsistent_) +
+                     delta_ * std::log(ratio_consistent_);
+    const double K = time_model_ * C + 1.0;
+    A_ = K;
+    for (int i = 0; i < 10; ++i) {
+      A_ = K + std::log(A_);
+    }
+  }
+
+  double epsilon_{0};
+  double delta_{0};
+  double time_model_{0};
+  double rejected_consistent_{0};
+  double rejected_evaluated_{0};
+
+  double A_{0};
+  double ratio_consistent_{1};
+  double ratio_inconsistent_{1};
+};
+
+// Scorers evaluate a model on the samples and score it in a single pass.
+// Score returns false as soon as the model can't reach best_score or is
+// rejected by the optional SPRT, the score and inliers being then incomplete.
+// Otherwise, the score is written and buffers->inliers_indices holds the
+// indexes of the inliers.
+
 class RansacScoring {
  public:
   RansacScoring(double threshold) : threshold_(threshold) {}
 
-  template <class IT, class T>
-  ScoreInfo<T> Score(IT begin, IT end, const ScoreInfo<T>& best_score) const {
-    ScoreInfo<T> score;
-    for (IT it = begin; it != end; ++it) {
-      if (it->norm() < threshold_) {
-        ++score.score;
-        score.inliers_indices.push_back(int(it - begin));
+  template <class MODEL, class IT>
+  bool Score(const typename MODEL::Type& model, IT begin, IT end,
+             double best_score, double* score, ScoringBuffers* buffers,
+             const SprtTest* sprt = nullptr) const {
+    auto& inliers = buffers->inliers_indices;
+    inliers.clear();
+    double lambda = 1.0;
+    const int count = end - begin;
+    for (int i = 0; i < count; ++i, ++begin) {
+      const bool consistent =
+          MODEL::Evaluate(model, *begin).norm() < threshold_;
+      if (consistent) {
+        inliers.push_back(i);
+      }
+      if ((!consistent &&
+           int(inliers.size()) + (count - i - 1) < best_score) ||
+          (sprt && !sprt->Update(consistent, &lambda))) {
+        buffers->evaluated_count = i + 1;
+        return false;
       }
     }
-    return score;
+    buffers->evaluated_count = count;
+    *score = inliers.size();
+    return true;
   }
   double threshold_{0};
 };
@@ -41,16 +151,11 @@ class MedianBasedScoring {
   MedianBasedScoring() = default;
   MedianBasedScoring(double nth) : nth_(nth) {}
 
-  template <class IT>
-  double ComputeMedian(IT begin, IT end) const {
-    const int count = (end - begin);
-    const int median_index = count * nth_;
-    std::vector<double> norms(count);
-    for (IT it = begin; it != end; ++it) {
-      norms[(it - begin)] = it->norm();
-    }
-    std::nth_element(norms.begin(), norms.begin() + median_index, norms.end());
-    return norms[median_index];
+  double ComputeMedian(std::vector<double>* norms) const {
+    const int median_index = norms->size() * nth_;
+    std::nth_element(norms->begin(), norms->begin() + median_index,
+                     norms->end());
+    return (*norms)[median_index];
   }
 
  protected:
@@ -61,22 +166,37 @@ class MSacScoring {
  public:
   MSacScoring(double threshold) : threshold_(threshold) {}
 
-  template <class IT, class T>
-  ScoreInfo<T> Score(IT begin, IT end, const ScoreInfo<T>& best_score) const {
-    ScoreInfo<T> score;
-    for (IT it = begin; it != end; ++it) {
-      const auto v = (*it).norm();
-      const int index = int(it - begin);
-      if (v <= threshold_) {
-        score.score += v * v;
-        score.inliers_indices.push_back(index);
+  template <class MODEL, class IT>
+  bool Score(const typename MODEL::Type& model, IT begin, IT end,
+             double best_score, double* score, ScoringBuffers* buffers,
+             const SprtTest* sprt = nullptr) const {
+    const double eps = 1e-8;
+    // Cost above which the score is below best_score
+    const double max_cost = 1.0 / best_score - eps;
+
+    auto& inliers = buffers->inliers_indices;
+    inliers.clear();
+    double cost = 0;
+    double lambda = 1.0;
+    const int count = end - begin;
+    for (int i = 0; i < count; ++i, ++begin) {
+      const auto v = MODEL::Evaluate(model, *begin).norm();
+      const bool consistent = v <= threshold_;
+      if (consistent) {
+        cost += v * v;
+        inliers.push_back(i);
       } else {
-        score.score += threshold_ * threshold_;
+        cost += threshold_ * threshold_;
+      }
+      if ((cost > max_cost && 1.0 / (cost + eps) < best_score) ||
+          (sprt && !sprt->Update(consistent, &lambda))) {
+        buffers->evaluated_count = i + 1;
+        return false;
       }
     }
-    const double eps = 1e-8;
-    score.score = 1.0 / (score.score + eps);
-    return score;
+    buffers->evaluated_count = count;
+    *score = 1.0 / (cost + eps);
+    return true;
   }
   double threshold_{0};
 };
@@ -86,21 +206,37 @@ class LMedSScoring : public MedianBasedScoring {
   LMedSScoring(double multiplier)
       : MedianBasedScoring(0.5), multiplier_(multiplier) {}
 
-  template <class IT, class T>
-  ScoreInfo<T> Score(IT begin, IT end, const ScoreInfo<T>& best_score) const {
-    const auto median = this->ComputeMedian(begin, end);
+  // Median-based scores don't use a threshold, so the SPRT isn't applied
+  template <class MODEL, class IT>
+  bool Score(const typename MODEL::Type& model, IT begin, IT end,
+             double best_score, double* score, ScoringBuffers* buffers,
+             const SprtTest* /*sprt*/ = nullptr) const {
+    auto& norms = buffers->norms;
+    norms.clear();
+    for (IT it = begin; it != end; ++it) {
+      norms.push_back(MODEL::Evaluate(model, *it).norm());
+    }
+    buffers->evaluated_count = norms.size();
+    auto& inliers = buffers->inliers_indices;
+    inliers.clear();
+    if (norms.empty()) {
+      *score = 0;
+      return true;
+    }
+
+    auto& sorted_norms = buffers->sorted_norms;
+    sorted_norms.assign(norms.begin(), norms.end());
+    const auto median = this->ComputeMedian(&sorted_norms);
     const auto mad = 1.4826 * median;
     const auto threshold = this->multiplier_ * mad;
-    ScoreInfo<T> score;
-    for (IT it = begin; it != end; ++it) {
-      const auto v = it->norm();
-      if (v <= threshold) {
-        score.inliers_indices.push_back(int(it - begin));
+    for (int i = 0; i < norms.size(); ++i) {
+      if (norms[i] <= threshold) {
+        inliers.push_back(i);
       }
     }
     const double eps = 1e-8;
-    score.score = 1.0 / (median + eps);
-    return score;
+    *score = 1.0 / (median + eps);
+    return true;
   }
 
   double multiplier_;
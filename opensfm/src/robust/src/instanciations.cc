@@ -1,6 +1,29 @@
 #include <robust/instanciations.h>
 
 namespace robust {
+namespace {
+std::vector<double> SamplesPriors(const Eigen::VectorXd& priors,
+                                  int samples_count) {
+  if (priors.size() > 0 && priors.size() != samples_count) {
+    throw std::runtime_error("Priors and features have different sizes.");
+  }
+  return std::vector<double>(priors.data(), priors.data() + priors.size());
+}
+
+std::vector<Eigen::Vector3d> SamplesPositions(
+    const Eigen::Matrix<double, -1, 3>& bearings,
+    const RobustEstimatorParams& parameters) {
+  std::vector<Eigen::Vector3d> positions;
+  if (parameters.sampling == NAPSAC) {
+    positions.resize(bearings.rows());
+    for (int i = 0; i < bearings.rows(); ++i) {
+      positions[i] = bearings.row(i).normalized();
+    }
+  }
+  return positions;
+}
+}  // namespace
+
 ScoreInfo<Line::Type> RANSACLine(const Eigen::Matrix<double, -1, 2>& points,
                                  double threshold,
                                  const RobustEstimatorParams& parameters,
@@ -16,7 +39,8 @@ using EssentialMatrixModel = EssentialMatrix<EpipolarGeodesic>;
 ScoreInfo<EssentialMatrixModel::Type> RANSACEssential(
     const Eigen::Matrix<double, -1, 3>& x1,
     const Eigen::Matrix<double, -1, 3>& x2, double threshold,
-    const RobustEstimatorParams& parameters, const RansacType& ransac_type) {
+    const RobustEstimatorParams& parameters, const RansacType& ransac_type,
+    const Eigen::VectorXd& priors) {
   if ((x1.cols() != x2.cols()) || (x1.rows() != x2.rows())) {
     throw std::runtime_error("Features matrices have different sizes.");
   }
@@ -26,14 +50,16 @@ ScoreInfo<EssentialMatrixModel::Type> RANSACEssential(
     samples[i].first = x1.row(i);
     samples[i].second = x2.row(i);
   }
-  return RunEstimation<EssentialMatrixModel>(samples, threshold, parameters,
-                                             ransac_type);
+  return RunEstimation<EssentialMatrixModel>(
+      samples, threshold, parameters, ransac_type,
+      SamplesPriors(priors, samples.size()), SamplesPositions(x1, parameters));
 }
 
 ScoreInfo<RelativePose::Type> RANSACRelativePose(
     const Eigen::Matrix<double, -1, 3>& x1,
     const Eigen::Matrix<double, -1, 3>& x2, double threshold,
-    const RobustEstimatorParams& parameters, const RansacType& ransac_type) {
+    const RobustEstimatorParams& parameters, const RansacType& ransac_type,
+    const Eigen::VectorXd& priors) {
   if ((x1.cols() != x2.cols()) || (x1.rows() != x2.rows())) {
     throw std::runtime_error("Features matrices have different sizes.");
   }
@@ -43,8 +69,9 @@ ScoreInfo<RelativePose::Type> RANSACRelativePose(
     samples[i].first = x1.row(i);
     samples[i].second = x2.row(i);
   }
-  return RunEstimation<RelativePose>(samples, threshold, parameters,
-                                     ransac_type);
+  return RunEstimation<RelativePose>(
+      samples, threshold, parameters, ransac_type,
+      SamplesPriors(priors, samples.size()), SamplesPositions(x1, parameters));
 }
 
 ScoreInfo<RelativeRotation::Type> RANSACRelativeRotation(
@@ -67,7 +94,8 @@ ScoreInfo<RelativeRotation::Type> RANSACRelativeRotation(
 ScoreInfo<AbsolutePose::Type> RANSACAbsolutePose(
     const Eigen::Matrix<double, -1, 3>& bearings,
     const Eigen::Matrix<double, -1, 3>& points, double threshold,
-    const RobustEstimatorParams& parameters, const RansacType& ransac_type) {
+    const RobustEstimatorParams& parameters, const RansacType& ransac_type,
+    const Eigen::VectorXd& priors) {
   if ((bearings.cols() != points.cols()) ||
       (bearings.rows() != points.rows())) {
     throw std::runtime_error("Features matrices have different sizes.");
@@ -78,8 +106,10 @@ ScoreInfo<AbsolutePose::Type> RANSACAbsolutePose(
     samples[i].first = bearings.row(i).normalized();
     samples[i].second = points.row(i);
   }
-  return RunEstimation<AbsolutePose>(samples, threshold, parameters,
-                                     ransac_type);
+  return RunEstimation<AbsolutePose>(
+      samples, threshold, parameters, ransac_type,
+      SamplesPriors(priors, samples.size()),
+      SamplesPositions(bearings, parameters));
 }
 
 ScoreInfo<AbsolutePoseKnownRotation::Type> RANSACAbsolutePoseKnownRotation(
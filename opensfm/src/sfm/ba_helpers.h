@@ -6,10 +6,22 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace py = pybind11;
 namespace sfm {
 class GroundControlPoint;
+
+// Point projection observations of a whole map, with shots indexes into
+// shots and points indexes into points
+struct MapObservations {
+  const map::Map* map{nullptr};
+  size_t structure_revision{0};
+  std::vector<const map::Shot*> shots;
+  std::vector<const map::Landmark*> points;
+  bundle::PointProjectionObservations observations;
+};
+
 class BAHelpers {
  public:
   static py::dict Bundle(
@@ -28,6 +40,27 @@ class BAHelpers {
       const AlignedVector<map::GroundControlPoint>& gcp,
       const map::ShotId& central_shot_id, const py::dict& config);
 
+  // Bundle adjustment of a large map by parts, without ground control
+  // points nor GPS bias compensation. The rig instances are partitioned
+  // into clusters of covisible shots which, with the separator points seen
+  // by several clusters fixed, are independent and adjusted in parallel.
+  // This alternates with the adjustment of the separator points along with
+  // the instances observing them, until the latter barely decreases the
+  // cost. Rig cameras are fixed, cameras are only adjusted with separators.
+  static py::dict BundlePartitioned(
+      map::Map& map,
+      const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
+      const std::unordered_map<map::RigCameraId, map::RigCamera>&
+          rig_camera_priors,
+      const py::dict& config);
+
+  // Partition of the rig instances in clusters of at most max_shots shots,
+  // unless a single instance has more. Clusters are grown from a seed by
+  // adding the instance having the most observations of points in common
+  // with the cluster.
+  static std::vector<std::vector<map::RigInstanceId>> PartitionRigInstances(
+      const map::Map& map, size_t max_shots);
+
   static py::dict BundleShotPoses(
       map::Map& map, const std::unordered_set<map::ShotId>& shot_ids,
       const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
@@ -57,6 +90,19 @@ class BAHelpers {
       const AlignedVector<map::GroundControlPoint>& gcp,
       const py::dict& config);
 
+  // Gather the observations of a map, shots being processed in parallel.
+  // The observations are left as is if they were gathered for the same
+  // structure of the map, so that callers keeping them across bundles of a
+  // reconstruction whose poses or points only moved reuse them.
+  static void GatherMapObservations(const map::Map& map, int num_threads,
+                                    MapObservations& observations);
+
+  // Add a rig instance with the average GPS position of its shots as prior
+  static void AddRigInstanceToBundle(bundle::BundleAdjuster& ba,
+                                     const map::Map& map,
+                                     const map::RigInstance& instance,
+                                     bool use_gps, bool constant);
+
  private:
   static std::unordered_set<map::Shot*> DirectShotNeighbors(
       map::Map& map, const std::unordered_set<map::Shot*>& shot_ids,
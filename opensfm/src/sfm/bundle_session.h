@@ -0,0 +1,55 @@
+#pragma once
+#include <bundle/bundle_adjuster.h>
+#include <map/map.h>
+#include <pybind11/pybind11.h>
+#include <sfm/ba_helpers.h>
+
+#include <memory>
+#include <unordered_map>
+
+namespace py = pybind11;
+namespace sfm {
+
+// Bundle adjustments of a reconstruction being grown. The same adjuster, and
+// its ceres problem, are kept across bundles and synchronized with the map :
+// the residual blocks of new observations are added, the ones of removed
+// observations (outliers) are removed, and local bundles switch the parameter
+// blocks outside of their neighborhood to constant, which leaves their
+// observations out of the problem.
+class BundleSession {
+ public:
+  BundleSession(
+      map::Map& map,
+      const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
+      const std::unordered_map<map::RigCameraId, map::RigCamera>&
+          rig_camera_priors);
+
+  // Same as BAHelpers::Bundle, without ground control points
+  py::dict Bundle(const py::dict& config);
+
+  // Same as BAHelpers::BundleLocal, without ground control points. The
+  // observations of the shots of moving rig instances outside of the
+  // neighborhood are adjusted too, where BAHelpers leaves them out.
+  py::tuple BundleLocal(const map::ShotId& central_shot_id,
+                        const py::dict& config);
+
+ private:
+  // Add the cameras, rig cameras, rig instances and points missing from the
+  // adjuster, as constant, and update its observations if the structure of
+  // the map changed. Instances can't be removed from the adjuster, which is
+  // rebuilt if some of them disappeared or changed.
+  void Update(const py::dict& config);
+  void SetOptions(const py::dict& config);
+
+  map::Map& map_;
+  std::unordered_map<map::CameraId, geometry::Camera> camera_priors_;
+  std::unordered_map<map::RigCameraId, map::RigCamera> rig_camera_priors_;
+
+  std::unique_ptr<bundle::BundleAdjuster> ba_;
+  // Observations of the map, kept until its structure changes
+  MapObservations map_observations_;
+  // Structure revision of the map the observations were set for
+  size_t structure_revision_{0};
+  std::unordered_map<map::RigInstanceId, size_t> instances_shots_count_;
+};
+}  // namespace sfm
@@ -10,14 +10,17 @@
 # Ignore errors for [5] global variable types and [24] untyped generics.
 # pyre-ignore-all-errors[5,24]
 
+import numpy
 import opensfm.pybundle
 import opensfm.pygeometry
 import opensfm.pymap
 from typing import *
 __all__  = [
 "BAHelpers",
+"BundleSession",
 "add_connections",
 "count_tracks_per_shot",
+"create_tracks_manager",
 "realign_maps",
 "remove_connections"
 ]
@@ -29,14 +32,23 @@ class BAHelpers:
     @staticmethod
     def bundle_local(arg0: opensfm.pymap.Map, arg1: Dict[str, opensfm.pygeometry.Camera], arg2: Dict[str, opensfm.pymap.RigCamera], arg3: List[opensfm.pymap.GroundControlPoint], arg4: str, arg5: dict) -> tuple: ...
     @staticmethod
+    def bundle_partitioned(arg0: opensfm.pymap.Map, arg1: Dict[str, opensfm.pygeometry.Camera], arg2: Dict[str, opensfm.pymap.RigCamera], arg3: dict) -> dict: ...
+    @staticmethod
     def bundle_shot_poses(arg0: opensfm.pymap.Map, arg1: Set[str], arg2: Dict[str, opensfm.pygeometry.Camera], arg3: Dict[str, opensfm.pymap.RigCamera], arg4: dict) -> dict: ...
     @staticmethod
     def bundle_to_map(arg0: opensfm.pybundle.BundleAdjuster, arg1: opensfm.pymap.Map, arg2: bool) -> None: ...
     @staticmethod
     def detect_alignment_constraints(arg0: opensfm.pymap.Map, arg1: dict, arg2: List[opensfm.pymap.GroundControlPoint]) -> str: ...
     @staticmethod
+    def partition_rig_instances(arg0: opensfm.pymap.Map, arg1: int) -> List[List[str]]: ...
+    @staticmethod
     def shot_neighborhood_ids(arg0: opensfm.pymap.Map, arg1: str, arg2: int, arg3: int, arg4: int) -> Tuple[Set[str], Set[str]]: ...
+class BundleSession:
+    def __init__(self, arg0: opensfm.pymap.Map, arg1: Dict[str, opensfm.pygeometry.Camera], arg2: Dict[str, opensfm.pymap.RigCamera]) -> None: ...
+    def bundle(self, arg0: dict) -> dict: ...
+    def bundle_local(self, arg0: str, arg1: dict) -> tuple: ...
 def add_connections(arg0: opensfm.pymap.TracksManager, arg1: str, arg2: List[str]) -> None:...
 def count_tracks_per_shot(arg0: opensfm.pymap.TracksManager, arg1: List[str], arg2: List[str]) -> Dict[str, int]:...
+def create_tracks_manager(arg0: List[str], arg1: List[numpy.ndarray[numpy.float32]], arg2: List[numpy.ndarray[numpy.int32]], arg3: List[numpy.ndarray[numpy.int32]], arg4: List[numpy.ndarray[numpy.int32]], arg5: List[numpy.ndarray[numpy.float32]], arg6: List[Tuple[int, int]], arg7: List[numpy.ndarray[numpy.int32]], arg8: int, arg9: bool, arg10: float) -> opensfm.pymap.TracksManager:...
 def realign_maps(arg0: opensfm.pymap.Map, arg1: opensfm.pymap.Map, arg2: bool) -> None:...
 def remove_connections(arg0: opensfm.pymap.TracksManager, arg1: str, arg2: List[str]) -> None:...
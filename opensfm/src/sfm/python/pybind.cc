@@ -5,6 +5,7 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <sfm/ba_helpers.h>
+#include <sfm/bundle_session.h>
 #include <sfm/retriangulation.h>
 #include <sfm/tracks_helpers.h>
 
@@ -20,10 +21,74 @@ PYBIND11_MODULE(pysfm, m) {
         py::call_guard<py::gil_scoped_release>());
   m.def("remove_connections", &sfm::tracks_helpers::RemoveConnections,
         py::call_guard<py::gil_scoped_release>());
+  m.def(
+      "create_tracks_manager",
+      [](const std::vector<map::ShotId> &images,
+         const std::vector<foundation::pyarray_f> &points,
+         const std::vector<foundation::pyarray_int> &colors,
+         const std::vector<foundation::pyarray_int> &segmentations,
+         const std::vector<foundation::pyarray_int> &instances,
+         const std::vector<foundation::pyarray_f> &depths,
+         const std::vector<std::pair<int, int>> &matches_images,
+         const std::vector<foundation::pyarray_int> &matches, int min_length,
+         bool depth_is_radial, double depth_std_deviation) {
+        const auto size = images.size();
+        if (points.size() != size || colors.size() != size ||
+            segmentations.size() != size || instances.size() != size ||
+            depths.size() != size || matches_images.size() != matches.size()) {
+          throw std::runtime_error("Inconsistent features or matches counts");
+        }
+
+        // Empty arrays stand for missing data
+        std::vector<sfm::tracks_helpers::ImageFeatures> features(size);
+        for (size_t i = 0; i < size; ++i) {
+          auto &image = features[i];
+          if (points[i].size() == 0) {
+            continue;
+          }
+          image.num_features = points[i].shape(0);
+          const auto n = static_cast<py::ssize_t>(image.num_features);
+          if (points[i].size() != 3 * n || colors[i].size() != 3 * n) {
+            throw std::runtime_error("Points and colors must be N x 3");
+          }
+          image.points = points[i].data();
+          image.colors = colors[i].data();
+          if (segmentations[i].size() == n) {
+            image.segmentations = segmentations[i].data();
+          }
+          if (instances[i].size() == n) {
+            image.instances = instances[i].data();
+          }
+          if (depths[i].size() == n) {
+            image.depths = depths[i].data();
+          }
+        }
+
+        std::vector<sfm::tracks_helpers::ImagesMatches> images_matches(
+            matches.size());
+        for (size_t i = 0; i < matches.size(); ++i) {
+          if (matches[i].size() % 2 != 0) {
+            throw std::runtime_error("Matches must be M x 2");
+          }
+          auto &pair = images_matches[i];
+          pair.image1 = matches_images[i].first;
+          pair.image2 = matches_images[i].second;
+          pair.num_matches = matches[i].size() / 2;
+          pair.matches = matches[i].data();
+        }
+
+        py::gil_scoped_release release;
+        return sfm::tracks_helpers::CreateTracksManager(
+            images, features, images_matches, min_length, depth_is_radial,
+            depth_std_deviation);
+      });
 
   py::class_<sfm::BAHelpers>(m, "BAHelpers")
       .def_static("bundle", &sfm::BAHelpers::Bundle)
       .def_static("bundle_local", &sfm::BAHelpers::BundleLocal)
+      .def_static("bundle_partitioned", &sfm::BAHelpers::BundlePartitioned)
+      .def_static("partition_rig_instances",
+                  &sfm::BAHelpers::PartitionRigInstances)
       .def_static("bundle_shot_poses", &sfm::BAHelpers::BundleShotPoses)
       .def_static("bundle_to_map", &sfm::BAHelpers::BundleToMap)
       .def_static("shot_neighborhood_ids", &sfm::BAHelpers::ShotNeighborhoodIds)
@@ -31,6 +96,15 @@ PYBIND11_MODULE(pysfm, m) {
                   &sfm::BAHelpers::DetectAlignmentConstraints)
       .def_static("add_gcp_to_bundle", &sfm::BAHelpers::AddGCPToBundle);
 
+  py::class_<sfm::BundleSession>(m, "BundleSession")
+      .def(py::init<
+               map::Map &,
+               const std::unordered_map<map::CameraId, geometry::Camera> &,
+               const std::unordered_map<map::RigCameraId, map::RigCamera> &>(),
+           py::keep_alive<1, 2>())
+      .def("bundle", &sfm::BundleSession::Bundle)
+      .def("bundle_local", &sfm::BundleSession::BundleLocal);
+
   m.def("realign_maps", &sfm::retriangulation::RealignMaps,
         py::call_guard<py::gil_scoped_release>());
 }
@@ -5,14 +5,155 @@
 #include <map/map.h>
 #include <sfm/ba_helpers.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <memory>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "geo/geo.h"
 #include "map/defines.h"
 
+namespace {
+// Adjustment of some rig instances of a map and of some of the points they
+// observe, the other points being fixed
+struct PartBundle {
+  std::unique_ptr<bundle::BundleAdjuster> ba;
+  std::vector<map::RigInstanceId> instances;
+  std::vector<map::LandmarkId> points;
+  std::vector<map::CameraId> cameras;
+};
+
+PartBundle CreatePartBundle(
+    const map::Map& map,
+    const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
+    const std::unordered_map<map::RigCameraId, map::RigCamera>&
+        rig_camera_priors,
+    const std::vector<map::RigInstanceId>& instances,
+    const std::unordered_set<const map::Landmark*>& separators,
+    bool adjust_separators, bool fix_cameras, const Vec3d& up_vector,
+    const py::dict& config, int num_threads) {
+  PartBundle part;
+  part.ba = std::make_unique<bundle::BundleAdjuster>();
+  part.instances = instances;
+  auto& ba = *part.ba;
+  ba.SetUseAnalyticDerivatives(
+      config["bundle_analytic_derivatives"].cast<bool>());
+  ba.SetNumThreads(num_threads);
+
+  std::set<map::CameraId> cameras_ids;
+  std::set<map::RigCameraId> rig_cameras_ids;
+  for (const auto& instance_id : instances) {
+    const auto& instance = map.GetRigInstance(instance_id);
+    for (const auto& shot_n_rig_camera : instance.GetRigCameras()) {
+      cameras_ids.insert(map.GetShot(shot_n_rig_camera.first).GetCamera()->id);
+      rig_cameras_ids.insert(shot_n_rig_camera.second->id);
+    }
+  }
+  for (const auto& camera_id : cameras_ids) {
+    ba.AddCamera(camera_id, map.GetCameras().at(camera_id),
+                 camera_priors.at(camera_id), fix_cameras);
+    part.cameras.push_back(camera_id);
+  }
+  constexpr bool fix_rig_cameras{true};
+  for (const auto& rig_camera_id : rig_cameras_ids) {
+    ba.AddRigCamera(rig_camera_id, map.GetRigCameras().at(rig_camera_id).pose,
+                    rig_camera_priors.at(rig_camera_id).pose,
+                    fix_rig_cameras);
+  }
+
+  const bool use_gps = config["bundle_use_gps"].cast<bool>();
+  constexpr bool fix_instances{false};
+  for (const auto& instance_id : instances) {
+    sfm::BAHelpers::AddRigInstanceToBundle(
+        ba, map, map.GetRigInstance(instance_id), use_gps, fix_instances);
+  }
+
+  std::unordered_map<const map::Landmark*, int> points;
+  for (const auto& instance_id : instances) {
+    for (const auto& shot_pair : map.GetRigInstance(instance_id).GetShots()) {
+      const int shot_index = ba.GetShotIndex(shot_pair.first);
+      if (!up_vector.isZero()) {
+        constexpr double std_dev = 1e-3;
+        ba.AddAbsoluteUpVector(shot_pair.first, up_vector, std_dev);
+      }
+      for (const auto& lm_obs : shot_pair.second->GetLandmarkObservations()) {
+        const auto* lm = lm_obs.first;
+        auto point = points.find(lm);
+        if (point == points.end()) {
+          const bool is_separator = separators.count(lm) > 0;
+          const bool fix_point = is_separator != adjust_separators;
+          const int point_index =
+              ba.AddPoint(lm->id_, lm->GetGlobalPos(), fix_point);
+          point = points.emplace(lm, point_index).first;
+          if (!fix_point) {
+            part.points.push_back(lm->id_);
+          }
+        }
+        const auto& obs = lm_obs.second;
+        ba.AddPointProjectionObservation(shot_index, point->second, obs.point,
+                                         obs.scale, obs.depth_prior);
+      }
+    }
+  }
+
+  ba.SetPointProjectionLossFunction(
+      config["loss_function"].cast<std::string>(),
+      config["loss_function_threshold"].cast<double>());
+  ba.SetInternalParametersPriorSD(
+      config["exif_focal_sd"].cast<double>(),
+      config["principal_point_sd"].cast<double>(),
+      config["radial_distortion_k1_sd"].cast<double>(),
+      config["radial_distortion_k2_sd"].cast<double>(),
+      config["tangential_distortion_p1_sd"].cast<double>(),
+      config["tangential_distortion_p2_sd"].cast<double>(),
+      config["radial_distortion_k3_sd"].cast<double>(),
+      config["radial_distortion_k4_sd"].cast<double>());
+  ba.SetRigParametersPriorSD(config["rig_translation_sd"].cast<double>(),
+                             config["rig_rotation_sd"].cast<double>());
+  ba.SetMaxNumIterations(config["bundle_max_iterations"].cast<int>());
+  ba.SetLinearSolverType("SPARSE_SCHUR");
+  return part;
+}
+
+void PartBundleToMap(const PartBundle& part, bool update_cameras,
+                     map::Map& map) {
+  const auto& ba = *part.ba;
+  if (update_cameras) {
+    for (const auto& camera_id : part.cameras) {
+      auto& camera = map.GetCameras().at(camera_id);
+      for (const auto& p : ba.GetCamera(camera_id).GetParametersMap()) {
+        camera.SetParameterValue(p.first, p.second);
+      }
+    }
+  }
+  for (const auto& instance_id : part.instances) {
+    const auto new_instance = ba.GetRigInstance(instance_id).GetValue();
+    if (!new_instance.IsValid()) {
+      throw std::runtime_error("Rig Instance " + instance_id +
+                               " has either NaN or INF values.");
+    }
+    map.GetRigInstance(instance_id).SetPose(new_instance);
+  }
+  const auto errors = ba.GetReprojectionErrors();
+  for (const auto& point_id : part.points) {
+    const int point_index = ba.GetPointIndex(point_id);
+    const auto& pt = ba.GetPoint(point_index);
+    if (!pt.GetValue().allFinite()) {
+      throw std::runtime_error("Point " + point_id +
+                               " has either NaN or INF values.");
+    }
+    auto& point = map.GetLandmark(point_id);
+    point.SetGlobalPos(pt.GetValue());
+    const auto range = ba.GetPointReprojectionErrorsRange(point_index);
+    point.SetReprojectionErrors(errors, range.first, range.second);
+  }
+}
+}  // namespace
+
 namespace sfm {
 std::pair<std::unordered_set<map::ShotId>, std::unordered_set<map::ShotId>>
 BAHelpers::ShotNeighborhoodIds(map::Map& map,
@@ -113,6 +254,101 @@ std::unordered_set<map::Shot*> BAHelpers::DirectShotNeighbors(
   return neighbors;
 }
 
+void BAHelpers::GatherMapObservations(const map::Map& map, int num_threads,
+                                      MapObservations& observations) {
+  if (observations.map == &map &&
+      observations.structure_revision == map.GetStructureRevision()) {
+    return;
+  }
+
+  MapObservations gathered;
+  gathered.map = &map;
+  gathered.structure_revision = map.GetStructureRevision();
+
+  std::unordered_map<const map::Landmark*, int> points_indexes;
+  points_indexes.reserve(map.GetLandmarks().size());
+  for (const auto& lm_pair : map.GetLandmarks()) {
+    points_indexes[&lm_pair.second] = gathered.points.size();
+    gathered.points.push_back(&lm_pair.second);
+  }
+
+  std::vector<int> offsets(1, 0);
+  for (const auto& shot_pair : map.GetShots()) {
+    gathered.shots.push_back(&shot_pair.second);
+    offsets.push_back(offsets.back() +
+                      shot_pair.second.GetLandmarkObservations().size());
+  }
+
+  auto& projections = gathered.observations;
+  const int count = offsets.back();
+  projections.shots.resize(count);
+  projections.points.resize(count);
+  projections.coordinates.resize(count);
+  projections.std_deviations.resize(count);
+  projections.depth_priors.resize(count);
+#pragma omp parallel for schedule(dynamic) num_threads(std::max(num_threads, 1))
+  for (int i = 0; i < gathered.shots.size(); ++i) {
+    int j = offsets[i];
+    for (const auto& lm_obs : gathered.shots[i]->GetLandmarkObservations()) {
+      const auto& obs = lm_obs.second;
+      projections.shots[j] = i;
+      projections.points[j] = points_indexes.at(lm_obs.first);
+      projections.coordinates[j] = obs.point;
+      projections.std_deviations[j] = obs.scale;
+      projections.depth_priors[j] = obs.depth_prior;
+      ++j;
+    }
+  }
+
+  observations = std::move(gathered);
+}
+void BAHelpers::AddRigInstanceToBundle(bundle::BundleAdjuster& ba,
+                                       const map::Map& map,
+                                       const map::RigInstance& instance,
+                                       bool use_gps, bool constant) {
+  Vec3d average_position = Vec3d::Zero();
+  double average_std = 0.;
+  int gps_count = 0;
+
+  // average GPS and assign GPS constraint to the instance
+  std::unordered_map<std::string, std::string> shot_cameras, shot_rig_cameras;
+  for (const auto& shot_n_rig_camera : instance.GetRigCameras()) {
+    const auto shot_id = shot_n_rig_camera.first;
+    const auto& shot = map.GetShot(shot_id);
+    shot_cameras[shot_id] = shot.GetCamera()->id;
+    shot_rig_cameras[shot_id] = shot_n_rig_camera.second->id;
+
+    if (use_gps) {
+      const auto pos = shot.GetShotMeasurements().gps_position_;
+      const auto acc = shot.GetShotMeasurements().gps_accuracy_;
+      if (pos.HasValue() && acc.HasValue()) {
+        if (acc.Value() <= 0) {
+          throw std::runtime_error(
+              "Shot " + shot.GetId() +
+              " has an accuracy <= 0: " + std::to_string(acc.Value()) +
+              ". Try modifying "
+              "your input parser to filter such values.");
+        }
+        average_position += pos.Value();
+        average_std += acc.Value();
+        ++gps_count;
+      }
+    }
+  }
+
+  ba.AddRigInstance(instance.id, instance.GetPose(), shot_cameras,
+                    shot_rig_cameras, constant);
+
+  if (use_gps && gps_count > 0) {
+    const std::string gps_scale_group = "dummy";  // unused for now
+    average_position /= gps_count;
+    average_std /= gps_count;
+    ba.AddRigInstancePositionPrior(instance.id, average_position,
+                                   Vec3d::Constant(average_std),
+                                   gps_scale_group);
+  }
+}
+
 py::tuple BAHelpers::BundleLocal(
     map::Map& map,
     const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
@@ -144,7 +380,7 @@ py::tuple BAHelpers::BundleLocal(
   std::unordered_set<map::Shot*> int_and_bound(interior.cbegin(),
                                                interior.cend());
   int_and_bound.insert(boundary.cbegin(), boundary.cend());
-  std::unordered_set<map::Landmark*> points;
+  std::unordered_map<map::Landmark*, int> points;
   py::list pt_ids;
 
   constexpr bool point_constant{false};
@@ -220,27 +456,31 @@ py::tuple BAHelpers::BundleLocal(
   size_t added_reprojections = 0;
   for (auto* shot : interior) {
     // Add all points of the shots that are in the interior
+    const int shot_index = ba.GetShotIndex(shot->id_);
     for (const auto& lm_obs : shot->GetLandmarkObservations()) {
       auto* lm = lm_obs.first;
-      if (points.count(lm) == 0) {
-        points.insert(lm);
+      auto point = points.find(lm);
+      if (point == points.end()) {
         pt_ids.append(lm->id_);
-        ba.AddPoint(lm->id_, lm->GetGlobalPos(), point_constant);
+        const int point_index =
+            ba.AddPoint(lm->id_, lm->GetGlobalPos(), point_constant);
+        point = points.emplace(lm, point_index).first;
         ++added_landmarks;
       }
       const auto& obs = lm_obs.second;
-      ba.AddPointProjectionObservation(shot->id_, lm_obs.first->id_, obs.point,
+      ba.AddPointProjectionObservation(shot_index, point->second, obs.point,
                                        obs.scale, obs.depth_prior);
       ++added_reprojections;
     }
   }
   for (auto* shot : boundary) {
+    const int shot_index = ba.GetShotIndex(shot->id_);
     for (const auto& lm_obs : shot->GetLandmarkObservations()) {
-      auto* lm = lm_obs.first;
-      if (points.count(lm) > 0) {
+      const auto point = points.find(lm_obs.first);
+      if (point != points.end()) {
         const auto& obs = lm_obs.second;
-        ba.AddPointProjectionObservation(shot->id_, lm_obs.first->id_,
-                                         obs.point, obs.scale, obs.depth_prior);
+        ba.AddPointProjectionObservation(shot_index, point->second, obs.point,
+                                         obs.scale, obs.depth_prior);
         ++added_reprojections;
       }
     }
@@ -282,10 +522,12 @@ py::tuple BAHelpers::BundleLocal(
     instance.SetPose(i.GetValue());
   }
 
-  for (auto* point : points) {
-    const auto& pt = ba.GetPoint(point->id_);
+  const auto errors = ba.GetReprojectionErrors();
+  for (const auto& [point, point_index] : points) {
+    const auto& pt = ba.GetPoint(point_index);
     point->SetGlobalPos(pt.GetValue());
-    point->SetReprojectionErrors(pt.reprojection_errors);
+    const auto range = ba.GetPointReprojectionErrorsRange(point_index);
+    point->SetReprojectionErrors(errors, range.first, range.second);
   }
   const auto timer_teardown = std::chrono::high_resolution_clock::now();
   report["brief_report"] = ba.BriefReport();
@@ -409,6 +651,256 @@ size_t BAHelpers::AddGCPToBundle(
   return added_gcp_observations;
 }
 
+std::vector<std::vector<map::RigInstanceId>> BAHelpers::PartitionRigInstances(
+    const map::Map& map, size_t max_shots) {
+  // Seeds are taken by id, for reproducible partitions
+  std::vector<const map::RigInstance*> instances;
+  for (const auto& instance_pair : map.GetRigInstances()) {
+    instances.push_back(&instance_pair.second);
+  }
+  std::sort(instances.begin(), instances.end(),
+            [](const map::RigInstance* a, const map::RigInstance* b) {
+              return a->id < b->id;
+            });
+
+  std::unordered_set<const map::RigInstance*> assigned;
+  std::vector<std::vector<map::RigInstanceId>> clusters;
+  for (const auto* seed : instances) {
+    if (assigned.count(seed) > 0) {
+      continue;
+    }
+    clusters.emplace_back();
+    auto& cluster = clusters.back();
+    size_t shots_count = 0;
+
+    // Observations of points in common with the cluster, per instance
+    std::unordered_map<const map::RigInstance*, size_t> common;
+    const map::RigInstance* next = seed;
+    while (next != nullptr) {
+      assigned.insert(next);
+      common.erase(next);
+      cluster.push_back(next->id);
+      shots_count += next->NumberOfShots();
+      for (const auto& shot_pair : next->GetShots()) {
+        for (const auto& lm_obs :
+             shot_pair.second->GetLandmarkObservations()) {
+          for (const auto& shot_obs : lm_obs.first->GetObservations()) {
+            const auto* instance = shot_obs.first->GetRigInstance();
+            if (assigned.count(instance) == 0) {
+              ++common[instance];
+            }
+          }
+        }
+      }
+
+      next = nullptr;
+      size_t best_common = 0;
+      for (const auto& [instance, count] : common) {
+        if (shots_count + instance->NumberOfShots() > max_shots) {
+          continue;
+        }
+        if (next == nullptr || count > best_common ||
+            (count == best_common && instance->id < next->id)) {
+          best_common = count;
+          next = instance;
+        }
+      }
+    }
+  }
+  return clusters;
+}
+
+py::dict BAHelpers::BundlePartitioned(
+    map::Map& map,
+    const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
+    const std::unordered_map<map::RigCameraId, map::RigCamera>&
+        rig_camera_priors,
+    const py::dict& config) {
+  py::dict report;
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  const int max_iterations =
+      config["bundle_partition_max_iterations"].cast<int>();
+  if (max_iterations <= 0) {
+    throw std::runtime_error(
+        "bundle_partition_max_iterations must be positive, got " +
+        std::to_string(max_iterations));
+  }
+
+  const auto clusters = PartitionRigInstances(
+      map, config["bundle_partition_cluster_size"].cast<size_t>());
+  if (clusters.empty()) {
+    // Nothing to adjust in a map without rig instances
+    report["brief_report"] = "";
+    report["wall_times"] = py::dict();
+    report["wall_times"]["setup"] =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start)
+            .count() /
+        1000000.0;
+    report["wall_times"]["run"] = 0.0;
+    report["wall_times"]["teardown"] = 0.0;
+    report["num_images"] = map.GetShots().size();
+    report["num_points"] = map.GetLandmarks().size();
+    report["num_reprojections"] = 0;
+    report["num_clusters"] = 0;
+    report["num_separator_points"] = 0;
+    report["iterations"] = 0;
+    return report;
+  }
+  std::unordered_map<const map::RigInstance*, int> instances_clusters;
+  for (int i = 0; i < clusters.size(); ++i) {
+    for (const auto& instance_id : clusters[i]) {
+      instances_clusters[&map.GetRigInstance(instance_id)] = i;
+    }
+  }
+
+  // Points seen by several clusters, and the instances observing them
+  std::unordered_set<const map::Landmark*> separators;
+  std::set<map::RigInstanceId> separators_instances_ids;
+  size_t num_reprojections = 0;
+  for (const auto& lm_pair : map.GetLandmarks()) {
+    const auto& observations = lm_pair.second.GetObservations();
+    num_reprojections += observations.size();
+    if (observations.empty()) {
+      continue;
+    }
+    const auto first_cluster =
+        instances_clusters.at(observations.begin()->first->GetRigInstance());
+    for (const auto& shot_obs : observations) {
+      const auto* instance = shot_obs.first->GetRigInstance();
+      if (instances_clusters.at(instance) != first_cluster) {
+        separators.insert(&lm_pair.second);
+        break;
+      }
+    }
+  }
+  for (const auto* lm : separators) {
+    for (const auto& shot_obs : lm->GetObservations()) {
+      separators_instances_ids.insert(shot_obs.first->GetRigInstance()->id);
+    }
+  }
+  const std::vector<map::RigInstanceId> separators_instances(
+      separators_instances_ids.begin(), separators_instances_ids.end());
+
+  auto align_method = config["align_method"].cast<std::string>();
+  if (align_method.compare("auto") == 0) {
+    align_method = DetectAlignmentConstraints(map, config, {});
+  }
+  Vec3d up_vector = Vec3d::Zero();
+  if (align_method.compare("orientation_prior") == 0) {
+    const std::string align_orientation_prior =
+        config["align_orientation_prior"].cast<std::string>();
+    if (align_orientation_prior.compare("vertical") == 0) {
+      up_vector = Vec3d(0, 0, -1);
+    } else if (align_orientation_prior.compare("horizontal") == 0) {
+      up_vector = Vec3d(0, -1, 0);
+    }
+  }
+
+  // Without separators, the single cluster is the whole problem
+  const bool fix_cameras = !config["optimize_camera_parameters"].cast<bool>();
+  const bool fix_clusters_cameras = fix_cameras || !separators.empty();
+  const int num_threads = std::max(config["processes"].cast<int>(), 1);
+  const int cluster_threads =
+      std::max(num_threads / static_cast<int>(clusters.size()), 1);
+  const double tolerance = config["bundle_partition_tolerance"].cast<double>();
+
+  // Parts are set up, run and written back to the map at each iteration
+  using Clock = std::chrono::high_resolution_clock;
+  Clock::duration setup_time = Clock::now() - start;
+  Clock::duration run_time = Clock::duration::zero();
+  Clock::duration teardown_time = Clock::duration::zero();
+
+  std::string brief_report;
+  int iterations = 0;
+  while (iterations < max_iterations) {
+    ++iterations;
+    auto timer = Clock::now();
+
+    // Clusters are independent once separators are fixed. Exceptions can't
+    // leave the parallel loop, and are thrown afterwards.
+    std::vector<PartBundle> parts;
+    for (const auto& cluster : clusters) {
+      constexpr bool adjust_separators{false};
+      parts.push_back(CreatePartBundle(
+          map, camera_priors, rig_camera_priors, cluster, separators,
+          adjust_separators, fix_clusters_cameras, up_vector, config,
+          cluster_threads));
+    }
+    setup_time += Clock::now() - timer;
+    timer = Clock::now();
+    std::vector<std::string> errors(parts.size());
+    {
+      py::gil_scoped_release release;
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+      for (int i = 0; i < parts.size(); ++i) {
+        try {
+          parts[i].ba->Run();
+        } catch (const std::exception& e) {
+          errors[i] = e.what();
+        }
+      }
+    }
+    run_time += Clock::now() - timer;
+    timer = Clock::now();
+    for (int i = 0; i < parts.size(); ++i) {
+      if (!errors[i].empty()) {
+        throw std::runtime_error(errors[i]);
+      }
+      PartBundleToMap(parts[i], !fix_clusters_cameras, map);
+    }
+    brief_report = parts.front().ba->BriefReport();
+    teardown_time += Clock::now() - timer;
+    if (separators.empty()) {
+      break;
+    }
+
+    timer = Clock::now();
+    constexpr bool adjust_separators{true};
+    const auto separators_part = CreatePartBundle(
+        map, camera_priors, rig_camera_priors, separators_instances,
+        separators, adjust_separators, fix_cameras, up_vector, config,
+        num_threads);
+    setup_time += Clock::now() - timer;
+    timer = Clock::now();
+    {
+      py::gil_scoped_release release;
+      separators_part.ba->Run();
+    }
+    run_time += Clock::now() - timer;
+    timer = Clock::now();
+    PartBundleToMap(separators_part, !fix_cameras, map);
+    brief_report = separators_part.ba->BriefReport();
+    teardown_time += Clock::now() - timer;
+
+    // Consensus is reached when clusters agree on separators
+    const double initial_cost = separators_part.ba->GetInitialCost();
+    const double final_cost = separators_part.ba->GetFinalCost();
+    if (initial_cost - final_cost <= tolerance * initial_cost) {
+      break;
+    }
+  }
+
+  const auto seconds = [](const Clock::duration& duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+               .count() /
+           1000000.0;
+  };
+  report["brief_report"] = brief_report;
+  report["wall_times"] = py::dict();
+  report["wall_times"]["setup"] = seconds(setup_time);
+  report["wall_times"]["run"] = seconds(run_time);
+  report["wall_times"]["teardown"] = seconds(teardown_time);
+  report["num_images"] = map.GetShots().size();
+  report["num_points"] = map.GetLandmarks().size();
+  report["num_reprojections"] = num_reprojections;
+  report["num_clusters"] = clusters.size();
+  report["num_separator_points"] = separators.size();
+  report["iterations"] = iterations;
+  return report;
+}
+
 py::dict BAHelpers::BundleShotPoses(
     map::Map& map, const std::unordered_set<map::ShotId>& shot_ids,
     const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
@@ -605,9 +1097,12 @@ py::dict BAHelpers::Bundle(
     ba.AddCamera(cam.id, cam, cam_prior, fix_cameras);
   }
 
-  for (const auto& pt_pair : map.GetLandmarks()) {
-    const auto& pt = pt_pair.second;
-    ba.AddPoint(pt.id_, pt.GetGlobalPos(), false);
+  const int num_threads = config["processes"].cast<int>();
+  ba.SetNumThreads(num_threads);
+  MapObservations map_observations;
+  GatherMapObservations(map, num_threads, map_observations);
+  for (const auto* pt : map_observations.points) {
+    ba.AddPoint(pt->id_, pt->GetGlobalPos(), false);
   }
 
   auto align_method = config["align_method"].cast<std::string>();
@@ -647,70 +1142,34 @@ py::dict BAHelpers::Bundle(
   }
 
   // setup rig instances
-  const std::string gps_scale_group = "dummy";  // unused for now
-  for (auto instance_pair : map.GetRigInstances()) {
-    auto& instance = instance_pair.second;
-
-    Vec3d average_position = Vec3d::Zero();
-    double average_std = 0.;
-    int gps_count = 0;
-
-    // average GPS and assign GPS constraint to the instance
-    std::unordered_map<std::string, std::string> shot_cameras, shot_rig_cameras;
-    for (const auto& shot_n_rig_camera : instance.GetRigCameras()) {
-      const auto shot_id = shot_n_rig_camera.first;
-      const auto& shot = map.GetShot(shot_id);
-      shot_cameras[shot_id] = shot.GetCamera()->id;
-      shot_rig_cameras[shot_id] = shot_n_rig_camera.second->id;
-
-      if (config["bundle_use_gps"].cast<bool>()) {
-        const auto pos = shot.GetShotMeasurements().gps_position_;
-        const auto acc = shot.GetShotMeasurements().gps_accuracy_;
-        if (pos.HasValue() && acc.HasValue()) {
-          if (acc.Value() <= 0) {
-            throw std::runtime_error(
-                "Shot " + shot.GetId() +
-                " has an accuracy <= 0: " + std::to_string(acc.Value()) +
-                ". Try modifying "
-                "your input parser to filter such values.");
-          }
-          average_position += pos.Value();
-          average_std += acc.Value();
-          ++gps_count;
-        }
-      }
-    }
-
-    ba.AddRigInstance(instance_pair.first, instance.GetPose(), shot_cameras,
-                      shot_rig_cameras, false);
-
-    if (config["bundle_use_gps"].cast<bool>() && gps_count > 0) {
-      average_position /= gps_count;
-      average_std /= gps_count;
-      ba.AddRigInstancePositionPrior(instance_pair.first, average_position,
-                                     Vec3d::Constant(average_std),
-                                     gps_scale_group);
-    }
+  const bool use_gps = config["bundle_use_gps"].cast<bool>();
+  for (const auto& instance_pair : map.GetRigInstances()) {
+    constexpr bool fix_instance{false};
+    AddRigInstanceToBundle(ba, map, instance_pair.second, use_gps,
+                           fix_instance);
   }
 
-  size_t added_reprojections = 0;
-  for (const auto& shot_pair : map.GetShots()) {
-    const auto& shot = shot_pair.second;
-
-    // that one doesn't have it's rig counterpart
-    if (do_add_align_vector) {
-      constexpr double std_dev = 1e-3;
-      ba.AddAbsoluteUpVector(shot.id_, up_vector, std_dev);
+  // that one doesn't have it's rig counterpart
+  if (do_add_align_vector) {
+    constexpr double std_dev = 1e-3;
+    for (const auto& shot_pair : map.GetShots()) {
+      ba.AddAbsoluteUpVector(shot_pair.first, up_vector, std_dev);
     }
+  }
 
-    // setup observations for any shot type
-    for (const auto& lm_obs : shot.GetLandmarkObservations()) {
-      const auto& obs = lm_obs.second;
-      ba.AddPointProjectionObservation(shot.id_, lm_obs.first->id_, obs.point,
-                                       obs.scale, obs.depth_prior);
-      ++added_reprojections;
-    }
+  // setup observations for any shot type, points were added in the gathered
+  // order so that their indexes match, but shots indexes need remapping
+  std::vector<int> shots_indexes;
+  shots_indexes.reserve(map_observations.shots.size());
+  for (const auto* shot : map_observations.shots) {
+    shots_indexes.push_back(ba.GetShotIndex(shot->id_));
   }
+  auto& observations = map_observations.observations;
+  for (auto& shot : observations.shots) {
+    shot = shots_indexes[shot];
+  }
+  ba.AddPointProjectionObservations(observations);
+  const size_t added_reprojections = observations.shots.size();
 
   if (config["bundle_use_gcp"].cast<bool>() && !gcp.empty()) {
     AddGCPToBundle(ba, map, gcp, config);
@@ -738,7 +1197,6 @@ py::dict BAHelpers::Bundle(
   ba.SetRigParametersPriorSD(config["rig_translation_sd"].cast<double>(),
                              config["rig_rotation_sd"].cast<double>());
 
-  ba.SetNumThreads(config["processes"].cast<int>());
   ba.SetMaxNumIterations(config["bundle_max_iterations"].cast<int>());
   ba.SetLinearSolverType("SPARSE_SCHUR");
   const auto timer_setup = std::chrono::high_resolution_clock::now();
@@ -820,14 +1278,18 @@ void BAHelpers::BundleToMap(const bundle::BundleAdjuster& bundle_adjuster,
   }
 
   // Update points
+  const auto errors = bundle_adjuster.GetReprojectionErrors();
   for (auto& point : output_map.GetLandmarks()) {
-    const auto& pt = bundle_adjuster.GetPoint(point.first);
+    const int point_index = bundle_adjuster.GetPointIndex(point.first);
+    const auto& pt = bundle_adjuster.GetPoint(point_index);
     if (!pt.GetValue().allFinite()) {
       throw std::runtime_error("Point " + point.first +
                                " has either NaN or INF values.");
     }
     point.second.SetGlobalPos(pt.GetValue());
-    point.second.SetReprojectionErrors(pt.reprojection_errors);
+    const auto range =
+        bundle_adjuster.GetPointReprojectionErrorsRange(point_index);
+    point.second.SetReprojectionErrors(errors, range.first, range.second);
   }
 }
 
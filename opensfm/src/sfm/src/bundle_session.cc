@@ -0,0 +1,321 @@
+#include <foundation/types.h>
+#include <sfm/ba_helpers.h>
+#include <sfm/bundle_session.h>
+
+#include <chrono>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+double Seconds(const std::chrono::high_resolution_clock::time_point& begin,
+               const std::chrono::high_resolution_clock::time_point& end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - begin)
+             .count() /
+         1000000.0;
+}
+}  // namespace
+
+namespace sfm {
+BundleSession::BundleSession(
+    map::Map& map,
+    const std::unordered_map<map::CameraId, geometry::Camera>& camera_priors,
+    const std::unordered_map<map::RigCameraId, map::RigCamera>&
+        rig_camera_priors)
+    : map_(map),
+      camera_priors_(camera_priors),
+      rig_camera_priors_(rig_camera_priors) {}
+
+void BundleSession::Update(const py::dict& config) {
+  bool reset = !ba_;
+  for (const auto& [instance_id, shots_count] : instances_shots_count_) {
+    const auto& instances = map_.GetRigInstances();
+    const auto instance = instances.find(instance_id);
+    if (instance == instances.end() ||
+        instance->second.GetShotIDs().size() != shots_count) {
+      reset = true;
+      break;
+    }
+  }
+  if (reset) {
+    ba_ = std::make_unique<bundle::BundleAdjuster>();
+    ba_->SetKeepProblem(true);
+    ba_->SetUseAnalyticDerivatives(
+        config["bundle_analytic_derivatives"].cast<bool>());
+    structure_revision_ = 0;
+    instances_shots_count_.clear();
+  }
+
+  const int num_threads = config["processes"].cast<int>();
+  ba_->SetNumThreads(num_threads);
+
+  constexpr bool constant{true};
+  for (const auto& [camera_id, camera] : map_.GetCameras()) {
+    if (!ba_->HasCamera(camera_id)) {
+      ba_->AddCamera(camera_id, camera, camera_priors_.at(camera_id),
+                     constant);
+    }
+  }
+  for (const auto& [rig_camera_id, rig_camera] : map_.GetRigCameras()) {
+    if (!ba_->HasRigCamera(rig_camera_id)) {
+      ba_->AddRigCamera(rig_camera_id, rig_camera.pose,
+                        rig_camera_priors_.at(rig_camera_id).pose, constant);
+    }
+  }
+  const bool use_gps = config["bundle_use_gps"].cast<bool>();
+  for (const auto& [instance_id, instance] : map_.GetRigInstances()) {
+    if (!ba_->HasRigInstance(instance_id)) {
+      BAHelpers::AddRigInstanceToBundle(*ba_, map_, instance, use_gps,
+                                        constant);
+      instances_shots_count_[instance_id] = instance.GetShotIDs().size();
+    }
+  }
+
+  BAHelpers::GatherMapObservations(map_, num_threads, map_observations_);
+  if (structure_revision_ == map_observations_.structure_revision) {
+    return;
+  }
+
+  // Points removed from the map are left unobserved in the adjuster, and
+  // are thus not part of its problem anymore
+  std::vector<int> points_indexes;
+  points_indexes.reserve(map_observations_.points.size());
+  for (const auto* pt : map_observations_.points) {
+    points_indexes.push_back(
+        ba_->AddPoint(pt->id_, pt->GetGlobalPos(), constant));
+  }
+  std::vector<int> shots_indexes;
+  shots_indexes.reserve(map_observations_.shots.size());
+  for (const auto* shot : map_observations_.shots) {
+    shots_indexes.push_back(ba_->GetShotIndex(shot->id_));
+  }
+  auto observations = map_observations_.observations;
+  for (auto& shot : observations.shots) {
+    shot = shots_indexes[shot];
+  }
+  for (auto& point : observations.points) {
+    point = points_indexes[point];
+  }
+  ba_->SetPointProjectionObservations(observations);
+  structure_revision_ = map_observations_.structure_revision;
+}
+
+void BundleSession::SetOptions(const py::dict& config) {
+  ba_->SetPointProjectionLossFunction(
+      config["loss_function"].cast<std::string>(),
+      config["loss_function_threshold"].cast<double>());
+  ba_->SetInternalParametersPriorSD(
+      config["exif_focal_sd"].cast<double>(),
+      config["principal_point_sd"].cast<double>(),
+      config["radial_distortion_k1_sd"].cast<double>(),
+      config["radial_distortion_k2_sd"].cast<double>(),
+      config["tangential_distortion_p1_sd"].cast<double>(),
+      config["tangential_distortion_p2_sd"].cast<double>(),
+      config["radial_distortion_k3_sd"].cast<double>(),
+      config["radial_distortion_k4_sd"].cast<double>());
+  ba_->SetRigParametersPriorSD(config["rig_translation_sd"].cast<double>(),
+                               config["rig_rotation_sd"].cast<double>());
+}
+
+py::dict BundleSession::Bundle(const py::dict& config) {
+  py::dict report;
+  const auto start = std::chrono::high_resolution_clock::now();
+  Update(config);
+
+  const bool fix_cameras = !config["optimize_camera_parameters"].cast<bool>();
+  const auto& all_cameras = map_.GetCameras();
+  for (const auto& [camera_id, camera] : all_cameras) {
+    ba_->SetCamera(camera_id, camera, fix_cameras);
+  }
+
+  constexpr size_t kMinRigInstanceForAdjust{10};
+  const size_t shots_per_rig_cameras =
+      map_.GetRigCameras().size() > 0
+          ? static_cast<size_t>(map_.GetShots().size() /
+                                map_.GetRigCameras().size())
+          : 1;
+  const auto lock_rig_camera =
+      shots_per_rig_cameras <= kMinRigInstanceForAdjust;
+  for (const auto& [rig_camera_id, rig_camera] : map_.GetRigCameras()) {
+    const bool is_leverarm =
+        all_cameras.find(rig_camera_id) != all_cameras.end();
+    ba_->SetRigCamera(rig_camera_id, rig_camera.pose,
+                      is_leverarm | lock_rig_camera);
+  }
+
+  constexpr bool fix_instances{false};
+  for (const auto& [instance_id, instance] : map_.GetRigInstances()) {
+    ba_->SetRigInstance(instance_id, instance.GetPose(), fix_instances);
+  }
+  constexpr bool fix_points{false};
+  const auto& points = map_.GetLandmarks();
+  for (const auto& [point_id, point] : points) {
+    ba_->SetPoint(ba_->GetPointIndex(point_id), point.GetGlobalPos(),
+                  fix_points);
+  }
+
+  auto align_method = config["align_method"].cast<std::string>();
+  if (align_method.compare("auto") == 0) {
+    align_method = BAHelpers::DetectAlignmentConstraints(map_, config, {});
+  }
+  ba_->ClearAbsoluteUpVectors();
+  if (align_method.compare("orientation_prior") == 0) {
+    const std::string align_orientation_prior =
+        config["align_orientation_prior"].cast<std::string>();
+    Vec3d up_vector = Vec3d::Zero();
+    if (align_orientation_prior.compare("vertical") == 0) {
+      up_vector = Vec3d(0, 0, -1);
+    } else if (align_orientation_prior.compare("horizontal") == 0) {
+      up_vector = Vec3d(0, -1, 0);
+    }
+    if (!up_vector.isZero()) {
+      constexpr double std_dev = 1e-3;
+      for (const auto& shot_pair : map_.GetShots()) {
+        ba_->AddAbsoluteUpVector(shot_pair.first, up_vector, std_dev);
+      }
+    }
+  }
+
+  const bool compensate_gps_bias =
+      config["bundle_compensate_gps_bias"].cast<bool>();
+  const auto& biases = map_.GetBiases();
+  for (const auto& camera_pair : all_cameras) {
+    const auto& camera_id = camera_pair.first;
+    if (compensate_gps_bias) {
+      ba_->SetCameraBias(camera_id, biases.at(camera_id));
+    } else {
+      ba_->ResetCameraBias(camera_id);
+    }
+  }
+
+  SetOptions(config);
+  ba_->SetMaxNumIterations(config["bundle_max_iterations"].cast<int>());
+  ba_->SetLinearSolverType("SPARSE_SCHUR");
+  const auto timer_setup = std::chrono::high_resolution_clock::now();
+
+  {
+    py::gil_scoped_release release;
+    ba_->Run();
+  }
+
+  const auto timer_run = std::chrono::high_resolution_clock::now();
+
+  BAHelpers::BundleToMap(*ba_, map_, !fix_cameras);
+
+  const auto timer_teardown = std::chrono::high_resolution_clock::now();
+  report["brief_report"] = ba_->BriefReport();
+  report["wall_times"] = py::dict();
+  report["wall_times"]["setup"] = Seconds(start, timer_setup);
+  report["wall_times"]["run"] = Seconds(timer_setup, timer_run);
+  report["wall_times"]["teardown"] = Seconds(timer_run, timer_teardown);
+  report["num_images"] = map_.GetShots().size();
+  report["num_points"] = points.size();
+  report["num_reprojections"] = ba_->GetProjectionsCount();
+  report["num_built_cost_functions"] =
+      ba_->GetBuiltProjectionCostFunctionsCount();
+  return report;
+}
+
+py::tuple BundleSession::BundleLocal(const map::ShotId& central_shot_id,
+                                     const py::dict& config) {
+  py::dict report;
+  const auto start = std::chrono::high_resolution_clock::now();
+  Update(config);
+
+  const auto neighborhood = BAHelpers::ShotNeighborhood(
+      map_, central_shot_id, config["local_bundle_radius"].cast<size_t>(),
+      config["local_bundle_min_common_points"].cast<size_t>(),
+      config["local_bundle_max_shots"].cast<size_t>());
+  const auto& interior = neighborhood.first;
+  const auto& boundary = neighborhood.second;
+
+  constexpr bool fix_cameras{true};
+  for (const auto& [camera_id, camera] : map_.GetCameras()) {
+    ba_->SetCamera(camera_id, camera, fix_cameras);
+  }
+  constexpr bool fix_rig_cameras{true};
+  for (const auto& [rig_camera_id, rig_camera] : map_.GetRigCameras()) {
+    ba_->SetRigCamera(rig_camera_id, rig_camera.pose, fix_rig_cameras);
+  }
+
+  // Instances having a shot in the boundary are fixed, as well as the ones
+  // outside of the neighborhood. The GPS prior of the moving ones is thus
+  // averaged over the same shots as in BAHelpers::BundleLocal.
+  std::vector<map::RigInstance*> moving_instances;
+  for (auto& [instance_id, instance] : map_.GetRigInstances()) {
+    bool in_neighborhood = false;
+    bool fix_instance = false;
+    for (const auto& shot_n_rig_camera : instance.GetRigCameras()) {
+      auto* shot = &map_.GetShot(shot_n_rig_camera.first);
+      in_neighborhood |= interior.count(shot) > 0;
+      fix_instance |= boundary.count(shot) > 0;
+    }
+    fix_instance |= !in_neighborhood;
+    ba_->SetRigInstance(instance_id, instance.GetPose(), fix_instance);
+    if (!fix_instance) {
+      moving_instances.push_back(&instance);
+    }
+  }
+
+  // Only the points of the interior shots are adjusted
+  std::unordered_set<map::Landmark*> moving_points;
+  for (auto* shot : interior) {
+    for (const auto& lm_obs : shot->GetLandmarkObservations()) {
+      moving_points.insert(lm_obs.first);
+    }
+  }
+  for (auto& [point_id, point] : map_.GetLandmarks()) {
+    const bool fix_point = moving_points.count(&point) == 0;
+    ba_->SetPoint(ba_->GetPointIndex(point_id), point.GetGlobalPos(),
+                  fix_point);
+  }
+
+  ba_->ClearAbsoluteUpVectors();
+  for (const auto& camera_pair : map_.GetCameras()) {
+    ba_->ResetCameraBias(camera_pair.first);
+  }
+
+  SetOptions(config);
+  ba_->SetMaxNumIterations(10);
+  ba_->SetLinearSolverType("DENSE_SCHUR");
+  const auto timer_setup = std::chrono::high_resolution_clock::now();
+
+  {
+    py::gil_scoped_release release;
+    ba_->Run();
+  }
+
+  const auto timer_run = std::chrono::high_resolution_clock::now();
+  for (auto* instance : moving_instances) {
+    instance->SetPose(ba_->GetRigInstance(instance->id).GetValue());
+  }
+
+  py::list pt_ids;
+  size_t num_reprojections = 0;
+  const auto errors = ba_->GetReprojectionErrors();
+  for (auto* point : moving_points) {
+    const int point_index = ba_->GetPointIndex(point->id_);
+    point->SetGlobalPos(ba_->GetPoint(point_index).GetValue());
+    const auto range = ba_->GetPointReprojectionErrorsRange(point_index);
+    point->SetReprojectionErrors(errors, range.first, range.second);
+    pt_ids.append(point->id_);
+    num_reprojections += point->NumberOfObservations();
+  }
+  const auto timer_teardown = std::chrono::high_resolution_clock::now();
+  report["brief_report"] = ba_->BriefReport();
+  report["wall_times"] = py::dict();
+  report["wall_times"]["setup"] = Seconds(start, timer_setup);
+  report["wall_times"]["run"] = Seconds(timer_setup, timer_run);
+  report["wall_times"]["teardown"] = Seconds(timer_run, timer_teardown);
+  report["num_images"] = interior.size();
+  report["num_interior_images"] = interior.size();
+  report["num_boundary_images"] = boundary.size();
+  report["num_other_images"] =
+      map_.NumberOfShots() - interior.size() - boundary.size();
+  report["num_points"] = moving_points.size();
+  report["num_reprojections"] = num_reprojections;
+  report["num_built_cost_functions"] =
+      ba_->GetBuiltProjectionCostFunctionsCount();
+  return py::make_tuple(pt_ids, report);
+}
+}  // namespace sfm
@@ -1,5 +1,10 @@
+#include <foundation/union_find.h>
 #include <sfm/tracks_helpers.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -42,4 +47,132 @@ void RemoveConnections(map::TracksManager& manager, const map::ShotId& shot_id,
     manager.RemoveObservation(shot_id, connection);
   }
 }
+
+map::TracksManager CreateTracksManager(
+    const std::vector<map::ShotId>& images,
+    const std::vector<ImageFeatures>& features,
+    const std::vector<ImagesMatches>& matches, int min_length,
+    bool depth_is_radial, double depth_std_deviation) {
+  const int num_images = images.size();
+  const int64_t num_pairs = matches.size();
+  if (features.size() != images.size()) {
+    throw std::runtime_error("Features and images counts differ");
+  }
+
+  // Union-find elements are the matched features, sorted by image then
+  // feature index, and the elements of image i start at element_offsets[i]
+  std::vector<std::vector<int>> matched_features(num_images);
+  for (const auto& pair : matches) {
+    for (int i = 0; i < pair.num_matches; ++i) {
+      const std::pair<int, int> image_features[] = {
+          {pair.image1, pair.matches[2 * i]},
+          {pair.image2, pair.matches[2 * i + 1]}};
+      for (const auto& image_feature : image_features) {
+        const auto& image = features.at(image_feature.first);
+        if (image.points && (image_feature.second < 0 ||
+                             image_feature.second >= image.num_features)) {
+          throw std::runtime_error("Invalid feature index in matches");
+        }
+        matched_features[image_feature.first].push_back(image_feature.second);
+      }
+    }
+  }
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < num_images; ++i) {
+    auto& image_features = matched_features[i];
+    std::sort(image_features.begin(), image_features.end());
+    image_features.erase(
+        std::unique(image_features.begin(), image_features.end()),
+        image_features.end());
+  }
+  std::vector<int64_t> element_offsets(num_images + 1, 0);
+  for (int i = 0; i < num_images; ++i) {
+    element_offsets[i + 1] = element_offsets[i] + matched_features[i].size();
+  }
+  if (element_offsets.back() > std::numeric_limits<int>::max()) {
+    throw std::runtime_error("Too many matched features");
+  }
+  const int num_elements = element_offsets.back();
+  const auto element_index = [&](int image, int feature) {
+    const auto& image_features = matched_features[image];
+    const auto find = std::lower_bound(image_features.begin(),
+                                       image_features.end(), feature);
+    return static_cast<int>(element_offsets[image] +
+                            (find - image_features.begin()));
+  };
+
+  // Look-up matches elements in parallel, then union them
+  std::vector<int64_t> edge_offsets(num_pairs + 1, 0);
+  for (int64_t i = 0; i < num_pairs; ++i) {
+    edge_offsets[i + 1] = edge_offsets[i] + matches[i].num_matches;
+  }
+  std::vector<std::pair<int, int>> edges(edge_offsets.back());
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0; i < num_pairs; ++i) {
+    const auto& pair = matches[i];
+    for (int j = 0; j < pair.num_matches; ++j) {
+      edges[edge_offsets[i] + j] =
+          std::make_pair(element_index(pair.image1, pair.matches[2 * j]),
+                         element_index(pair.image2, pair.matches[2 * j + 1]));
+    }
+  }
+  FlatUnionFind union_find(num_elements);
+  for (const auto& edge : edges) {
+    union_find.Union(edge.first, edge.second);
+  }
+  std::vector<std::pair<int, int>>().swap(edges);
+
+  std::vector<int> track_offsets, track_elements;
+  union_find.GetClusters(&track_offsets, &track_elements);
+  std::vector<int> element_images(num_elements);
+  for (int i = 0; i < num_images; ++i) {
+    std::fill(element_images.begin() + element_offsets[i],
+              element_images.begin() + element_offsets[i + 1], i);
+  }
+
+  map::TracksManager manager;
+  int num_tracks = 0;
+  for (size_t i = 0; i + 1 < track_offsets.size(); ++i) {
+    const auto begin = track_elements.begin() + track_offsets[i];
+    const auto end = track_elements.begin() + track_offsets[i + 1];
+    if (end - begin < min_length) {
+      continue;
+    }
+
+    // Elements are sorted by image : any image seen twice is adjacent
+    const auto same_image = std::adjacent_find(
+        begin, end, [&element_images](int e1, int e2) {
+          return element_images[e1] == element_images[e2];
+        });
+    if (same_image != end) {
+      continue;
+    }
+
+    const auto track_id = std::to_string(num_tracks++);
+    for (auto it = begin; it != end; ++it) {
+      const auto image = element_images[*it];
+      const auto& data = features[image];
+      if (!data.points) {
+        continue;
+      }
+      const auto f = matched_features[image][*it - element_offsets[image]];
+      map::Observation observation(
+          data.points[3 * f], data.points[3 * f + 1], data.points[3 * f + 2],
+          data.colors[3 * f], data.colors[3 * f + 1], data.colors[3 * f + 2],
+          f,
+          data.segmentations ? data.segmentations[f]
+                             : map::Observation::NO_SEMANTIC_VALUE,
+          data.instances ? data.instances[f]
+                         : map::Observation::NO_SEMANTIC_VALUE);
+      if (data.depths && std::isfinite(data.depths[f])) {
+        const double depth = data.depths[f];
+        observation.depth_prior = map::Depth(
+            depth, depth_is_radial,
+            std::max(depth_std_deviation * depth, depth_std_deviation));
+      }
+      manager.AddObservation(images[image], track_id, observation);
+    }
+  }
+  return manager;
+}
 }  // namespace sfm::tracks_helpers
@@ -63,4 +63,44 @@ TEST_F(TracksHelpersTest, RemoveConnections) {
   EXPECT_EQ(1, counts.at("2"));
   EXPECT_EQ(1, counts.at("3"));
 }
+
+TEST(CreateTracksManager, LinksMatchesIntoTracks) {
+  // Three images with three features, feature i at (i, i, i)
+  const std::vector<float> points = {0, 0, 0, 1, 1, 1, 2, 2, 2};
+  const std::vector<int> colors = {0, 0, 0, 1, 1, 1, 2, 2, 2};
+  const std::vector<float> depths = {NAN, 10.0, 20.0};
+  std::vector<sfm::tracks_helpers::ImageFeatures> features(3);
+  for (auto& image : features) {
+    image.num_features = 3;
+    image.points = points.data();
+    image.colors = colors.data();
+  }
+  features[1].depths = depths.data();
+
+  // Track (0/0, 1/1, 2/2), a track seeing image 0 twice (0/1, 1/0, 0/2) and
+  // a too short one (1/2, 2/0)
+  const std::vector<int> matches01 = {0, 1, 1, 0};
+  const std::vector<int> matches12 = {1, 2, 2, 0};
+  const std::vector<int> matches10 = {0, 2};
+  const std::vector<sfm::tracks_helpers::ImagesMatches> matches = {
+      {0, 1, 2, matches01.data()},
+      {1, 2, 2, matches12.data()},
+      {1, 0, 1, matches10.data()}};
+
+  const auto manager = sfm::tracks_helpers::CreateTracksManager(
+      {"0", "1", "2"}, features, matches, 3, true, 0.5);
+  ASSERT_EQ(1, manager.NumTracks());
+
+  std::unordered_map<map::ShotId, map::Observation> track;
+  track["0"] = map::Observation(0, 0, 0, 0, 0, 0, 0);
+  track["1"] = map::Observation(1, 1, 1, 1, 1, 1, 1);
+  track["2"] = map::Observation(2, 2, 2, 2, 2, 2, 2);
+  EXPECT_EQ(track, manager.GetTrackObservations("0"));
+
+  const auto depth = manager.GetObservation("1", "0").depth_prior;
+  ASSERT_TRUE(depth.has_value());
+  EXPECT_EQ(10.0, depth->value);
+  EXPECT_EQ(5.0, depth->std_deviation);
+  EXPECT_TRUE(depth->is_radial);
+}
 }  // namespace
@@ -17,4 +17,33 @@ void AddConnections(map::TracksManager& manager, const map::ShotId& shot_id,
                     const std::vector<map::TrackId>& connections);
 void RemoveConnections(map::TracksManager& manager, const map::ShotId& shot_id,
                        const std::vector<map::TrackId>& connections);
+
+// Views on an image features data, which must outlive CreateTracksManager.
+// Images without features have null points.
+struct ImageFeatures {
+  int num_features{0};
+  const float* points{nullptr};  // N x 3 (x, y, scale), row-major
+  const int* colors{nullptr};    // N x 3 RGB, row-major
+  // Optional data, null if missing
+  const int* segmentations{nullptr};
+  const int* instances{nullptr};
+  const float* depths{nullptr};
+};
+
+// View on the features matches between two images (indexes in the images
+// list), as M x 2 row-major (feature in image1, feature in image2) indexes
+struct ImagesMatches {
+  int image1{0};
+  int image2{0};
+  int num_matches{0};
+  const int* matches{nullptr};
+};
+
+// Link pair-wise matches into tracks, keeping only tracks with at least
+// min_length features that don't see the same image twice
+map::TracksManager CreateTracksManager(
+    const std::vector<map::ShotId>& images,
+    const std::vector<ImageFeatures>& features,
+    const std::vector<ImagesMatches>& matches, int min_length,
+    bool depth_is_radial, double depth_std_deviation);
 }  // namespace sfm::tracks_helpers
@@ -1635,6 +1635,42 @@ vl_covdet_delete (VlCovDet * self)
   vl_free(self) ;
 }
 
+/** @brief Create a copy sharing the scale space of another object
+ ** @param self object.
+ ** @return new object, or @c NULL if memory is insufficient.
+ **
+ ** The copy has no features and its own buffers, but reads the
+ ** Gaussian scale space of @a self. Patches and orientations can then
+ ** be extracted from several threads, one copy per thread. The copy
+ ** must be deleted with ::vl_covdet_delete_shared_copy, before @a self.
+ **/
+
+VlCovDet *
+vl_covdet_new_shared_copy (VlCovDet const * self)
+{
+  VlCovDet * copy = vl_malloc(sizeof(VlCovDet)) ;
+  if (copy == NULL) return NULL ;
+  memcpy(copy, self, sizeof(VlCovDet)) ;
+  copy->css = NULL ;
+  copy->features = NULL ;
+  copy->numFeatures = 0 ;
+  copy->numFeatureBufferSize = 0 ;
+  copy->patch = NULL ;
+  copy->patchBufferSize = 0 ;
+  return copy ;
+}
+
+/** @brief Delete an object created by ::vl_covdet_new_shared_copy
+ ** @param self object.
+ **/
+
+void
+vl_covdet_delete_shared_copy (VlCovDet * self)
+{
+  if (self->patch) vl_free (self->patch) ;
+  vl_free(self) ;
+}
+
 /** @brief Append a feature to the internal buffer.
  ** @param self object.
  ** @param feature a pointer to the feature to append.
@@ -189,6 +189,8 @@ typedef struct _VlCovDet VlCovDet ;
 VL_EXPORT VlCovDet * vl_covdet_new (VlCovDetMethod method) ;
 VL_EXPORT void vl_covdet_delete (VlCovDet * self) ;
 VL_EXPORT void vl_covdet_reset (VlCovDet * self) ;
+VL_EXPORT VlCovDet * vl_covdet_new_shared_copy (VlCovDet const * self) ;
+VL_EXPORT void vl_covdet_delete_shared_copy (VlCovDet * self) ;
 /** @} */
 
 /** @name Process data
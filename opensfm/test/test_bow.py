@@ -0,0 +1,50 @@
+# pyre-unsafe
+import numpy as np
+from opensfm import bow, pyfeatures
+
+
+def test_vocabulary_tree_nearest_words() -> None:
+    np.random.seed(42)
+    words = np.random.rand(500, 16).astype(np.float32)
+    descriptors = words[[3, 141, 499]] + 1e-3
+
+    tree = pyfeatures.VocabularyTree(words, branching=4)
+    closest = tree.nearest_words(descriptors, 5, max_checks=len(words))
+
+    distances = np.linalg.norm(descriptors[:, None] - words[None], axis=2)
+    assert closest.shape == (3, 5)
+    assert np.array_equal(closest, np.argsort(distances, axis=1)[:, :5])
+
+
+def test_bow_index_nearest_images() -> None:
+    frequencies = np.array([1, 2, 3, 4, 5, 6])
+    bows = bow.BagOfWords(np.zeros((6, 2), dtype=np.float32), frequencies)
+    images_words = [
+        np.array([0, 1, 1, 2], dtype=np.int32),
+        np.array([0, 1, 2], dtype=np.int32),
+        np.array([3, 4], dtype=np.int32),
+        np.array([1, 2, 2, 5], dtype=np.int32),
+    ]
+    index = bows.inverted_index()
+    for words in images_words:
+        index.add_image(words)
+
+    references = np.array([0, 2], dtype=np.int32)
+    candidates = np.array([0, 1, 2, 3], dtype=np.int32)
+    neighbors, distances = index.nearest_images(references, candidates, 3)
+
+    # Image 2 shares no word with the others, so it is at the maximum distance
+    assert neighbors.tolist() == [[1, 3, 2], [0, 1, 3]]
+    assert np.allclose(distances[1], [2, 2, 2])
+    for i, neighbor in enumerate(neighbors[0]):
+        expected = bows.bow_distance(images_words[0], images_words[neighbor])
+        assert np.isclose(distances[0, i], expected, atol=1e-6)
+
+    # Each reference has its own candidates
+    neighbors, distances = index.nearest_images(
+        references,
+        np.array([3, 2, 1, 3], dtype=np.int32),
+        3,
+        np.array([0, 2, 4], dtype=np.int32),
+    )
+    assert neighbors.tolist() == [[3, 2, -1], [1, 3, -1]]
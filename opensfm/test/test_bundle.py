@@ -9,6 +9,7 @@ from opensfm import (
     pybundle,
     pygeometry,
     pymap,
+    pysfm,
     reconstruction,
     tracking,
     types,
@@ -96,11 +97,10 @@ def _projection_errors_std(points) -> float:
     return np.std(all_errors)
 
 
-def test_bundle_projection_fixed_internals(scene_synthetic) -> None:
-    reference = scene_synthetic.reconstruction
-    camera_priors = dict(reference.cameras.items())
-    rig_priors = dict(reference.rig_cameras.items())
-    graph = tracking.as_graph(scene_synthetic.tracks_manager)
+def _add_observations(
+    reference: types.Reconstruction, tracks_manager: pymap.TracksManager
+) -> None:
+    graph = tracking.as_graph(tracks_manager)
     # Create the connections in the reference
     for point_id in reference.points.keys():
         if point_id in graph:
@@ -133,6 +133,13 @@ def test_bundle_projection_fixed_internals(scene_synthetic) -> None:
                 )
                 reference.map.add_observation(shot_id, point_id, obs)
 
+
+def test_bundle_projection_fixed_internals(scene_synthetic) -> None:
+    reference = scene_synthetic.reconstruction
+    camera_priors = dict(reference.cameras.items())
+    rig_priors = dict(reference.rig_cameras.items())
+    _add_observations(reference, scene_synthetic.tracks_manager)
+
     orig_camera = copy.deepcopy(reference.cameras["1"])
 
     custom_config = config.default_config()
@@ -146,6 +153,98 @@ def test_bundle_projection_fixed_internals(scene_synthetic) -> None:
     assert reference.cameras["1"].k2 == orig_camera.k2
 
 
+def test_bundle_session(scene_synthetic) -> None:
+    reference = copy.deepcopy(scene_synthetic.reconstruction)
+    camera_priors = dict(reference.cameras.items())
+    rig_priors = dict(reference.rig_cameras.items())
+    _add_observations(reference, scene_synthetic.tracks_manager)
+    expected = copy.deepcopy(reference, {"copy_observations": True})
+
+    custom_config = config.default_config()
+    custom_config["bundle_use_gps"] = False
+    reconstruction.bundle(expected, camera_priors, rig_priors, [], custom_config)
+
+    session = pysfm.BundleSession(reference.map, camera_priors, rig_priors)
+    report = reconstruction.bundle(
+        reference, camera_priors, rig_priors, [], custom_config, session
+    )
+    assert report["num_built_cost_functions"] == report["num_reprojections"]
+    num_reprojections = report["num_reprojections"]
+    assert _projection_errors_std(reference.points) < 5e-3
+    for shot_id, shot in expected.shots.items():
+        assert np.allclose(
+            shot.pose.get_origin(),
+            reference.shots[shot_id].pose.get_origin(),
+            atol=1e-4,
+        )
+
+    # Local bundles of the session only switch the outer blocks to constant
+    shot_id = next(iter(reference.shots))
+    point_ids, report = reconstruction.bundle_local(
+        reference, camera_priors, rig_priors, [], shot_id, custom_config, session
+    )
+    assert len(point_ids) == report["num_points"] > 0
+    assert report["num_built_cost_functions"] == 0
+    assert _projection_errors_std(reference.points) < 5e-3
+
+    # Moving points and shots in between keeps the session's cost functions
+    point_ids, report = reconstruction.bundle_local(
+        reference, camera_priors, rig_priors, [], shot_id, custom_config
+    )
+    assert len(point_ids) == report["num_points"] > 0
+    report = reconstruction.bundle(
+        reference, camera_priors, rig_priors, [], custom_config, session
+    )
+    assert report["num_built_cost_functions"] == 0
+    assert _projection_errors_std(reference.points) < 5e-3
+
+    # Removed points are left out of the next bundles, which reuse the cost
+    # functions of the remaining observations
+    reference.remove_point(point_ids[0])
+    report = reconstruction.bundle(
+        reference, camera_priors, rig_priors, [], custom_config, session
+    )
+    assert report["num_reprojections"] < num_reprojections
+    assert report["num_built_cost_functions"] == 0
+    assert _projection_errors_std(reference.points) < 5e-3
+
+
+def test_bundle_partitioned(scene_synthetic) -> None:
+    reference = copy.deepcopy(scene_synthetic.reconstruction)
+    camera_priors = dict(reference.cameras.items())
+    rig_priors = dict(reference.rig_cameras.items())
+    _add_observations(reference, scene_synthetic.tracks_manager)
+
+    cluster_size = 5
+    clusters = pysfm.BAHelpers.partition_rig_instances(reference.map, cluster_size)
+    instances = [i for c in clusters for i in c]
+    assert sorted(instances) == sorted(reference.rig_instances)
+    for cluster in clusters:
+        assert 0 < len(cluster) <= cluster_size
+
+    custom_config = config.default_config()
+    custom_config["bundle_use_gps"] = False
+    custom_config["bundle_partition_cluster_size"] = cluster_size
+    report = reconstruction.bundle(
+        reference, camera_priors, rig_priors, [], custom_config
+    )
+    assert report["num_clusters"] == len(clusters)
+    assert report["num_separator_points"] > 0
+    assert _projection_errors_std(reference.points) < 5e-3
+
+
+def test_bundle_partitioned_invalid() -> None:
+    custom_config = config.default_config()
+    custom_config["bundle_partition_cluster_size"] = 5
+    empty = types.Reconstruction()
+    report = pysfm.BAHelpers.bundle_partitioned(empty.map, {}, {}, custom_config)
+    assert report["num_clusters"] == report["iterations"] == 0
+
+    custom_config["bundle_partition_max_iterations"] = 0
+    with pytest.raises(RuntimeError):
+        pysfm.BAHelpers.bundle_partitioned(empty.map, {}, {}, custom_config)
+
+
 def create_shots(bundle_adjuster: pybundle.BundleAdjuster, num_shots: int) -> None:
     for i in range(num_shots):
         instance_id = str(i + 1)
@@ -158,6 +257,47 @@ def create_shots(bundle_adjuster: pybundle.BundleAdjuster, num_shots: int) -> No
         )
 
 
+def test_shot_and_point_indexes(bundle_adjuster: pybundle.BundleAdjuster) -> None:
+    """Shots and points are indexed in the order they were added"""
+    sa = bundle_adjuster
+    create_shots(sa, 2)
+    assert sa.add_point("p1", np.array([0, 0, 1]), False) == 0
+    assert sa.add_point("p2", np.array([0, 0, 2]), False) == 1
+    assert sa.add_point("p1", np.array([0, 0, 1]), False) == 0
+
+    assert sa.get_shot_index("1") == 0
+    assert sa.get_shot_index("2") == 1
+    assert sa.get_point_index("p2") == 1
+    assert sa.get_point(1).id == "p2"
+    assert np.allclose(sa.get_point(1).p, [0, 0, 2])
+
+    sa.add_point_projection_observation(1, 0, np.array([0, 0]), 1)
+    with pytest.raises(RuntimeError):
+        sa.get_point_index("p3")
+
+
+def test_constant_observations_reprojection_errors(
+    bundle_adjuster: pybundle.BundleAdjuster,
+) -> None:
+    """Observations whose parameters are all constant get a reprojection error"""
+    sa = bundle_adjuster
+    sa.add_rig_instance(
+        "1",
+        pygeometry.Pose(np.array([0, 0, 0]), np.array([0, 0, 0])),
+        {"1": "cam1"},
+        {"1": "rig_cam1"},
+        True,
+    )
+    sa.add_point("p1", np.array([0.1, 0, 1]), True)
+    sa.add_point_projection_observation("1", "p1", np.array([0, 0]), 1)
+    sa.set_compute_reprojection_errors(True)
+    sa.run()
+
+    errors = sa.get_point_reprojection_errors("p1")
+    assert list(errors.keys()) == ["1"]
+    assert np.allclose(np.linalg.norm(errors["1"]), 0.1)
+
+
 def test_pair(bundle_adjuster: pybundle.BundleAdjuster) -> None:
     """Simple two camera test"""
     sa = bundle_adjuster
@@ -257,6 +397,61 @@ def test_pair_with_points_priors(bundle_adjuster: pybundle.BundleAdjuster) -> No
     assert np.allclose(r12.get_scale("1"), 0.5)
     assert np.allclose(r12.get_scale("2"), 0.5)
 
+    # Running again reuses the projection cost functions of the first run
+    sa.run()
+    assert np.allclose(
+        sa.get_rig_instance_pose("1").translation, s1.translation, atol=1e-6
+    )
+    assert np.allclose(sa.get_point("p1").p, p1.p, atol=1e-6)
+    assert np.allclose(sa.get_point("p2").p, p2.p, atol=1e-6)
+
+
+def test_schur_block_diagonal_covariance(
+    bundle_adjuster: pybundle.BundleAdjuster,
+) -> None:
+    """Block-diagonal covariances match the exact ones of a single free rig"""
+    sa = bundle_adjuster
+    camera = pygeometry.Camera.create_perspective(1.0, 0.0, 0.0)
+    poses = {
+        "1": pygeometry.Pose(np.array([0, 0, 0]), np.array([0, 0, 0])),
+        "2": pygeometry.Pose(np.array([0, 0.1, 0]), np.array([-1, 0, 0])),
+    }
+    for instance_id, pose in poses.items():
+        sa.add_rig_instance(
+            instance_id,
+            pose,
+            {instance_id: "cam1"},
+            {instance_id: "rig_cam1"},
+            instance_id == "1",
+        )
+
+    points = [[0, 0, 4], [1, 1, 5], [-1, 1, 6], [1, -1, 3], [-1, -1, 4], [2, 0, 5]]
+    for i, p in enumerate(points):
+        point_id = str(i)
+        sa.add_point(point_id, np.array(p), False)
+        for instance_id, pose in poses.items():
+            sa.add_point_projection_observation(
+                instance_id,
+                point_id,
+                camera.project(pose.transform(np.array(p))),
+                0.01,
+            )
+
+    sa.set_compute_covariances(True)
+    sa.set_covariance_algorithm_type("DENSE_SVD")
+    sa.run()
+    assert sa.get_covariance_estimation_valid()
+    expected = sa.get_rig_instance_covariance("2")
+
+    sa.set_covariance_algorithm_type("SCHUR_BLOCK_DIAGONAL")
+    sa.set_covariance_shots(["2"])
+    sa.run()
+    assert sa.get_covariance_estimation_valid()
+    assert np.allclose(sa.get_rig_instance_covariance("2"), expected, rtol=1e-4)
+
+    with pytest.raises(RuntimeError):
+        sa.set_covariance_shots(["3"])
+
 
 def test_pair_non_rigid(bundle_adjuster: pybundle.BundleAdjuster) -> None:
     """Simple two rigs test"""
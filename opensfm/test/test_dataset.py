@@ -1,7 +1,7 @@
 # pyre-unsafe
 import numpy as np
 
-from opensfm import features
+from opensfm import features, pymap
 from opensfm.test import data_generation
 
 
@@ -38,3 +38,25 @@ def test_dataset_load_features_sift(tmpdir) -> None:
     )
     # pyre-fixme[6]: For 2nd argument expected `Union[_SupportsArray[dtype[typing.Any...
     assert np.allclose(instances, semantic.instances)
+
+
+def test_dataset_load_read_only_tracks_manager(tmpdir) -> None:
+    data = data_generation.create_berlin_test_folder(tmpdir)
+    data.config["tracks_binary_format"] = True
+
+    tracks_manager = pymap.TracksManager()
+    observation = pymap.Observation(0.1, 0.2, 0.3, 255, 0, 0, 7)
+    tracks_manager.add_observation("image1", "track1", observation)
+    tracks_manager.add_observation("image2", "track1", observation)
+    data.save_tracks_manager(tracks_manager)
+
+    data.config["tracks_flat_backend"] = False
+    loaded = data.load_read_only_tracks_manager()
+    assert isinstance(loaded, pymap.TracksManager)
+
+    data.config["tracks_flat_backend"] = True
+    flat = data.load_read_only_tracks_manager()
+    assert isinstance(flat, pymap.FlatTracksManager)
+    assert sorted(flat.get_shot_ids()) == ["image1", "image2"]
+    assert flat.get_observation("image2", "track1").id == 7
+    assert flat.get_all_pairs_connectivity() == {("image1", "image2"): 1}
@@ -884,6 +884,26 @@ def test_point_reproj_errors_assign() -> None:
         assert np.allclose(pt.reprojection_errors[k], reproj_errors[k])
 
 
+def test_landmarks_reprojection_errors() -> None:
+    # Given some point observed by two shots, with reprojection errors
+    rec = _create_reconstruction(1, {"0": 2}, n_points=1)
+    pt = rec.points["0"]
+    obs = pymap.Observation(100, 200, 0.5, 255, 0, 0, 0)
+    for shot in rec.shots.values():
+        rec.add_observation(shot, pt, obs)
+    pt.reprojection_errors = {"0": np.array([1.0, 2.0]), "1": np.array([3.0, 4.0])}
+
+    # When removing one of the observations
+    rec.remove_observation("0", "0")
+
+    # Its error should be removed too
+    assert list(pt.reprojection_errors.keys()) == ["1"]
+    points, shots, errors = rec.map.get_landmarks_reprojection_errors()
+    assert points == ["0"]
+    assert shots == ["1"]
+    assert np.allclose(errors, [[3.0, 4.0]])
+
+
 def test_point_delete_non_existing() -> None:
     # Given some created points
     n_points = 100
@@ -0,0 +1,39 @@
+# pyre-unsafe
+import numpy as np
+import pytest
+from opensfm import pyfeatures
+
+
+def blob_image(width: int, height: int, num_blobs: int) -> np.ndarray:
+    """Random gaussian blobs on a black background, with values in [0, 1]."""
+    rng = np.random.default_rng(42)
+    xs, ys = np.meshgrid(np.arange(width), np.arange(height))
+    image = np.zeros((height, width), dtype=np.float32)
+    for x, y, sigma in zip(
+        rng.uniform(0, width, num_blobs),
+        rng.uniform(0, height, num_blobs),
+        rng.uniform(1.5, 8.0, num_blobs),
+    ):
+        image += np.exp(-((xs - x) ** 2 + (ys - y) ** 2) / (2 * sigma**2))
+    return (image / image.max()).astype(np.float32)
+
+
+@pytest.mark.parametrize("non_maxima_suppression", [0.0, 1.0])
+def test_hahog_same_for_any_threads_count(non_maxima_suppression: float) -> None:
+    image = blob_image(320, 240, 400)
+
+    points, desc = pyfeatures.hahog(
+        image,
+        non_maxima_suppression=non_maxima_suppression,
+        num_threads=1,
+    )
+    assert len(points) > 50
+
+    for num_threads in [2, 3, 8]:
+        threaded_points, threaded_desc = pyfeatures.hahog(
+            image,
+            non_maxima_suppression=non_maxima_suppression,
+            num_threads=num_threads,
+        )
+        np.testing.assert_array_equal(points, threaded_points)
+        np.testing.assert_array_equal(desc, threaded_desc)
@@ -61,6 +61,56 @@ def test_match_using_words() -> None:
         assert i == j
 
 
+def test_match_using_words_batch() -> None:
+    configuration = config.default_config()
+    nfeatures = 1000
+
+    features, words = example_features(nfeatures, configuration)
+    batch_matches = pyfeatures.match_using_words_batch(
+        features[0],
+        words[0],
+        [features[1], features[0]],
+        [words[1], words[0]],
+        configuration["lowes_ratio"],
+        configuration["bow_num_checks"],
+        symmetric=True,
+        num_threads=2,
+    )
+    assert len(batch_matches) == 2
+    for matches in batch_matches:
+        assert len(matches) == nfeatures
+        for i, j in matches:
+            assert i == j
+
+
+def test_match_batch_arguments() -> None:
+    pairs = [("1", "2"), ("2", "3"), ("1", "3"), ("1", "4")]
+    args = list(matching.match_batch_arguments(pairs, None, {}, {}, {}))
+    assert [(im1, candidates) for im1, candidates, *_ in args] == [
+        ("1", ["2", "3", "4"]),
+        ("2", ["3"]),
+    ]
+
+
+def test_match_hamming() -> None:
+    configuration = config.default_config()
+    nfeatures = 500
+
+    d1 = np.random.randint(0, 256, size=(nfeatures, 61), dtype=np.uint8)
+    d2 = d1[::-1].copy()
+    d2[:, 0] ^= 1
+    expected = [(i, nfeatures - 1 - i) for i in range(nfeatures)]
+    assert matching.match_brute_force(d1, d2, configuration) == expected
+    assert sorted(matching.match_brute_force_symmetric(d1, d2, configuration)) == (
+        expected
+    )
+
+    mask = np.ones((nfeatures, nfeatures), dtype=bool)
+    mask[0, nfeatures - 1] = False
+    matches = matching.match_brute_force(d1, d2, configuration, mask)
+    assert matches == expected[1:]
+
+
 def test_unfilter_matches() -> None:
     matches = np.array([])
     m1 = np.array([], dtype=bool)
@@ -79,6 +129,18 @@ def test_unfilter_matches() -> None:
     assert res[1][1] == 6
 
 
+def test_matches_priors() -> None:
+    matches = np.array([[0, 1], [1, 0]])
+    d1 = np.array([[0.0, 0.0], [1.0, 1.0]], dtype=np.float32)
+    d2 = np.array([[1.0, 0.0], [3.0, 4.0]], dtype=np.float32)
+    assert np.allclose(matching.matches_priors(d1, d2, matches), [-5.0, -1.0])
+
+    # Hamming distances of binary descriptors
+    b1 = np.array([[0b1111, 0], [0, 0]], dtype=np.uint8)
+    b2 = np.array([[0b0001, 0b11], [0b0011, 0]], dtype=np.uint8)
+    assert np.allclose(matching.matches_priors(b1, b2, matches), [-2.0, -3.0])
+
+
 def test_match_images(scene_synthetic) -> None:
     reference = scene_synthetic.reconstruction
     synthetic = synthetic_dataset.SyntheticDataSet(
@@ -6,7 +6,7 @@ from typing import Any, Dict, Generator
 import numpy as np
 import pytest
 
-from opensfm import commands, dataset, feature_loader, geo, pairs_selection
+from opensfm import commands, dataset, feature_loader, geo, pairs_selection, vlad
 from opensfm.dataset_base import DataSetBase
 from opensfm.test import data_generation
 
@@ -133,6 +133,52 @@ def test_match_candidates_from_metadata_graph(lund_path) -> None:
     match_candidates_from_metadata(data)
 
 
+class RetrievalDataSet:
+    config = {"processes": 1}
+
+
+def test_compute_vlad_affinity_same_as_per_image() -> None:
+    reference = geo.TopocentricConverter(0, 0, 0)
+    # Unevenly spaced along the equator, so that GPS neighbors are not
+    # symmetric
+    xs = [0, 1, 2, 10, 11, 30, 31, 32, 33, 34]
+    images = ["{:02d}".format(i) for i in range(len(xs))]
+    exifs = {
+        im: {"gps": {"latitude": 0.0, "longitude": x * 1e-5}, "camera": "c"}
+        for im, x in zip(images, xs)
+    }
+    np.random.seed(42)
+    histograms = {im: np.random.rand(16).astype(np.float32) for im in images}
+    images_ref, images_cand = images[:5], images
+
+    max_neighbors = 3
+    for max_gps_neighbors in [0, 2]:
+        results = pairs_selection.compute_vlad_affinity(
+            RetrievalDataSet(),
+            images_ref,
+            images_cand,
+            exifs,
+            reference,
+            0,
+            max_gps_neighbors,
+            dict(histograms),
+            max_neighbors,
+            False,
+        )
+
+        preempted, _ = pairs_selection.preempt_candidates(
+            images_ref, images_cand, exifs, reference, max_gps_neighbors, 0
+        )
+        assert {im for im, _, _ in results} == set(preempted)
+        for im, distances, others in results:
+            _, expected_distances, expected_others = vlad.vlad_distances(
+                im, preempted[im], histograms
+            )
+            order = np.argsort(expected_distances)[:max_neighbors]
+            assert others == [expected_others[i] for i in order]
+            assert np.allclose(distances, np.array(expected_distances)[order])
+
+
 def test_get_gps_point() -> None:
     reference = geo.TopocentricConverter(0, 0, 0)
     exifs = {}
@@ -69,6 +69,55 @@ def test_outliers_line_ransac() -> None:
     assert np.allclose(len(result.inliers_indices), inliers_count, atol=1)
 
 
+def test_outliers_line_ransac_sprt() -> None:
+    a, b, x, samples = line_data()
+
+    scale = 2.0
+    y = a * x + b + np.random.rand(x.shape[0]) * scale
+
+    ratio_outliers = 0.4
+    outliers_max = 5.0
+    add_outliers(ratio_outliers, x, scale, outliers_max)
+
+    data = np.array([x, y]).transpose()
+
+    params = pyrobust.RobustEstimatorParams()
+    params.iterations = 1000
+    params.use_sprt = True
+    result = pyrobust.ransac_line(data, scale, params, pyrobust.RansacType.RANSAC)
+
+    inliers_count = (1 - ratio_outliers) * samples
+    assert np.allclose(result.score, inliers_count, atol=1)
+    assert np.allclose(len(result.inliers_indices), inliers_count, atol=1)
+    assert result.inliers_indices == sorted(result.inliers_indices)
+
+
+def test_outliers_line_ransac_parallel() -> None:
+    a, b, x, samples = line_data()
+
+    scale = 2.0
+    y = a * x + b + np.random.rand(x.shape[0]) * scale
+
+    ratio_outliers = 0.4
+    outliers_max = 5.0
+    add_outliers(ratio_outliers, x, scale, outliers_max)
+
+    data = np.array([x, y]).transpose()
+
+    params = pyrobust.RobustEstimatorParams()
+    params.iterations = 1000
+    params.num_threads = 4
+    result = pyrobust.ransac_line(data, scale, params, pyrobust.RansacType.RANSAC)
+    result_again = pyrobust.ransac_line(
+        data, scale, params, pyrobust.RansacType.RANSAC
+    )
+
+    inliers_count = (1 - ratio_outliers) * samples
+    assert np.allclose(result.score, inliers_count, atol=1)
+    assert np.allclose(len(result.inliers_indices), inliers_count, atol=1)
+    assert result.inliers_indices == result_again.inliers_indices
+
+
 def test_normal_line_msac() -> None:
     a, b, x, samples = line_data()
 
@@ -265,6 +314,46 @@ def test_outliers_relative_pose_ransac(pairs_and_their_E) -> None:
     assert np.linalg.norm(expected - result.lo_model, ord="fro") < 16e-2
 
 
+def test_outliers_relative_pose_ransac_guided_sampling(pairs_and_their_E) -> None:
+    for f1, f2, _, _ in pairs_and_their_E:
+        points = np.concatenate((f1, f2), axis=1)
+
+        scale = 1e-3
+        points += np.random.rand(*points.shape) * scale
+
+        ratio_outliers = 0.3
+        inliers = points.copy()
+        add_outliers(ratio_outliers, points, 0.1, 1.0)
+        is_outlier = np.any(points != inliers, axis=1)
+
+        f1, f2 = points[:, 0:3], points[:, 3:6]
+        f1 /= np.linalg.norm(f1, axis=1)[:, None]
+        f2 /= np.linalg.norm(f2, axis=1)[:, None]
+
+        # Outliers have lower priors on average
+        priors = np.random.rand(len(points)) + np.where(is_outlier, 0.0, 0.5)
+
+        scale_eps_ratio = 1e-1
+        for sampling in (pyrobust.SamplingType.PROSAC, pyrobust.SamplingType.NAPSAC):
+            params = pyrobust.RobustEstimatorParams()
+            params.iterations = 1000
+            params.sampling = sampling
+            result = pyrobust.ransac_relative_pose(
+                f1,
+                f2,
+                scale * (1.0 + scale_eps_ratio),
+                params,
+                pyrobust.RansacType.RANSAC,
+                priors,
+            )
+
+            tolerance = 0.15
+            inliers_count = (1 - ratio_outliers) * len(points)
+            assert np.isclose(
+                len(result.inliers_indices), inliers_count, rtol=tolerance
+            )
+
+
 def test_outliers_relative_rotation_ransac(pairs_and_their_E) -> None:
     for f1, _, _, _ in pairs_and_their_E:
         vec_x = np.random.rand(3)
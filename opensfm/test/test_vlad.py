@@ -1,7 +1,7 @@
 # pyre-unsafe
 import numpy as np
 import pytest
-from opensfm import vlad
+from opensfm import pyfeatures, vlad
 
 
 def test_vlad_distances_order() -> None:
@@ -46,3 +46,42 @@ def test_unnormalized_vlad() -> None:
     assert res is not None
     assert res[0] == res[1] == res[2] == 0
     assert pytest.approx(res[3], 1e-6) == 0.1
+
+
+def test_unnormalized_vlad_uint8() -> None:
+    features = np.array([[0, 11], [9, 1]], dtype=np.uint8)
+    centers = np.array([[10.0, 0.0], [0.0, 10.0]], dtype=np.float32)
+
+    res = vlad.unnormalized_vlad(features, centers)
+    assert res is not None
+    assert np.allclose(res, [-1, 1, 0, 1])
+
+
+def test_compute_vlad_neighbors() -> None:
+    descriptors = np.array([[0, 0], [1, 0], [3, 0], [0, 2]], dtype=np.float32)
+    references = np.array([0, 2], dtype=np.int32)
+    candidates = np.array([0, 1, 2, 3], dtype=np.int32)
+
+    neighbors, distances = pyfeatures.compute_vlad_neighbors(
+        descriptors, references, candidates, 2
+    )
+    assert neighbors.tolist() == [[1, 3], [1, 0]]
+    assert np.allclose(distances, [[1, 2], [2, 3]])
+
+    # Each reference has its own candidates
+    neighbors, distances = pyfeatures.compute_vlad_neighbors(
+        descriptors,
+        references,
+        np.array([3, 2, 0, 1], dtype=np.int32),
+        2,
+        np.array([0, 2, 4], dtype=np.int32),
+    )
+    assert neighbors.tolist() == [[3, 2], [1, 0]]
+    assert np.allclose(distances, [[2, 3], [2, 3]])
+
+    # Nearest of the same group and nearest of other groups
+    groups = np.array([0, 0, 0, 1], dtype=np.int32)
+    neighbors, distances = pyfeatures.compute_vlad_neighbors(
+        descriptors, references, candidates, 1, groups=groups
+    )
+    assert neighbors.tolist() == [[1, 3], [1, 3]]
@@ -4,10 +4,9 @@ import typing as t
 
 import networkx as nx
 import numpy as np
-from opensfm import pymap
+from opensfm import pymap, pysfm
 from opensfm.dataset_base import DataSetBase
 from opensfm.pymap import TracksManager
-from opensfm.unionfind import UnionFind
 
 
 logger: logging.Logger = logging.getLogger(__name__)
@@ -78,68 +77,27 @@ def create_tracks_manager(
 ) -> TracksManager:
     """Link matches into tracks."""
     logger.debug("Merging features onto tracks")
-    uf = UnionFind()
-    for im1, im2 in matches:
-        for f1, f2 in matches[im1, im2]:
-            uf.union((im1, f1), (im2, f2))
-
-    sets = {}
-    for i in uf:
-        p = uf[i]
-        if p in sets:
-            sets[p].append(i)
-        else:
-            sets[p] = [i]
-
-    tracks = [t for t in sets.values() if _good_track(t, min_length)]
-
-    NO_VALUE = pymap.Observation.NO_SEMANTIC_VALUE
-    tracks_manager = pymap.TracksManager()
-    num_observations = 0
-    num_depth_priors = 0
-    for track_id, track in enumerate(tracks):
-        for image, featureid in track:
-            if image not in features:
-                continue
-            x, y, s = features[image][featureid]
-            r, g, b = colors[image][featureid]
-            segmentation, instance = (
-                segmentations[image][featureid] if image in segmentations else NO_VALUE,
-                instances[image][featureid] if image in instances else NO_VALUE,
-            )
-            obs = pymap.Observation(
-                x,
-                y,
-                s,
-                int(r),
-                int(g),
-                int(b),
-                featureid,
-                # pyre-fixme[6]: For 8th argument expected `int` but got
-                #  `Union[ndarray[typing.Any, typing.Any], int]`.
-                segmentation,
-                # pyre-fixme[6]: For 9th argument expected `int` but got
-                #  `Union[ndarray[typing.Any, typing.Any], int]`.
-                instance,
-            )
-            if image in depths:
-                depth_value = depths[image][featureid]
-                if not np.isnan(depth_value) and not np.isinf(depth_value):
-                    std = max(
-                        depth_std_deviation * depth_value,  # pyre-ignore
-                        depth_std_deviation,
-                    )
-                    obs.depth_prior = pymap.Depth(
-                        value=depth_value,  # pyre-ignore
-                        std_deviation=std,
-                        is_radial=depth_is_radial,
-                    )
-                    num_depth_priors += 1
-            tracks_manager.add_observation(image, str(track_id), obs)
-            num_observations += 1
+    images = sorted(set(features).union(*matches))
+    image_indexes = {image: i for i, image in enumerate(images)}
+    empty = np.empty(0)
+
+    # Images without features, semantics or depths get empty arrays
+    tracks_manager = pysfm.create_tracks_manager(
+        images,
+        [features.get(im, empty) for im in images],
+        [colors.get(im, empty) for im in images],
+        [segmentations.get(im, empty) for im in images],
+        [instances.get(im, empty) for im in images],
+        [depths.get(im, empty) for im in images],
+        [(image_indexes[im1], image_indexes[im2]) for im1, im2 in matches],
+        [np.asarray(m).reshape(-1, 2) for m in matches.values()],
+        min_length,
+        depth_is_radial,
+        depth_std_deviation,
+    )
     logger.info(
-        f"{len(tracks)} tracks, {num_observations} observations,"
-        f" {num_depth_priors} depth priors added to TracksManager"
+        f"{tracks_manager.num_tracks()} tracks over {tracks_manager.num_shots()}"
+        " images added to TracksManager"
     )
     return tracks_manager
 
@@ -227,15 +185,6 @@ def all_common_tracks(
     return common_tracks
 
 
-def _good_track(track: t.List[t.Tuple[str, int]], min_length: int) -> bool:
-    if len(track) < min_length:
-        return False
-    images = [f[0] for f in track]
-    if len(images) != len(set(images)):
-        return False
-    return True
-
-
 def as_weighted_graph(tracks_manager: pymap.TracksManager) -> nx.Graph:
     """Return the tracks manager as a weighted graph
     having shots a snodes and weighted by the # of
@@ -3,23 +3,25 @@ from functools import lru_cache
 from typing import Dict, Iterable, List, Optional, Tuple
 
 import numpy as np
-from opensfm import bow, feature_loader, pyfeatures
+from opensfm import bow, context, feature_loader, pyfeatures
 from opensfm.dataset_base import DataSetBase
 
 
 def unnormalized_vlad(
-    features: np.ndarray, centers: np.ndarray
+    features: np.ndarray, centers: np.ndarray, num_threads: int = 1
 ) -> Optional[np.ndarray]:
     """Compute unnormalized VLAD histograms from a set of
     features in relation to centers.
 
+    uint8 features are used as is against floating point centers.
+
     Returns the unnormalized VLAD vector.
     """
     correct_dims = centers.shape[1] == features.shape[1]
-    correct_type = centers.dtype == features.dtype
+    correct_type = centers.dtype == features.dtype or features.dtype == np.uint8
     if not correct_dims or not correct_type:
         return None
-    return pyfeatures.compute_vlad_descriptor(features, centers)
+    return pyfeatures.compute_vlad_descriptor(features, centers, num_threads)
 
 
 def signed_square_root_normalize(v: np.ndarray) -> np.ndarray:
@@ -69,7 +71,8 @@ class VladCache:
         descriptors = features_data.descriptors
         if descriptors is None:
             return None
-        vlad = unnormalized_vlad(descriptors, words)
+        num_threads = context.threads_per_process(data.config["processes"])
+        vlad = unnormalized_vlad(descriptors, words, num_threads)
         if vlad is None:
             return None
         vlad = signed_square_root_normalize(vlad)